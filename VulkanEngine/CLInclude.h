@@ -8,6 +8,11 @@
 #include <glm/gtx/hash.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
 
 #include "CLShape.h"
 
@@ -21,18 +26,51 @@ namespace cl {
 	bool clIntersect(glm::vec3 &p, clSphere & s);
 	bool clIntersect(glm::vec3 &p, clHalfspace &h);
 	bool clIntersect(glm::vec3 &p, clFrustum &f);
+	bool clIntersect(glm::vec3 &p, clFrustumPlanes &f);
 
 	bool clIntersect(clEdge &e, clSphere & s);
 	bool clIntersect(clEdge &e, clHalfspace &h);
 	bool clIntersect(clEdge &e, clFrustum &f);
+	bool clIntersect(clEdge &e, clFrustumPlanes &f);
 
 	bool clIntersect(clQuad &e, clSphere & s);
 	bool clIntersect(clQuad &e, clHalfspace &h);
 	bool clIntersect(clQuad &e, clFrustum &f);
+	bool clIntersect(clQuad &e, clFrustumPlanes &f);
 
 	bool clIntersect(clSphere &s0, clSphere &s1);
 	bool clIntersect(clSphere &s, clPlane &p);
 	bool clIntersect(clSphere &s, clFrustum &f);
+
+	bool clIntersect(clAABB &b0, clAABB &b1);
+	bool clIntersect(clAABB &b, clSphere &s);
+	bool clIntersect(clAABB &b, clFrustum &f);
+	bool clIntersect(clAABB &b, clFrustumPlanes &f);
+
+	bool clIntersect(clOBB &b0, clOBB &b1);
+	bool clIntersect(clOBB &b, clSphere &s);
+	bool clIntersect(clOBB &b, clFrustum &f);
+	bool clIntersect(clOBB &b, clFrustumPlanes &f);
+
+	bool clIntersect(clRay &r, clAABB &b, float &t);
+	bool clIntersect(clRay &r, clOBB &b, float &t);
+
+	//---------------------------------------------------------------------
+	//Batch intersection tests, bit i of the result mask is set if shape i intersects
+
+	void clGetPlanes(clFrustum &f, clPlane planes[6]);		//planes of a frustum, normals pointing inwards
+
+	void clIntersect(clSphereSoA &s, clPlane *planes, uint32_t numPlanes, std::vector<uint32_t> &mask);
+	void clIntersect(clSphereSoA &s, clFrustum &f, std::vector<uint32_t> &mask);
+	void clIntersect(clAABBSoA &b, clPlane *planes, uint32_t numPlanes, std::vector<uint32_t> &mask);
+	void clIntersect(clAABBSoA &b, clFrustum &f, std::vector<uint32_t> &mask);
+	void clIntersect(clSphere &s, clSphereSoA &spheres, std::vector<uint32_t> &mask);
+	void clIntersect(clSphereSoA &s0, clSphereSoA &s1, std::vector<uint32_t> &mask);
+	void clIntersect(clAABB &b, clAABBSoA &boxes, std::vector<uint32_t> &mask);
+	void clIntersect(clRay &r, float maxT, clAABBSoA &boxes, std::vector<uint32_t> &mask);
+
+	///\returns whether bit i is set in a result mask
+	inline bool clTestMask(std::vector<uint32_t> &mask, uint32_t i) { return (mask[i >> 5] >> (i & 31)) & 1; }
 };
 
 
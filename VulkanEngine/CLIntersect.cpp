@@ -30,11 +30,11 @@ namespace cl {
 		clQuad nq4 = clQuad(q.points[3], q.points[0],
 							q.points[0] + q.plane.normal, q.points[3] + q.plane.normal);
 
-		struct clHalfspace halfspaces[4] = {
-			{ nq1.plane, 1 },
-			{ nq2.plane, 1 },
-			{ nq3.plane, 1 },
-			{ nq4.plane, 1 }
+		struct clHalfspace halfspaces[4] = {		//edge plane normals point away from the quad
+			{ nq1.plane, -1 },
+			{ nq2.plane, -1 },
+			{ nq3.plane, -1 },
+			{ nq4.plane, -1 }
 		};
 
 		return	clIntersect(p, halfspaces[0]) &&
@@ -61,15 +61,16 @@ namespace cl {
 	*
 	* \brief Tests whether a point lies in a halfspace.
 	*
+	* Points on the plane lie in both halfspaces.
+	*
 	* \param[in] p Point in 3D space
 	* \param[in] h Halfspace
 	* \returns whether the point p lies in halfspace h
 	*
 	*/
 	bool clIntersect(glm::vec3 &p, clHalfspace &h) {
-		float ord = glm::dot(p, h.plane.normal);
-		int sign = signbit(ord) ? -1 : 1;
-		return (sign == h.sign);
+		float dist = glm::dot(p, h.plane.normal) - h.plane.d;	//signed distance from the plane
+		return h.sign > 0 ? dist >= 0.0f : dist <= 0.0f;
 	}
 
 	/**
@@ -82,20 +83,24 @@ namespace cl {
 	*
 	*/
 	bool clIntersect(glm::vec3 &p, clFrustum &f) {
-		struct clHalfspace halfspaces[6] = {
-			{ f.quads[0].plane, 1 },
-			{ f.quads[1].plane, 1 },
-			{ f.quads[2].plane, 1 },
-			{ f.quads[3].plane, 1 },
-			{ f.quads[4].plane, 1 },
-			{ f.quads[5].plane, 1 }
-		};
-		return	clIntersect(p, halfspaces[0]) &&
-			clIntersect(p, halfspaces[1]) &&
-			clIntersect(p, halfspaces[2]) &&
-			clIntersect(p, halfspaces[3]) &&
-			clIntersect(p, halfspaces[4]) &&
-			clIntersect(p, halfspaces[5]);
+		clFrustumPlanes fp(f);
+		return clIntersect(p, fp);
+	}
+
+	/**
+	*
+	* \brief Tests whether a point intersects with a frustum given by its planes
+	*
+	* \param[in] p Point in 3D space
+	* \param[in] f Frustum planes
+	* \returns whether the point p lies in frustum f
+	*
+	*/
+	bool clIntersect(glm::vec3 &p, clFrustumPlanes &f) {
+		for (uint32_t i = 0; i < 6; i++) {
+			if (glm::dot(p, f.planes[i].normal) < f.planes[i].d) return false;
+		}
+		return true;
 	}
 
 
@@ -129,26 +134,56 @@ namespace cl {
 
 
 	/**
-	* \brief
+	* \brief Tests whether an edge intersects with a half space
 	*
-	* \param[in]
-	* \param[in]
-	* \returns whether 
+	* The signed distance to the plane is linear along the edge, so the edge intersects
+	* if and only if one of its end points lies in the halfspace.
+	*
+	* \param[in] e Edge (line segment) in 3D space
+	* \param[in] h Halfspace
+	* \returns whether edge e intersects with halfspace h
 	*
 	*/
 	bool clIntersect(clEdge &e, clHalfspace &h) {
-		return true;
+		return clIntersect(e.points[0], h) || clIntersect(e.points[1], h);
 	}
 
 	/**
-	* \brief
+	* \brief Tests whether an edge intersects with a frustum
 	*
-	* \param[in]
-	* \param[in]
-	* \returns whether 
+	* \param[in] e Edge (line segment) in 3D space
+	* \param[in] f Frustum
+	* \returns whether edge e intersects with frustum f
 	*
 	*/
 	bool clIntersect(clEdge &e, clFrustum &f) {
+		clFrustumPlanes fp(f);
+		return clIntersect(e, fp);
+	}
+
+	/**
+	* \brief Tests whether an edge intersects with a frustum given by its planes
+	*
+	* The edge p0 + t(p1 - p0), t in [0,1], is clipped against each plane. The edge intersects
+	* if the remaining parameter interval is not empty.
+	*
+	* \param[in] e Edge (line segment) in 3D space
+	* \param[in] f Frustum planes
+	* \returns whether edge e intersects with frustum f
+	*
+	*/
+	bool clIntersect(clEdge &e, clFrustumPlanes &f) {
+		float t0 = 0.0f, t1 = 1.0f;
+
+		for (uint32_t i = 0; i < 6; i++) {
+			float d0 = glm::dot(e.points[0], f.planes[i].normal) - f.planes[i].d;	//signed distances of the end points
+			float d1 = glm::dot(e.points[1], f.planes[i].normal) - f.planes[i].d;
+
+			if (d0 < 0.0f && d1 < 0.0f) return false;		//edge is completely outside this plane
+			if (d0 < 0.0f) t0 = std::max(t0, d0 / (d0 - d1));	//clip the part before entering
+			else if (d1 < 0.0f) t1 = std::min(t1, d0 / (d0 - d1));	//clip the part after leaving
+			if (t0 > t1) return false;
+		}
 		return true;
 	}
 
@@ -171,10 +206,10 @@ namespace cl {
 			if (clIntersect(q.points[i], s)) return true;
 		}
 
-		if (clIntersect(clEdge(q.points[0], q.points[1]), s)) return true;	//intersection with one of the quad edges?
-		if (clIntersect(clEdge(q.points[1], q.points[2]), s)) return true;
-		if (clIntersect(clEdge(q.points[2], q.points[3]), s)) return true;
-		if (clIntersect(clEdge(q.points[3], q.points[0]), s)) return true;
+		for (uint32_t i = 0; i < 4; i++) {					//intersection with one of the quad edges?
+			clEdge e(q.points[i], q.points[(i + 1) % 4]);
+			if (clIntersect(e, s)) return true;
+		}
 
 		return clIntersect(s.center, q );	//intersection between projected center and quad in plane?
 	}
@@ -194,15 +229,81 @@ namespace cl {
 		return false;
 	}
 
+	///Vertex indices of the 12 frustum edges
+	static const uint32_t clFrustumEdges[12][2] = {
+		{ 0, 1 },{ 1, 2 },{ 2, 3 },{ 3, 0 },			//near
+		{ 4, 5 },{ 5, 6 },{ 6, 7 },{ 7, 4 },			//far
+		{ 0, 4 },{ 1, 5 },{ 2, 6 },{ 3, 7 } };			//sides
+
+	/**
+	* \brief Projects points onto an axis
+	*
+	* \param[in] points Pointer to the points
+	* \param[in] n Number of points
+	* \param[in] axis The axis, does not have to be normalized
+	* \param[out] minv Smallest projection
+	* \param[out] maxv Largest projection
+	*
+	*/
+	static void clProject(glm::vec3 *points, uint32_t n, glm::vec3 &axis, float &minv, float &maxv) {
+		minv = maxv = glm::dot(points[0], axis);
+		for (uint32_t i = 1; i < n; i++) {
+			float ord = glm::dot(points[i], axis);
+			minv = std::min(minv, ord);
+			maxv = std::max(maxv, ord);
+		}
+	}
+
+	/**
+	* \brief Tests whether a quad intersects with a frustum
+	*
+	* \param[in] q Quad given as 4 points
+	* \param[in] f Frustum
+	* \returns whether quad q intersects with frustum f
+	*
+	*/
+	bool clIntersect(clQuad &q, clFrustum &f) {
+		clFrustumPlanes fp(f);
+		return clIntersect(q, fp);
+	}
+
 	/**
-	* \brief
+	* \brief Tests whether a quad intersects with a frustum given by its planes
+	*
+	* Uses the separating axis theorem. Two convex polyhedra do not intersect if and only if there is a
+	* separating axis among the face normals of both, and the cross products of their edge directions.
+	* The frustum planes are tested first, since most quads are rejected by them.
 	*
-	* \param[in]
-	* \param[in]
-	* \returns whether 
+	* \param[in] q Quad given as 4 points
+	* \param[in] f Frustum planes
+	* \returns whether quad q intersects with frustum f
 	*
 	*/
-	bool clIntersect(clQuad &e, clFrustum &f) {
+	bool clIntersect(clQuad &q, clFrustumPlanes &f) {
+		for (uint32_t i = 0; i < 6; i++) {					//all quad vertices outside of a frustum plane?
+			uint32_t j = 0;
+			for (; j < 4 && glm::dot(q.points[j], f.planes[i].normal) < f.planes[i].d; j++);
+			if (j == 4) return false;
+		}
+
+		for (uint32_t i = 0; i < 4; i++) {					//a quad vertex inside the frustum?
+			if (clIntersect(q.points[i], f)) return true;
+		}
+
+		float qmin, qmax, fmin, fmax;
+		clProject(f.vertices, 8, q.plane.normal, fmin, fmax);	//quad plane separates?
+		if (fmax < q.plane.d || fmin > q.plane.d) return false;
+
+		for (uint32_t i = 0; i < 4; i++) {
+			glm::vec3 qe = q.points[(i + 1) % 4] - q.points[i];
+			for (uint32_t j = 0; j < 12; j++) {
+				glm::vec3 axis = glm::cross(qe, f.vertices[clFrustumEdges[j][1]] - f.vertices[clFrustumEdges[j][0]]);
+				if (glm::dot(axis, axis) < 1.0e-12f) continue;		//parallel edges
+				clProject(q.points, 4, axis, qmin, qmax);
+				clProject(f.vertices, 8, axis, fmin, fmax);
+				if (qmax < fmin || fmax < qmin) return false;
+			}
+		}
 		return true;
 	}
 
@@ -257,6 +358,250 @@ namespace cl {
 	}
 
 
-};
 
+	//------------------------------------------------------------------------
+
+	/**
+	* \brief Tests whether two axis aligned boxes intersect
+	*
+	* \param[in] b0 First box
+	* \param[in] b1 Second box
+	* \returns whether the two boxes intersect
+	*
+	*/
+	bool clIntersect(clAABB &b0, clAABB &b1) {
+		glm::vec3 diff = glm::abs(b0.center - b1.center);
+		glm::vec3 sumExt = b0.extent + b1.extent;
+		return diff.x <= sumExt.x && diff.y <= sumExt.y && diff.z <= sumExt.z;
+	}
+
+	/**
+	* \brief Tests whether an axis aligned box intersects with a sphere
+	*
+	* \param[in] b Box
+	* \param[in] s Sphere
+	* \returns whether box b intersects with sphere s
+	*
+	*/
+	bool clIntersect(clAABB &b, clSphere &s) {
+		glm::vec3 diff = glm::max(glm::abs(s.center - b.center) - b.extent, glm::vec3(0.0f));	//from the closest box point to the center
+		return glm::dot(diff, diff) <= s.radius*s.radius;
+	}
+
+	/**
+	* \brief Tests whether an axis aligned box intersects with a frustum
+	*
+	* \param[in] b Box
+	* \param[in] f Frustum
+	* \returns whether box b intersects with frustum f
+	*
+	*/
+	bool clIntersect(clAABB &b, clFrustum &f) {
+		clFrustumPlanes fp(f);
+		return clIntersect(b, fp);
+	}
+
+	/**
+	* \brief Tests whether an axis aligned box intersects with a frustum given by its planes
+	*
+	* \param[in] b Box
+	* \param[in] f Frustum planes
+	* \returns whether box b intersects with frustum f
+	*
+	*/
+	bool clIntersect(clAABB &b, clFrustumPlanes &f) {
+		glm::vec3 axes[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+		clOBB obb(b.center, axes, b.extent);
+		return clIntersect(obb, f);
+	}
+
+
+	//------------------------------------------------------------------------
+
+	/**
+	* \brief Tests whether two oriented boxes intersect
+	*
+	* Uses the separating axis theorem with the 3 axes of each box and the 9 cross products of their axes.
+	* Axes are tested in this order, returning as soon as a separating axis has been found.
+	*
+	* \param[in] b0 First box
+	* \param[in] b1 Second box
+	* \returns whether the two boxes intersect
+	*
+	*/
+	bool clIntersect(clOBB &b0, clOBB &b1) {
+		const float eps = 1.0e-6f;				//avoids wrong results for nearly parallel axes
+		float R[3][3], absR[3][3];
+
+		for (uint32_t i = 0; i < 3; i++) {		//rotation of b1 in the frame of b0
+			for (uint32_t j = 0; j < 3; j++) {
+				R[i][j] = glm::dot(b0.axes[i], b1.axes[j]);
+				absR[i][j] = fabs(R[i][j]) + eps;
+			}
+		}
+
+		glm::vec3 diff = b1.center - b0.center;
+		float t[3] = { glm::dot(diff, b0.axes[0]), glm::dot(diff, b0.axes[1]), glm::dot(diff, b0.axes[2]) };	//in the frame of b0
+
+		for (uint32_t i = 0; i < 3; i++) {		//axes of b0
+			float r1 = b1.extent[0] * absR[i][0] + b1.extent[1] * absR[i][1] + b1.extent[2] * absR[i][2];
+			if (fabs(t[i]) > b0.extent[i] + r1) return false;
+		}
+
+		for (uint32_t j = 0; j < 3; j++) {		//axes of b1
+			float r0 = b0.extent[0] * absR[0][j] + b0.extent[1] * absR[1][j] + b0.extent[2] * absR[2][j];
+			if (fabs(t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j]) > r0 + b1.extent[j]) return false;
+		}
+
+		for (uint32_t i = 0; i < 3; i++) {		//cross products of axis i of b0 and axis j of b1
+			uint32_t i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+			for (uint32_t j = 0; j < 3; j++) {
+				uint32_t j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+				float r0 = b0.extent[i1] * absR[i2][j] + b0.extent[i2] * absR[i1][j];
+				float r1 = b1.extent[j1] * absR[i][j2] + b1.extent[j2] * absR[i][j1];
+				if (fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > r0 + r1) return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	* \brief Tests whether an oriented box intersects with a sphere
+	*
+	* \param[in] b Box
+	* \param[in] s Sphere
+	* \returns whether box b intersects with sphere s
+	*
+	*/
+	bool clIntersect(clOBB &b, clSphere &s) {
+		glm::vec3 diff = s.center - b.center;
+		clAABB local(glm::vec3(0.0f), b.extent);		//the box in its own frame
+		clSphere ls;
+		ls.center = glm::vec3(glm::dot(diff, b.axes[0]), glm::dot(diff, b.axes[1]), glm::dot(diff, b.axes[2]));
+		ls.radius = s.radius;
+		return clIntersect(local, ls);
+	}
+
+	/**
+	* \brief Tests whether an oriented box intersects with a frustum
+	*
+	* \param[in] b Box
+	* \param[in] f Frustum
+	* \returns whether box b intersects with frustum f
+	*
+	*/
+	bool clIntersect(clOBB &b, clFrustum &f) {
+		clFrustumPlanes fp(f);
+		return clIntersect(b, fp);
+	}
+
+	/**
+	* \brief Tests whether an axis separates an oriented box and a frustum
+	*
+	* \param[in] b Box
+	* \param[in] f Frustum planes
+	* \param[in] axis The axis, does not have to be normalized
+	* \returns whether the projections of b and f onto the axis do not overlap
+	*
+	*/
+	static bool clSeparates(clOBB &b, clFrustumPlanes &f, glm::vec3 axis) {
+		float c = glm::dot(b.center, axis);
+		float r =	b.extent.x * fabs(glm::dot(b.axes[0], axis)) +
+					b.extent.y * fabs(glm::dot(b.axes[1], axis)) +
+					b.extent.z * fabs(glm::dot(b.axes[2], axis));
+		float fmin, fmax;
+		clProject(f.vertices, 8, axis, fmin, fmax);
+		return c + r < fmin || c - r > fmax;
+	}
+
+	/**
+	* \brief Tests whether an oriented box intersects with a frustum given by its planes
+	*
+	* First the box is tested against each plane in center/extent form, which rejects most boxes and
+	* accepts those whose center is inside. The remaining boxes are tested with the separating axis theorem,
+	* using the box axes and the cross products of box axes and frustum edges.
+	*
+	* \param[in] b Box
+	* \param[in] f Frustum planes
+	* \returns whether box b intersects with frustum f
+	*
+	*/
+	bool clIntersect(clOBB &b, clFrustumPlanes &f) {
+		bool centerInside = true;
+		for (uint32_t i = 0; i < 6; i++) {
+			glm::vec3 &n = f.planes[i].normal;
+			float dist = glm::dot(b.center, n) - f.planes[i].d;
+			float r =	b.extent.x * fabs(glm::dot(b.axes[0], n)) +
+						b.extent.y * fabs(glm::dot(b.axes[1], n)) +
+						b.extent.z * fabs(glm::dot(b.axes[2], n));
+			if (dist + r < 0.0f) return false;				//box is completely outside this plane
+			if (dist < 0.0f) centerInside = false;
+		}
+		if (centerInside) return true;
+
+		for (uint32_t i = 0; i < 3; i++) {
+			if (clSeparates(b, f, b.axes[i])) return false;
+		}
+
+		for (uint32_t i = 0; i < 3; i++) {
+			for (uint32_t j = 0; j < 12; j++) {
+				glm::vec3 axis = glm::cross(b.axes[i], f.vertices[clFrustumEdges[j][1]] - f.vertices[clFrustumEdges[j][0]]);
+				if (glm::dot(axis, axis) < 1.0e-12f) continue;		//parallel edges
+				if (clSeparates(b, f, axis)) return false;
+			}
+		}
+		return true;
+	}
+
+
+	//------------------------------------------------------------------------
+
+	/**
+	* \brief Tests whether a ray hits an axis aligned box
+	*
+	* Slab test, the ray is clipped against the 3 pairs of planes bounding the box.
+	*
+	* \param[in] r Ray
+	* \param[in] b Box
+	* \param[out] t Ray parameter of the first hit, 0 if the ray starts inside the box
+	* \returns whether ray r hits box b
+	*
+	*/
+	bool clIntersect(clRay &r, clAABB &b, float &t) {
+		float tnear = 0.0f, tfar = std::numeric_limits<float>::max();
+
+		for (uint32_t i = 0; i < 3; i++) {
+			float o = r.origin[i] - b.center[i];
+			if (fabs(r.direction[i]) < 1.0e-20f) {			//ray is parallel to the slab
+				if (fabs(o) > b.extent[i]) return false;
+				continue;
+			}
+			float inv = 1.0f / r.direction[i];
+			float t1 = (-b.extent[i] - o) * inv;
+			float t2 = (b.extent[i] - o) * inv;
+			tnear = std::max(tnear, std::min(t1, t2));
+			tfar = std::min(tfar, std::max(t1, t2));
+			if (tnear > tfar) return false;
+		}
+		t = tnear;
+		return true;
+	}
+
+	/**
+	* \brief Tests whether a ray hits an oriented box
+	*
+	* \param[in] r Ray
+	* \param[in] b Box
+	* \param[out] t Ray parameter of the first hit, 0 if the ray starts inside the box
+	* \returns whether ray r hits box b
+	*
+	*/
+	bool clIntersect(clRay &r, clOBB &b, float &t) {
+		glm::vec3 o = r.origin - b.center;
+		clRay local(	glm::vec3(glm::dot(o, b.axes[0]), glm::dot(o, b.axes[1]), glm::dot(o, b.axes[2])),	//ray in the frame of the box
+						glm::vec3(glm::dot(r.direction, b.axes[0]), glm::dot(r.direction, b.axes[1]), glm::dot(r.direction, b.axes[2])));
+		clAABB lb(glm::vec3(0.0f), b.extent);
+		return clIntersect(local, lb, t);
+	}
 
+}
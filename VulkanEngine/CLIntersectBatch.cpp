@@ -0,0 +1,371 @@
+#include "CLInclude.h"
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define CL_SIMD_WIDTH 8
+	typedef __m256 clFloatV;
+	#define clLoadV(p)		_mm256_loadu_ps(p)
+	#define clSetV(v)		_mm256_set1_ps(v)
+	#define clAddV(a,b)		_mm256_add_ps(a,b)
+	#define clSubV(a,b)		_mm256_sub_ps(a,b)
+	#define clMulV(a,b)		_mm256_mul_ps(a,b)
+	#define clAndV(a,b)		_mm256_and_ps(a,b)
+	#define clMinV(a,b)		_mm256_min_ps(a,b)
+	#define clMaxV(a,b)		_mm256_max_ps(a,b)
+	#define clAbsV(a)		_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a)
+	#define clGEV(a,b)		_mm256_cmp_ps(a,b,_CMP_GE_OQ)
+	#define clLEV(a,b)		_mm256_cmp_ps(a,b,_CMP_LE_OQ)
+	#define clMaskV(a)		((uint32_t)_mm256_movemask_ps(a))
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CL_SIMD_WIDTH 4
+	typedef __m128 clFloatV;
+	#define clLoadV(p)		_mm_loadu_ps(p)
+	#define clSetV(v)		_mm_set1_ps(v)
+	#define clAddV(a,b)		_mm_add_ps(a,b)
+	#define clSubV(a,b)		_mm_sub_ps(a,b)
+	#define clMulV(a,b)		_mm_mul_ps(a,b)
+	#define clAndV(a,b)		_mm_and_ps(a,b)
+	#define clMinV(a,b)		_mm_min_ps(a,b)
+	#define clMaxV(a,b)		_mm_max_ps(a,b)
+	#define clAbsV(a)		_mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+	#define clGEV(a,b)		_mm_cmpge_ps(a,b)
+	#define clLEV(a,b)		_mm_cmple_ps(a,b)
+	#define clMaskV(a)		((uint32_t)_mm_movemask_ps(a))
+#else
+	#define CL_SIMD_WIDTH 1			//no SIMD, only the scalar loops are used
+#endif
+
+
+namespace cl {
+
+	//------------------------------------------------------------------------
+	//Helpers
+
+	/**
+	* \brief Clear a result mask and make it big enough for n shapes
+	*
+	* \param[out] mask The mask, one bit per shape
+	* \param[in] n Number of shapes
+	*
+	*/
+	static void clResetMask(std::vector<uint32_t> &mask, uint32_t n) {
+		mask.assign((n + 31) / 32, 0);
+	}
+
+	/**
+	* \brief Set the result bit of shape i
+	*
+	* \param[in,out] mask The mask, one bit per shape
+	* \param[in] i Index of the shape
+	*
+	*/
+	static inline void clSetBit(std::vector<uint32_t> &mask, uint32_t i) {
+		mask[i >> 5] |= 1u << (i & 31);
+	}
+
+	/**
+	* \brief Get the planes of a frustum with normals pointing inwards
+	*
+	* The quad planes of a frustum are oriented by the order of their points. Planes that do not have
+	* the center of the frustum on their positive side are flipped, see clFrustumPlanes.
+	*
+	* \param[in] f Frustum
+	* \param[out] planes The 6 frustum planes, a point p is inside if dot(normal, p) >= d for all planes
+	*
+	*/
+	void clGetPlanes(clFrustum &f, clPlane planes[6]) {
+		clFrustumPlanes fp(f);
+		for (uint32_t i = 0; i < 6; i++) planes[i] = fp.planes[i];
+	}
+
+
+	//------------------------------------------------------------------------
+
+	/**
+	*
+	* \brief Tests many spheres against a set of planes
+	*
+	* A sphere intersects if it is not completely on the negative side of any plane, i.e. dot(normal, center) - d >= -radius
+	* for all planes. Used with the planes of a frustum, this is the usual conservative frustum culling test.
+	* 4 or 8 spheres are tested at once with SSE or AVX.
+	*
+	* \param[in] s Spheres
+	* \param[in] planes Pointer to the planes
+	* \param[in] numPlanes Number of planes
+	* \param[out] mask Bit i is set if sphere i intersects
+	*
+	*/
+	void clIntersect(clSphereSoA &s, clPlane *planes, uint32_t numPlanes, std::vector<uint32_t> &mask) {
+		uint32_t n = s.size();
+		clResetMask(mask, n);
+		uint32_t i = 0;
+
+#if CL_SIMD_WIDTH > 1
+		for (; i + CL_SIMD_WIDTH <= n; i += CL_SIMD_WIDTH) {
+			clFloatV x = clLoadV(&s.x[i]), y = clLoadV(&s.y[i]), z = clLoadV(&s.z[i]);
+			clFloatV negr = clSubV(clSetV(0.0f), clLoadV(&s.radius[i]));
+			clFloatV inside = clGEV(negr, negr);		//all bits set
+
+			for (uint32_t j = 0; j < numPlanes; j++) {
+				clFloatV dist = clAddV(clAddV(clMulV(x, clSetV(planes[j].normal.x)), clMulV(y, clSetV(planes[j].normal.y))),
+										clMulV(z, clSetV(planes[j].normal.z)));
+				dist = clSubV(dist, clSetV(planes[j].d));
+				inside = clAndV(inside, clGEV(dist, negr));
+				if (clMaskV(inside) == 0) break;			//all spheres are outside
+			}
+			mask[i >> 5] |= clMaskV(inside) << (i & 31);
+		}
+#endif
+
+		for (; i < n; i++) {
+			uint32_t j = 0;
+			for (; j < numPlanes; j++) {
+				float dist = planes[j].normal.x * s.x[i] + planes[j].normal.y * s.y[i] + planes[j].normal.z * s.z[i] - planes[j].d;
+				if (dist < -s.radius[i]) break;
+			}
+			if (j == numPlanes) clSetBit(mask, i);
+		}
+	}
+
+	/**
+	*
+	* \brief Tests many spheres against a frustum
+	*
+	* \param[in] s Spheres
+	* \param[in] f Frustum
+	* \param[out] mask Bit i is set if sphere i intersects the frustum
+	*
+	*/
+	void clIntersect(clSphereSoA &s, clFrustum &f, std::vector<uint32_t> &mask) {
+		clPlane planes[6];
+		clGetPlanes(f, planes);
+		clIntersect(s, planes, 6, mask);
+	}
+
+	/**
+	*
+	* \brief Tests many axis aligned boxes against a set of planes
+	*
+	* A box with center c and extent e intersects if dot(normal, c) - d >= -dot(|normal|, e) for all planes,
+	* i.e. its vertex furthest along the plane normal is on the positive side.
+	*
+	* \param[in] b Boxes in center/extent form
+	* \param[in] planes Pointer to the planes
+	* \param[in] numPlanes Number of planes
+	* \param[out] mask Bit i is set if box i intersects
+	*
+	*/
+	void clIntersect(clAABBSoA &b, clPlane *planes, uint32_t numPlanes, std::vector<uint32_t> &mask) {
+		uint32_t n = b.size();
+		clResetMask(mask, n);
+		uint32_t i = 0;
+
+#if CL_SIMD_WIDTH > 1
+		for (; i + CL_SIMD_WIDTH <= n; i += CL_SIMD_WIDTH) {
+			clFloatV cx = clLoadV(&b.cx[i]), cy = clLoadV(&b.cy[i]), cz = clLoadV(&b.cz[i]);
+			clFloatV ex = clLoadV(&b.ex[i]), ey = clLoadV(&b.ey[i]), ez = clLoadV(&b.ez[i]);
+			clFloatV inside = clGEV(cx, clSetV(-INFINITY));
+
+			for (uint32_t j = 0; j < numPlanes; j++) {
+				glm::vec3 an = glm::abs(planes[j].normal);
+				clFloatV dist = clAddV(clAddV(clMulV(cx, clSetV(planes[j].normal.x)), clMulV(cy, clSetV(planes[j].normal.y))),
+										clMulV(cz, clSetV(planes[j].normal.z)));
+				dist = clSubV(dist, clSetV(planes[j].d));
+				clFloatV radius = clAddV(clAddV(clMulV(ex, clSetV(an.x)), clMulV(ey, clSetV(an.y))), clMulV(ez, clSetV(an.z)));
+				inside = clAndV(inside, clGEV(clAddV(dist, radius), clSetV(0.0f)));
+				if (clMaskV(inside) == 0) break;			//all boxes are outside
+			}
+			mask[i >> 5] |= clMaskV(inside) << (i & 31);
+		}
+#endif
+
+		for (; i < n; i++) {
+			uint32_t j = 0;
+			for (; j < numPlanes; j++) {
+				glm::vec3 an = glm::abs(planes[j].normal);
+				float dist = planes[j].normal.x * b.cx[i] + planes[j].normal.y * b.cy[i] + planes[j].normal.z * b.cz[i] - planes[j].d;
+				float radius = an.x * b.ex[i] + an.y * b.ey[i] + an.z * b.ez[i];
+				if (dist + radius < 0.0f) break;
+			}
+			if (j == numPlanes) clSetBit(mask, i);
+		}
+	}
+
+	/**
+	*
+	* \brief Tests many axis aligned boxes against a frustum
+	*
+	* \param[in] b Boxes in center/extent form
+	* \param[in] f Frustum
+	* \param[out] mask Bit i is set if box i intersects the frustum
+	*
+	*/
+	void clIntersect(clAABBSoA &b, clFrustum &f, std::vector<uint32_t> &mask) {
+		clPlane planes[6];
+		clGetPlanes(f, planes);
+		clIntersect(b, planes, 6, mask);
+	}
+
+
+	//------------------------------------------------------------------------
+
+	/**
+	*
+	* \brief Tests one sphere against many spheres
+	*
+	* \param[in] s The sphere
+	* \param[in] spheres Spheres to test against
+	* \param[out] mask Bit i is set if sphere i intersects with s
+	*
+	*/
+	void clIntersect(clSphere &s, clSphereSoA &spheres, std::vector<uint32_t> &mask) {
+		uint32_t n = spheres.size();
+		clResetMask(mask, n);
+		uint32_t i = 0;
+
+#if CL_SIMD_WIDTH > 1
+		clFloatV sx = clSetV(s.center.x), sy = clSetV(s.center.y), sz = clSetV(s.center.z), sr = clSetV(s.radius);
+		for (; i + CL_SIMD_WIDTH <= n; i += CL_SIMD_WIDTH) {
+			clFloatV dx = clSubV(clLoadV(&spheres.x[i]), sx);
+			clFloatV dy = clSubV(clLoadV(&spheres.y[i]), sy);
+			clFloatV dz = clSubV(clLoadV(&spheres.z[i]), sz);
+			clFloatV sumRad = clAddV(clLoadV(&spheres.radius[i]), sr);
+			clFloatV dist2 = clAddV(clAddV(clMulV(dx, dx), clMulV(dy, dy)), clMulV(dz, dz));
+			mask[i >> 5] |= clMaskV(clLEV(dist2, clMulV(sumRad, sumRad))) << (i & 31);
+		}
+#endif
+
+		for (; i < n; i++) {
+			float dx = spheres.x[i] - s.center.x, dy = spheres.y[i] - s.center.y, dz = spheres.z[i] - s.center.z;
+			float sumRad = spheres.radius[i] + s.radius;
+			if (dx*dx + dy*dy + dz*dz <= sumRad*sumRad) clSetBit(mask, i);
+		}
+	}
+
+	/**
+	*
+	* \brief Tests pairs of spheres, sphere i of the first list against sphere i of the second list
+	*
+	* \param[in] s0 First spheres
+	* \param[in] s1 Second spheres, must have at least as many spheres as s0
+	* \param[out] mask Bit i is set if sphere i of s0 intersects with sphere i of s1
+	*
+	*/
+	void clIntersect(clSphereSoA &s0, clSphereSoA &s1, std::vector<uint32_t> &mask) {
+		uint32_t n = std::min(s0.size(), s1.size());
+		clResetMask(mask, n);
+		uint32_t i = 0;
+
+#if CL_SIMD_WIDTH > 1
+		for (; i + CL_SIMD_WIDTH <= n; i += CL_SIMD_WIDTH) {
+			clFloatV dx = clSubV(clLoadV(&s0.x[i]), clLoadV(&s1.x[i]));
+			clFloatV dy = clSubV(clLoadV(&s0.y[i]), clLoadV(&s1.y[i]));
+			clFloatV dz = clSubV(clLoadV(&s0.z[i]), clLoadV(&s1.z[i]));
+			clFloatV sumRad = clAddV(clLoadV(&s0.radius[i]), clLoadV(&s1.radius[i]));
+			clFloatV dist2 = clAddV(clAddV(clMulV(dx, dx), clMulV(dy, dy)), clMulV(dz, dz));
+			mask[i >> 5] |= clMaskV(clLEV(dist2, clMulV(sumRad, sumRad))) << (i & 31);
+		}
+#endif
+
+		for (; i < n; i++) {
+			float dx = s0.x[i] - s1.x[i], dy = s0.y[i] - s1.y[i], dz = s0.z[i] - s1.z[i];
+			float sumRad = s0.radius[i] + s1.radius[i];
+			if (dx*dx + dy*dy + dz*dz <= sumRad*sumRad) clSetBit(mask, i);
+		}
+	}
+
+
+
+	//------------------------------------------------------------------------
+
+	/**
+	*
+	* \brief Tests one axis aligned box against many axis aligned boxes
+	*
+	* \param[in] b The box
+	* \param[in] boxes Boxes to test against
+	* \param[out] mask Bit i is set if box i intersects with b
+	*
+	*/
+	void clIntersect(clAABB &b, clAABBSoA &boxes, std::vector<uint32_t> &mask) {
+		uint32_t n = boxes.size();
+		clResetMask(mask, n);
+		uint32_t i = 0;
+
+#if CL_SIMD_WIDTH > 1
+		clFloatV bcx = clSetV(b.center.x), bcy = clSetV(b.center.y), bcz = clSetV(b.center.z);
+		clFloatV bex = clSetV(b.extent.x), bey = clSetV(b.extent.y), bez = clSetV(b.extent.z);
+		for (; i + CL_SIMD_WIDTH <= n; i += CL_SIMD_WIDTH) {
+			clFloatV inside = clLEV(clAbsV(clSubV(clLoadV(&boxes.cx[i]), bcx)), clAddV(clLoadV(&boxes.ex[i]), bex));
+			inside = clAndV(inside, clLEV(clAbsV(clSubV(clLoadV(&boxes.cy[i]), bcy)), clAddV(clLoadV(&boxes.ey[i]), bey)));
+			inside = clAndV(inside, clLEV(clAbsV(clSubV(clLoadV(&boxes.cz[i]), bcz)), clAddV(clLoadV(&boxes.ez[i]), bez)));
+			mask[i >> 5] |= clMaskV(inside) << (i & 31);
+		}
+#endif
+
+		for (; i < n; i++) {
+			if (fabs(boxes.cx[i] - b.center.x) <= boxes.ex[i] + b.extent.x &&
+				fabs(boxes.cy[i] - b.center.y) <= boxes.ey[i] + b.extent.y &&
+				fabs(boxes.cz[i] - b.center.z) <= boxes.ez[i] + b.extent.z) clSetBit(mask, i);
+		}
+	}
+
+	/**
+	*
+	* \brief Tests one ray against many axis aligned boxes
+	*
+	* Slab test as in clIntersect(clRay &, clAABB &, float &). Direction components near 0 are replaced
+	* by a tiny value, so that no infinities or NaNs occur.
+	*
+	* \param[in] r The ray
+	* \param[in] maxT Boxes are only hit if the hit parameter is not larger than this
+	* \param[in] boxes Boxes to test against
+	* \param[out] mask Bit i is set if the ray hits box i
+	*
+	*/
+	void clIntersect(clRay &r, float maxT, clAABBSoA &boxes, std::vector<uint32_t> &mask) {
+		uint32_t n = boxes.size();
+		clResetMask(mask, n);
+		glm::vec3 inv;
+		for (uint32_t k = 0; k < 3; k++) {
+			float dir = r.direction[k];
+			if (fabs(dir) < 1.0e-20f) dir = dir < 0.0f ? -1.0e-20f : 1.0e-20f;
+			inv[k] = 1.0f / dir;
+		}
+		uint32_t i = 0;
+
+#if CL_SIMD_WIDTH > 1
+		clFloatV ox = clSetV(r.origin.x), oy = clSetV(r.origin.y), oz = clSetV(r.origin.z);
+		clFloatV ix = clSetV(inv.x), iy = clSetV(inv.y), iz = clSetV(inv.z);
+		for (; i + CL_SIMD_WIDTH <= n; i += CL_SIMD_WIDTH) {
+			clFloatV o = clSubV(ox, clLoadV(&boxes.cx[i])), e = clLoadV(&boxes.ex[i]);
+			clFloatV t1 = clMulV(clSubV(clSubV(clSetV(0.0f), e), o), ix), t2 = clMulV(clSubV(e, o), ix);
+			clFloatV tnear = clMaxV(clSetV(0.0f), clMinV(t1, t2)), tfar = clMinV(clSetV(maxT), clMaxV(t1, t2));
+
+			o = clSubV(oy, clLoadV(&boxes.cy[i])); e = clLoadV(&boxes.ey[i]);
+			t1 = clMulV(clSubV(clSubV(clSetV(0.0f), e), o), iy); t2 = clMulV(clSubV(e, o), iy);
+			tnear = clMaxV(tnear, clMinV(t1, t2)); tfar = clMinV(tfar, clMaxV(t1, t2));
+
+			o = clSubV(oz, clLoadV(&boxes.cz[i])); e = clLoadV(&boxes.ez[i]);
+			t1 = clMulV(clSubV(clSubV(clSetV(0.0f), e), o), iz); t2 = clMulV(clSubV(e, o), iz);
+			tnear = clMaxV(tnear, clMinV(t1, t2)); tfar = clMinV(tfar, clMaxV(t1, t2));
+
+			mask[i >> 5] |= clMaskV(clLEV(tnear, tfar)) << (i & 31);
+		}
+#endif
+
+		for (; i < n; i++) {
+			float o[3] = { r.origin.x - boxes.cx[i], r.origin.y - boxes.cy[i], r.origin.z - boxes.cz[i] };
+			float e[3] = { boxes.ex[i], boxes.ey[i], boxes.ez[i] };
+			float tnear = 0.0f, tfar = maxT;
+			for (uint32_t k = 0; k < 3; k++) {
+				float t1 = (-e[k] - o[k]) * inv[k], t2 = (e[k] - o[k]) * inv[k];
+				tnear = std::max(tnear, std::min(t1, t2));
+				tfar = std::min(tfar, std::max(t1, t2));
+			}
+			if (tnear <= tfar) clSetBit(mask, i);
+		}
+	}
+
+}
@@ -85,6 +85,145 @@ namespace cl {
 		};
 	};
 
+	///A frustum given by 6 planes with normals pointing inwards, and its 8 corner points.
+	///Compute this once per frame, then use it for many intersection tests.
+	struct clFrustumPlanes {
+		struct clPlane planes[6];	///<near, far, left, right, top, bottom; p is inside if dot(normal, p) >= d for all planes
+		glm::vec3 vertices[8];		///<near plane and far plane points, same order as in clFrustum
+
+		///Constructor of struct clFrustumPlanes
+		clFrustumPlanes() {};
+		///Constructor of struct clFrustumPlanes, orients the quad planes of a frustum towards its center
+		clFrustumPlanes(clFrustum &f) {
+			glm::vec3 center(0.0f, 0.0f, 0.0f);
+			for (uint32_t i = 0; i < 8; i++) {
+				vertices[i] = f.vertices[i];
+				center += f.vertices[i];
+			}
+			center /= 8.0f;
+
+			for (uint32_t i = 0; i < 6; i++) {
+				planes[i] = f.quads[i].plane;
+				if (glm::dot(planes[i].normal, center) < planes[i].d) {
+					planes[i].normal = -planes[i].normal;
+					planes[i].d = -planes[i].d;
+				}
+			}
+		};
+		///Constructor of struct clFrustumPlanes, from a Vulkan view projection matrix (clip depth 0 to 1)
+		clFrustumPlanes(glm::mat4 viewProj) {
+			glm::vec4 r0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);	//rows of the matrix
+			glm::vec4 r1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+			glm::vec4 r2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+			glm::vec4 r3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+			glm::vec4 eq[6] = { r2, r3 - r2, r3 + r0, r3 - r0, r3 + r1, r3 - r1 };	//dot(eq, (p,1)) >= 0 inside
+
+			for (uint32_t i = 0; i < 6; i++) {
+				float len = glm::length(glm::vec3(eq[i]));
+				planes[i].normal = glm::vec3(eq[i]) / len;
+				planes[i].d = -eq[i].w / len;
+			}
+
+			glm::mat4 invViewProj = glm::inverse(viewProj);
+			glm::vec2 corners[4] = { { -1.0f, -1.0f },{ 1.0f, -1.0f },{ 1.0f, 1.0f },{ -1.0f, 1.0f } };
+			for (uint32_t i = 0; i < 8; i++) {
+				glm::vec4 p = invViewProj * glm::vec4(corners[i % 4], i < 4 ? 0.0f : 1.0f, 1.0f);
+				vertices[i] = glm::vec3(p) / p.w;
+			}
+		};
+	};
+
+
+	///An axis aligned box given by its center and its half widths along the axes
+	struct clAABB {
+		glm::vec3 center = glm::vec3(0.0f, 0.0f, 0.0f);	///<center of the box
+		glm::vec3 extent = glm::vec3(0.0f, 0.0f, 0.0f);	///<half widths along x, y and z
+
+		///Constructor of struct clAABB
+		clAABB() {};
+		///Constructor of struct clAABB
+		clAABB(glm::vec3 c, glm::vec3 e) : center(c), extent(e) {};
+	};
+
+	///An oriented box given by its center, 3 orthonormal axes and its half widths along these axes
+	struct clOBB {
+		glm::vec3 center = glm::vec3(0.0f, 0.0f, 0.0f);	///<center of the box
+		glm::vec3 axes[3];								///<orthonormal axes of the box
+		glm::vec3 extent = glm::vec3(0.0f, 0.0f, 0.0f);	///<half widths along the axes
+
+		///Constructor of struct clOBB
+		clOBB() {};
+		///Constructor of struct clOBB
+		clOBB(glm::vec3 c, glm::vec3 a[3], glm::vec3 e) : center(c), extent(e) {
+			for (uint32_t i = 0; i < 3; i++) axes[i] = a[i];
+		};
+		///Constructor of struct clOBB, transforms a local space AABB by a matrix made of rotation, scaling and translation
+		clOBB(clAABB &b, glm::mat4 transform) {
+			center = glm::vec3(transform * glm::vec4(b.center, 1.0f));
+			for (uint32_t i = 0; i < 3; i++) {
+				glm::vec3 axis = glm::vec3(transform[i]);
+				float len = glm::length(axis);
+				axes[i] = axis / len;
+				extent[i] = b.extent[i] * len;
+			}
+		};
+	};
+
+	///A ray starting at an origin, going along a direction
+	struct clRay {
+		glm::vec3 origin = glm::vec3(0.0f, 0.0f, 0.0f);		///<start point of the ray
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);	///<direction, distances along the ray are measured in multiples of it
+
+		///Constructor of struct clRay
+		clRay() {};
+		///Constructor of struct clRay
+		clRay(glm::vec3 o, glm::vec3 d) : origin(o), direction(d) {};
+	};
+
+
+	//---------------------------------------------------------------------
+	//Shapes stored as structure of arrays, for testing many shapes at once
+
+	///Many spheres, each coordinate in its own array
+	struct clSphereSoA {
+		std::vector<float> x;			///<x coordinates of the centers
+		std::vector<float> y;			///<y coordinates of the centers
+		std::vector<float> z;			///<z coordinates of the centers
+		std::vector<float> radius;		///<radii
+
+		///Add a sphere
+		void add(const clSphere &s) {
+			x.push_back(s.center.x); y.push_back(s.center.y); z.push_back(s.center.z);
+			radius.push_back(s.radius);
+		}
+		///Remove all spheres
+		void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+		///\returns the number of spheres
+		uint32_t size() const { return (uint32_t)x.size(); }
+	};
+
+	///Many axis aligned boxes in center/extent form, each coordinate in its own array
+	struct clAABBSoA {
+		std::vector<float> cx;			///<x coordinates of the centers
+		std::vector<float> cy;			///<y coordinates of the centers
+		std::vector<float> cz;			///<z coordinates of the centers
+		std::vector<float> ex;			///<half widths along x
+		std::vector<float> ey;			///<half widths along y
+		std::vector<float> ez;			///<half widths along z
+
+		///Add a box given by its center and half widths
+		void add(glm::vec3 center, glm::vec3 extent) {
+			cx.push_back(center.x); cy.push_back(center.y); cz.push_back(center.z);
+			ex.push_back(extent.x); ey.push_back(extent.y); ez.push_back(extent.z);
+		}
+		///Add a box
+		void add(const clAABB &b) { add(b.center, b.extent); }
+		///Remove all boxes
+		void clear() { cx.clear(); cy.clear(); cz.clear(); ex.clear(); ey.clear(); ez.clear(); }
+		///\returns the number of boxes
+		uint32_t size() const { return (uint32_t)cx.size(); }
+	};
+
 };
 
 
@@ -0,0 +1,344 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief Build the BVH over a list of boxes
+	*
+	* Item i of the BVH is box i of the list. Build time and tree quality are stored in the build statistics.
+	* The top levels are split by the calling thread. Large subtrees below them are built on the thread pool
+	* of the engine, each into its own node list, which is appended to the node list afterwards.
+	* Must only be called from the main thread if numThreads is not 1, since it waits for the thread pool.
+	*
+	* \param[in] boxes The boxes of the items
+	* \param[in] numThreads Max number of subtrees built in parallel, 0 for the number of hardware threads
+	*
+	*/
+	void VEBVH::build(std::vector<cl::clAABB> &boxes, uint32_t numThreads) {
+		std::chrono::high_resolution_clock::time_point t_start = vh::vhTimeNow();
+
+		clear();
+		if (boxes.empty()) return;
+
+		m_items.resize(boxes.size());
+		for (uint32_t i = 0; i < boxes.size(); i++) m_items[i] = i;
+
+		if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+		uint32_t parallelDepth = 0;							//subtrees at this depth are built on the thread pool
+		while ((1u << parallelDepth) < numThreads) parallelDepth++;
+
+		std::vector<veSubtree> subtrees;
+		m_nodes.reserve(2 * boxes.size());
+		m_nodes.push_back(veNode());
+		buildNode(m_nodes, 0, boxes, 0, (uint32_t)boxes.size(), 0, parallelDepth, numThreads > 1 ? &subtrees : nullptr);
+
+		std::vector<std::vector<veNode>> subtreeNodes(subtrees.size());		//the root of subtree i is subtreeNodes[i][0]
+		std::vector<std::future<void>> futures;
+		for (uint32_t i = 0; i < subtrees.size(); i++) {
+			futures.push_back(getEnginePointer()->m_threadPool->submit([&, i]() {
+				subtreeNodes[i].push_back(veNode());
+				buildNode(subtreeNodes[i], 0, boxes, subtrees[i].m_first, subtrees[i].m_count, subtrees[i].m_depth, parallelDepth, nullptr);
+			}));
+		}
+		for (auto &future : futures) future.get();
+
+		for (uint32_t i = 0; i < subtrees.size(); i++) {
+			uint32_t offset = (uint32_t)m_nodes.size() - 1;		//subtreeNodes[i][j] becomes m_nodes[offset + j] for j > 0
+			for (uint32_t j = 0; j < subtreeNodes[i].size(); j++) {
+				veNode n = subtreeNodes[i][j];
+				if (n.m_count == 0) n.m_first += offset;
+				if (j == 0) m_nodes[subtrees[i].m_node] = n;
+				else m_nodes.push_back(n);
+			}
+		}
+
+		computeStats();
+		m_stats.m_buildSahCost = m_stats.m_sahCost;
+		m_stats.m_buildTime = std::chrono::duration<double, std::milli>(vh::vhTimeNow() - t_start).count();
+	}
+
+
+	/**
+	*
+	* \brief Update the node boxes after the item boxes changed
+	*
+	* The tree is kept, only the boxes are recomputed bottom up. Since children are always stored after their
+	* parent, this is a single backwards pass over the node list. The tree gets worse if items moved far, which
+	* shows in the SAH cost of the build statistics.
+	*
+	* \param[in] boxes The boxes of the items, in the same order as for build()
+	*
+	*/
+	void VEBVH::refit(std::vector<cl::clAABB> &boxes) {
+		for (uint32_t i = (uint32_t)m_nodes.size(); i-- > 0; ) {
+			veNode &node = m_nodes[i];
+			if (node.m_count > 0) {
+				node.m_min = glm::vec3(std::numeric_limits<float>::max());
+				node.m_max = glm::vec3(-std::numeric_limits<float>::max());
+				for (uint32_t j = node.m_first; j < node.m_first + node.m_count; j++) {
+					cl::clAABB &box = boxes[m_items[j]];
+					node.m_min = glm::min(node.m_min, box.center - box.extent);
+					node.m_max = glm::max(node.m_max, box.center + box.extent);
+				}
+			}
+			else {
+				node.m_min = glm::min(m_nodes[node.m_first].m_min, m_nodes[node.m_first + 1].m_min);
+				node.m_max = glm::max(m_nodes[node.m_first].m_max, m_nodes[node.m_first + 1].m_max);
+			}
+		}
+		computeStats();
+	}
+
+
+	/**
+	*
+	* \brief Remove all nodes and items
+	*
+	*/
+	void VEBVH::clear() {
+		m_nodes.clear();
+		m_items.clear();
+		m_stats = veBuildStats();
+	}
+
+
+	/**
+	*
+	* \brief Compute the box of a node and split it
+	*
+	* For each axis, the item centers are sorted into bins, and the SAH cost of splitting between each pair
+	* of neighboring bins is computed. The node is split at the cheapest position. It becomes a leaf if it has at most
+	* m_maxLeafSize items, or if not splitting is cheaper and it has at most VE_BVH_MAX_SAH_LEAF items.
+	* If all centers fall into the same bin, the items are split in the middle.
+	*
+	* If a list of subtrees is given, children at parallelDepth with at least VE_BVH_PARALLEL_ITEMS items are not
+	* built, but added to this list, so that build() can build them on the thread pool.
+	*
+	* \param[in] nodes The node list to build into
+	* \param[in] node Index of the node
+	* \param[in] boxes The boxes of the items
+	* \param[in] first First entry of the node in the item list
+	* \param[in] count Number of items of the node
+	* \param[in] depth Depth of the node, the root has depth 0
+	* \param[in] parallelDepth Large children at this depth or below are added to the list of subtrees
+	* \param[out] pSubtrees List of subtrees left for the thread pool, or nullptr to build all nodes
+	*
+	*/
+	void VEBVH::buildNode(	std::vector<veNode> &nodes, uint32_t node, std::vector<cl::clAABB> &boxes,
+							uint32_t first, uint32_t count, uint32_t depth, uint32_t parallelDepth,
+							std::vector<veSubtree> *pSubtrees) {
+
+		glm::vec3 bmin(std::numeric_limits<float>::max()), bmax(-std::numeric_limits<float>::max());
+		glm::vec3 cmin = bmin, cmax = bmax;
+		for (uint32_t i = first; i < first + count; i++) {
+			cl::clAABB &box = boxes[m_items[i]];
+			bmin = glm::min(bmin, box.center - box.extent);
+			bmax = glm::max(bmax, box.center + box.extent);
+			cmin = glm::min(cmin, box.center);
+			cmax = glm::max(cmax, box.center);
+		}
+		nodes[node].m_min = bmin;
+		nodes[node].m_max = bmax;
+		nodes[node].m_first = first;
+		nodes[node].m_count = count;
+		if (count <= m_maxLeafSize || depth >= VE_BVH_MAX_DEPTH) return;
+
+		//find the cheapest split
+		struct veBin {
+			glm::vec3 m_min = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 m_max = glm::vec3(-std::numeric_limits<float>::max());
+			uint32_t m_count = 0;
+		};
+
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestAxis = 0, bestSplit = 0;
+		glm::vec3 csize = cmax - cmin;
+
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			if (csize[axis] <= 0.0f) continue;
+			float scale = (float)VE_BVH_NUM_BINS / csize[axis];
+
+			veBin bins[VE_BVH_NUM_BINS];
+			for (uint32_t i = first; i < first + count; i++) {
+				cl::clAABB &box = boxes[m_items[i]];
+				uint32_t b = std::min((uint32_t)((box.center[axis] - cmin[axis]) * scale), VE_BVH_NUM_BINS - 1);
+				bins[b].m_min = glm::min(bins[b].m_min, box.center - box.extent);
+				bins[b].m_max = glm::max(bins[b].m_max, box.center + box.extent);
+				bins[b].m_count++;
+			}
+
+			float rightArea[VE_BVH_NUM_BINS];					//area and count of the bins right of each split
+			uint32_t rightCount[VE_BVH_NUM_BINS];
+			veBin acc;
+			for (uint32_t b = VE_BVH_NUM_BINS - 1; b > 0; b--) {
+				acc.m_min = glm::min(acc.m_min, bins[b].m_min);
+				acc.m_max = glm::max(acc.m_max, bins[b].m_max);
+				acc.m_count += bins[b].m_count;
+				rightArea[b] = getHalfArea(acc.m_min, acc.m_max);
+				rightCount[b] = acc.m_count;
+			}
+
+			acc = veBin();
+			for (uint32_t b = 0; b < VE_BVH_NUM_BINS - 1; b++) {	//split between bin b and b+1
+				acc.m_min = glm::min(acc.m_min, bins[b].m_min);
+				acc.m_max = glm::max(acc.m_max, bins[b].m_max);
+				acc.m_count += bins[b].m_count;
+				if (acc.m_count == 0 || rightCount[b + 1] == 0) continue;
+
+				float cost = getHalfArea(acc.m_min, acc.m_max) * acc.m_count + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		uint32_t mid;
+		if (bestCost == std::numeric_limits<float>::max()) {		//all centers are in the same bin
+			if (count <= VE_BVH_MAX_SAH_LEAF) return;
+			mid = first + count / 2;
+		}
+		else {
+			float parentArea = getHalfArea(bmin, bmax);
+			float splitCost = 1.0f + (parentArea > 0.0f ? bestCost / parentArea : (float)count);	//one node visit plus expected item tests
+			if (splitCost >= (float)count && count <= VE_BVH_MAX_SAH_LEAF) return;
+
+			float scale = (float)VE_BVH_NUM_BINS / csize[bestAxis];
+			float cminAxis = cmin[bestAxis];
+			auto it = std::partition(m_items.begin() + first, m_items.begin() + first + count, [&](uint32_t item) {
+				return std::min((uint32_t)((boxes[item].center[bestAxis] - cminAxis) * scale), VE_BVH_NUM_BINS - 1) < bestSplit; });
+			mid = (uint32_t)(it - m_items.begin());
+		}
+
+		uint32_t left = (uint32_t)nodes.size();
+		nodes.push_back(veNode());
+		nodes.push_back(veNode());
+		nodes[node].m_first = left;
+		nodes[node].m_count = 0;
+
+		uint32_t childFirst[2] = { first, mid };
+		uint32_t childCount[2] = { mid - first, first + count - mid };
+		for (uint32_t i = 0; i < 2; i++) {
+			if (pSubtrees != nullptr && depth + 1 >= parallelDepth && childCount[i] >= VE_BVH_PARALLEL_ITEMS) {
+				pSubtrees->push_back({ left + i, childFirst[i], childCount[i], depth + 1 });
+			}
+			else buildNode(nodes, left + i, boxes, childFirst[i], childCount[i], depth + 1, parallelDepth, pSubtrees);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Compute node counts, depth, leaf size and SAH cost of the BVH
+	*
+	*/
+	void VEBVH::computeStats() {
+		m_stats.m_numItems = (uint32_t)m_items.size();
+		m_stats.m_numNodes = (uint32_t)m_nodes.size();
+		m_stats.m_numLeaves = 0;
+		m_stats.m_maxDepth = 0;
+		m_stats.m_sahCost = 0.0f;
+		if (m_nodes.empty()) return;
+
+		float rootArea = getHalfArea(m_nodes[0].m_min, m_nodes[0].m_max);
+		std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };		//node and depth
+		while (!stack.empty()) {
+			uint32_t node = stack.back().first;
+			uint32_t depth = stack.back().second;
+			stack.pop_back();
+
+			veNode &n = m_nodes[node];
+			float prob = rootArea > 0.0f ? getHalfArea(n.m_min, n.m_max) / rootArea : 1.0f;	//probability that a ray hitting the root hits the node
+			if (n.m_count > 0) {
+				m_stats.m_numLeaves++;
+				m_stats.m_maxDepth = std::max(m_stats.m_maxDepth, depth);
+				m_stats.m_sahCost += prob * n.m_count;
+			}
+			else {
+				m_stats.m_sahCost += prob;
+				stack.push_back({ n.m_first, depth + 1 });
+				stack.push_back({ n.m_first + 1, depth + 1 });
+			}
+		}
+		m_stats.m_avgLeafSize = (float)m_items.size() / (float)m_stats.m_numLeaves;
+	}
+
+
+	/**
+	*
+	* \brief Write the BVH to a binary stream
+	*
+	* \param[in] out The stream
+	*
+	*/
+	void VEBVH::save(std::ostream &out) {
+		uint32_t header[4] = { 0x48564256, 1, (uint32_t)m_nodes.size(), (uint32_t)m_items.size() };	//"VBVH", version
+		out.write((char*)header, sizeof(header));
+		out.write((char*)m_nodes.data(), m_nodes.size() * sizeof(veNode));
+		out.write((char*)m_items.data(), m_items.size() * sizeof(uint32_t));
+	}
+
+
+	/**
+	*
+	* \brief Read the BVH from a binary stream
+	*
+	* \param[in] in The stream
+	* \param[in] numItems The number of items the BVH must have
+	* \returns whether a valid BVH could be read
+	*
+	*/
+	bool VEBVH::load(std::istream &in, uint32_t numItems) {
+		std::chrono::high_resolution_clock::time_point t_start = vh::vhTimeNow();
+		clear();
+
+		uint32_t header[4];
+		if (!in.read((char*)header, sizeof(header))) return false;
+		if (header[0] != 0x48564256 || header[1] != 1 || header[3] != numItems || header[2] > 2 * numItems ||
+			(header[2] == 0 && numItems > 0)) return false;
+
+		m_nodes.resize(header[2]);
+		m_items.resize(header[3]);
+		in.read((char*)m_nodes.data(), m_nodes.size() * sizeof(veNode));
+		in.read((char*)m_items.data(), m_items.size() * sizeof(uint32_t));
+		if (!in) {
+			clear();
+			return false;
+		}
+		std::vector<bool> referenced(m_nodes.size(), false);
+		for (uint32_t i = 0; i < m_nodes.size(); i++) {		//reject files whose nodes point outside the lists or do not form a tree
+			veNode &node = m_nodes[i];
+			bool valid = node.m_count == 0 ?
+				node.m_first > i && (uint64_t)node.m_first + 1 < m_nodes.size() && !referenced[node.m_first] && !referenced[node.m_first + 1] :
+				(uint64_t)node.m_first + node.m_count <= m_items.size();
+			if (!valid) {
+				clear();
+				return false;
+			}
+			if (node.m_count == 0) referenced[node.m_first] = referenced[node.m_first + 1] = true;
+		}
+
+		computeStats();
+		m_stats.m_buildSahCost = m_stats.m_sahCost;
+		if (m_stats.m_maxDepth > VE_BVH_MAX_DEPTH) {		//the traversal stack only holds trees built by this class
+			clear();
+			return false;
+		}
+		m_stats.m_loaded = true;
+		m_stats.m_buildTime = std::chrono::duration<double, std::milli>(vh::vhTimeNow() - t_start).count();
+		return true;
+	}
+
+}
+
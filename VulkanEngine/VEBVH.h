@@ -0,0 +1,185 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_BVH_MAX_DEPTH = 62;			///<Nodes at this depth become leaves, bounds the traversal stack
+const uint32_t VE_BVH_NUM_BINS = 16;			///<Number of bins per axis for evaluating split positions
+const uint32_t VE_BVH_MAX_SAH_LEAF = 16;		///<Nodes with more items are always split
+const uint32_t VE_BVH_PARALLEL_ITEMS = 4096;	///<Subtrees with at least this many items may be built by another thread
+const float VE_BVH_MAX_REFIT_COST = 2.0f;		///<A refitted BVH is rebuilt when its SAH cost grew by this factor
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief A bounding volume hierarchy over a list of axis aligned boxes
+	*
+	* The BVH does not know what the boxes contain. It is used for the triangles of a mesh and for the
+	* entities of a scene. Ray traversal visits the nearer child first and calls a test function for the items
+	* of each leaf that is hit. The test function can shorten the ray, which prunes the rest of the traversal.
+	*
+	* Nodes are split with the surface area heuristic (SAH), evaluated for VE_BVH_NUM_BINS bins along each axis.
+	* The top levels of large trees are split into subtrees that are built on the thread pool of the engine.
+	*
+	*/
+	class VEBVH {
+
+	public:
+
+		///A node of the BVH, 32 bytes
+		struct veNode {
+			glm::vec3	m_min;				///<Minimum corner of the node box
+			uint32_t	m_first;			///<Leaf: first entry in the item list, inner node: index of the left child, the right child follows it
+			glm::vec3	m_max;				///<Maximum corner of the node box
+			uint32_t	m_count;			///<Number of items of a leaf, 0 for inner nodes
+		};
+
+		///Build time and quality of a BVH
+		struct veBuildStats {
+			double		m_buildTime = 0.0;		///<Time for building or loading the BVH (ms)
+			bool		m_loaded = false;		///<The BVH was loaded from a file
+			uint32_t	m_numItems = 0;			///<Number of items
+			uint32_t	m_numNodes = 0;			///<Number of nodes
+			uint32_t	m_numLeaves = 0;		///<Number of leaves
+			uint32_t	m_maxDepth = 0;			///<Depth of the deepest leaf
+			float		m_avgLeafSize = 0.0f;	///<Average number of items per leaf
+			float		m_sahCost = 0.0f;		///<Expected cost of a ray hitting the root, in node visits plus item tests
+			float		m_buildSahCost = 0.0f;	///<SAH cost right after the BVH was built or loaded, refitting increases m_sahCost
+		};
+
+	protected:
+		std::vector<veNode>		m_nodes;				///<All nodes, the root is node 0
+		std::vector<uint32_t>	m_items;				///<Item indices, each leaf references a range of this list
+		veBuildStats			m_stats;				///<Statistics of the last build
+
+		///A subtree left for the thread pool
+		struct veSubtree {
+			uint32_t	m_node;				///<Index of the subtree root in the node list
+			uint32_t	m_first;			///<First entry of the subtree in the item list
+			uint32_t	m_count;			///<Number of items of the subtree
+			uint32_t	m_depth;			///<Depth of the subtree root
+		};
+
+		void buildNode(	std::vector<veNode> &nodes, uint32_t node, std::vector<cl::clAABB> &boxes,
+						uint32_t first, uint32_t count, uint32_t depth, uint32_t parallelDepth,
+						std::vector<veSubtree> *pSubtrees);	//split a node recursively
+		void computeStats();							//compute the quality measures of m_stats
+
+		///\returns half the surface area of a box
+		static float getHalfArea(glm::vec3 bmin, glm::vec3 bmax) {
+			glm::vec3 d = glm::max(bmax - bmin, glm::vec3(0.0f));
+			return d.x * d.y + d.y * d.z + d.z * d.x;
+		};
+
+		///Slab test of a ray against a node box, returns the entry distance in tnear
+		static bool intersectNode(veNode &node, glm::vec3 &origin, glm::vec3 &invDir, float maxT, float &tnear) {
+			glm::vec3 t1 = (node.m_min - origin) * invDir;
+			glm::vec3 t2 = (node.m_max - origin) * invDir;
+			glm::vec3 tmin = glm::min(t1, t2), tmax = glm::max(t1, t2);
+			tnear = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+			float tfar = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxT));
+			return tnear <= tfar;
+		};
+
+	public:
+		uint32_t				m_maxLeafSize = 4;		///<Nodes with at most this many items become leaves
+
+		///Constructor
+		VEBVH() {};
+		///Destructor
+		~VEBVH() {};
+
+		void		build(std::vector<cl::clAABB> &boxes, uint32_t numThreads = 0);	//build the BVH over a list of boxes
+		void		refit(std::vector<cl::clAABB> &boxes);	//update the node boxes after the item boxes changed
+		void		clear();								//remove all nodes
+		void		save(std::ostream &out);				//write the BVH to a binary stream
+		bool		load(std::istream &in, uint32_t numItems);	//read the BVH from a binary stream
+
+		///\returns build time and quality of the BVH
+		veBuildStats & getStats() { return m_stats; };
+
+		///\returns true if the BVH has no nodes
+		bool		empty() { return m_nodes.empty(); };
+		///\returns the node list
+		std::vector<veNode> & getNodes() { return m_nodes; };
+		///\returns the box holding all items
+		cl::clAABB	getBounds() {
+			if (m_nodes.empty()) return cl::clAABB();
+			return cl::clAABB((m_nodes[0].m_min + m_nodes[0].m_max) * 0.5f, (m_nodes[0].m_max - m_nodes[0].m_min) * 0.5f);
+		};
+
+		/**
+		*
+		* \brief Traverse the BVH along a ray
+		*
+		* \param[in] ray The ray, distances are measured in multiples of its direction
+		* \param[in,out] maxT Only boxes closer than this are visited, the test function can decrease it
+		* \param[in] testItem Function bool(uint32_t item, float &maxT) testing an item, returning true if it was hit
+		* \returns whether any item was hit
+		*
+		*/
+		template<typename F> bool traverse(cl::clRay &ray, float &maxT, F testItem) {
+			if (m_nodes.empty()) return false;
+
+			glm::vec3 invDir;
+			for (uint32_t i = 0; i < 3; i++) {		//avoid infinities, which would produce NaNs in the slab test
+				float d = ray.direction[i];
+				if (fabs(d) < 1.0e-20f) d = d < 0.0f ? -1.0e-20f : 1.0e-20f;
+				invDir[i] = 1.0f / d;
+			}
+
+			bool hit = false;
+			float tnear, tnear2;
+			uint32_t stack[VE_BVH_MAX_DEPTH + 2];	//the stack never holds more than depth + 1 nodes
+			float stackT[VE_BVH_MAX_DEPTH + 2];		//entry distances of the nodes on the stack
+			uint32_t top = 0;
+			if (!intersectNode(m_nodes[0], ray.origin, invDir, maxT, tnear)) return false;
+			stack[top] = 0;
+			stackT[top++] = tnear;
+
+			while (top > 0) {
+				--top;
+				if (stackT[top] > maxT) continue;	//a closer hit has been found since the node was pushed
+				veNode &node = m_nodes[stack[top]];
+
+				if (node.m_count > 0) {				//leaf
+					for (uint32_t i = node.m_first; i < node.m_first + node.m_count; i++) {
+						if (testItem(m_items[i], maxT)) hit = true;
+					}
+					continue;
+				}
+
+				uint32_t left = node.m_first, right = node.m_first + 1;
+				bool hitLeft = intersectNode(m_nodes[left], ray.origin, invDir, maxT, tnear);
+				bool hitRight = intersectNode(m_nodes[right], ray.origin, invDir, maxT, tnear2);
+				if (hitLeft && hitRight) {			//push the farther child first, so the nearer one is visited next
+					if (tnear < tnear2) {
+						std::swap(left, right);
+						std::swap(tnear, tnear2);
+					}
+					stack[top] = left;
+					stackT[top++] = tnear;
+					stack[top] = right;
+					stackT[top++] = tnear2;
+				}
+				else if (hitLeft) {
+					stack[top] = left;
+					stackT[top++] = tnear;
+				}
+				else if (hitRight) {
+					stack[top] = right;
+					stackT[top++] = tnear2;
+				}
+			}
+			return hit;
+		};
+	};
+
+}
+
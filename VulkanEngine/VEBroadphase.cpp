@@ -0,0 +1,375 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief Give an entity a proxy in the broadphase
+	*
+	* The proxy is marked as moved, so the next update() finds all its pairs.
+	*
+	* \param[in] pEntity Pointer to the entity
+	*
+	*/
+	void VEBroadphase::addEntity(VEEntity *pEntity) {
+		if (pEntity->m_broadphaseProxy != VE_BROADPHASE_NO_PROXY) return;
+
+		uint32_t proxy;
+		if (m_freeProxies.size() > 0) {
+			proxy = m_freeProxies.back();
+			m_freeProxies.pop_back();
+		}
+		else {
+			proxy = (uint32_t)m_proxies.size();
+			m_proxies.push_back(veProxy());
+		}
+
+		m_proxies[proxy].m_pEntity = pEntity;
+		pEntity->m_broadphaseProxy = proxy;
+		if (m_type == VE_BROADPHASE_SWEEP_AND_PRUNE) m_sorted.push_back(proxy);
+
+		updateEntity(pEntity, pEntity->getWorldTransform());
+		if (!m_proxies[proxy].m_moved) {
+			m_proxies[proxy].m_moved = true;
+			m_moved.push_back(proxy);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Free the proxy of an entity and forget all its pairs
+	*
+	* \param[in] pEntity Pointer to the entity
+	*
+	*/
+	void VEBroadphase::removeEntity(VEEntity *pEntity) {
+		uint32_t proxy = pEntity->m_broadphaseProxy;
+		if (proxy == VE_BROADPHASE_NO_PROXY) return;
+
+		for (auto it = m_pairs.begin(); it != m_pairs.end(); ) {
+			if ((uint32_t)(*it >> 32) == proxy || (uint32_t)(*it & 0xFFFFFFFF) == proxy) it = m_pairs.erase(it);
+			else ++it;
+		}
+
+		if (m_proxies[proxy].m_large) {
+			m_large.erase(std::find(m_large.begin(), m_large.end(), proxy));
+			m_proxies[proxy].m_large = false;
+		}
+		else if (m_type == VE_BROADPHASE_SWEEP_AND_PRUNE) {
+			m_sorted.erase(std::find(m_sorted.begin(), m_sorted.end(), proxy));
+		}
+		else {
+			removeFromCells(proxy);
+		}
+
+		m_proxies[proxy].m_pEntity = nullptr;		//a moved proxy stays in m_moved and is skipped by update()
+		m_freeProxies.push_back(proxy);
+		pEntity->m_broadphaseProxy = VE_BROADPHASE_NO_PROXY;
+	}
+
+
+	/**
+	*
+	* \brief Compute the world space box of an entity
+	*
+	* If the box changed, the proxy is marked as moved.
+	*
+	* \param[in] pEntity Pointer to the entity
+	* \param[in] worldMatrix The current world matrix of the entity
+	*
+	*/
+	void VEBroadphase::updateEntity(VEEntity *pEntity, glm::mat4 worldMatrix) {
+		cl::clAABB box = pEntity->getWorldBoundingBox(worldMatrix);
+
+		veProxy &proxy = m_proxies[pEntity->m_broadphaseProxy];
+		if (box.center == proxy.m_box.center && box.extent == proxy.m_box.extent) return;
+
+		proxy.m_box = box;
+		if (!proxy.m_moved) {
+			proxy.m_moved = true;
+			m_moved.push_back(pEntity->m_broadphaseProxy);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Find all overlapping pairs and call the callbacks
+	*
+	* Pairs containing a moved proxy are tested again and removed if they no longer overlap.
+	* Then all moved proxies are queried for new pairs. The callbacks are called only for pairs that
+	* began or ended, not for pairs that keep overlapping. Pairs of removed entities end silently.
+	*
+	*/
+	void VEBroadphase::update() {
+		for (auto proxy : m_moved) {
+			if (m_proxies[proxy].m_pEntity == nullptr) continue;
+			updateLarge(proxy);
+			if (m_type == VE_BROADPHASE_SPATIAL_HASH && !m_proxies[proxy].m_large) updateCells(proxy);
+		}
+		if (m_type == VE_BROADPHASE_SWEEP_AND_PRUNE) sortProxies();
+
+		m_changedPairs.clear();
+		for (auto it = m_pairs.begin(); it != m_pairs.end(); ) {		//remove pairs that do not overlap any more
+			uint32_t p0 = (uint32_t)(*it >> 32);
+			uint32_t p1 = (uint32_t)(*it & 0xFFFFFFFF);
+			if ((m_proxies[p0].m_moved || m_proxies[p1].m_moved) && !overlaps(p0, p1)) {
+				m_changedPairs.push_back({ m_proxies[p0].m_pEntity, m_proxies[p1].m_pEntity, false });
+				it = m_pairs.erase(it);
+			}
+			else ++it;
+		}
+
+		m_newPairs.clear();
+		for (auto proxy : m_moved) {								//find new pairs
+			if (m_proxies[proxy].m_pEntity != nullptr) queryProxy(proxy);
+		}
+		for (auto proxy : m_moved) m_proxies[proxy].m_moved = false;
+		m_moved.clear();
+
+		m_pairList.clear();
+		for (auto key : m_pairs) {
+			vePair pair;
+			pair.m_pEntity0 = m_proxies[(uint32_t)(key >> 32)].m_pEntity;
+			pair.m_pEntity1 = m_proxies[(uint32_t)(key & 0xFFFFFFFF)].m_pEntity;
+			pair.m_begin = m_newPairs.count(key) > 0;
+			m_pairList.push_back(pair);
+			if (pair.m_begin) m_changedPairs.push_back(pair);
+		}
+
+		for (auto &pair : m_changedPairs) {
+			for (auto &callback : m_callbacks) callback(pair);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Test whether the boxes of two proxies overlap
+	*
+	* \param[in] p0 First proxy
+	* \param[in] p1 Second proxy
+	* \returns whether the boxes overlap
+	*
+	*/
+	bool VEBroadphase::overlaps(uint32_t p0, uint32_t p1) {
+		return cl::clIntersect(m_proxies[p0].m_box, m_proxies[p1].m_box);
+	}
+
+
+	/**
+	*
+	* \brief Test whether a box covers more than VE_BROADPHASE_MAX_CELLS hash cells
+	*
+	* \param[in] box The box
+	* \returns whether the box belongs to a large proxy
+	*
+	*/
+	bool VEBroadphase::isLarge(cl::clAABB &box) {
+		glm::vec3 cells = glm::floor((box.center + box.extent) / m_cellSize) - glm::floor((box.center - box.extent) / m_cellSize) + 1.0f;
+		return cells.x * cells.y * cells.z > (float)VE_BROADPHASE_MAX_CELLS;
+	}
+
+
+	/**
+	*
+	* \brief Move a proxy to or from the list of large proxies, if its box changed its class
+	*
+	* \param[in] proxy The proxy
+	*
+	*/
+	void VEBroadphase::updateLarge(uint32_t proxy) {
+		bool large = isLarge(m_proxies[proxy].m_box);
+		if (large == m_proxies[proxy].m_large) return;
+
+		m_proxies[proxy].m_large = large;
+		if (large) {
+			if (m_type == VE_BROADPHASE_SWEEP_AND_PRUNE) m_sorted.erase(std::find(m_sorted.begin(), m_sorted.end(), proxy));
+			else removeFromCells(proxy);
+			m_large.push_back(proxy);
+		}
+		else {
+			m_large.erase(std::find(m_large.begin(), m_large.end(), proxy));
+			if (m_type == VE_BROADPHASE_SWEEP_AND_PRUNE) m_sorted.push_back(proxy);		//sortProxies() moves it to its place
+		}
+	}
+
+
+	/**
+	*
+	* \brief Sort the proxies along x with insertion sort
+	*
+	* Since objects move only a little from frame to frame, the list is nearly sorted and only few swaps are needed.
+	* Also computes the largest box width, which bounds the search range of queryProxy(). Large proxies are not
+	* in the list, so they do not widen the search range.
+	*
+	*/
+	void VEBroadphase::sortProxies() {
+		m_maxWidth = 0.0f;
+		for (uint32_t i = 0; i < m_sorted.size(); i++) {
+			uint32_t proxy = m_sorted[i];
+			float minX = m_proxies[proxy].m_box.center.x - m_proxies[proxy].m_box.extent.x;
+			m_maxWidth = std::max(m_maxWidth, 2.0f * m_proxies[proxy].m_box.extent.x);
+
+			uint32_t j = i;
+			for (; j > 0; j--) {
+				cl::clAABB &prev = m_proxies[m_sorted[j - 1]].m_box;
+				if (prev.center.x - prev.extent.x <= minX) break;
+				m_sorted[j] = m_sorted[j - 1];
+			}
+			m_sorted[j] = proxy;
+		}
+	}
+
+
+	/**
+	*
+	* \brief Store a proxy in all hash cells its box touches
+	*
+	* Nothing is done if the box still touches the same cells.
+	*
+	* \param[in] proxy The proxy
+	*
+	*/
+	void VEBroadphase::updateCells(uint32_t proxy) {
+		cl::clAABB &box = m_proxies[proxy].m_box;
+		glm::ivec3 cellMin = glm::ivec3(glm::floor((box.center - box.extent) / m_cellSize));
+		glm::ivec3 cellMax = glm::ivec3(glm::floor((box.center + box.extent) / m_cellSize));
+		if (cellMin == m_proxies[proxy].m_cellMin && cellMax == m_proxies[proxy].m_cellMax) return;
+
+		removeFromCells(proxy);
+		for (int32_t x = cellMin.x; x <= cellMax.x; x++) {
+			for (int32_t y = cellMin.y; y <= cellMax.y; y++) {
+				for (int32_t z = cellMin.z; z <= cellMax.z; z++) {
+					m_cells[getCellKey(x, y, z)].push_back(proxy);
+				}
+			}
+		}
+		m_proxies[proxy].m_cellMin = cellMin;
+		m_proxies[proxy].m_cellMax = cellMax;
+	}
+
+
+	/**
+	*
+	* \brief Remove a proxy from all hash cells it is stored in
+	*
+	* \param[in] proxy The proxy
+	*
+	*/
+	void VEBroadphase::removeFromCells(uint32_t proxy) {
+		glm::ivec3 cellMin = m_proxies[proxy].m_cellMin;
+		glm::ivec3 cellMax = m_proxies[proxy].m_cellMax;
+
+		for (int32_t x = cellMin.x; x <= cellMax.x; x++) {
+			for (int32_t y = cellMin.y; y <= cellMax.y; y++) {
+				for (int32_t z = cellMin.z; z <= cellMax.z; z++) {
+					auto cell = m_cells.find(getCellKey(x, y, z));
+					if (cell == m_cells.end()) continue;
+
+					std::vector<uint32_t> &proxies = cell->second;
+					auto it = std::find(proxies.begin(), proxies.end(), proxy);
+					if (it != proxies.end()) {
+						*it = proxies.back();
+						proxies.pop_back();
+					}
+					if (proxies.empty()) m_cells.erase(cell);
+				}
+			}
+		}
+		m_proxies[proxy].m_cellMin = glm::ivec3(1);		//empty range
+		m_proxies[proxy].m_cellMax = glm::ivec3(0);
+	}
+
+
+	/**
+	*
+	* \brief Add a proxy to the candidates of the current query
+	*
+	* \param[in] proxy The candidate proxy
+	*
+	*/
+	void VEBroadphase::addCandidate(uint32_t proxy) {
+		m_candidates.push_back(proxy);
+		m_candidateBoxes.add(m_proxies[proxy].m_box);
+	}
+
+
+	/**
+	*
+	* \brief Find all proxies overlapping with a moved proxy and add the pairs
+	*
+	* The large proxies are always tested. A large proxy is tested against all other proxies, since its box
+	* would cover most of the sorted list or too many hash cells. The candidates are gathered first and then
+	* tested against the box of the proxy in one SIMD batch.
+	*
+	* \param[in] proxy The moved proxy
+	*
+	*/
+	void VEBroadphase::queryProxy(uint32_t proxy) {
+		cl::clAABB &box = m_proxies[proxy].m_box;
+		m_stamp++;
+		m_proxies[proxy].m_stamp = m_stamp;
+
+		m_candidates.clear();
+		m_candidateBoxes.clear();
+
+		for (auto other : m_large) {
+			if (other != proxy) addCandidate(other);
+		}
+		if (m_proxies[proxy].m_large) {
+			for (uint32_t other = 0; other < m_proxies.size(); other++) {
+				if (m_proxies[other].m_pEntity != nullptr && !m_proxies[other].m_large) addCandidate(other);
+			}
+		}
+		else if (m_type == VE_BROADPHASE_SWEEP_AND_PRUNE) {
+			float lo = box.center.x - box.extent.x - m_maxWidth;	//no box starting before this can reach the proxy
+			float hi = box.center.x + box.extent.x;
+
+			auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), lo, [&](uint32_t p, float x) {
+				return m_proxies[p].m_box.center.x - m_proxies[p].m_box.extent.x < x; });
+
+			for (; it != m_sorted.end(); ++it) {
+				cl::clAABB &other = m_proxies[*it].m_box;
+				if (other.center.x - other.extent.x > hi) break;
+				if (*it != proxy) addCandidate(*it);
+			}
+		}
+		else {
+			glm::ivec3 cellMin = m_proxies[proxy].m_cellMin;
+			glm::ivec3 cellMax = m_proxies[proxy].m_cellMax;
+			for (int32_t x = cellMin.x; x <= cellMax.x; x++) {
+				for (int32_t y = cellMin.y; y <= cellMax.y; y++) {
+					for (int32_t z = cellMin.z; z <= cellMax.z; z++) {
+						auto cell = m_cells.find(getCellKey(x, y, z));
+						if (cell == m_cells.end()) continue;
+
+						for (auto other : cell->second) {
+							if (m_proxies[other].m_stamp == m_stamp) continue;		//already added from another cell
+							m_proxies[other].m_stamp = m_stamp;
+							addCandidate(other);
+						}
+					}
+				}
+			}
+		}
+
+		cl::clIntersect(box, m_candidateBoxes, m_candidateMask);
+		for (uint32_t i = 0; i < m_candidates.size(); i++) {
+			if (!cl::clTestMask(m_candidateMask, i)) continue;
+			uint64_t key = getPairKey(proxy, m_candidates[i]);
+			if (m_pairs.insert(key).second) m_newPairs.insert(key);
+		}
+	}
+
+}
@@ -0,0 +1,134 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_BROADPHASE_NO_PROXY = 0xFFFFFFFF;		///<Entity is not managed by the broadphase
+const uint32_t VE_BROADPHASE_MAX_CELLS = 64;			///<Proxies covering more hash cells are large proxies
+
+
+namespace ve {
+
+	class VEEntity;
+
+	/**
+	*
+	* \brief Finds all pairs of entities whose world space bounding boxes overlap
+	*
+	* Each registered entity has a proxy holding its world space AABB, computed from the local box of its mesh.
+	* The box is updated whenever the entity UBO is updated, and the proxy is marked as moved if the box changed.
+	* Overlapping pairs are kept from frame to frame. In update(), only pairs containing a moved proxy are tested again,
+	* and only moved proxies are queried for new pairs, so the cost scales with the number of moving entities
+	* and the number of pairs. Two methods are available for finding the candidates of a moved proxy:
+	*- Sweep and prune: proxies are kept sorted along x with insertion sort, which is nearly linear if motion is coherent.
+	*  Works best if objects have very different sizes.
+	*- Spatial hash: proxies are stored in all grid cells they touch. Works best for uniformly dense scenes
+	*  of similarly sized objects, the cell size should be a little larger than a typical object.
+	*
+	* The candidates of a query are gathered as structure of arrays and tested against the proxy with the SIMD
+	* batch test of the cl library.
+	*
+	* Proxies whose boxes would cover more than VE_BROADPHASE_MAX_CELLS hash cells, like a ground plane, are large proxies.
+	* They are kept in a separate list with both methods, so they neither widen the search range of sweep and prune
+	* nor fill the hash map. Each query tests the few large proxies directly, and a moved large proxy is tested against all proxies.
+	*
+	* Pairs that began or ended to overlap in an update are handed to all registered callbacks. The scene manager
+	* also sends them as VE_EVENT_COLLISION events.
+	*
+	*/
+	class VEBroadphase {
+
+	public:
+
+		///Method used for finding candidate pairs
+		enum veBroadphaseType {
+			VE_BROADPHASE_SWEEP_AND_PRUNE,		///<Incremental sweep and prune along the x axis
+			VE_BROADPHASE_SPATIAL_HASH			///<Uniform grid stored in a hash map
+		};
+
+		///Two entities whose bounding boxes overlap
+		struct vePair {
+			VEEntity *	m_pEntity0;				///<First entity
+			VEEntity *	m_pEntity1;				///<Second entity
+			bool		m_begin;				///<true if the boxes began to overlap in the last update, false if they stopped
+		};
+
+		typedef std::function<void(vePair &)> vePairCallback;	///<Called for each pair that began or ended
+
+	protected:
+
+		///An entity and its bounds
+		struct veProxy {
+			VEEntity *	m_pEntity = nullptr;					///<Entity, or nullptr if the proxy is free
+			cl::clAABB	m_box;									///<World space bounding box
+			bool		m_moved = false;						///<Box changed since the last update
+			bool		m_large = false;						///<Proxy is in the list of large proxies
+			glm::ivec3	m_cellMin = glm::ivec3(1);				///<First hash cell covered by the box
+			glm::ivec3	m_cellMax = glm::ivec3(0);				///<Last hash cell covered by the box, empty if smaller than m_cellMin
+			uint32_t	m_stamp = 0;							///<Last query that visited this proxy
+		};
+
+		veBroadphaseType				m_type;					///<Method for finding candidates
+		float							m_cellSize;				///<Edge length of the hash cells
+		std::vector<veProxy>			m_proxies;				///<All proxies
+		std::vector<uint32_t>			m_freeProxies;			///<Proxies that can be reused
+		std::vector<uint32_t>			m_moved;				///<Proxies moved since the last update
+		std::vector<uint32_t>			m_sorted;				///<Sweep and prune: proxies sorted by minimum x
+		float							m_maxWidth = 0.0f;		///<Sweep and prune: largest box width along x, without large proxies
+		std::vector<uint32_t>			m_large;				///<Large proxies, neither sorted nor in hash cells
+		std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;	///<Spatial hash: proxies in each cell
+		std::unordered_set<uint64_t>	m_pairs;				///<Overlapping pairs of proxies, smaller index in the upper 32 bits
+		std::unordered_set<uint64_t>	m_newPairs;				///<Pairs found in the last update
+		std::vector<vePair>				m_pairList;				///<Result of the last update
+		std::vector<vePair>				m_changedPairs;			///<Pairs that began or ended in the last update
+		std::vector<vePairCallback>		m_callbacks;			///<Called for each changed pair after an update
+		std::vector<uint32_t>			m_candidates;			///<Candidates of the current query
+		cl::clAABBSoA					m_candidateBoxes;		///<Boxes of the candidates, tested in one batch
+		std::vector<uint32_t>			m_candidateMask;		///<Result of the batch test
+		uint32_t						m_stamp = 0;			///<Counts queries
+
+		bool		overlaps(uint32_t p0, uint32_t p1);			//do the boxes of two proxies overlap
+		bool		isLarge(cl::clAABB &box);					//does a box cover too many hash cells
+		void		updateLarge(uint32_t proxy);				//move a proxy to or from the large proxies
+		void		sortProxies();								//insertion sort along x
+		void		updateCells(uint32_t proxy);				//move a proxy to the cells of its box
+		void		removeFromCells(uint32_t proxy);			//remove a proxy from all its cells
+		void		queryProxy(uint32_t proxy);					//find new pairs of a moved proxy
+		void		addCandidate(uint32_t proxy);				//add a proxy to the candidates of the current query
+
+		///\returns a key for a hash cell
+		static uint64_t	getCellKey(int32_t x, int32_t y, int32_t z) {
+			return ((uint64_t)(x & 0x1FFFFF) << 42) | ((uint64_t)(y & 0x1FFFFF) << 21) | (uint64_t)(z & 0x1FFFFF);
+		};
+		///\returns a key for a pair of proxies, independent of their order
+		static uint64_t	getPairKey(uint32_t p0, uint32_t p1) {
+			return p0 < p1 ? ((uint64_t)p0 << 32) | p1 : ((uint64_t)p1 << 32) | p0;
+		};
+
+	public:
+		///Constructor
+		VEBroadphase(veBroadphaseType type = VE_BROADPHASE_SWEEP_AND_PRUNE, float cellSize = 10.0f) : m_type(type), m_cellSize(cellSize) {};
+		///Destructor
+		~VEBroadphase() {};
+
+		void		addEntity(VEEntity *pEntity);			//give an entity a proxy
+		void		removeEntity(VEEntity *pEntity);		//free the proxy of an entity
+		void		updateEntity(VEEntity *pEntity, glm::mat4 worldMatrix);	//compute the world space box of an entity
+		void		update();								//find the overlapping pairs and call the callbacks
+
+		///Add a function that is called for each pair that began or ended to overlap in an update
+		void		addCallback(vePairCallback callback) { m_callbacks.push_back(callback); };
+		///\returns the overlapping pairs found in the last update, m_begin is set for new pairs
+		std::vector<vePair> & getPairs() { return m_pairList; };
+		///\returns the pairs that began or ended to overlap in the last update
+		std::vector<vePair> & getChangedPairs() { return m_changedPairs; };
+		///\returns the method used for finding candidates
+		veBroadphaseType getType() { return m_type; };
+	};
+
+}
+
@@ -0,0 +1,423 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief Constructor, registers the built in components
+	*
+	*/
+	VEECS::VEECS() {
+		m_componentSizes.resize(VE_COMPONENT_FIRST_CUSTOM);
+		m_componentSizes[VE_COMPONENT_TRANSFORM] = sizeof(veTransformComponent);
+		m_componentSizes[VE_COMPONENT_WORLD] = sizeof(veWorldComponent);
+		m_componentSizes[VE_COMPONENT_BOUNDS] = sizeof(veBoundsComponent);
+		m_componentSizes[VE_COMPONENT_RENDER] = sizeof(veRenderComponent);
+		m_componentSizes[VE_COMPONENT_LIGHT] = sizeof(veLightComponent);
+		m_componentSizes[VE_COMPONENT_NODE] = sizeof(veNodeComponent);
+	}
+
+
+	/**
+	*
+	* \brief Destructor, frees all chunks
+	*
+	*/
+	VEECS::~VEECS() {
+		for (auto pArchetype : m_archetypes) {
+			for (auto pChunk : pArchetype->m_chunks) delete[] pChunk;
+			delete pArchetype;
+		}
+	}
+
+
+	/**
+	*
+	* \brief Add a custom component type
+	*
+	* \param[in] size Size of the component in bytes
+	* \returns the id of the component type, its mask bit is 1 << id
+	*
+	*/
+	uint32_t VEECS::registerComponent(uint32_t size) {
+		if (m_componentSizes.size() >= VE_ECS_MAX_COMPONENTS) {
+			throw std::runtime_error("Error: too many ECS component types!");
+		}
+		m_componentSizes.push_back(size);
+		return (uint32_t)m_componentSizes.size() - 1;
+	}
+
+
+	/**
+	*
+	* \brief Find the archetype of a component mask, create it if it does not exist
+	*
+	* Component arrays are aligned to 16 bytes. The number of entities per chunk is chosen so that all arrays
+	* fit into VE_ECS_CHUNK_SIZE bytes, chunks are larger only if not even one entity would fit.
+	*
+	* \param[in] mask The component mask
+	* \returns the index of the archetype
+	*
+	*/
+	uint32_t VEECS::getArchetype(veComponentMask mask) {
+		auto it = m_archetypeMap.find(mask);
+		if (it != m_archetypeMap.end()) return it->second;
+
+		uint32_t numComponents = 0;
+		uint32_t rowSize = sizeof(veEntityHandle);
+		for (uint32_t c = 0; c < m_componentSizes.size(); c++) {
+			if (mask & (1u << c)) {
+				rowSize += m_componentSizes[c];
+				numComponents++;
+			}
+		}
+
+		veArchetype *pArchetype = new veArchetype();
+		pArchetype->m_mask = mask;
+		uint32_t padding = 16 * (numComponents + 1);			//worst case for aligning each array
+		pArchetype->m_capacity = std::max(1u, (VE_ECS_CHUNK_SIZE - std::min(padding, VE_ECS_CHUNK_SIZE)) / rowSize);
+
+		uint32_t offset = pArchetype->m_capacity * sizeof(veEntityHandle);
+		for (uint32_t c = 0; c < VE_ECS_MAX_COMPONENTS; c++) {
+			pArchetype->m_offsets[c] = 0;
+			if (c >= m_componentSizes.size() || (mask & (1u << c)) == 0) continue;
+			offset = (offset + 15) & ~15u;
+			pArchetype->m_offsets[c] = offset;
+			offset += pArchetype->m_capacity * m_componentSizes[c];
+		}
+		pArchetype->m_chunkSize = std::max(offset, VE_ECS_CHUNK_SIZE);
+
+		m_archetypes.push_back(pArchetype);
+		m_archetypeMap[mask] = (uint32_t)m_archetypes.size() - 1;
+		return (uint32_t)m_archetypes.size() - 1;
+	}
+
+
+	/**
+	*
+	* \brief Append an entity to an archetype
+	*
+	* The components are zeroed, transforms are set to identity, render components get no culling slot.
+	*
+	* \param[in] archetype The archetype
+	* \param[in] handle Handle of the entity
+	* \returns the row of the entity in the archetype
+	*
+	*/
+	uint32_t VEECS::allocateRow(uint32_t archetype, veEntityHandle handle) {
+		veArchetype *pArchetype = m_archetypes[archetype];
+		uint32_t row = pArchetype->m_numEntities++;
+		if (row / pArchetype->m_capacity >= pArchetype->m_chunks.size()) {
+			pArchetype->m_chunks.push_back(new uint8_t[pArchetype->m_chunkSize]);
+		}
+
+		((veEntityHandle*)pArchetype->m_chunks[row / pArchetype->m_capacity])[row % pArchetype->m_capacity] = handle;
+		for (uint32_t c = 0; c < m_componentSizes.size(); c++) {
+			if ((pArchetype->m_mask & (1u << c)) == 0) continue;
+			uint8_t *pComponent = getComponentPtr(pArchetype, row, c);
+			memset(pComponent, 0, m_componentSizes[c]);
+			if (c == VE_COMPONENT_TRANSFORM || c == VE_COMPONENT_WORLD) *(glm::mat4*)pComponent = glm::mat4(1.0f);
+			if (c == VE_COMPONENT_RENDER) ((veRenderComponent*)pComponent)->m_cullSlot = VE_CULL_NO_SLOT;
+		}
+		return row;
+	}
+
+
+	/**
+	*
+	* \brief Remove an entity from an archetype
+	*
+	* The last entity of the archetype is moved into the gap, so the entities stay packed.
+	* Empty chunks are freed, except one spare chunk.
+	*
+	* \param[in] archetype The archetype
+	* \param[in] row The row of the entity
+	*
+	*/
+	void VEECS::freeRow(uint32_t archetype, uint32_t row) {
+		veArchetype *pArchetype = m_archetypes[archetype];
+		uint32_t last = --pArchetype->m_numEntities;
+
+		if (row != last) {
+			veEntityHandle *pLastHandle = &((veEntityHandle*)pArchetype->m_chunks[last / pArchetype->m_capacity])[last % pArchetype->m_capacity];
+			((veEntityHandle*)pArchetype->m_chunks[row / pArchetype->m_capacity])[row % pArchetype->m_capacity] = *pLastHandle;
+			for (uint32_t c = 0; c < m_componentSizes.size(); c++) {
+				if ((pArchetype->m_mask & (1u << c)) == 0) continue;
+				memcpy(getComponentPtr(pArchetype, row, c), getComponentPtr(pArchetype, last, c), m_componentSizes[c]);
+			}
+			m_records[pLastHandle->m_index].m_row = row;
+		}
+
+		uint32_t usedChunks = (pArchetype->m_numEntities + pArchetype->m_capacity - 1) / pArchetype->m_capacity;
+		while (pArchetype->m_chunks.size() > usedChunks + 1) {
+			delete[] pArchetype->m_chunks.back();
+			pArchetype->m_chunks.pop_back();
+		}
+	}
+
+
+	/**
+	*
+	* \brief Move an entity to the archetype of a new component mask
+	*
+	* Components in both archetypes are copied, new components get default values.
+	*
+	* \param[in] handle The entity
+	* \param[in] mask The new component mask
+	*
+	*/
+	void VEECS::moveEntity(veEntityHandle handle, veComponentMask mask) {
+		veRecord record = m_records[handle.m_index];
+		veArchetype *pSource = m_archetypes[record.m_archetype];
+		if (pSource->m_mask == mask) return;
+
+		uint32_t archetype = getArchetype(mask);
+		veArchetype *pDest = m_archetypes[archetype];
+		uint32_t row = allocateRow(archetype, handle);
+		for (uint32_t c = 0; c < m_componentSizes.size(); c++) {
+			if ((pSource->m_mask & pDest->m_mask & (1u << c)) == 0) continue;
+			memcpy(getComponentPtr(pDest, row, c), getComponentPtr(pSource, record.m_row, c), m_componentSizes[c]);
+		}
+		freeRow(record.m_archetype, record.m_row);
+
+		m_records[handle.m_index].m_archetype = archetype;
+		m_records[handle.m_index].m_row = row;
+	}
+
+
+	/**
+	*
+	* \brief Create an entity
+	*
+	* \param[in] mask The components of the entity
+	* \returns the handle of the entity
+	*
+	*/
+	veEntityHandle VEECS::createEntity(veComponentMask mask) {
+		veEntityHandle handle;
+		if (m_freeRecords.size() > 0) {
+			handle.m_index = m_freeRecords.back();
+			m_freeRecords.pop_back();
+		}
+		else {
+			handle.m_index = (uint32_t)m_records.size();
+			m_records.push_back(veRecord());
+		}
+		handle.m_generation = m_records[handle.m_index].m_generation;
+
+		uint32_t archetype = getArchetype(mask);
+		veRecord &record = m_records[handle.m_index];
+		record.m_archetype = archetype;
+		record.m_row = allocateRow(archetype, handle);
+		record.m_alive = true;
+		m_numEntities++;
+		return handle;
+	}
+
+
+	/**
+	*
+	* \brief Destroy an entity, its handle becomes invalid
+	*
+	* \param[in] handle The entity
+	*
+	*/
+	void VEECS::destroyEntity(veEntityHandle handle) {
+		if (!isAlive(handle)) return;
+
+		veRecord &record = m_records[handle.m_index];
+		freeRow(record.m_archetype, record.m_row);
+		record.m_alive = false;
+		record.m_generation++;
+		m_freeRecords.push_back(handle.m_index);
+		m_numEntities--;
+	}
+
+
+	/**
+	*
+	* \brief Add components with default values to an entity
+	*
+	* \param[in] handle The entity
+	* \param[in] mask The components to add, components the entity already has are not changed
+	*
+	*/
+	void VEECS::addComponents(veEntityHandle handle, veComponentMask mask) {
+		if (!isAlive(handle)) return;
+		moveEntity(handle, m_archetypes[m_records[handle.m_index].m_archetype]->m_mask | mask);
+	}
+
+
+	/**
+	*
+	* \brief Remove components from an entity
+	*
+	* \param[in] handle The entity
+	* \param[in] mask The components to remove
+	*
+	*/
+	void VEECS::removeComponents(veEntityHandle handle, veComponentMask mask) {
+		if (!isAlive(handle)) return;
+		moveEntity(handle, m_archetypes[m_records[handle.m_index].m_archetype]->m_mask & ~mask);
+	}
+
+
+	/**
+	*
+	* \param[in] handle The entity
+	* \returns whether the entity exists
+	*
+	*/
+	bool VEECS::isAlive(veEntityHandle handle) {
+		return	handle.m_index < m_records.size() && m_records[handle.m_index].m_alive &&
+				m_records[handle.m_index].m_generation == handle.m_generation;
+	}
+
+
+	/**
+	*
+	* \param[in] handle The entity
+	* \returns the components of the entity, 0 if it does not exist
+	*
+	*/
+	veComponentMask VEECS::getComponentMask(veEntityHandle handle) {
+		if (!isAlive(handle)) return 0;
+		return m_archetypes[m_records[handle.m_index].m_archetype]->m_mask;
+	}
+
+
+	/**
+	*
+	* \brief Add a system that is called in each runSystems()
+	*
+	* Systems are called in the order they were added.
+	*
+	* \param[in] name Name of the system
+	* \param[in] include The system is called for chunks having all these components
+	* \param[in] exclude The system is not called for chunks having any of these components
+	* \param[in] function The function called for each chunk
+	* \param[in] parallel If true, chunks are processed by the thread pool
+	*
+	*/
+	void VEECS::addSystem(	veName name, veComponentMask include, veComponentMask exclude,
+							veSystemFunction function, bool parallel) {
+		veSystem system;
+		system.m_name = name;
+		system.m_include = include;
+		system.m_exclude = exclude;
+		system.m_function = function;
+		system.m_parallel = parallel;
+		m_systems.push_back(system);
+	}
+
+
+	/**
+	*
+	* \brief Remove a system
+	*
+	* \param[in] name Name of the system
+	*
+	*/
+	void VEECS::removeSystem(veName name) {
+		for (uint32_t i = 0; i < m_systems.size(); i++) {
+			if (m_systems[i].m_name == name) {
+				m_systems.erase(m_systems.begin() + i);
+				return;
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Call all systems for their chunks
+	*
+	* \param[in] dt Time passed since the last frame
+	*
+	*/
+	void VEECS::runSystems(double dt) {
+		for (auto &system : m_systems) {
+			if (system.m_parallel) {
+				parallelForEach(system.m_include, system.m_exclude, [&](veChunkView &chunk) { system.m_function(chunk, dt); });
+			}
+			else {
+				forEach(system.m_include, system.m_exclude, [&](veChunkView &chunk) { system.m_function(chunk, dt); });
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Call a function for each chunk, using the thread pool of the engine
+	*
+	* The chunks are split into one batch per hardware thread. The call returns when all chunks are done.
+	* The list of chunks is kept in the frame arena of the engine, so this must be called from the main thread.
+	*
+	* \param[in] include Chunks must have all these components
+	* \param[in] exclude Chunks must have none of these components
+	* \param[in] function Called for each chunk, must only write to the chunk it is given
+	*
+	*/
+	void VEECS::parallelForEach(veComponentMask include, veComponentMask exclude, std::function<void(veChunkView &)> function) {
+		uint32_t numChunks = 0;
+		forEach(include, exclude, [&](veChunkView &) { numChunks++; });
+
+		vh::vhSpan<veChunkView> chunks = getEnginePointer()->getFrameArena().allocate<veChunkView>(numChunks);
+		numChunks = 0;
+		forEach(include, exclude, [&](veChunkView &chunk) { chunks[numChunks++] = chunk; });
+
+		uint32_t numThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+		if (numThreads == 1 || chunks.size() < 2) {
+			for (auto &chunk : chunks) function(chunk);
+			return;
+		}
+
+		std::vector<std::future<void>> futures;
+		uint32_t chunksPerThread = ((uint32_t)chunks.size() + numThreads - 1) / numThreads;
+		for (uint32_t start = 0; start < chunks.size(); start += chunksPerThread) {
+			uint32_t end = std::min(start + chunksPerThread, (uint32_t)chunks.size());
+			futures.push_back(getEnginePointer()->m_threadPool->submit([&, start, end]() {
+				for (uint32_t i = start; i < end; i++) function(chunks[i]);
+			}));
+		}
+		for (auto &future : futures) future.get();
+	}
+
+
+	/**
+	*
+	* \brief Compute world transforms and world boxes of entities that do not belong to scene nodes
+	*
+	* These entities have no parent, so their world transform is their local transform.
+	* World boxes enclose the local boxes transformed to world space.
+	*
+	*/
+	void VEECS::updateTransforms() {
+		parallelForEach(VE_MASK_TRANSFORM | VE_MASK_WORLD, VE_MASK_NODE, [](veChunkView &chunk) {
+			veTransformComponent *pTransforms = chunk.get<veTransformComponent>(VE_COMPONENT_TRANSFORM);
+			veWorldComponent *pWorlds = chunk.get<veWorldComponent>(VE_COMPONENT_WORLD);
+			for (uint32_t i = 0; i < chunk.m_count; i++) pWorlds[i].m_world = pTransforms[i].m_local;
+
+			if (!chunk.has(VE_COMPONENT_BOUNDS)) return;
+			veBoundsComponent *pBounds = chunk.get<veBoundsComponent>(VE_COMPONENT_BOUNDS);
+			for (uint32_t i = 0; i < chunk.m_count; i++) {
+				glm::mat4 &W = pWorlds[i].m_world;
+				glm::mat3 absW = glm::mat3(glm::abs(glm::vec3(W[0])), glm::abs(glm::vec3(W[1])), glm::abs(glm::vec3(W[2])));
+				pBounds[i].m_world.center = glm::vec3(W * glm::vec4(pBounds[i].m_local.center, 1.0f));
+				pBounds[i].m_world.extent = absW * pBounds[i].m_local.extent;
+			}
+		});
+	}
+
+}
+
@@ -0,0 +1,257 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_ECS_MAX_COMPONENTS = 32;			///<Max number of component types, each has a bit in a component mask
+const uint32_t VE_ECS_CHUNK_SIZE = 16384;			///<Bytes per chunk of entities
+const uint32_t VE_ECS_NO_ENTITY = 0xFFFFFFFF;		///<Index of an invalid entity handle
+
+
+namespace ve {
+
+	class VESceneNode;
+	class VEMesh;
+	class VEMaterial;
+
+	typedef uint32_t veComponentMask;				///<One bit per component type
+
+	///Built in component types, custom types are registered with VEECS::registerComponent()
+	enum veComponentType {
+		VE_COMPONENT_TRANSFORM,			///<veTransformComponent
+		VE_COMPONENT_WORLD,				///<veWorldComponent
+		VE_COMPONENT_BOUNDS,			///<veBoundsComponent
+		VE_COMPONENT_RENDER,			///<veRenderComponent
+		VE_COMPONENT_LIGHT,				///<veLightComponent
+		VE_COMPONENT_NODE,				///<veNodeComponent
+		VE_COMPONENT_FIRST_CUSTOM		///<First id given to custom components
+	};
+
+	const veComponentMask VE_MASK_TRANSFORM = 1u << VE_COMPONENT_TRANSFORM;	///<Mask of the transform component
+	const veComponentMask VE_MASK_WORLD = 1u << VE_COMPONENT_WORLD;			///<Mask of the world component
+	const veComponentMask VE_MASK_BOUNDS = 1u << VE_COMPONENT_BOUNDS;		///<Mask of the bounds component
+	const veComponentMask VE_MASK_RENDER = 1u << VE_COMPONENT_RENDER;		///<Mask of the render component
+	const veComponentMask VE_MASK_LIGHT = 1u << VE_COMPONENT_LIGHT;			///<Mask of the light component
+	const veComponentMask VE_MASK_NODE = 1u << VE_COMPONENT_NODE;			///<Mask of the node component
+
+	///Identifies an ECS entity, becomes invalid when the entity is destroyed
+	struct veEntityHandle {
+		uint32_t	m_index = VE_ECS_NO_ENTITY;		///<Index of the entity record
+		uint32_t	m_generation = 0;				///<Must match the generation of the record
+
+		///\returns whether the handles identify the same entity
+		bool operator==(const veEntityHandle &h) const { return m_index == h.m_index && m_generation == h.m_generation; };
+		///\returns whether the handles identify different entities
+		bool operator!=(const veEntityHandle &h) const { return !(*this == h); };
+	};
+
+	///Local to parent transform
+	struct veTransformComponent {
+		glm::mat4	m_local;						///<Transform from local to parent space
+	};
+
+	///World transform, computed from the transforms of the entity and its parents
+	struct veWorldComponent {
+		glm::mat4	m_world;						///<Transform from local to world space
+	};
+
+	///Bounding boxes of the geometry
+	struct veBoundsComponent {
+		cl::clAABB	m_local;						///<Box in local space
+		cl::clAABB	m_world;						///<Box in world space, computed from m_local and the world transform
+	};
+
+	///What to draw
+	struct veRenderComponent {
+		VEMesh *	m_pMesh;						///<Mesh to draw
+		VEMaterial * m_pMaterial;					///<Material of the mesh
+		uint32_t	m_flags;						///<VE_RENDER_VISIBLE, VE_RENDER_CASTS_SHADOW
+		uint32_t	m_cullSlot;						///<Slot in the GPU culling buffers of an entity without scene node, see VEGPUCulling::updateECSEntities()
+	};
+
+	const uint32_t VE_RENDER_VISIBLE = 1;			///<Render component flag: should be drawn
+	const uint32_t VE_RENDER_CASTS_SHADOW = 2;		///<Render component flag: drawn in the shadow pass
+
+	///Light colors and parameters, see VELight
+	struct veLightComponent {
+		uint32_t	m_type;							///<VELight::veLightType
+		glm::vec4	m_colAmbient;					///<Ambient color
+		glm::vec4	m_colDiffuse;					///<Diffuse color
+		glm::vec4	m_colSpecular;					///<Specular color
+		glm::vec4	m_param;						///<Light parameters, 0...reach
+	};
+
+	///Scene node that uses this entity for its data
+	struct veNodeComponent {
+		VESceneNode * m_pNode;						///<The scene node
+	};
+
+
+	/**
+	*
+	* \brief Stores entities as sets of components, grouped by archetype
+	*
+	* All entities with the same set of components form an archetype. The entities of an archetype are stored
+	* in chunks of VE_ECS_CHUNK_SIZE bytes. Inside a chunk, each component type has its own array, so a system
+	* reading a few components only touches the memory of these components. Entities are kept packed, removing
+	* an entity moves the last entity of the archetype into the gap. Adding or removing components moves an
+	* entity to another archetype.
+	*
+	* Components are plain data and are copied with memcpy. New components are zeroed, transforms are set to identity,
+	* render components have no culling slot.
+	*
+	* Systems are functions called for each chunk whose archetype has a set of components and lacks another set.
+	* Parallel systems hand their chunks to the thread pool of the engine, so they must only write to the chunk
+	* they are given. Creating or destroying entities and changing their components must not happen in a system,
+	* and invalidates all component pointers.
+	*
+	* Each scene node owns an entity mirroring its data (VE_COMPONENT_NODE points back to it). Scene nodes write
+	* their transforms, entities their bounds and render data, and lights their colors, when their UBO updates find
+	* that these have changed. Entities created directly in the ECS have no scene node; their world transforms
+	* and boxes are computed in updateTransforms(). With GPU culling enabled, those with a render component are
+	* drawn by VEGPUCulling::updateECSEntities().
+	*
+	*/
+	class VEECS {
+
+	public:
+
+		///All entities with the same components
+		struct veArchetype {
+			veComponentMask			m_mask = 0;						///<Components of the entities
+			uint32_t				m_capacity = 0;					///<Entities per chunk
+			uint32_t				m_chunkSize = 0;				///<Bytes per chunk
+			uint32_t				m_offsets[VE_ECS_MAX_COMPONENTS];	///<Offset of each component array in a chunk
+			std::vector<uint8_t *>	m_chunks;						///<Chunk memory, the entity handles come first
+			uint32_t				m_numEntities = 0;				///<Number of entities
+		};
+
+		///The entities of a chunk, handed to systems
+		struct veChunkView {
+			veArchetype *	m_pArchetype;							///<Archetype of the entities
+			uint8_t *		m_pData;								///<Chunk memory
+			uint32_t		m_count;								///<Number of entities in the chunk
+
+			///\returns the array of a component in the chunk, the archetype must have the component
+			template<typename T> T * get(uint32_t component) { return (T*)(m_pData + m_pArchetype->m_offsets[component]); };
+			///\returns the array of entity handles in the chunk
+			veEntityHandle * getHandles() { return (veEntityHandle*)m_pData; };
+			///\returns whether the entities have a component
+			bool has(uint32_t component) { return (m_pArchetype->m_mask & (1u << component)) != 0; };
+		};
+
+		typedef std::function<void(veChunkView &chunk, double dt)> veSystemFunction;	///<Called for each matching chunk
+
+	protected:
+
+		///Where the components of an entity are stored
+		struct veRecord {
+			uint32_t	m_archetype = 0;							///<Archetype of the entity
+			uint32_t	m_row = 0;									///<Index of the entity in the archetype
+			uint32_t	m_generation = 0;							///<Increased when the entity is destroyed
+			bool		m_alive = false;							///<Record is in use
+		};
+
+		///A registered system
+		struct veSystem {
+			veName				m_name;								///<Name for removing the system
+			veComponentMask		m_include;							///<Chunks must have all these components
+			veComponentMask		m_exclude;							///<Chunks must have none of these components
+			veSystemFunction	m_function;							///<Called for each chunk
+			bool				m_parallel;							///<Chunks may be processed by several threads
+		};
+
+		std::vector<uint32_t>			m_componentSizes;			///<Size of each component type
+		std::vector<veArchetype *>		m_archetypes;				///<All archetypes
+		std::unordered_map<veComponentMask, uint32_t> m_archetypeMap;	///<Archetype of each component mask
+		std::vector<veRecord>			m_records;					///<Records of all entities
+		std::vector<uint32_t>			m_freeRecords;				///<Records that can be reused
+		std::vector<veSystem>			m_systems;					///<Systems called by runSystems()
+		uint32_t						m_numEntities = 0;			///<Number of entities
+
+		uint32_t	getArchetype(veComponentMask mask);				//find or create an archetype
+		uint32_t	allocateRow(uint32_t archetype, veEntityHandle handle);	//append an entity with default components
+		void		freeRow(uint32_t archetype, uint32_t row);		//remove an entity, moving the last one into the gap
+		void		moveEntity(veEntityHandle handle, veComponentMask mask);	//move an entity to another archetype
+
+		///\returns pointer to a component of an entity in an archetype
+		uint8_t *	getComponentPtr(veArchetype *pArchetype, uint32_t row, uint32_t component) {
+			return	pArchetype->m_chunks[row / pArchetype->m_capacity] + pArchetype->m_offsets[component] +
+					(row % pArchetype->m_capacity) * m_componentSizes[component];
+		};
+
+	public:
+		VEECS();
+		~VEECS();
+
+		uint32_t		registerComponent(uint32_t size);			//add a custom component type
+		veEntityHandle	createEntity(veComponentMask mask);			//create an entity with default components
+		void			destroyEntity(veEntityHandle handle);		//destroy an entity
+		void			addComponents(veEntityHandle handle, veComponentMask mask);		//add default components
+		void			removeComponents(veEntityHandle handle, veComponentMask mask);	//remove components
+		bool			isAlive(veEntityHandle handle);				//does the entity exist
+		veComponentMask	getComponentMask(veEntityHandle handle);	//components of an entity
+
+		void			addSystem(	veName name, veComponentMask include, veComponentMask exclude,
+									veSystemFunction function, bool parallel = true);	//add a system called by runSystems()
+		void			removeSystem(veName name);				//remove a system
+		///Remove a system, the string is looked up without interning it
+		void			removeSystem(const std::string &name) { veName id; if (veName::find(name, id)) removeSystem(id); };
+		void			runSystems(double dt);						//call all systems
+		void			updateTransforms();							//world transforms and boxes of entities without scene nodes
+		void			parallelForEach(veComponentMask include, veComponentMask exclude,
+										std::function<void(veChunkView &)> function);	//call a function for each chunk in parallel
+
+		///\returns the number of entities
+		uint32_t		getNumEntities() { return m_numEntities; };
+		///\returns all archetypes
+		std::vector<veArchetype *> & getArchetypes() { return m_archetypes; };
+
+		/**
+		*
+		* \brief Get a component of an entity
+		*
+		* \param[in] handle The entity
+		* \param[in] component Type of the component
+		* \returns pointer to the component, or nullptr if the entity does not exist or has no such component.
+		* The pointer becomes invalid when any entity is created, destroyed or changes its components.
+		*
+		*/
+		template<typename T> T * getComponent(veEntityHandle handle, uint32_t component) {
+			if (!isAlive(handle)) return nullptr;
+			veRecord &record = m_records[handle.m_index];
+			veArchetype *pArchetype = m_archetypes[record.m_archetype];
+			if ((pArchetype->m_mask & (1u << component)) == 0) return nullptr;
+			return (T*)getComponentPtr(pArchetype, record.m_row, component);
+		};
+
+		/**
+		*
+		* \brief Call a function for each chunk in the calling thread
+		*
+		* \param[in] include Chunks must have all these components
+		* \param[in] exclude Chunks must have none of these components
+		* \param[in] function Function void(veChunkView &chunk)
+		*
+		*/
+		template<typename F> void forEach(veComponentMask include, veComponentMask exclude, F function) {
+			for (auto pArchetype : m_archetypes) {
+				if ((pArchetype->m_mask & include) != include || (pArchetype->m_mask & exclude) != 0) continue;
+
+				for (uint32_t c = 0; c * pArchetype->m_capacity < pArchetype->m_numEntities; c++) {
+					veChunkView chunk;
+					chunk.m_pArchetype = pArchetype;
+					chunk.m_pData = pArchetype->m_chunks[c];
+					chunk.m_count = std::min(pArchetype->m_capacity, pArchetype->m_numEntities - c * pArchetype->m_capacity);
+					function(chunk);
+				}
+			}
+		};
+	};
+
+}
+
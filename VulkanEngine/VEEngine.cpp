@@ -24,7 +24,7 @@ namespace ve {
 	* \brief Constructor of my VEEngine
 	* \param[in] debug Switch debuggin on or off
 	*/ 
-	VEEngine::VEEngine(bool debug) : m_debug(debug) {
+	VEEngine::VEEngine(bool debug) : m_debug(debug), m_frameArena(VE_FRAME_ARENA_SIZE) {
 		g_pVEEngineSingleton = this; 
 	}
 
@@ -34,34 +34,76 @@ namespace ve {
 	/**
 	* \brief Initialize the engine
 	*
-	* Creates a VEREnderer, VESceneManager, VEWindow. Then initializes Vulkan and gets the Vulkan instance.
+	* Creates a VEFileSystem, VEREnderer, VESceneManager, VEWindow. Then initializes Vulkan and gets the Vulkan instance.
 	* After this, initializes VERenderer, VESceneManager and VEWindow. Then it registers default event listeners.
+	*
+	* Independent work overlaps: the standard meshes are imported on the thread pool during the whole startup,
+	* and the Vulkan instance is created on the thread pool while the window is created. The duration of each
+	* phase is logged and can be read with getStartupPhases().
 	*/
 	void VEEngine::initEngine() {
-		createRenderer();					//create a renderer
-		createSceneManager();				//create a scene manager
-		createWindow();						//create a window
-		m_pWindow->initWindow(800, 600);	//inittialize the window
+		m_initStart = vhTimeNow();
+		vhLogInit();						//start the log flusher thread
+		createFileSystem();					//create the file system first, shaders are read through it
 
 		m_threadPool = new ThreadPool(20); //worker threads
 		m_threadPool->init();
 
+		createRenderer();					//create a renderer
+		createSceneManager();				//create a scene manager
+		createWindow();						//create a window
+		m_pSceneManager->prefetchStandardAssets();	//import the standard meshes while the rest starts up
+
+		std::chrono::high_resolution_clock::time_point t_start = vhTimeNow();
+		m_pWindow->initWindowSystem();
 		std::vector<const char*> instanceExtensions = getRequiredInstanceExtensions();
 		std::vector<const char*> validationLayers = getValidationLayers();
-		vhDevCreateInstance(instanceExtensions, validationLayers, &m_instance);
-		
-		if( m_debug )
-			vh::vhSetupDebugCallback( m_instance, &callback );				//create a debug callback for printing debug information
+		double instanceTime = 0.0;
+		std::future<void> instance = m_threadPool->submit([&]() {
+			std::chrono::high_resolution_clock::time_point t_instance = vhTimeNow();
+			vhDevCreateInstance(instanceExtensions, validationLayers, &m_instance);
+
+			if (m_debug)
+				vh::vhSetupDebugCallback(m_instance, &callback);			//create a debug callback for printing debug information
+			instanceTime = vhTimeDuration(t_instance) * 1000.0;
+		});
+
+		m_pWindow->initWindow(800, 600);	//inittialize the window while the instance is created
+		addStartupPhase("window", vhTimeDuration(t_start) * 1000.0);
+		instance.get();
+		addStartupPhase("instance", instanceTime);
 		
+		t_start = vhTimeNow();
 		m_pWindow->createSurface(m_instance, &m_pRenderer->m_surface);	//create a Vulkan surface
 		m_pRenderer->initRenderer();			//initialize the renderer
+		addStartupPhase("renderer", vhTimeDuration(t_start) * 1000.0);
+
+		t_start = vhTimeNow();
 		m_pSceneManager->initSceneManager();	//initialize the scene manager
+		addStartupPhase("scene manager", vhTimeDuration(t_start) * 1000.0);
 
 		registerEventListeners();
+		addStartupPhase("engine", vhTimeDuration(m_initStart) * 1000.0);
 		m_loopCount = 1;
 	}
 
 
+	/**
+	*
+	* \brief Record and log the duration of a startup phase
+	*
+	* Must be called from the main thread.
+	*
+	* \param[in] name Name of the phase
+	* \param[in] duration Duration of the phase (ms)
+	*
+	*/
+	void VEEngine::addStartupPhase(std::string name, double duration) {
+		m_startupPhases.push_back({ name, duration });
+		VHLOGINFO("Startup %s: %.2f ms", name, duration);
+	}
+
+
 	/**
 	* \brief Create the only VEWindow instance and store a pointer to it.
 	*
@@ -91,6 +133,16 @@ namespace ve {
 		m_pSceneManager = new VESceneManager();
 	}
 
+	/**
+	* \brief Create the only VEFileSystem instance and store a pointer to it.
+	*
+	* Overload to mount directories and packs before anything is loaded.
+	*
+	*/
+	void VEEngine::createFileSystem() {
+		m_pFileSystem = new VEFileSystem();
+	}
+
 
 	/**
 	*
@@ -124,6 +176,11 @@ namespace ve {
 
 		vkDestroySurfaceKHR(m_instance, m_pRenderer->m_surface, nullptr);
 		vkDestroyInstance(m_instance, nullptr);
+
+		delete m_pFileSystem;
+		m_pFileSystem = nullptr;
+
+		vhLogClose();
 	}
 
 	//-------------------------------------------------------------------------------------------------------
@@ -180,9 +237,9 @@ namespace ve {
 	* \param[in] name The name of the event listener to be removed.
 	*
 	*/
-	void VEEngine::removeEventListener(std::string name) {
+	void VEEngine::removeEventListener(veName name) {
 		for (uint32_t i = 0; i < m_eventListener.size(); i++) {
-			if (m_eventListener[i]->getName() == name) {
+			if (m_eventListener[i]->getNameID() == name) {
 				m_eventListener[i] = m_eventListener[m_eventListener.size() - 1];		//write over last listener
 				m_eventListener.pop_back();
 				return;
@@ -198,9 +255,9 @@ namespace ve {
 	* The event listener will be removed from the list and destroyed.
 	*
 	*/
-	void VEEngine::deleteEventListener(std::string name)  {
+	void VEEngine::deleteEventListener(veName name)  {
 		for (uint32_t i = 0; i < m_eventListener.size(); i++) {
-			if (m_eventListener[i]->getName() == name) {
+			if (m_eventListener[i]->getNameID() == name) {
 				delete m_eventListener[i];											//delete the pointer
 				m_eventListener[i] = m_eventListener[m_eventListener.size()-1];		//write over last listener
 				m_eventListener.pop_back();
@@ -308,30 +365,28 @@ namespace ve {
 	* \brief Go through the event list, and call all listeners for it.
 	*
 	* Go through all events in the event list and pass them to the event listeners. Continuous events are kept,
-	* all other events are deleted from the list at the end.
+	* all other events are deleted from the list. The events are copied into the frame arena first, so the list keeps
+	* its memory, and events added by listeners are processed in the next loop.
 	*
 	* \param[in] dt The delta time that has passed since the last loop.
 	*
 	*/
 	void VEEngine::processEvents( double dt) {
 
-		std::vector<veEvent> keepEvents;							//Keep these events in the list
-		for (auto event : m_eventlist) {
-			if (event.lifeTime == VE_EVENT_LIFETIME_CONTINUOUS) {
-				keepEvents.push_back(event);
+		vh::vhSpan<veEvent> events = m_frameArena.allocateCopy(m_eventlist.data(), m_eventlist.size());	//listeners may add new events
+		m_eventlist.clear();
+
+		for (auto &event : events) {
+			if (event.lifeTime == VE_EVENT_LIFETIME_CONTINUOUS) {		//Keep these events in the list
+				m_eventlist.push_back(event);
 			}
 		}
 
-		for (auto event : m_eventlist) {
+		for (auto &event : events) {
 			if ( event.notBeforeTime <= m_loopCount) {
 				callListeners(dt, event);
 			}
 		}
-		m_eventlist.clear();
-
-		for (auto event : keepEvents) {
-			m_eventlist.push_back(event);
-		}
 	}
 
 
@@ -357,8 +412,10 @@ namespace ve {
 	*
 	*/
 	void VEEngine::fatalError(std::string message) {
+		VHLOGERROR("%s", message);
+
 		while (m_eventListener.size() > 0) {
-			deleteEventListener( m_eventListener[0]->getName() );
+			deleteEventListener( m_eventListener[0]->getNameID() );
 		}
 
 		registerEventListener(new VEEventListenerNuklearError(message) );		
@@ -414,14 +471,20 @@ namespace ve {
 	*
 	* This is the main render loop. It performs time measurements, runs the event processing, checks whether the window
 	* size has changed (if so, informs the VEREnderer), and asks the VERenderer to draw and present one frame.
+	* Each loop starts by freeing the frame arena. The heap allocations of the main thread are counted in each loop,
+	* after setCheckFrameAllocations(true) a loop that allocates after the warmup is reported and asserted.
 	*
 	*/
 	void VEEngine::run() {
 		std::chrono::high_resolution_clock::time_point t_start = vh::vhTimeNow();
 		std::chrono::high_resolution_clock::time_point t_prev = t_start;
 		std::chrono::high_resolution_clock::time_point t_now;
+		uint32_t checkAllocationsFrom = m_loopCount + VE_ALLOCATION_WARMUP_FRAMES;
 
 		while ( !m_end_running) {
+			m_frameArena.reset();				//free the temporary data of the last loop
+			uint64_t numAllocations = vh::vhMemGetNumAllocations();
+
 			m_dt = vh::vhTimeDuration( t_prev );
 			t_prev = vh::vhTimeNow();
 			m_AvgFrameTime = vh::vhAverage( (float)m_dt, m_AvgFrameTime );
@@ -435,6 +498,7 @@ namespace ve {
 				m_pWindow->waitForWindowSizeChange();
 				m_pRenderer->recreateSwapchain();
 				m_framebufferResized = false;
+				checkAllocationsFrom = m_loopCount + VE_ALLOCATION_WARMUP_FRAMES;
 			}
 			
 			processEvents(m_dt);				//process all current events, including pressed keys
@@ -456,6 +520,18 @@ namespace ve {
 
 			m_pRenderer->presentFrame();		//present the next frame
 
+			if (m_timeToFirstFrame == 0.0) {
+				m_timeToFirstFrame = vhTimeDuration(m_initStart) * 1000.0;
+				addStartupPhase("first frame", m_timeToFirstFrame);
+			}
+
+			m_frameAllocations = vh::vhMemGetNumAllocations() - numAllocations;
+			if (m_checkFrameAllocations && m_loopCount >= checkAllocationsFrom && m_frameAllocations > 0) {
+				VHLOGERROR("Loop %u made %llu heap allocations", m_loopCount, (unsigned long long)m_frameAllocations);
+				vh::vhLogFlush();
+				assert(m_frameAllocations == 0);
+			}
+
 			m_loopCount++;
 		}
 		closeEngine();
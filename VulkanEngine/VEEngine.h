@@ -11,6 +11,9 @@
 #define getEnginePointer() g_pVEEngineSingleton
 #endif
 
+const size_t VE_FRAME_ARENA_SIZE = 1 << 16;			///<Initial size of the frame arena, it grows if needed
+const uint32_t VE_ALLOCATION_WARMUP_FRAMES = 60;	///<Frames before the allocation check starts, containers reach their size meanwhile
+
 namespace ve {
 
 	//use this macro to check the function result, if its not VK_SUCCESS then return the error
@@ -26,6 +29,7 @@ namespace ve {
 	class VERenderer;
 	class VEEventListener;
 	class VESceneManager;
+	class VEFileSystem;
 
 	class VEEngine;
 	extern VEEngine* g_pVEEngineSingleton;	///<Pointer to the only class instance 
@@ -51,6 +55,7 @@ namespace ve {
 		VEWindow * m_pWindow = nullptr;					///<Pointer to the only Window instance
 		VERenderer * m_pRenderer = nullptr;				///<Pointer to the only renderer instance
 		VESceneManager * m_pSceneManager = nullptr;		///<Pointer to the only scene manager instance
+		VEFileSystem * m_pFileSystem = nullptr;			///<Pointer to the only file system instance
 		VkDebugReportCallbackEXT callback;				///<Debug callback handle
 
 		std::vector<veEvent> m_eventlist;				///<List of events that should be handled in the next loop
@@ -68,6 +73,14 @@ namespace ve {
 		bool m_end_running = false;						///<Flag indicating that the engine should leave the render loop
 		bool m_debug = true;							///<Flag indicating whether debugging is enabled or not
 
+		std::chrono::high_resolution_clock::time_point m_initStart;	///<Time initEngine() was called
+		std::vector<std::pair<std::string, double>> m_startupPhases;	///<Name and duration (ms) of each startup phase
+		double m_timeToFirstFrame = 0.0;				///<Time from calling initEngine() until the first frame was presented (ms)
+
+		vh::vhLinearArena m_frameArena;					///<Memory for temporary data of the current loop, freed when the next loop starts
+		uint64_t m_frameAllocations = 0;				///<Heap allocations of the main thread in the last loop
+		bool m_checkFrameAllocations = false;			///<Assert that steady state loops do not allocate, needs VH_COUNT_ALLOCATIONS
+
 		virtual std::vector<const char*> getRequiredInstanceExtensions(); //Return a list of required Vulkan instance extensions
 		virtual std::vector<const char*> getValidationLayers();	//Returns a list of required Vulkan validation layers
 		void callListeners(double dt, veEvent event);	//Call all event listeners and give them certain event
@@ -79,6 +92,7 @@ namespace ve {
 		virtual void createWindow();			//Create the only window
 		virtual void createRenderer();			//Create the only renderer
 		virtual void createSceneManager();		//Create the only scene manager
+		virtual void createFileSystem();		//Create the only file system
 		virtual void registerEventListeners();	//Register all default event listeners, can be overloaded
 		virtual void closeEngine();				//Close down the engine
 
@@ -93,8 +107,12 @@ namespace ve {
 		virtual void fatalError(std::string message);		//Show an error message and close down the engine
 		virtual void end();									//end the render loop
 		void registerEventListener(VEEventListener *lis);	//Register a new event listener.
-		void removeEventListener(std::string name);			//Remove an event listener - it is NOT deleted automatically!
-		void deleteEventListener(std::string name);			//Delete an event listener
+		void removeEventListener(veName name);				//Remove an event listener - it is NOT deleted automatically!
+		///Remove an event listener, the string is looked up without interning it
+		void removeEventListener(const std::string &name) { veName id; if (veName::find(name, id)) removeEventListener(id); };
+		void deleteEventListener(veName name);				//Delete an event listener
+		///Delete an event listener, the string is looked up without interning it
+		void deleteEventListener(const std::string &name) { veName id; if (veName::find(name, id)) deleteEventListener(id); };
 		void addEvent(veEvent event);						//Add an event to the event list - will be handled in the next loop
 		void deleteEvent(veEvent event);					//Delete an event from the event list
 
@@ -107,6 +125,17 @@ namespace ve {
 		float			 getAvgFrameTime() { return m_AvgFrameTime;  };
 		///\returns the average update time (s)
 		float			 getAvgUpdateTime() { return m_AvgUpdateTime; };
+		void			 addStartupPhase(std::string name, double duration);	//Record and log the duration of a startup phase
+		///\returns name and duration (ms) of each startup phase, in the order they ended
+		std::vector<std::pair<std::string, double>> & getStartupPhases() { return m_startupPhases; };
+		///\returns the time from calling initEngine() until the first frame was presented (ms), 0 before that
+		double			 getTimeToFirstFrame() { return m_timeToFirstFrame; };
+		///\returns the arena for temporary data of the current loop, use only on the main thread
+		vh::vhLinearArena & getFrameArena() { return m_frameArena; };
+		///\returns the number of heap allocations of the main thread in the last loop, 0 if VH_COUNT_ALLOCATIONS is not defined
+		uint64_t		 getFrameAllocations() { return m_frameAllocations; };
+		///\brief Assert that loops after the warmup do not allocate heap memory on the main thread
+		void			 setCheckFrameAllocations(bool check) { m_checkFrameAllocations = check; };
 	};
 
 
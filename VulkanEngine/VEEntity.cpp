@@ -23,18 +23,30 @@ namespace ve {
 	* \param[in] name The name of this node.
 	* \param[in] transf Position and orientation.
 	* \param[in] parent A parent.
+	* \param[in] components Components of the ECS entity besides transform, world and node, added by subclasses
 	*
 	*/
 
-	VESceneNode::VESceneNode(std::string name, glm::mat4 transf, VESceneNode *parent) : VENamedClass(name) {
+	VESceneNode::VESceneNode(std::string name, glm::mat4 transf, VESceneNode *parent, veComponentMask components) : VENamedClass(name) {
 		m_parent = parent;
 		if (parent != nullptr) {
 			parent->addChild(this);		//if there is a parent, add this scene node to the parent as a child
 		}
+		VEECS *pECS = getSceneManagerPointer()->getECS();
+		m_ecsEntity = pECS->createEntity(VE_MASK_TRANSFORM | VE_MASK_WORLD | VE_MASK_NODE | components);
+		pECS->getComponent<veNodeComponent>(m_ecsEntity, VE_COMPONENT_NODE)->m_pNode = this;
+
 		setTransform(transf);			//sets this MO also onto the dirty list to be updated
 	}
 
 
+	/**
+	* \brief Destructor of the scene node class, destroys its ECS entity.
+	*/
+	VESceneNode::~VESceneNode() {
+		getSceneManagerPointer()->getECS()->destroyEntity(m_ecsEntity);
+	}
+
 
 	/**
 	* \returns the scene node's local to parent transform.
@@ -48,6 +60,7 @@ namespace ve {
 	*/
 	void VESceneNode::setTransform(glm::mat4 trans) {
 		m_transform = trans;
+		m_transformChanged = true;
 	}
 
 	/**
@@ -55,6 +68,7 @@ namespace ve {
 	*/
 	void VESceneNode::setPosition(glm::vec3 pos) {
 		m_transform[3] = glm::vec4(pos.x, pos.y, pos.z, 1.0f);
+		m_transformChanged = true;
 	};
 
 	/**
@@ -141,6 +155,7 @@ namespace ve {
 		m_transform[0] = glm::vec4(x.x, x.y, x.z, 0.0f);
 		glm::vec3 y = glm::normalize(glm::cross(z, x));
 		m_transform[1] = glm::vec4(y.x, y.y, y.z, 0.0f);
+		m_transformChanged = true;
 
 	}
 
@@ -201,6 +216,7 @@ namespace ve {
 	* \brief Update the entity's UBO buffer with the current world matrix
 	*
 	* Calculate the new world matrix (and inv transpose matix to transform normal vectors).
+	* If the local or the world transform have changed, write them to the ECS entity.
 	* Then copy the struct content into the UBO. Then call all children to do the same.
 	*
 	* \param[in] parentWorldMatrix The parent's world matrix or an identity matrix.
@@ -208,12 +224,27 @@ namespace ve {
 	*
 	*/
 	void VESceneNode::update(glm::mat4 parentWorldMatrix, uint32_t imageIndex ) {
-		glm::mat4 worldMatrix = parentWorldMatrix * getTransform();		//compute the world matrix
+		glm::mat4 worldMatrix = parentWorldMatrix * m_transform;		//compute the world matrix
+		if (m_transformChanged || worldMatrix != m_worldTransform) {
+			m_worldTransform = worldMatrix;
+			m_transformChanged = false;
+			updateECS();										//let ECS systems see the new transforms
+		}
 		updateUBO( worldMatrix, imageIndex);					//call derived class for specific data like object color
 		updateChildren( worldMatrix, imageIndex);				//update all children
 	}
 
 
+	/**
+	* \brief Write the local and the world transform to the ECS entity
+	*/
+	void VESceneNode::updateECS() {
+		VEECS *pECS = getSceneManagerPointer()->getECS();
+		pECS->getComponent<veTransformComponent>(m_ecsEntity, VE_COMPONENT_TRANSFORM)->m_local = m_transform;
+		pECS->getComponent<veWorldComponent>(m_ecsEntity, VE_COMPONENT_WORLD)->m_world = m_worldTransform;
+	}
+
+
 	/**
 	* \brief Update the UBOs of all children of this entity
 	*/
@@ -251,23 +282,18 @@ namespace ve {
 	*
 	*/
 
-	void VESceneNode::getOBB(std::vector<glm::vec4> &points, float t1, float t2,
+	void VESceneNode::getOBB(vh::vhSpan<glm::vec4> points, float t1, float t2,
 		glm::vec3 &center, float &width, float &height, float &depth) {
 
 		glm::mat4 W = getWorldTransform();
 
-		std::vector<glm::vec4> axes;		//3 local axes, into pos and minus direction
-		axes.push_back(-1.0f*W[0]);
-		axes.push_back(W[0]);
-		axes.push_back(-1.0f*W[1]);
-		axes.push_back(W[1]);
-		axes.push_back(-1.0f*W[2]);
-		axes.push_back(W[2]);
-
-		std::vector<glm::vec4> box;			//maxima points into the 6 directions
-		std::vector<float> maxvalues;		//max ordinates
-		box.resize(6);
-		maxvalues.resize(6);
+		glm::vec4 axes[6] = {				//3 local axes, into pos and minus direction
+			-1.0f*W[0], W[0],
+			-1.0f*W[1], W[1],
+			-1.0f*W[2], W[2] };
+
+		glm::vec4 box[6];					//maxima points into the 6 directions
+		float maxvalues[6];					//max ordinates
 		for (uint32_t i = 0; i < 6; i++) {	//fill maxima with first point
 			box[i] = points[0];
 			maxvalues[i] = glm::dot(axes[i], points[0]);
@@ -307,10 +333,12 @@ namespace ve {
 	* \param[in] transf Transform of the object, containing orientation and position.
 	* \param[in] parent Parent of the object, or nullptr.
 	* \param[in] sizeUBO Size of the object's UBO, if >0 then the object needs UBOs
+	* \param[in] components Additional components of the ECS entity
 	*
 	*/
-	VESceneObject::VESceneObject(std::string name, glm::mat4 transf, VESceneNode *parent, uint32_t sizeUBO ) : 
-									VESceneNode(name, transf, parent) {
+	VESceneObject::VESceneObject(	std::string name, glm::mat4 transf, VESceneNode *parent, uint32_t sizeUBO,
+									veComponentMask components ) :
+									VESceneNode(name, transf, parent, components) {
 
 		if (sizeUBO > 0) {
 			vh::vhBufCreateUniformBuffers(	getRendererPointer()->getVmaAllocator(),
@@ -388,7 +416,8 @@ namespace ve {
 	VEEntity::VEEntity(	std::string name, veEntityType type, 
 						VEMesh *pMesh, VEMaterial *pMat, 
 						glm::mat4 transf, VESceneNode *parent) :
-							VESceneObject(name, transf, parent, (uint32_t) sizeof(veUBOPerObject_t)), m_entityType( type ) {
+							VESceneObject(name, transf, parent, (uint32_t) sizeof(veUBOPerObject_t), VE_MASK_BOUNDS | VE_MASK_RENDER),
+							m_entityType( type ) {
 
 		setTransform(transf);
 
@@ -427,6 +456,8 @@ namespace ve {
 	*
 	* \brief Update the entity's UBO.
 	*
+	* Render data and local box are written to the ECS entity only if mesh, material or visibility have changed.
+	*
 	* \param[in] worldMatrix The new world matrix of the entity
 	* \param[in] imageIndex The Index of the swapchain image that is currently used.
 	*
@@ -442,6 +473,47 @@ namespace ve {
 		};
 
 		VESceneObject::updateUBO( (void*)&m_ubo, (uint32_t)sizeof(veUBOPerObject_t), imageIndex);
+
+		VEGPUCulling *pCulling = getRendererForwardPointer()->getGPUCulling();
+		if (pCulling != nullptr && m_cullSlot != VE_CULL_NO_SLOT) {
+			pCulling->updateEntity(this, imageIndex);					//keep the culling slot in sync with the UBO
+		}
+
+		VEBroadphase *pBroadphase = getSceneManagerPointer()->getBroadphase();
+		if (pBroadphase != nullptr && m_broadphaseProxy != VE_BROADPHASE_NO_PROXY) {
+			pBroadphase->updateEntity(this, worldMatrix);				//keep the world box in sync
+		}
+
+		VEOctree *pOctree = getSceneManagerPointer()->getOctree();
+		if (pOctree != nullptr && m_octreeProxy != VE_OCTREE_NO_PROXY) {
+			pOctree->updateEntity(this, worldMatrix);					//move to another node if needed
+		}
+
+		uint32_t renderFlags = (m_drawEntity ? VE_RENDER_VISIBLE : 0) | (m_castsShadow ? VE_RENDER_CASTS_SHADOW : 0);
+		if (m_pMesh != m_ecsRender.m_pMesh || m_pMaterial != m_ecsRender.m_pMaterial || renderFlags != m_ecsRender.m_flags) {
+			m_ecsRender.m_pMesh = m_pMesh;								//let ECS systems see the new render data
+			m_ecsRender.m_pMaterial = m_pMaterial;
+			m_ecsRender.m_flags = renderFlags;
+
+			VEECS *pECS = getSceneManagerPointer()->getECS();
+			veRenderComponent *pRender = pECS->getComponent<veRenderComponent>(m_ecsEntity, VE_COMPONENT_RENDER);
+			pRender->m_pMesh = m_pMesh;
+			pRender->m_pMaterial = m_pMaterial;
+			pRender->m_flags = renderFlags;
+			veBoundsComponent *pBounds = pECS->getComponent<veBoundsComponent>(m_ecsEntity, VE_COMPONENT_BOUNDS);
+			pBounds->m_local = m_pMesh != nullptr ? m_pMesh->m_boundingBox : cl::clAABB(glm::vec3(0.0f), glm::vec3(1.0f));
+			pBounds->m_world = getWorldBoundingBox(worldMatrix);
+		}
+	}
+
+
+	/**
+	* \brief Write the transforms and the world box to the ECS entity
+	*/
+	void VEEntity::updateECS() {
+		VESceneNode::updateECS();
+		getSceneManagerPointer()->getECS()->getComponent<veBoundsComponent>(m_ecsEntity, VE_COMPONENT_BOUNDS)->m_world =
+			getWorldBoundingBox(m_worldTransform);
 	}
 
 
@@ -463,6 +535,31 @@ namespace ve {
 		}
 	}
 
+	/**
+	*
+	* \brief Get the world space box of the mesh
+	*
+	* The local box of the mesh is transformed, and the box holding the result is returned.
+	* Entities without a mesh get a box with half width 1 around their position.
+	*
+	* \param[in] worldMatrix The world matrix of the entity
+	* \returns the world space axis aligned box
+	*
+	*/
+	cl::clAABB VEEntity::getWorldBoundingBox(glm::mat4 worldMatrix) {
+		if (m_pMesh == nullptr) return cl::clAABB(glm::vec3(worldMatrix[3]), glm::vec3(1.0f));
+
+		cl::clAABB &local = m_pMesh->m_boundingBox;
+		cl::clAABB box;
+		box.center = glm::vec3(worldMatrix * glm::vec4(local.center, 1.0f));
+		for (uint32_t i = 0; i < 3; i++) {
+			box.extent[i] =	fabs(worldMatrix[0][i]) * local.extent.x +
+							fabs(worldMatrix[1][i]) * local.extent.y +
+							fabs(worldMatrix[2][i]) * local.extent.z;
+		}
+		return box;
+	}
+
 
 
 	//-------------------------------------------------------------------------------------------------
@@ -536,7 +633,7 @@ namespace ve {
 	*
 	*/
 	void VECamera::getBoundingSphere(glm::vec3 *center, float *radius) {
-		std::vector<glm::vec4> points;
+		glm::vec4 points[VE_NUM_FRUSTUM_POINTS];
 
 		getFrustumPoints(points);					//get frustum points in world space
 
@@ -544,7 +641,7 @@ namespace ve {
 		for (auto point : points) {
 			mean += point;
 		}
-		mean /= (float)points.size();
+		mean /= (float)VE_NUM_FRUSTUM_POINTS;
 
 		float maxsq = 0.0f;
 		for (auto point : points) {
@@ -636,24 +733,28 @@ namespace ve {
 	*
 	* \param[in] z0 Startparameter for interpolating the frustum
 	* \param[in] z1 Endparameter for interlopating the frustum
-	* \param[out] points List of 8 points that make up the interpolated frustum in world space
+	* \param[out] points Receives the 8 points that make up the interpolated frustum in world space, must hold VE_NUM_FRUSTUM_POINTS points
 	*
 	*/
-	void VECameraProjective::getFrustumPoints(std::vector<glm::vec4> &points, float z0, float z1) {
+	void VECameraProjective::getFrustumPoints(vh::vhSpan<glm::vec4> points, float z0, float z1) {
+		if (points.size() < VE_NUM_FRUSTUM_POINTS) {
+			throw std::runtime_error("Error: getFrustumPoints() needs room for 8 points!");
+		}
+
 		float halfh = (float)tan( (m_fov/2.0f) * M_PI / 180.0f );
 		float halfw = halfh * m_aspectRatio;
 
 		glm::mat4 W = getWorldTransform();
 
-		points.push_back( W*glm::vec4(-m_nearPlane * halfw, -m_nearPlane * halfh, m_nearPlane, 1.0f ) );
-		points.push_back( W*glm::vec4( m_nearPlane * halfw, -m_nearPlane * halfh, m_nearPlane, 1.0f));
-		points.push_back( W*glm::vec4(-m_nearPlane * halfw,  m_nearPlane * halfh, m_nearPlane, 1.0f));
-		points.push_back( W*glm::vec4( m_nearPlane * halfw,  m_nearPlane * halfh, m_nearPlane, 1.0f));
+		points[0] = W*glm::vec4(-m_nearPlane * halfw, -m_nearPlane * halfh, m_nearPlane, 1.0f );
+		points[1] = W*glm::vec4( m_nearPlane * halfw, -m_nearPlane * halfh, m_nearPlane, 1.0f);
+		points[2] = W*glm::vec4(-m_nearPlane * halfw,  m_nearPlane * halfh, m_nearPlane, 1.0f);
+		points[3] = W*glm::vec4( m_nearPlane * halfw,  m_nearPlane * halfh, m_nearPlane, 1.0f);
 
-		points.push_back( W*glm::vec4(-m_farPlane * halfw, -m_farPlane * halfh, m_farPlane, 1.0f));
-		points.push_back( W*glm::vec4( m_farPlane * halfw, -m_farPlane * halfh, m_farPlane, 1.0f));
-		points.push_back( W*glm::vec4(-m_farPlane * halfw,  m_farPlane * halfh, m_farPlane, 1.0f));
-		points.push_back( W*glm::vec4( m_farPlane * halfw,  m_farPlane * halfh, m_farPlane, 1.0f));
+		points[4] = W*glm::vec4(-m_farPlane * halfw, -m_farPlane * halfh, m_farPlane, 1.0f);
+		points[5] = W*glm::vec4( m_farPlane * halfw, -m_farPlane * halfh, m_farPlane, 1.0f);
+		points[6] = W*glm::vec4(-m_farPlane * halfw,  m_farPlane * halfh, m_farPlane, 1.0f);
+		points[7] = W*glm::vec4( m_farPlane * halfw,  m_farPlane * halfh, m_farPlane, 1.0f);
 
 		for (uint32_t i = 0; i < 4; i++) {						//interpolate with z0, z1 in [0,1]
 			glm::vec4 diff = points[i + 4] - points[i + 0];
@@ -738,24 +839,28 @@ namespace ve {
 	*
 	* \param[in] t1 Startparameter for interpolating the frustum
 	* \param[in] t2 Endparameter for interlopating the frustum
-	* \param[out] points List of 8 points that make up the interpolated frustum in world space
+	* \param[out] points Receives the 8 points that make up the interpolated frustum in world space, must hold VE_NUM_FRUSTUM_POINTS points
 	*
 	*/
-	void VECameraOrtho::getFrustumPoints(std::vector<glm::vec4> &points, float t1, float t2) {
+	void VECameraOrtho::getFrustumPoints(vh::vhSpan<glm::vec4> points, float t1, float t2) {
+		if (points.size() < VE_NUM_FRUSTUM_POINTS) {
+			throw std::runtime_error("Error: getFrustumPoints() needs room for 8 points!");
+		}
+
 		float halfh = m_height / 2.0f;
 		float halfw = m_width / 2.0f;
 
 		glm::mat4 W = getWorldTransform();
 
-		points.push_back( W*glm::vec4(-halfw, -halfh, m_nearPlane, 1.0f));
-		points.push_back( W*glm::vec4( halfw, -halfh, m_nearPlane, 1.0f));
-		points.push_back( W*glm::vec4(-halfw,  halfh, m_nearPlane, 1.0f));
-		points.push_back( W*glm::vec4( halfw,  halfh, m_nearPlane, 1.0f));
+		points[0] = W*glm::vec4(-halfw, -halfh, m_nearPlane, 1.0f);
+		points[1] = W*glm::vec4( halfw, -halfh, m_nearPlane, 1.0f);
+		points[2] = W*glm::vec4(-halfw,  halfh, m_nearPlane, 1.0f);
+		points[3] = W*glm::vec4( halfw,  halfh, m_nearPlane, 1.0f);
 
-		points.push_back( W*glm::vec4(-halfw, -halfh, m_farPlane, 1.0f));
-		points.push_back( W*glm::vec4( halfw, -halfh, m_farPlane, 1.0f));
-		points.push_back( W*glm::vec4(-halfw,  halfh, m_farPlane, 1.0f));
-		points.push_back( W*glm::vec4( halfw,  halfh, m_farPlane, 1.0f));
+		points[4] = W*glm::vec4(-halfw, -halfh, m_farPlane, 1.0f);
+		points[5] = W*glm::vec4( halfw, -halfh, m_farPlane, 1.0f);
+		points[6] = W*glm::vec4(-halfw,  halfh, m_farPlane, 1.0f);
+		points[7] = W*glm::vec4( halfw,  halfh, m_farPlane, 1.0f);
 
 		for (uint32_t i = 0; i < 4; i++) {						//interpolate
 			glm::vec4 diff = points[i + 4] - points[i + 0];
@@ -779,7 +884,7 @@ namespace ve {
 	*
 	*/
 	VELight::VELight(std::string name, glm::mat4 transf, VESceneNode *parent ) : 
-						VESceneObject(name, transf, parent, (uint32_t)sizeof(veUBOPerLight_t)) {
+						VESceneObject(name, transf, parent, (uint32_t)sizeof(veUBOPerLight_t), VE_MASK_LIGHT) {
 	};
 
 
@@ -795,6 +900,16 @@ namespace ve {
 	*
 	*/
 	void VELight::updateUBO(glm::mat4 worldMatrix, uint32_t imageIndex) {
+		if (m_ubo.type[0] != getLightType() || m_ubo.col_ambient != m_col_ambient || m_ubo.col_diffuse != m_col_diffuse ||
+			m_ubo.col_specular != m_col_specular || m_ubo.param != m_param) {		//the last UBO holds what the ECS has
+			veLightComponent *pLight = getSceneManagerPointer()->getECS()->getComponent<veLightComponent>(m_ecsEntity, VE_COMPONENT_LIGHT);
+			pLight->m_type = getLightType();
+			pLight->m_colAmbient = m_col_ambient;
+			pLight->m_colDiffuse = m_col_diffuse;
+			pLight->m_colSpecular = m_col_specular;
+			pLight->m_param = m_param;
+		}
+
 		m_ubo = {};
 
 		m_ubo.type[0] = getLightType();
@@ -859,12 +974,12 @@ namespace ve {
 	*/
 	void VEDirectionalLight::updateShadowCameras(VECamera *pCamera, uint32_t imageIndex) {
 
-		std::vector<float> limits = { 0.0f, 0.05f, 0.15f, 0.50f, 1.0f };	//the frustum is split into 4 segments
+		static const float limits[] = { 0.0f, 0.05f, 0.15f, 0.50f, 1.0f };	//the frustum is split into 4 segments
 
 		for (uint32_t i = 0; i < m_shadowCameras.size(); i++) {
 			VECameraOrtho *pShadowCamera = (VECameraOrtho *)m_shadowCameras[i];
 
-			std::vector<glm::vec4> pointsW;
+			glm::vec4 pointsW[VE_NUM_FRUSTUM_POINTS];
 			pCamera->getFrustumPoints(pointsW, limits[i], limits[i+1]);		//get the ith frustum segment
 
 			glm::vec3 center;
@@ -927,7 +1042,7 @@ namespace ve {
 			pShadowCamera->m_nearPlaneFraction = 0.0f;
 			pShadowCamera->m_farPlaneFraction =  1.0f;
 
-			std::vector<glm::vec3> zaxis =
+			static const glm::vec3 zaxis[] =
 			{
 				glm::vec3(1.0f,  0.0f,  0.0f),
 				glm::vec3(-1.0f,  0.0f,  0.0f),
@@ -936,7 +1051,7 @@ namespace ve {
 				glm::vec3(0.0f,  0.0f,  1.0f),
 				glm::vec3(0.0f,  0.0f, -1.0f)
 			};
-			std::vector<glm::vec3> up =
+			static const glm::vec3 up[] =
 			{
 				glm::vec3(0.0f,  1.0f,  0.0f),
 				glm::vec3(0.0f,  1.0f,  0.0f),
@@ -979,7 +1094,7 @@ namespace ve {
 	void VESpotLight::updateShadowCameras(VECamera *pCamera, uint32_t imageIndex) {
 
 		//std::vector<float> limits = { 0.0f, 0.05f, 0.15f, 0.50f, 1.0f };	//the frustum is split into 4 segments
-		std::vector<float> limits = { 0.0f, 1.0f };		//the frustum is split into 1 segment
+		static const float limits[] = { 0.0f, 1.0f };		//the frustum is split into 1 segment
 
 		for (uint32_t i = 0; i < m_shadowCameras.size(); i++) {
 
@@ -8,6 +8,8 @@
 
 #pragma once
 
+const uint32_t VE_NUM_FRUSTUM_POINTS = 8;		///<Number of points written by VECamera::getFrustumPoints()
+
 namespace ve {
 
 	//----------------------------------------------------------------------------------------------
@@ -26,6 +28,8 @@ namespace ve {
 	* relation is stored in the parent and children pointers. If the scene node does not have a parent,
 	* then the parent is automatically the world frame of reference.
 	* Since there is a parent-child relationship, scene nodes build up trees of nodes.
+	* Each scene node owns an entity of the scene manager's ECS, which receives the local and world transforms
+	* when a node update finds that they have changed.
 	*
 	*/
 
@@ -41,7 +45,12 @@ namespace ve {
 		};
 
 	protected:
-		glm::mat4		m_transform = glm::mat4(1.0);		///<Transform from local to parent space, the engine uses Y-UP, Left-handed
+		glm::mat4		m_transform;						///<Transform from local to parent space, the engine uses Y-UP, Left-handed
+		glm::mat4		m_worldTransform = glm::mat4(1.0f);	///<World transform last written to the ECS
+		bool			m_transformChanged = true;			///<Local transform has changed since it was last written to the ECS
+		veEntityHandle	m_ecsEntity;						///<ECS entity mirroring the data of this node for ECS systems
+
+		virtual void	updateECS();						//Write the transforms to the ECS entity
 
 	public:
 		VESceneNode *				m_parent = nullptr;		///<Pointer to entity parent
@@ -50,13 +59,14 @@ namespace ve {
 		//-------------------------------------------------------------------------------------
 		//Class and type
 
-		VESceneNode(std::string name, glm::mat4 transf = glm::mat4(1.0f), VESceneNode *parent = nullptr);
+		VESceneNode(std::string name, glm::mat4 transf = glm::mat4(1.0f), VESceneNode *parent = nullptr, veComponentMask components = 0);
 
-		///Destructor of the scene node class.
-		virtual ~VESceneNode() {};
+		virtual ~VESceneNode();
 
 		///\returns the scene node type
 		virtual veNodeType	getNodeType() { return VE_OBJECT_TYPE_SCENENODE; };
+		///\returns the ECS entity of the scene node
+		veEntityHandle		getECSEntity() { return m_ecsEntity; };
 
 		//-------------------------------------------------------------------------------------
 		//transforms
@@ -92,7 +102,7 @@ namespace ve {
 		//Bounding volumes
 
 		virtual void getBoundingSphere( glm::vec3 *center, float *radius );		//return center and radius for a bounding sphere
-		virtual void getOBB(std::vector<glm::vec4> &pointsW, float t1, float t2, glm::vec3 &center, float &width, float &height, float &depth);	//return min and max along the axes
+		virtual void getOBB(vh::vhSpan<glm::vec4> pointsW, float t1, float t2, glm::vec3 &center, float &width, float &height, float &depth);	//return min and max along the axes
 	};
 
 
@@ -123,7 +133,8 @@ namespace ve {
 		std::vector<VmaAllocation>		m_uniformBuffersAllocation;		///<VMA information for the UBOs
 		std::vector<VkDescriptorSet>	m_descriptorSetsUBO;			///<Descriptor sets for UBO
 
-		VESceneObject(std::string name, glm::mat4 transf = glm::mat4(1.0f), VESceneNode *parent = nullptr, uint32_t sizeUBO = 0);
+		VESceneObject(	std::string name, glm::mat4 transf = glm::mat4(1.0f), VESceneNode *parent = nullptr,
+						uint32_t sizeUBO = 0, veComponentMask components = 0);
 		virtual ~VESceneObject();
 	};
 
@@ -153,7 +164,8 @@ namespace ve {
 			VE_ENTITY_TYPE_CUBEMAP,				///<A cubemap for sky boxes
 			VE_ENTITY_TYPE_CUBEMAP2,			///<A cubemap for sky boxes, but simulated
 			VE_ENTITY_TYPE_SKYPLANE,			///<A plane for sky boxes
-			VE_ENTITY_TYPE_TERRAIN_HEIGHTMAP	///<A heightmap for terrain modelling
+			VE_ENTITY_TYPE_TERRAIN_HEIGHTMAP,	///<A heightmap for terrain modelling
+			VE_ENTITY_TYPE_IMPOSTOR				///<Camera facing quads standing in for distant instances of a model
 		};
 
 		///Data that is updated for each object
@@ -167,6 +179,9 @@ namespace ve {
 	protected:
 		veEntityType				m_entityType = VE_ENTITY_TYPE_NORMAL;			///<Entity type
 		glm::vec4					m_param = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);	///<Free parameter, e.g. for texture animation
+		veRenderComponent			m_ecsRender = { nullptr, nullptr, 0xFFFFFFFF, VE_CULL_NO_SLOT };	///<Render data last written to the ECS, invalid flags force the first write
+
+		virtual void updateECS();									//Write the transforms and the world box to the ECS entity
 
 	public:
 		struct veUBOPerObject_t		m_ubo;							///<UBO to be copied to the GPU
@@ -176,6 +191,10 @@ namespace ve {
 		VESubrender *				m_pSubrenderer = nullptr;		///<subrenderer this entity is registered with / replace with a set
 		bool						m_drawEntity = false;			///<should it be drawn at all?
 		bool						m_castsShadow = true;			///<draw in the shadow pass?
+		uint32_t					m_cullSlot = VE_CULL_NO_SLOT;	///<slot in the GPU culling buffers
+		uint32_t					m_broadphaseProxy = VE_BROADPHASE_NO_PROXY;	///<proxy in the broadphase
+		uint32_t					m_octreeProxy = VE_OCTREE_NO_PROXY;			///<proxy in the octree
+		uint32_t					m_raycastMask = 0xFFFFFFFF;		///<hit by ray casts whose mask shares a bit with this
 
 		std::vector<VkDescriptorSet> m_descriptorSetsResources;		///<Per subrenderer descriptor sets for other resources
 
@@ -203,6 +222,7 @@ namespace ve {
 		//Bounding volume
 
 		virtual void getBoundingSphere( glm::vec3 *center, float *radius );		//return center and radius for a bounding sphere
+		cl::clAABB	 getWorldBoundingBox(glm::mat4 worldMatrix);			//return the world space box of the mesh
 	};
 
 
@@ -281,8 +301,8 @@ namespace ve {
 		//Bounding volumes
 
 		virtual void getBoundingSphere(glm::vec3 *center, float *radius);		//return center and radius for a bounding sphere
-		///\returns list of frustum points in world space - pure virtual for the camera base class
-		virtual void getFrustumPoints(std::vector<glm::vec4> &points, float z0 = 0.0f, float z1 = 1.0f)=0;
+		///\brief Write the VE_NUM_FRUSTUM_POINTS frustum points in world space - pure virtual for the camera base class
+		virtual void getFrustumPoints(vh::vhSpan<glm::vec4> points, float z0 = 0.0f, float z1 = 1.0f)=0;
 
 	};
 
@@ -331,7 +351,7 @@ namespace ve {
 		//-------------------------------------------------------------------------------------
 		//Bounding volume
 
-		virtual void getFrustumPoints(std::vector<glm::vec4> &points, float t1 = 0.0f, float t2 = 1.0f);	//return list of frustum points in world space
+		virtual void getFrustumPoints(vh::vhSpan<glm::vec4> points, float t1 = 0.0f, float t2 = 1.0f);	//write the frustum points in world space
 	};
 
 
@@ -376,7 +396,7 @@ namespace ve {
 		//-------------------------------------------------------------------------------------
 		//Bounding volume
 
-		virtual void getFrustumPoints(std::vector<glm::vec4> &points, float t1 = 0.0f, float t2 = 1.0f);	//return list of frustum points in world space
+		virtual void getFrustumPoints(vh::vhSpan<glm::vec4> points, float t1 = 0.0f, float t2 = 1.0f);	//write the frustum points in world space
 
 	};
 
@@ -415,7 +435,7 @@ namespace ve {
 		};
 
 	public:
-		struct veUBOPerLight_t	m_ubo;						///<The UBO that is copied to the GPU
+		struct veUBOPerLight_t	m_ubo = {};					///<The UBO that is copied to the GPU
 		std::vector<VECamera*>	m_shadowCameras;			///<Up to 6 shadow cameras for this light
 
 		glm::vec4 m_col_ambient  = 0.3f * glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);	///<Ambient color
@@ -49,6 +49,9 @@ namespace ve {
 		case VE_EVENT_MOUSESCROLL:
 			return onMouseScroll(event);
 			break;
+		case VE_EVENT_COLLISION:
+			return onCollision(event);
+			break;
 
 		default:
 			break;
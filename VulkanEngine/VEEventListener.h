@@ -38,7 +38,8 @@ namespace ve {
 		VE_EVENT_KEYBOARD=4,			///<A keyboard event
 		VE_EVENT_MOUSEMOVE=8,			///<The mouse has been moved
 		VE_EVENT_MOUSEBUTTON=16,		///<A mouse button event
-		VE_EVENT_MOUSESCROLL=32			///<Mouse scroll event
+		VE_EVENT_MOUSESCROLL=32,		///<Mouse scroll event
+		VE_EVENT_COLLISION=64			///<Bounding boxes of two entities began or ended to overlap, ptr points to a VEBroadphase::vePair
 	};
 
 	/**
@@ -107,6 +108,8 @@ namespace ve {
 		virtual bool onMouseButton(veEvent event) { return false; };
 		///Mouse scroll event.  Event can be consumed.
 		virtual bool onMouseScroll(veEvent event) { return false; };
+		///Collision event from the broadphase. Event can be consumed.
+		virtual bool onCollision(veEvent event) { return false; };
 
 	public:
 		VEEventListener( std::string name );
@@ -244,7 +244,7 @@ namespace ve {
 		
 		//LEFT
 		for (auto ID : randArray) {
-			std::cout << "House ID: " << ID << std::endl;
+			VHLOGINFO("House ID: %d", ID);
 
 			VESceneNode *node = sceneManager->loadModel("The Building" + std::to_string(houseNamesID++), "models/buildings", "buildingV2_" + std::to_string(ID) + ".obj");
 
@@ -260,7 +260,7 @@ namespace ve {
 
 		//RIGHT
 		for (auto ID : randArray2) {
-			std::cout << "House ID: " << ID << std::endl;
+			VHLOGINFO("House ID: %d", ID);
 
 			VESceneNode *node = sceneManager->loadModel("The Building" + std::to_string(houseNamesID++), "models/buildings", "buildingV2_" + std::to_string(ID) + ".obj");
 
@@ -289,7 +289,7 @@ namespace ve {
 
 		zOffsetS += 12.0f;
 
-		std::cout << "moved houses" << std::endl;
+		VHLOGINFO("moved houses");
 	}
 
 
@@ -327,11 +327,11 @@ namespace ve {
 			m_makeScreenshot = false;
 		}
 
-		if (m_makeScreenshotDepth) {
+		if (m_makeScreenshotDepth && getRendererForwardPointer()->getShadowMap( getRendererPointer()->getImageIndex() ).size() > 0) {
 
 			VETexture *map = getRendererForwardPointer()->getShadowMap( getRendererPointer()->getImageIndex() )[0];
 			//VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-			VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;		//the render graph leaves shadow maps in this layout
 
 			VkExtent2D extent = map->m_extent;
 			uint32_t imageSize = extent.width * extent.height;
@@ -40,6 +40,15 @@ namespace ve {
 			sprintf(outbuffer, "Ligthtime (ms): %4.1f", getRendererForwardPointer()->m_AvgCmdLightTime*1000.0f);
 			nk_label(ctx, outbuffer, NK_TEXT_LEFT);
 
+			VEGPUCulling *pCulling = getRendererForwardPointer()->getGPUCulling();
+			if (pCulling != nullptr) {
+				uint32_t numVisible = pCulling->getNumberVisible(getRendererPointer()->getImageIndex(), 0);	//counted by the GPU when this image was last used
+
+				nk_layout_row_dynamic(ctx, 30, 1);
+				sprintf(outbuffer, "Visible: %u / %u", numVisible, pCulling->getNumberSlots());
+				nk_label(ctx, outbuffer, NK_TEXT_LEFT);
+			}
+
 		}
 		nk_end(ctx);
 
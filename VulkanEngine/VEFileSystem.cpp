@@ -0,0 +1,750 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	VEFileSystem * g_pVEFileSystemSingleton = nullptr;	///<Pointer to the only class instance
+
+	///A mounted directory or pack
+	struct VEFileSystem::veMount {
+		std::string			m_mountPoint;				///<Normalized mount point, empty for the root
+		std::string			m_directory;				///<Directory, empty for a pack
+		vh::vhMappedFile	m_pack;						///<Mapping of the pack file
+		const vePackEntry *	m_pEntries = nullptr;		///<Index of the pack, sorted by hash
+		uint32_t			m_numEntries = 0;			///<Number of entries in the index
+		const char *		m_pNames = nullptr;			///<File names of the pack
+		size_t				m_namesSize = 0;			///<Size of the file name block
+	};
+
+
+	//-------------------------------------------------------------------------------------------------------
+	//file data
+
+	///Move constructor, takes over the contents
+	veFileData::veFileData(veFileData &&other) {
+		*this = std::move(other);
+	}
+
+	///Move assignment, takes over the contents
+	veFileData & veFileData::operator=(veFileData &&other) {
+		if (this == &other) return *this;
+		release();
+		m_buffer = std::move(other.m_buffer);
+		m_mapped = other.m_mapped;
+		m_pData = other.m_pData;
+		m_size = other.m_size;
+		other.m_mapped = vh::vhMappedFile();
+		other.m_buffer.clear();
+		other.m_pData = nullptr;
+		other.m_size = 0;
+		return *this;
+	}
+
+	///Unmap or free the contents
+	void veFileData::release() {
+		vh::vhFileUnmap(m_mapped);
+		m_buffer.clear();
+		m_buffer.shrink_to_fit();
+		m_pData = nullptr;
+		m_size = 0;
+	}
+
+
+	//-------------------------------------------------------------------------------------------------------
+	//Assimp IO
+
+	///Assimp stream reading from a veFileData
+	class veAssimpStream : public Assimp::IOStream {
+	protected:
+		veFileData	m_data;				///<The file contents
+		size_t		m_pos = 0;			///<Read position
+
+	public:
+		///Constructor
+		veAssimpStream(veFileData &&data) : m_data(std::move(data)) {};
+		///Destructor
+		virtual ~veAssimpStream() {};
+
+		///Read up to count elements
+		virtual size_t Read(void *pBuffer, size_t size, size_t count) {
+			if (size == 0) return 0;
+			count = std::min(count, (m_data.m_size - m_pos) / size);
+			memcpy(pBuffer, m_data.m_pData + m_pos, count * size);
+			m_pos += count * size;
+			return count;
+		}
+		///Files are read only
+		virtual size_t Write(const void *, size_t, size_t) { return 0; };
+
+		///Move the read position, the offset counts backwards from the end for aiOrigin_END
+		virtual aiReturn Seek(size_t offset, aiOrigin origin) {
+			size_t pos;
+			switch (origin) {
+			case aiOrigin_SET: pos = offset; break;
+			case aiOrigin_CUR: pos = m_pos + offset; break;
+			case aiOrigin_END:
+				if (offset > m_data.m_size) return aiReturn_FAILURE;
+				pos = m_data.m_size - offset;
+				break;
+			default: return aiReturn_FAILURE;
+			}
+			if (pos > m_data.m_size) return aiReturn_FAILURE;
+			m_pos = pos;
+			return aiReturn_SUCCESS;
+		}
+		///\returns the read position
+		virtual size_t Tell() const { return m_pos; };
+		///\returns the size of the file
+		virtual size_t FileSize() const { return m_data.m_size; };
+		///Nothing to flush
+		virtual void Flush() {};
+	};
+
+	///Assimp IO system opening files through VEFileSystem
+	class veAssimpIOSystem : public Assimp::IOSystem {
+	protected:
+		VEFileSystem *	m_pFileSystem;	///<The file system
+
+	public:
+		///Constructor
+		veAssimpIOSystem(VEFileSystem *pFileSystem) : m_pFileSystem(pFileSystem) {};
+		///Destructor
+		virtual ~veAssimpIOSystem() {};
+
+		///\returns true if the file exists
+		virtual bool Exists(const char *pFile) const { return m_pFileSystem->exists(pFile); };
+		///\returns the separator of the normalized paths
+		virtual char getOsSeparator() const { return '/'; };
+
+		///Open a file for reading, writing is not supported
+		virtual Assimp::IOStream * Open(const char *pFile, const char *pMode = "rb") {
+			if (strpbrk(pMode, "wa+") != nullptr) return nullptr;
+			veFileData data;
+			if (!m_pFileSystem->read(pFile, data)) return nullptr;
+			return new veAssimpStream(std::move(data));
+		}
+		///Close a file
+		virtual void Close(Assimp::IOStream *pFile) { delete pFile; };
+	};
+
+
+	//-------------------------------------------------------------------------------------------------------
+	//file system
+
+	/**
+	*
+	* \brief Constructor, redirects vh::vhFileRead() to the file system
+	*
+	*/
+	VEFileSystem::VEFileSystem() {
+		g_pVEFileSystemSingleton = this;
+		vh::vhFileSetReadFunction([this](const std::string &filename, std::vector<char> &buffer) {
+			return read(filename, buffer);
+		});
+	}
+
+
+	/**
+	*
+	* \brief Destructor, unmounts everything
+	*
+	*/
+	VEFileSystem::~VEFileSystem() {
+		vh::vhFileSetReadFunction(nullptr);
+		unmountAll();
+		if (g_pVEFileSystemSingleton == this) g_pVEFileSystemSingleton = nullptr;
+	}
+
+
+	/**
+	*
+	* \brief Unify a path
+	*
+	* Backslashes become slashes, empty and . parts are removed, and .. removes the part before it.
+	* Leading .. and a leading slash are kept.
+	*
+	* \param[in] path The path
+	* \returns the normalized path
+	*
+	*/
+	std::string VEFileSystem::normalize(const std::string &path) {
+		std::string result;
+		result.reserve(path.size());
+		if (!path.empty() && (path[0] == '/' || path[0] == '\\')) result.push_back('/');
+		size_t root = result.size();
+
+		size_t pos = 0;
+		while (pos < path.size()) {
+			size_t end = path.find_first_of("/\\", pos);
+			if (end == std::string::npos) end = path.size();
+			size_t length = end - pos;
+
+			size_t slash = result.find_last_of('/');
+			size_t last = slash == std::string::npos ? 0 : slash + 1;		//start of the last part of the result
+
+			if (length == 0 || (length == 1 && path[pos] == '.')) {
+				//skip empty and . parts
+			}
+			else if (length == 2 && path[pos] == '.' && path[pos + 1] == '.' && result.size() > root &&
+					result.compare(last, std::string::npos, "..") != 0) {
+				result.resize(last > root ? last - 1 : root);
+			}
+			else if (length == 2 && path[pos] == '.' && path[pos + 1] == '.' && root > 0) {
+				//there is nothing above the root
+			}
+			else {
+				if (result.size() > root) result.push_back('/');
+				result.append(path, pos, length);
+			}
+			pos = end + 1;
+		}
+		return result;
+	}
+
+
+	/**
+	*
+	* \brief Hash of a file name in a pack (64 bit FNV-1a)
+	*
+	* \param[in] pName The normalized name relative to the mount point
+	* \param[in] length Length of the name
+	* \returns the hash
+	*
+	*/
+	uint64_t VEFileSystem::hash(const char *pName, size_t length) {
+		uint64_t h = 0xcbf29ce484222325ULL;
+		for (size_t i = 0; i < length; i++) {
+			h ^= (uint8_t)pName[i];
+			h *= 0x100000001b3ULL;
+		}
+		return h;
+	}
+
+
+	/**
+	*
+	* \brief Mount a directory
+	*
+	* Files below the mount point are then looked up in the directory first.
+	*
+	* \param[in] mountPoint Path prefix, e.g. "media/models", empty for all paths
+	* \param[in] directory The directory the files are in
+	* \returns false if the directory name is empty
+	*
+	*/
+	bool VEFileSystem::mountDirectory(std::string mountPoint, std::string directory) {
+		if (directory.empty()) return false;
+
+		veMount *pMount = new veMount();
+		pMount->m_mountPoint = normalize(mountPoint);
+		pMount->m_directory = normalize(directory);
+		if (pMount->m_directory.empty()) pMount->m_directory = ".";
+		m_mounts.push_back(pMount);
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Mount a pack file
+	*
+	* The pack is mapped into memory and its index is checked, then it stays mapped until it is unmounted.
+	*
+	* \param[in] mountPoint Path prefix, e.g. "media/models", empty for all paths
+	* \param[in] packFile The pack, created by createPack()
+	* \returns false if the pack could not be mapped or is broken
+	*
+	*/
+	bool VEFileSystem::mountPack(std::string mountPoint, std::string packFile) {
+		vh::vhMappedFile pack;
+		if (!vh::vhFileMap(packFile, pack)) return false;
+
+		vePackHeader header;
+		bool ok = pack.m_size >= sizeof(header);
+		if (ok) {
+			memcpy(&header, pack.m_pData, sizeof(header));
+			ok = header.m_magic == VE_PACK_MAGIC && header.m_version == VE_PACK_VERSION &&
+				header.m_indexOffset % alignof(vePackEntry) == 0 &&
+				header.m_indexOffset <= pack.m_size &&
+				header.m_numEntries <= (pack.m_size - header.m_indexOffset) / sizeof(vePackEntry) &&
+				header.m_namesOffset <= pack.m_size;
+		}
+
+		const vePackEntry *pEntries = ok ? (const vePackEntry*)(pack.m_pData + header.m_indexOffset) : nullptr;
+		size_t namesSize = ok ? pack.m_size - (size_t)header.m_namesOffset : 0;
+		for (uint32_t i = 0; ok && i < header.m_numEntries; i++) {
+			const vePackEntry &entry = pEntries[i];
+			ok = entry.m_offset <= pack.m_size && entry.m_storedSize <= pack.m_size - entry.m_offset &&
+				(size_t)entry.m_nameOffset + entry.m_nameLength <= namesSize &&
+				(i == 0 || pEntries[i - 1].m_hash <= entry.m_hash) &&
+				((entry.m_flags & VE_PACK_FLAG_LZ4) != 0 || entry.m_storedSize == entry.m_size);
+		}
+		if (!ok) {
+			vh::vhFileUnmap(pack);
+			return false;
+		}
+
+		veMount *pMount = new veMount();
+		pMount->m_mountPoint = normalize(mountPoint);
+		pMount->m_pack = pack;
+		pMount->m_pEntries = pEntries;
+		pMount->m_numEntries = header.m_numEntries;
+		pMount->m_pNames = pack.m_pData + header.m_namesOffset;
+		pMount->m_namesSize = namesSize;
+		m_mounts.push_back(pMount);
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Remove all mounts, unmapping all packs
+	*
+	* Data read from the packs becomes invalid.
+	*
+	*/
+	void VEFileSystem::unmountAll() {
+		for (auto pMount : m_mounts) {
+			vh::vhFileUnmap(pMount->m_pack);
+			delete pMount;
+		}
+		m_mounts.clear();
+	}
+
+
+	/**
+	*
+	* \brief Find the next mount a path is below
+	*
+	* \param[in] path The normalized path
+	* \param[out] relative The path relative to the mount point
+	* \param[in,out] start Search mounts before this index, is set to the index of the found mount
+	* \returns the mount, or nullptr if there is no more mount
+	*
+	*/
+	VEFileSystem::veMount * VEFileSystem::findMount(const std::string &path, std::string &relative, uint32_t &start) {
+		while (start > 0) {
+			veMount *pMount = m_mounts[--start];
+			const std::string &mountPoint = pMount->m_mountPoint;
+
+			if (mountPoint.empty()) {
+				relative = path;
+				return pMount;
+			}
+			if (path.size() > mountPoint.size() && path[mountPoint.size()] == '/' &&
+				path.compare(0, mountPoint.size(), mountPoint) == 0) {
+				relative = path.substr(mountPoint.size() + 1);
+				return pMount;
+			}
+		}
+		return nullptr;
+	}
+
+
+	/**
+	*
+	* \brief Find a file in a pack
+	*
+	* \param[in] pMount The mount of the pack
+	* \param[in] relative Path relative to the mount point
+	* \returns the entry of the file, or nullptr if the pack does not contain it
+	*
+	*/
+	const vePackEntry * VEFileSystem::findEntry(veMount *pMount, const std::string &relative) {
+		if (pMount->m_pEntries == nullptr) return nullptr;
+
+		uint64_t h = hash(relative.data(), relative.size());
+		const vePackEntry *pEnd = pMount->m_pEntries + pMount->m_numEntries;
+		const vePackEntry *pEntry = std::lower_bound(pMount->m_pEntries, pEnd, h,
+			[](const vePackEntry &entry, uint64_t value) { return entry.m_hash < value; });
+
+		for (; pEntry < pEnd && pEntry->m_hash == h; pEntry++) {
+			if (pEntry->m_nameLength == relative.size() &&
+				memcmp(pMount->m_pNames + pEntry->m_nameOffset, relative.data(), relative.size()) == 0) return pEntry;
+		}
+		return nullptr;
+	}
+
+
+	/**
+	*
+	* \brief Read a file from a pack
+	*
+	* Stored files point into the mapped pack, compressed files are decompressed into the buffer of data.
+	*
+	* \param[in] pMount The mount of the pack
+	* \param[in] pEntry Entry of the file
+	* \param[out] data The file contents
+	* \returns false if the blob could not be decompressed
+	*
+	*/
+	bool VEFileSystem::readPack(veMount *pMount, const vePackEntry *pEntry, veFileData &data) {
+		const char *pBlob = pMount->m_pack.m_pData + pEntry->m_offset;
+
+		if ((pEntry->m_flags & VE_PACK_FLAG_LZ4) == 0) {
+			data.m_pData = pBlob;
+			data.m_size = (size_t)pEntry->m_size;
+			return true;
+		}
+
+		data.m_buffer.resize((size_t)pEntry->m_size);
+		if (!lz4Decompress(pBlob, (size_t)pEntry->m_storedSize, data.m_buffer.data(), data.m_buffer.size())) {
+			data.release();
+			return false;
+		}
+		data.m_pData = data.m_buffer.data();
+		data.m_size = data.m_buffer.size();
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Test whether a file exists
+	*
+	* \param[in] path Path of the file
+	* \returns true if a mount or the disk contains the file
+	*
+	*/
+	bool VEFileSystem::exists(const std::string &path) {
+		std::string name = normalize(path);
+		std::string relative;
+		uint32_t start = (uint32_t)m_mounts.size();
+
+		while (veMount *pMount = findMount(name, relative, start)) {
+			if (pMount->m_directory.empty()) {
+				if (findEntry(pMount, relative) != nullptr) return true;
+			}
+			else if (std::ifstream(pMount->m_directory + "/" + relative).good()) return true;
+		}
+		return std::ifstream(name).good();
+	}
+
+
+	/**
+	*
+	* \brief Read a file
+	*
+	* The mounts are searched from the most recent to the first one, then the path is tried on disk.
+	* Files found on disk are mapped into memory.
+	*
+	* \param[in] path Path of the file
+	* \param[out] data The file contents
+	* \returns false if the file was not found, or is empty
+	*
+	*/
+	bool VEFileSystem::read(const std::string &path, veFileData &data) {
+		data.release();
+
+		std::string name = normalize(path);
+		std::string relative;
+		uint32_t start = (uint32_t)m_mounts.size();
+
+		while (veMount *pMount = findMount(name, relative, start)) {
+			if (pMount->m_directory.empty()) {
+				const vePackEntry *pEntry = findEntry(pMount, relative);
+				if (pEntry != nullptr) return readPack(pMount, pEntry, data);
+			}
+			else if (vh::vhFileMap(pMount->m_directory + "/" + relative, data.m_mapped)) break;
+		}
+
+		if (data.m_mapped.m_pData == nullptr && !vh::vhFileMap(name, data.m_mapped)) return false;
+		data.m_pData = data.m_mapped.m_pData;
+		data.m_size = data.m_mapped.m_size;
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Read a file into a buffer
+	*
+	* \param[in] path Path of the file
+	* \param[out] buffer Receives a copy of the file contents
+	* \returns false if the file was not found, or is empty
+	*
+	*/
+	bool VEFileSystem::read(const std::string &path, std::vector<char> &buffer) {
+		veFileData data;
+		if (!read(path, data)) return false;
+		if (!data.m_buffer.empty()) buffer = std::move(data.m_buffer);
+		else buffer.assign(data.m_pData, data.m_pData + data.m_size);
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Read a file on the thread pool
+	*
+	* Must be called from the main thread.
+	*
+	* \param[in] path Path of the file
+	* \returns a future holding the file contents, empty if the file was not found
+	*
+	*/
+	std::future<veFileData> VEFileSystem::readAsync(std::string path) {
+		return getEnginePointer()->m_threadPool->submit([this, path]() {
+			veFileData data;
+			read(path, data);
+			return data;
+		});
+	}
+
+
+	/**
+	*
+	* \brief Read many files in parallel, e.g. all assets of a level
+	*
+	* Must be called from the main thread.
+	*
+	* \param[in] paths Paths of the files
+	* \param[out] data The contents of the files, empty for files not found
+	* \returns the number of files read
+	*
+	*/
+	uint32_t VEFileSystem::readAll(const std::vector<std::string> &paths, std::vector<veFileData> &data) {
+		data.clear();
+		data.resize(paths.size());
+		std::vector<uint8_t> ok(paths.size(), 0);
+		VEObjLoader::parallelRun((uint32_t)paths.size(), [&](uint32_t i) { ok[i] = read(paths[i], data[i]) ? 1 : 0; });
+		return (uint32_t)std::count(ok.begin(), ok.end(), 1);
+	}
+
+
+	/**
+	*
+	* \brief Create an IO system so Assimp reads its files through the file system
+	*
+	* \returns the IO system, Assimp::Importer::SetIOHandler() takes ownership
+	*
+	*/
+	Assimp::IOSystem * VEFileSystem::createAssimpIOSystem() {
+		return new veAssimpIOSystem(this);
+	}
+
+
+	//-------------------------------------------------------------------------------------------------------
+	//packs
+
+	/**
+	*
+	* \brief Write a pack file
+	*
+	* Each blob starts at a multiple of VE_PACK_ALIGNMENT. If compression is on, a file is stored as LZ4 block
+	* if that saves at least an eighth of its size. The index and the names follow the blobs.
+	*
+	* \param[in] packFile Name of the new pack
+	* \param[in] directory Directory the files are read from
+	* \param[in] names Names of the files relative to the directory, they are found by these names after mounting
+	* \param[in] compress Try to compress the files
+	* \returns false if a file could not be read, a name appears twice, or the pack could not be written
+	*
+	*/
+	bool VEFileSystem::createPack(std::string packFile, std::string directory, const std::vector<std::string> &names, bool compress) {
+		std::ofstream out(packFile, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+
+		vePackHeader header;
+		out.write((const char*)&header, sizeof(header));
+		uint64_t offset = sizeof(header);
+
+		auto pad = [&](uint64_t alignment) {
+			static const char zeros[VE_PACK_ALIGNMENT] = {};
+			uint64_t padding = (alignment - offset % alignment) % alignment;
+			out.write(zeros, (std::streamsize)padding);
+			offset += padding;
+		};
+
+		std::vector<vePackEntry> entries(names.size());
+		std::string nameBlock;
+		std::vector<char> buffer;
+		std::vector<char> compressed;
+		for (uint32_t i = 0; i < names.size(); i++) {
+			std::string name = normalize(names[i]);
+
+			std::ifstream in(directory + "/" + name, std::ios::ate | std::ios::binary);
+			if (!in.is_open()) return false;
+			buffer.resize((size_t)in.tellg());
+			in.seekg(0);
+			in.read(buffer.data(), buffer.size());
+			if (!in) return false;
+
+			const std::vector<char> *pBlob = &buffer;
+			if (compress && buffer.size() < 0x7FFFFFFF) {
+				lz4Compress(buffer.data(), buffer.size(), compressed);
+				if (compressed.size() <= buffer.size() - buffer.size() / 8) {
+					pBlob = &compressed;
+					entries[i].m_flags = VE_PACK_FLAG_LZ4;
+				}
+			}
+
+			pad(VE_PACK_ALIGNMENT);
+			entries[i].m_hash = hash(name.data(), name.size());
+			entries[i].m_offset = offset;
+			entries[i].m_storedSize = pBlob->size();
+			entries[i].m_size = buffer.size();
+			entries[i].m_nameOffset = (uint32_t)nameBlock.size();
+			entries[i].m_nameLength = (uint32_t)name.size();
+			nameBlock += name;
+			out.write(pBlob->data(), (std::streamsize)pBlob->size());
+			offset += pBlob->size();
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const vePackEntry &a, const vePackEntry &b) { return a.m_hash < b.m_hash; });
+		for (size_t i = 0; i < entries.size(); i++) {
+			for (size_t j = i + 1; j < entries.size() && entries[j].m_hash == entries[i].m_hash; j++) {
+				if (entries[i].m_nameLength == entries[j].m_nameLength &&
+					nameBlock.compare(entries[i].m_nameOffset, entries[i].m_nameLength,
+									nameBlock, entries[j].m_nameOffset, entries[j].m_nameLength) == 0) return false;
+			}
+		}
+
+		pad(alignof(vePackEntry));
+		header.m_numEntries = (uint32_t)entries.size();
+		header.m_indexOffset = offset;
+		out.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(vePackEntry)));
+		offset += entries.size() * sizeof(vePackEntry);
+		header.m_namesOffset = offset;
+		out.write(nameBlock.data(), (std::streamsize)nameBlock.size());
+
+		out.seekp(0);
+		out.write((const char*)&header, sizeof(header));
+		return out.good();
+	}
+
+
+	///Append an LZ4 length extension
+	static void lz4WriteLength(std::vector<char> &dst, size_t length) {
+		while (length >= 255) {
+			dst.push_back((char)255);
+			length -= 255;
+		}
+		dst.push_back((char)length);
+	}
+
+
+	/**
+	*
+	* \brief Compress data into an LZ4 block
+	*
+	* A simple greedy compressor finding matches with a hash table of 4 byte sequences. The result is a standard
+	* LZ4 block, so packs can also be produced by other tools.
+	*
+	* \param[in] pSrc The data
+	* \param[in] srcSize Size of the data, less than 2 GB
+	* \param[out] dst The LZ4 block
+	*
+	*/
+	void VEFileSystem::lz4Compress(const char *pSrc, size_t srcSize, std::vector<char> &dst) {
+		const size_t minMatch = 4;
+		const size_t matchStartLimit = 12;				//the last match starts at least 12 bytes before the end
+		const size_t lastLiterals = 5;					//the last 5 bytes are literals
+
+		dst.clear();
+		dst.reserve(srcSize + srcSize / 255 + 16);
+		std::vector<int32_t> table(1 << 16, -1);
+
+		size_t anchor = 0;
+		size_t i = 0;
+		while (srcSize > matchStartLimit && i < srcSize - matchStartLimit) {
+			uint32_t sequence;
+			memcpy(&sequence, pSrc + i, minMatch);
+			uint32_t h = (sequence * 2654435761u) >> 16;
+			int32_t ref = table[h];
+			table[h] = (int32_t)i;
+			if (ref < 0 || i - ref > 0xFFFF || memcmp(pSrc + ref, pSrc + i, minMatch) != 0) {
+				i++;
+				continue;
+			}
+
+			size_t length = minMatch;
+			while (i + length < srcSize - lastLiterals && pSrc[ref + length] == pSrc[i + length]) length++;
+
+			size_t numLiterals = i - anchor;
+			size_t offset = i - ref;
+			dst.push_back((char)((std::min(numLiterals, (size_t)15) << 4) | std::min(length - minMatch, (size_t)15)));
+			if (numLiterals >= 15) lz4WriteLength(dst, numLiterals - 15);
+			dst.insert(dst.end(), pSrc + anchor, pSrc + i);
+			dst.push_back((char)(offset & 0xFF));
+			dst.push_back((char)(offset >> 8));
+			if (length - minMatch >= 15) lz4WriteLength(dst, length - minMatch - 15);
+
+			i += length;
+			anchor = i;
+		}
+
+		size_t numLiterals = srcSize - anchor;
+		dst.push_back((char)(std::min(numLiterals, (size_t)15) << 4));
+		if (numLiterals >= 15) lz4WriteLength(dst, numLiterals - 15);
+		dst.insert(dst.end(), pSrc + anchor, pSrc + srcSize);
+	}
+
+
+	/**
+	*
+	* \brief Decompress an LZ4 block
+	*
+	* All lengths and offsets are checked, so broken packs cannot write outside the destination.
+	*
+	* \param[in] pSrc The LZ4 block
+	* \param[in] srcSize Size of the block
+	* \param[out] pDst Receives the data
+	* \param[in] dstSize Size of the data
+	* \returns false if the block is broken or does not decompress to exactly dstSize bytes
+	*
+	*/
+	bool VEFileSystem::lz4Decompress(const char *pSrc, size_t srcSize, char *pDst, size_t dstSize) {
+		const uint8_t *ip = (const uint8_t*)pSrc;
+		const uint8_t *ipEnd = ip + srcSize;
+		char *op = pDst;
+		char *opEnd = pDst + dstSize;
+
+		auto readLength = [&](size_t &length) {
+			uint8_t b;
+			do {
+				if (ip >= ipEnd) return false;
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+			return true;
+		};
+
+		while (ip < ipEnd) {
+			uint8_t token = *ip++;
+
+			size_t numLiterals = token >> 4;
+			if (numLiterals == 15 && !readLength(numLiterals)) return false;
+			if ((size_t)(ipEnd - ip) < numLiterals || (size_t)(opEnd - op) < numLiterals) return false;
+			memcpy(op, ip, numLiterals);
+			ip += numLiterals;
+			op += numLiterals;
+			if (ip == ipEnd) break;									//the last sequence has no match
+
+			if (ipEnd - ip < 2) return false;
+			size_t offset = ip[0] | ((size_t)ip[1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > (size_t)(op - pDst)) return false;
+
+			size_t length = token & 15;
+			if (length == 15 && !readLength(length)) return false;
+			length += 4;
+			if ((size_t)(opEnd - op) < length) return false;
+
+			const char *match = op - offset;
+			if (offset >= length) memcpy(op, match, length);
+			else for (size_t i = 0; i < length; i++) op[i] = match[i];	//overlapping copy repeats the pattern
+			op += length;
+		}
+		return op == opEnd;
+	}
+
+}
+
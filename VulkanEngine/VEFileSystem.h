@@ -0,0 +1,128 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+
+#ifndef getFileSystemPointer
+#define getFileSystemPointer() g_pVEFileSystemSingleton
+#endif
+
+const uint32_t VE_PACK_MAGIC = 0x4B504556;		///<"VEPK", first bytes of a pack file
+const uint32_t VE_PACK_VERSION = 1;				///<Version of the pack format
+const uint32_t VE_PACK_ALIGNMENT = 4096;		///<Blobs start at multiples of this, so they are page aligned in the mapping
+const uint32_t VE_PACK_FLAG_LZ4 = 0x1;			///<The blob is an LZ4 block
+
+
+namespace ve {
+
+	class VEFileSystem;
+	extern VEFileSystem* g_pVEFileSystemSingleton;	///<Pointer to the only class instance
+
+	///Header at the start of a pack file
+	struct vePackHeader {
+		uint32_t	m_magic = VE_PACK_MAGIC;		///<Must be VE_PACK_MAGIC
+		uint32_t	m_version = VE_PACK_VERSION;	///<Must be VE_PACK_VERSION
+		uint32_t	m_numEntries = 0;				///<Number of files in the pack
+		uint32_t	m_reserved = 0;					///<Zero
+		uint64_t	m_indexOffset = 0;				///<Offset of the index, entries are sorted by hash
+		uint64_t	m_namesOffset = 0;				///<Offset of the file names
+	};
+
+	///One file in a pack
+	struct vePackEntry {
+		uint64_t	m_hash = 0;						///<Hash of the file name
+		uint64_t	m_offset = 0;					///<Offset of the blob, a multiple of VE_PACK_ALIGNMENT
+		uint64_t	m_storedSize = 0;				///<Size of the blob in the pack
+		uint64_t	m_size = 0;						///<Size of the file
+		uint32_t	m_nameOffset = 0;				///<Offset of the name relative to m_namesOffset
+		uint32_t	m_nameLength = 0;				///<Length of the name
+		uint32_t	m_flags = 0;					///<VE_PACK_FLAG_LZ4 if the blob is compressed
+		uint32_t	m_reserved = 0;					///<Zero
+	};
+
+	/**
+	*
+	* \brief Contents of a file read by VEFileSystem
+	*
+	* The data either points into a mapped pack, into a mapping of a single file, or into a buffer holding
+	* decompressed data. It stays valid as long as the object exists and the pack is mounted.
+	*
+	*/
+	struct veFileData {
+		const char *		m_pData = nullptr;		///<Start of the file contents
+		size_t				m_size = 0;				///<Size of the file
+		std::vector<char>	m_buffer;				///<Decompressed data
+		vh::vhMappedFile	m_mapped;				///<Mapping of a single file
+
+		///Constructor
+		veFileData() {};
+		veFileData(veFileData &&other);
+		veFileData & operator=(veFileData &&other);
+		veFileData(const veFileData &) = delete;
+		veFileData & operator=(const veFileData &) = delete;
+		///Destructor
+		~veFileData() { release(); };
+
+		void release();						//unmap or free the contents
+	};
+
+
+	/**
+	*
+	* \brief Virtual file system all assets are read through
+	*
+	* Directories and pack files can be mounted at a mount point, e.g. "media/models". A path below a mount point is
+	* looked up in the mounts, the most recent mount first. Paths not found in any mount are read from disk as they
+	* are, so mounting is optional and existing path names keep working.
+	*
+	* A pack is mapped into memory once when it is mounted. Its index is sorted by name hash and searched with a binary
+	* search, so reading a file from a pack needs no file open and no seek, and stored blobs are handed out as pointers
+	* into the mapping. Compressed blobs are LZ4 blocks and are decompressed into a buffer. Packs are written by
+	* createPack().
+	*
+	* Shaders and textures are read through vh::vhFileRead(), which is redirected here. Assimp gets an IO system
+	* reading through here, VEObjLoader, VEGltfLoader and cube maps call read() directly. Mount before loading assets,
+	* reads are thread safe as long as no mount changes.
+	*
+	*/
+	class VEFileSystem {
+
+	protected:
+		struct veMount;
+
+		std::vector<veMount*>	m_mounts;		///<All mounts, later mounts are searched first
+
+		veMount *	findMount(const std::string &path, std::string &relative, uint32_t &start);	//next mount containing path
+		const vePackEntry * findEntry(veMount *pMount, const std::string &relative);	//entry of a file in a pack
+		bool		readPack(veMount *pMount, const vePackEntry *pEntry, veFileData &data);	//read a file from a pack
+
+	public:
+		VEFileSystem();
+		virtual ~VEFileSystem();
+
+		bool	mountDirectory(std::string mountPoint, std::string directory);	//mount a directory
+		bool	mountPack(std::string mountPoint, std::string packFile);		//mount a pack file
+		void	unmountAll();													//remove all mounts
+
+		bool	exists(const std::string &path);								//is the file there
+		bool	read(const std::string &path, veFileData &data);				//read a file
+		bool	read(const std::string &path, std::vector<char> &buffer);		//read a file into a buffer
+		std::future<veFileData> readAsync(std::string path);					//read a file on the thread pool
+		uint32_t readAll(const std::vector<std::string> &paths, std::vector<veFileData> &data);	//read many files in parallel
+
+		Assimp::IOSystem * createAssimpIOSystem();								//IO system for Assimp::Importer::SetIOHandler()
+
+		static std::string	normalize(const std::string &path);				//unify separators, remove . and ..
+		static uint64_t		hash(const char *pName, size_t length);			//hash of a file name in a pack
+		static bool	createPack(std::string packFile, std::string directory, const std::vector<std::string> &names, bool compress);	//write a pack file
+		static void	lz4Compress(const char *pSrc, size_t srcSize, std::vector<char> &dst);	//compress into an LZ4 block
+		static bool	lz4Decompress(const char *pSrc, size_t srcSize, char *pDst, size_t dstSize);	//decompress an LZ4 block
+	};
+
+}
+
@@ -0,0 +1,842 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+/*
+GLSL source of shader/Forward/Cull/comp.spv, compile with glslangValidator -V cull.comp -o comp.spv
+
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct Object	{ vec4 sphere; uint group; uint flags; uint pad0; uint pad1; mat4 model; mat4 modelInvTrans; vec4 color; vec4 param; };
+struct View		{ vec4 planes[6]; uint flags; uint pad0; uint pad1; uint pad2; };
+struct Draw		{ uint indexCount; uint instanceCount; uint firstIndex; int vertexOffset; uint firstInstance; };
+struct Group	{ uint offset; uint indexCount; };
+
+layout(set = 0, binding = 0) readonly buffer Objects	{ Object objects[]; };
+layout(set = 0, binding = 1) readonly buffer Views		{ View views[]; };
+layout(set = 0, binding = 2) buffer Draws				{ Draw draws[]; };
+layout(set = 0, binding = 3) buffer Visible				{ uint counts[16]; uint slots[]; };
+layout(set = 0, binding = 4) readonly buffer Groups		{ Group groups[]; };
+
+layout(push_constant) uniform Params { uint numObjects; uint maxObjects; uint numViews; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= numObjects) return;
+
+	uint flags = objects[i].flags;
+	if (flags == 0) return;
+	vec4 sphere = objects[i].sphere;
+	uint group = objects[i].group;
+
+	for (uint v = 0; v < numViews; v++) {
+		bool visible = (flags & views[v].flags) != 0;
+		for (int p = 0; p < 6 && visible; p++) {
+			visible = dot(views[v].planes[p].xyz, sphere.xyz) + views[v].planes[p].w >= -sphere.w;
+		}
+		if (!visible) continue;
+
+		uint d = v * maxObjects + group;
+		draws[d].indexCount = groups[group].indexCount;
+		uint k = atomicAdd(draws[d].instanceCount, 1);
+		slots[v * maxObjects + groups[group].offset + k] = i;
+		atomicAdd(counts[v], 1);
+	}
+}
+
+
+Culled permutations of the object shaders (feature key bit VESubrender::VE_SHADER_FEATURE_GPU_CULLING) read the
+per object data of an instance from the culling set instead of the per object UBO. The set follows the per object sets,
+it is set 4 for subrenderers without resource set and set 5 otherwise:
+
+layout(constant_id = 2) const uint featureKey = 0;
+layout(set = 4, binding = 0) readonly buffer Objects	{ Object objects[]; };
+layout(set = 4, binding = 1) readonly buffer Visible	{ uint counts[16]; uint slots[]; };
+layout(push_constant) uniform Culled { uint first; };		//view * maxObjects + group offset
+
+	mat4 model = (featureKey & 8) != 0 ? objects[slots[first + gl_InstanceIndex]].model : objectUBO.model;
+*/
+
+
+namespace ve {
+
+	///Push constants of the culling compute shader
+	struct veCullParams {
+		uint32_t numObjects;		///<Number of slots to test
+		uint32_t maxObjects;		///<Stride of the views in the draw and slot arrays
+		uint32_t numViews;			///<Number of views to test against
+	};
+
+
+	/**
+	*
+	* \brief Create buffers, descriptor sets and the compute pipeline
+	*
+	* All buffers exist once per swap chain image, like the UBOs of the scene objects. Object, view and group buffers
+	* are written by the CPU and stay mapped. Indirect buffers are written by the compute shader only.
+	* Visible buffers hold the compacted slot lists read by the culled vertex shaders, their counters are read back
+	* by the CPU for statistics.
+	*
+	*/
+	void VEGPUCulling::initCulling() {
+		VkDevice device = getRendererPointer()->getDevice();
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+		uint32_t numImages = getRendererPointer()->getSwapChainNumber();
+
+		VkDeviceSize objectSize = m_maxObjects * sizeof(veCullObject);
+		VkDeviceSize viewSize = VE_CULL_MAX_VIEWS * sizeof(veCullView);
+		VkDeviceSize indirectSize = VE_CULL_MAX_VIEWS * m_maxObjects * sizeof(VkDrawIndexedIndirectCommand);
+		VkDeviceSize visibleSize = VE_CULL_MAX_VIEWS * (m_maxObjects + 1) * sizeof(uint32_t);
+		VkDeviceSize groupSize = m_maxObjects * sizeof(veCullGroupData);
+
+		if (numImages > 32) throw std::runtime_error("Error: GPU culling supports at most 32 swap chain images!");
+
+		m_objectBuffers.resize(numImages);
+		m_objectAllocations.resize(numImages);
+		m_pObjects.resize(numImages);
+		m_viewBuffers.resize(numImages);
+		m_viewAllocations.resize(numImages);
+		m_pViews.resize(numImages);
+		m_indirectBuffers.resize(numImages);
+		m_indirectAllocations.resize(numImages);
+		m_visibleBuffers.resize(numImages);
+		m_visibleAllocations.resize(numImages);
+		m_pVisible.resize(numImages);
+		m_groupBuffers.resize(numImages);
+		m_groupAllocations.resize(numImages);
+		m_pGroups.resize(numImages);
+
+		for (uint32_t i = 0; i < numImages; i++) {
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, objectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+												VMA_MEMORY_USAGE_CPU_TO_GPU, &m_objectBuffers[i], &m_objectAllocations[i]), "Could not create cull object buffer");
+			VECHECKRESULT(vmaMapMemory(allocator, m_objectAllocations[i], (void**)&m_pObjects[i]), "Could not map cull object buffer");
+			memset(m_pObjects[i], 0, (size_t)objectSize);
+
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, viewSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+												VMA_MEMORY_USAGE_CPU_TO_GPU, &m_viewBuffers[i], &m_viewAllocations[i]), "Could not create cull view buffer");
+			VECHECKRESULT(vmaMapMemory(allocator, m_viewAllocations[i], (void**)&m_pViews[i]), "Could not map cull view buffer");
+			memset(m_pViews[i], 0, (size_t)viewSize);
+
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, indirectSize,
+												VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+												VMA_MEMORY_USAGE_GPU_ONLY, &m_indirectBuffers[i], &m_indirectAllocations[i]), "Could not create indirect draw buffer");
+
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, visibleSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+												VMA_MEMORY_USAGE_GPU_TO_CPU, &m_visibleBuffers[i], &m_visibleAllocations[i]), "Could not create visible buffer");
+			VECHECKRESULT(vmaMapMemory(allocator, m_visibleAllocations[i], (void**)&m_pVisible[i]), "Could not map visible buffer");
+			memset(m_pVisible[i], 0, VE_CULL_MAX_VIEWS * sizeof(uint32_t));
+
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, groupSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+												VMA_MEMORY_USAGE_CPU_TO_GPU, &m_groupBuffers[i], &m_groupAllocations[i]), "Could not create cull group buffer");
+			VECHECKRESULT(vmaMapMemory(allocator, m_groupAllocations[i], (void**)&m_pGroups[i]), "Could not map cull group buffer");
+		}
+
+		//compute set:	binding 0...objects, binding 1...views, binding 2...indirect draws, binding 3...visible slots, binding 4...groups
+		//draw set:		binding 0...objects, binding 1...visible slots
+
+		VECHECKRESULT(vh::vhRenderCreateDescriptorPool(device,
+											{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+											{ 7 * numImages },
+											&m_descriptorPool), "Could not create cull descriptor pool");
+
+		VECHECKRESULT(vh::vhRenderCreateDescriptorSetLayout(device,
+											{ 1, 1, 1, 1, 1 },
+											{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+											  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+											  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+											{ VK_SHADER_STAGE_COMPUTE_BIT, VK_SHADER_STAGE_COMPUTE_BIT,
+											  VK_SHADER_STAGE_COMPUTE_BIT, VK_SHADER_STAGE_COMPUTE_BIT,
+											  VK_SHADER_STAGE_COMPUTE_BIT },
+											&m_descriptorSetLayout), "Could not create cull descriptor set layout");
+
+		VECHECKRESULT(vh::vhRenderCreateDescriptorSets(device, numImages, m_descriptorSetLayout, m_descriptorPool, m_descriptorSets),
+						"Could not create cull descriptor sets");
+
+		VECHECKRESULT(vh::vhRenderCreateDescriptorSets(device, numImages, getRendererForwardPointer()->getDescriptorSetLayoutCulling(),
+														m_descriptorPool, m_drawDescriptorSets),
+						"Could not create cull draw descriptor sets");
+
+		for (uint32_t i = 0; i < numImages; i++) {
+			VkDescriptorBufferInfo bufferInfos[5] = {
+				{ m_objectBuffers[i], 0, objectSize },
+				{ m_viewBuffers[i], 0, viewSize },
+				{ m_indirectBuffers[i], 0, indirectSize },
+				{ m_visibleBuffers[i], 0, visibleSize },
+				{ m_groupBuffers[i], 0, groupSize }
+			};
+
+			VkWriteDescriptorSet descriptorWrites[7] = {};
+			for (uint32_t j = 0; j < 7; j++) {
+				descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[j].dstSet = j < 5 ? m_descriptorSets[i] : m_drawDescriptorSets[i];
+				descriptorWrites[j].dstBinding = j < 5 ? j : j - 5;
+				descriptorWrites[j].dstArrayElement = 0;
+				descriptorWrites[j].descriptorCount = 1;
+				descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			for (uint32_t j = 0; j < 5; j++) descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+			descriptorWrites[5].pBufferInfo = &bufferInfos[0];		//objects
+			descriptorWrites[6].pBufferInfo = &bufferInfos[3];		//visible slots
+			vkUpdateDescriptorSets(device, 7, descriptorWrites, 0, nullptr);
+		}
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(veCullParams);
+
+		VECHECKRESULT(vh::vhPipeCreateGraphicsPipelineLayout(device, { m_descriptorSetLayout }, { pushConstantRange }, &m_pipelineLayout),
+						"Could not create cull pipeline layout");
+
+		VECHECKRESULT(vh::vhPipeCreateComputePipeline(device, "shader/Forward/Cull/comp.spv", m_pipelineLayout, &m_pipeline),
+						"Could not create cull pipeline");
+	}
+
+
+	/**
+	* \brief Destroy all Vulkan resources of the culling stage
+	*/
+	void VEGPUCulling::closeCulling() {
+		VkDevice device = getRendererPointer()->getDevice();
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+
+		vkDestroyPipeline(device, m_pipeline, nullptr);
+		vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+
+		for (uint32_t i = 0; i < m_objectBuffers.size(); i++) {
+			vmaUnmapMemory(allocator, m_objectAllocations[i]);
+			vmaDestroyBuffer(allocator, m_objectBuffers[i], m_objectAllocations[i]);
+			vmaUnmapMemory(allocator, m_viewAllocations[i]);
+			vmaDestroyBuffer(allocator, m_viewBuffers[i], m_viewAllocations[i]);
+			vmaDestroyBuffer(allocator, m_indirectBuffers[i], m_indirectAllocations[i]);
+			vmaUnmapMemory(allocator, m_visibleAllocations[i]);
+			vmaDestroyBuffer(allocator, m_visibleBuffers[i], m_visibleAllocations[i]);
+			vmaUnmapMemory(allocator, m_groupAllocations[i]);
+			vmaDestroyBuffer(allocator, m_groupBuffers[i], m_groupAllocations[i]);
+		}
+
+		for (auto pEntity : m_slots) {
+			if (pEntity != nullptr) pEntity->m_cullSlot = VE_CULL_NO_SLOT;
+		}
+		m_slots.clear();
+		m_freeSlots.clear();
+		m_objects.clear();
+		m_spheres.clear();
+		m_dirtyImages.clear();
+		m_groupIndices.clear();
+		m_ecsHandles.clear();
+		m_ecsFrames.clear();
+		m_groups.clear();
+		m_freeGroups.clear();
+		m_groupIDs.clear();
+	}
+
+
+	/**
+	*
+	* \brief Give an entity a slot in the culling buffers
+	*
+	* The entity joins the group of its subrenderer, mesh and material, a new group is created if there is none.
+	* The slot is cleared in all buffers, so it is not visible before updateEntity() has written it.
+	* If all slots are used, the entity is not culled on the GPU and is drawn as usual.
+	*
+	* \param[in] pEntity Pointer to the entity
+	*
+	*/
+	void VEGPUCulling::addEntity(VEEntity *pEntity) {
+		if (pEntity->m_cullSlot != VE_CULL_NO_SLOT || pEntity->m_pMesh == nullptr) return;
+
+		uint32_t slot = allocateSlot();
+		if (slot == VE_CULL_NO_SLOT) return;
+
+		auto key = std::make_tuple(pEntity->m_pSubrenderer, pEntity->m_pMesh, pEntity->m_pMaterial);
+		auto it = m_groupIDs.find(key);
+		uint32_t group;
+		if (it != m_groupIDs.end()) {
+			group = it->second;
+		}
+		else {
+			if (m_freeGroups.size() > 0) {
+				group = m_freeGroups.back();
+				m_freeGroups.pop_back();
+			}
+			else {
+				group = (uint32_t)m_groups.size();
+				m_groups.push_back({});
+			}
+			m_groups[group].m_pSubrender = pEntity->m_pSubrenderer;
+			m_groups[group].m_pMesh = pEntity->m_pMesh;
+			m_groups[group].m_pMaterial = pEntity->m_pMaterial;
+			m_groupIDs[key] = group;
+		}
+
+		m_groupIndices[slot] = (uint32_t)m_groups[group].m_entities.size();
+		m_groups[group].m_entities.push_back(pEntity);
+		m_groupsChanged = true;
+
+		m_objects[slot] = {};
+		m_objects[slot].m_group = group;
+		for (auto pObjects : m_pObjects) pObjects[slot] = m_objects[slot];
+		m_dirtyImages[slot] = 0;
+
+		m_slots[slot] = pEntity;
+		pEntity->m_cullSlot = slot;
+	}
+
+
+	/**
+	*
+	* \brief Free the slot of an entity
+	*
+	* The slot is cleared in all buffers, so the compute shader never marks it visible again.
+	* The entity leaves its group, an empty group is freed.
+	*
+	* \param[in] pEntity Pointer to the entity
+	*
+	*/
+	void VEGPUCulling::removeEntity(VEEntity *pEntity) {
+		uint32_t slot = pEntity->m_cullSlot;
+		if (slot == VE_CULL_NO_SLOT) return;
+
+		uint32_t group = m_objects[slot].m_group;
+		std::vector<VEEntity *> &entities = m_groups[group].m_entities;
+		VEEntity *pLast = entities.back();
+		entities[m_groupIndices[slot]] = pLast;					//replace with the former last entity (could be identical)
+		m_groupIndices[pLast->m_cullSlot] = m_groupIndices[slot];
+		entities.pop_back();
+		if (entities.empty()) {
+			while (!m_groups[group].m_ecsSlots.empty()) {
+				removeECSEntity(m_groups[group].m_ecsSlots.back());	//ECS entities are drawn only with a scene entity
+			}
+			m_groupIDs.erase(std::make_tuple(m_groups[group].m_pSubrender, m_groups[group].m_pMesh, m_groups[group].m_pMaterial));
+			m_freeGroups.push_back(group);
+		}
+		m_groupsChanged = true;
+
+		freeSlot(slot);
+		pEntity->m_cullSlot = VE_CULL_NO_SLOT;
+	}
+
+
+	/**
+	*
+	* \brief Take a free slot, or append a new slot if none is free
+	*
+	* \returns the slot, or VE_CULL_NO_SLOT if all slots are used
+	*
+	*/
+	uint32_t VEGPUCulling::allocateSlot() {
+		if (m_freeSlots.size() > 0) {
+			uint32_t slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			return slot;
+		}
+
+		if (m_slots.size() >= m_maxObjects) return VE_CULL_NO_SLOT;
+		m_slots.push_back(nullptr);
+		m_objects.push_back({});
+		m_spheres.add({ glm::vec3(0.0f), 0.0f });
+		m_dirtyImages.push_back(0);
+		m_groupIndices.push_back(0);
+		m_ecsHandles.push_back({});
+		m_ecsFrames.push_back(0);
+		return (uint32_t)m_slots.size() - 1;
+	}
+
+
+	/**
+	*
+	* \brief Clear a slot in all buffers and put it on the free list
+	*
+	* The compute shader never marks a cleared slot visible again.
+	*
+	* \param[in] slot The slot
+	*
+	*/
+	void VEGPUCulling::freeSlot(uint32_t slot) {
+		for (auto pObjects : m_pObjects) pObjects[slot] = {};
+		m_objects[slot] = {};
+		m_dirtyImages[slot] = 0;
+		m_slots[slot] = nullptr;
+		m_ecsHandles[slot] = {};
+		m_freeSlots.push_back(slot);
+	}
+
+
+	/**
+	*
+	* \brief Write the slot of an entity if it has changed
+	*
+	* Called from VEEntity::updateUBO() after the UBO has been set, so the culling data always match the entity UBO.
+	* The bounding sphere is computed again only if the model matrix, the color, the parameters or the visibility of
+	* the entity have changed. A changed slot is copied into the buffer of each swapchain image once, the next time
+	* this is called for that image.
+	*
+	* \param[in] pEntity Pointer to the entity
+	* \param[in] imageIndex The index of the swapchain image that is currently used
+	*
+	*/
+	void VEGPUCulling::updateEntity(VEEntity *pEntity, uint32_t imageIndex) {
+		uint32_t slot = pEntity->m_cullSlot;
+		veCullObject &object = m_objects[slot];
+		VEEntity::veUBOPerObject_t &ubo = pEntity->m_ubo;
+
+		uint32_t flags = 0;
+		if (pEntity->m_drawEntity) {
+			flags = VE_CULL_FLAG_DRAW | (pEntity->m_castsShadow ? VE_CULL_FLAG_SHADOW : 0);
+		}
+
+		if (flags != object.m_flags || ubo.model != object.m_model || ubo.color != object.m_color || ubo.param != object.m_param) {
+			glm::vec3 center;
+			float radius;
+			pEntity->getBoundingSphere(&center, &radius);
+
+			object.m_flags = flags;
+			object.m_model = ubo.model;
+			object.m_modelInvTrans = ubo.modelInvTrans;
+			object.m_color = ubo.color;
+			object.m_param = ubo.param;
+			setSphere(slot, center, radius);
+		}
+
+		writeSlot(slot, imageIndex);
+	}
+
+
+	/**
+	*
+	* \brief Compute the world space sphere of a slot whose model matrix has changed
+	*
+	* All images are marked stale, since the slot has changed.
+	*
+	* \param[in] slot The slot, its model matrix must be set
+	* \param[in] center Center of the bounding sphere in local space
+	* \param[in] radius Radius of the bounding sphere in local space
+	*
+	*/
+	void VEGPUCulling::setSphere(uint32_t slot, glm::vec3 center, float radius) {
+		veCullObject &object = m_objects[slot];
+		glm::mat4 &model = object.m_model;
+
+		float scale = std::max(	glm::length(glm::vec3(model[0])),
+								std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+		object.m_sphere = glm::vec4(glm::vec3(model * glm::vec4(center, 1.0f)), radius * scale);
+		m_spheres.x[slot] = object.m_sphere.x;
+		m_spheres.y[slot] = object.m_sphere.y;
+		m_spheres.z[slot] = object.m_sphere.z;
+		m_spheres.radius[slot] = object.m_sphere.w;
+		m_dirtyImages[slot] = (uint32_t)((1ull << m_pObjects.size()) - 1);		//all images are stale
+	}
+
+
+	/**
+	*
+	* \brief Copy a slot into the buffer of a swapchain image, if that buffer is stale
+	*
+	* \param[in] slot The slot
+	* \param[in] imageIndex The index of the swapchain image that is currently used
+	*
+	*/
+	void VEGPUCulling::writeSlot(uint32_t slot, uint32_t imageIndex) {
+		uint32_t bit = 1u << imageIndex;
+		if ((m_dirtyImages[slot] & bit) == 0) return;
+
+		m_pObjects[imageIndex][slot] = m_objects[slot];
+		m_dirtyImages[slot] &= ~bit;
+	}
+
+
+	/**
+	*
+	* \brief Find the group of a mesh and a material
+	*
+	* \param[in] pMesh Pointer to the mesh
+	* \param[in] pMaterial Pointer to the material
+	* \returns the first group of a subrenderer using mesh and material, or VE_CULL_NO_GROUP
+	*
+	*/
+	uint32_t VEGPUCulling::findGroup(VEMesh *pMesh, VEMaterial *pMaterial) {
+		for (auto &id : m_groupIDs) {
+			if (std::get<1>(id.first) == pMesh && std::get<2>(id.first) == pMaterial) return id.second;
+		}
+		return VE_CULL_NO_GROUP;
+	}
+
+
+	/**
+	*
+	* \brief Free the slot of an ECS entity and remove it from its group
+	*
+	* The render component of the entity still names the slot, updateECSEntities() detects this by the handle.
+	*
+	* \param[in] slot The slot
+	*
+	*/
+	void VEGPUCulling::removeECSEntity(uint32_t slot) {
+		std::vector<uint32_t> &slots = m_groups[m_objects[slot].m_group].m_ecsSlots;
+		uint32_t last = slots.back();
+		slots[m_groupIndices[slot]] = last;					//replace with the former last slot (could be identical)
+		m_groupIndices[last] = m_groupIndices[slot];
+		slots.pop_back();
+		m_groupsChanged = true;
+
+		freeSlot(slot);
+	}
+
+
+	/**
+	*
+	* \brief Give ECS entities without scene node slots, and write the slots that have changed
+	*
+	* Visits all entities with world and render components but without a scene node. An entity without a valid slot
+	* joins the group of a scene entity with the same mesh and material, if there is one. Entities whose mesh or
+	* material have changed switch groups. Slots of entities that were not visited, i.e. have been destroyed or
+	* have lost their render component, are freed. Like for scene entities, slot data are compared with the
+	* current state, and written to the buffer of the image only if they are stale.
+	* Must be called after VEECS::updateTransforms() of this frame, with the same image index.
+	*
+	* \param[in] imageIndex The index of the swapchain image that is currently used
+	* \returns true if groups have changed, then command buffers must be recorded again
+	*
+	*/
+	bool VEGPUCulling::updateECSEntities(uint32_t imageIndex) {
+		bool changed = false;
+		m_ecsFrame++;
+
+		VEMesh *pLastMesh = nullptr;					//most entities in a row share mesh and material
+		VEMaterial *pLastMaterial = nullptr;
+		uint32_t lastGroup = VE_CULL_NO_GROUP;
+
+		getSceneManagerPointer()->getECS()->forEach(VE_MASK_WORLD | VE_MASK_RENDER, VE_MASK_NODE, [&](VEECS::veChunkView &chunk) {
+			veEntityHandle *pHandles = chunk.getHandles();
+			veWorldComponent *pWorld = chunk.get<veWorldComponent>(VE_COMPONENT_WORLD);
+			veRenderComponent *pRender = chunk.get<veRenderComponent>(VE_COMPONENT_RENDER);
+
+			for (uint32_t i = 0; i < chunk.m_count; i++) {
+				veRenderComponent &render = pRender[i];
+				uint32_t slot = render.m_cullSlot;
+				if (slot != VE_CULL_NO_SLOT && (slot >= m_ecsHandles.size() || m_ecsHandles[slot] != pHandles[i])) {
+					slot = VE_CULL_NO_SLOT;						//the slot has been freed meanwhile
+				}
+
+				if (slot != VE_CULL_NO_SLOT) {
+					veCullGroup &group = m_groups[m_objects[slot].m_group];
+					if (group.m_pMesh != render.m_pMesh || group.m_pMaterial != render.m_pMaterial) {
+						removeECSEntity(slot);
+						slot = VE_CULL_NO_SLOT;
+						changed = true;
+					}
+				}
+
+				if (slot == VE_CULL_NO_SLOT) {
+					if (render.m_pMesh != pLastMesh || render.m_pMaterial != pLastMaterial) {
+						pLastMesh = render.m_pMesh;
+						pLastMaterial = render.m_pMaterial;
+						lastGroup = findGroup(render.m_pMesh, render.m_pMaterial);
+					}
+					if (lastGroup != VE_CULL_NO_GROUP && render.m_pMaterial != nullptr) slot = allocateSlot();
+					render.m_cullSlot = slot;
+					if (slot == VE_CULL_NO_SLOT) continue;
+
+					std::vector<uint32_t> &slots = m_groups[lastGroup].m_ecsSlots;
+					m_groupIndices[slot] = (uint32_t)slots.size();
+					slots.push_back(slot);
+					m_ecsHandles[slot] = pHandles[i];
+					m_objects[slot].m_group = lastGroup;
+					m_groupsChanged = true;
+					changed = true;
+				}
+				m_ecsFrames[slot] = m_ecsFrame;
+
+				veCullObject &object = m_objects[slot];
+				glm::mat4 &model = pWorld[i].m_world;
+				uint32_t flags = 0;
+				if (render.m_flags & VE_RENDER_VISIBLE) {
+					flags = VE_CULL_FLAG_DRAW | ((render.m_flags & VE_RENDER_CASTS_SHADOW) ? VE_CULL_FLAG_SHADOW : 0);
+				}
+
+				if (flags != object.m_flags || model != object.m_model || render.m_pMaterial->color != object.m_color) {
+					object.m_flags = flags;
+					object.m_model = model;
+					object.m_modelInvTrans = glm::transpose(glm::inverse(model));
+					object.m_color = render.m_pMaterial->color;
+					object.m_param = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);		//default parameter of VEEntity
+					setSphere(slot, render.m_pMesh->m_boundingSphereCenter, render.m_pMesh->m_boundingSphereRadius);
+				}
+
+				writeSlot(slot, imageIndex);
+			}
+		});
+
+		for (auto &group : m_groups) {					//free the slots of entities that were not visited
+			for (uint32_t i = 0; i < group.m_ecsSlots.size(); ) {
+				if (m_ecsFrames[group.m_ecsSlots[i]] == m_ecsFrame) {
+					i++;
+					continue;
+				}
+				removeECSEntity(group.m_ecsSlots[i]);		//moves the last slot to i
+				changed = true;
+			}
+		}
+
+		return changed;
+	}
+
+
+	/**
+	*
+	* \brief Extract the frustum planes from a view projection matrix
+	*
+	* Planes point inwards and are normalized, so dot(n,p)+d is the signed distance of a point to a plane.
+	* Clip space depth goes from 0 to 1 (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+	*
+	* \param[in] viewProj Projection matrix times view matrix
+	* \param[out] planes The planes left, right, bottom, top, near, far
+	*
+	*/
+	void VEGPUCulling::getFrustumPlanes(glm::mat4 viewProj, glm::vec4 planes[6]) {
+		glm::mat4 m = glm::transpose(viewProj);		//rows of the matrix
+
+		planes[0] = m[3] + m[0];
+		planes[1] = m[3] - m[0];
+		planes[2] = m[3] + m[1];
+		planes[3] = m[3] - m[1];
+		planes[4] = m[2];
+		planes[5] = m[3] - m[2];
+
+		for (uint32_t i = 0; i < 6; i++) {
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
+
+
+	/**
+	*
+	* \brief Write the frustum of one view
+	*
+	* \param[in] imageIndex The index of the swapchain image that is currently used
+	* \param[in] view Index of the view
+	* \param[in] pCamera The camera of the view
+	* \param[in] flags Objects need one of these flags to be visible
+	*
+	*/
+	void VEGPUCulling::setView(uint32_t imageIndex, uint32_t view, VECamera *pCamera, uint32_t flags) {
+		veCullView &cullView = m_pViews[imageIndex][view];
+		getFrustumPlanes(pCamera->getProjectionMatrix() * glm::inverse(pCamera->getWorldTransform()), cullView.m_planes);
+		cullView.m_flags = flags;
+	}
+
+
+	/**
+	*
+	* \brief Write the frusta of all views
+	*
+	* View 0 is the scene camera. Then follow the shadow cameras of all lights, in the order the shadow passes
+	* are added to the render graph. Views beyond VE_CULL_MAX_VIEWS are not culled on the GPU.
+	* Must be called with the same image index as VESceneManager::updateSceneNodes().
+	* The number of views is pushed by the recorded culling dispatch, so if it changes, all command buffers
+	* must be recorded again.
+	*
+	* \param[in] imageIndex The index of the swapchain image that is currently used
+	* \returns true if the number of views has changed
+	*
+	*/
+	bool VEGPUCulling::updateViews(uint32_t imageIndex) {
+		setView(imageIndex, 0, getSceneManagerPointer()->getCamera(), VE_CULL_FLAG_DRAW);
+
+		uint32_t j = 0;
+		for (auto pLight : getSceneManagerPointer()->getLights()) {
+			for (auto pCamera : pLight->m_shadowCameras) {
+				if (getShadowView(j) >= VE_CULL_MAX_VIEWS) break;
+				setView(imageIndex, getShadowView(j), pCamera, VE_CULL_FLAG_SHADOW);
+				j++;
+			}
+		}
+		uint32_t numViews = std::min(getShadowView(j), VE_CULL_MAX_VIEWS);
+		bool changed = numViews != m_numViews;
+		m_numViews = numViews;
+
+		for (uint32_t view = m_numViews; view < VE_CULL_MAX_VIEWS; view++) {
+			m_pViews[imageIndex][view].m_flags = 0;
+		}
+		return changed;
+	}
+
+
+	/**
+	*
+	* \brief Compute the group offsets and write the group buffer of a swapchain image
+	*
+	* Groups get consecutive ranges of the slot list of a view, each as large as the group. Offsets change only
+	* when entities are added or removed, and then all command buffers are recorded again, since draws push the offsets.
+	*
+	* \param[in] imageIndex The index of the swapchain image that is recorded
+	*
+	*/
+	void VEGPUCulling::updateGroups(uint32_t imageIndex) {
+		if (m_groupsChanged) {
+			uint32_t offset = 0;
+			for (auto &group : m_groups) {
+				group.m_offset = offset;
+				offset += (uint32_t)(group.m_entities.size() + group.m_ecsSlots.size());
+			}
+			m_groupsChanged = false;
+			m_dirtyGroupImages = (uint32_t)((1ull << m_pGroups.size()) - 1);
+		}
+
+		uint32_t bit = 1u << imageIndex;
+		if ((m_dirtyGroupImages & bit) == 0) return;
+
+		for (uint32_t i = 0; i < m_groups.size(); i++) {
+			m_pGroups[imageIndex][i].m_offset = m_groups[i].m_offset;
+			m_pGroups[imageIndex][i].m_indexCount = m_groups[i].m_entities.empty() ? 0 : m_groups[i].m_pMesh->m_indexCount;
+		}
+		m_dirtyGroupImages &= ~bit;
+	}
+
+
+	/**
+	*
+	* \brief Record the culling dispatch
+	*
+	* Must be recorded before all passes that draw with drawGroup(). The draws of the groups and the visible counters
+	* of all views are cleared first, then all slots are tested against all views. The barrier at the end makes the
+	* indirect commands visible to the draws, the slot lists to the vertex shaders and the counters to the host.
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] imageIndex The index of the swapchain image that is recorded
+	*
+	*/
+	void VEGPUCulling::recordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+		updateGroups(imageIndex);
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+		//draws and host reads of the last frame using these buffers must be finished
+
+		barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+							VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+							VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkCmdFillBuffer(commandBuffer, m_visibleBuffers[imageIndex], 0, VE_CULL_MAX_VIEWS * sizeof(uint32_t), 0);
+
+		uint32_t numGroups = (uint32_t)m_groups.size();
+		if (numGroups > 0) {
+			for (uint32_t view = 0; view < m_numViews; view++) {
+				vkCmdFillBuffer(commandBuffer, m_indirectBuffers[imageIndex],
+								(VkDeviceSize)view * m_maxObjects * sizeof(VkDrawIndexedIndirectCommand),
+								(VkDeviceSize)numGroups * sizeof(VkDrawIndexedIndirectCommand), 0);
+			}
+		}
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		veCullParams params = { (uint32_t)m_slots.size(), m_maxObjects, m_numViews };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[imageIndex], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(veCullParams), &params);
+		if (params.numObjects > 0 && params.numViews > 0) vkCmdDispatch(commandBuffer, (params.numObjects + 63) / 64, 1, 1);
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+							0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+
+	/**
+	*
+	* \brief Record the instanced draw of a group for the current view
+	*
+	* The pipeline of the culled permutation, the descriptor sets and vertex and index buffers must already be bound.
+	* The first entry of the group in the slot list of the view is pushed to the vertex shader, instance k of the
+	* draw is the slot at this entry plus k. The instance count has been written by the compute shader.
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] imageIndex The index of the swapchain image that is recorded
+	* \param[in] pipelineLayout Layout of the bound pipeline, with a uint32_t vertex push constant at offset 0
+	* \param[in] group Index of the group
+	*
+	*/
+	void VEGPUCulling::drawGroup(	VkCommandBuffer commandBuffer, uint32_t imageIndex,
+									VkPipelineLayout pipelineLayout, uint32_t group) {
+		uint32_t first = m_currentView * m_maxObjects + m_groups[group].m_offset;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &first);
+
+		VkDeviceSize offset = ((VkDeviceSize)m_currentView * m_maxObjects + group) * sizeof(VkDrawIndexedIndirectCommand);
+		vkCmdDrawIndexedIndirect(commandBuffer, m_indirectBuffers[imageIndex], offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+
+	/**
+	*
+	* \brief Get the number of visible entities of a view
+	*
+	* The counter is written by the GPU, so it is only valid after the frame using this image has finished.
+	*
+	* \param[in] imageIndex The index of the swapchain image
+	* \param[in] view Index of the view
+	* \returns the number of entities that passed the frustum test
+	*
+	*/
+	uint32_t VEGPUCulling::getNumberVisible(uint32_t imageIndex, uint32_t view) {
+		if (imageIndex >= m_pVisible.size() || view >= VE_CULL_MAX_VIEWS) return 0;
+		return m_pVisible[imageIndex][view];
+	}
+
+
+	/**
+	*
+	* \brief Test all slots against the frustum of a camera on the CPU
+	*
+	* Runs the test of the compute shader with the SIMD batch test of the cl library, 4 or 8 spheres at a time.
+	* Uses the bounding spheres of the last updateEntity() calls, so the result is valid for the current frame.
+	*
+	* \param[in] pCamera The camera
+	* \param[in] flags Slots need one of these flags to be visible, e.g. VE_CULL_FLAG_DRAW
+	* \param[out] mask Bit i is set if slot i is visible
+	* \returns the number of visible slots
+	*
+	*/
+	uint32_t VEGPUCulling::cullOnCPU(VECamera *pCamera, uint32_t flags, std::vector<uint32_t> &mask) {
+		glm::vec4 planes[6];
+		getFrustumPlanes(pCamera->getProjectionMatrix() * glm::inverse(pCamera->getWorldTransform()), planes);
+
+		cl::clPlane clPlanes[6];
+		for (uint32_t i = 0; i < 6; i++) {
+			clPlanes[i].normal = glm::vec3(planes[i]);
+			clPlanes[i].d = -planes[i].w;
+		}
+		cl::clIntersect(m_spheres, clPlanes, 6, mask);
+
+		uint32_t numVisible = 0;
+		for (uint32_t slot = 0; slot < m_objects.size(); slot++) {
+			if (!cl::clTestMask(mask, slot)) continue;
+			if ((m_objects[slot].m_flags & flags) == 0) mask[slot >> 5] &= ~(1u << (slot & 31));	//free or not drawn in this view
+			else numVisible++;
+		}
+		return numVisible;
+	}
+
+}
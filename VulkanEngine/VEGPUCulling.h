@@ -0,0 +1,191 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_CULL_MAX_VIEWS = 16;			///<Max number of views (camera + shadow cameras) that are culled on the GPU
+const uint32_t VE_CULL_NO_SLOT = 0xFFFFFFFF;	///<Entity is not managed by GPU culling
+const uint32_t VE_CULL_NO_VIEW = 0xFFFFFFFF;	///<Draws are not culled on the GPU
+const uint32_t VE_CULL_NO_GROUP = 0xFFFFFFFF;	///<Draw item is not a culled group
+
+
+namespace ve {
+
+	class VEEntity;
+	class VECamera;
+	class VESubrender;
+	class VEMesh;
+	class VEMaterial;
+
+	/**
+	*
+	* \brief An optional compute stage that culls entities on the GPU
+	*
+	* Each entity of an object subrenderer gets a slot in a GPU buffer holding its world space bounding sphere and
+	* its per object UBO data. Entities sharing subrenderer, mesh and material form a group, and each group owns a
+	* contiguous range of a compacted slot list. Each view (the scene camera and all shadow cameras) has its six
+	* frustum planes in a second buffer. A compute shader tests all spheres against all views and writes
+	*- the visible slots of each group and view into the group's range of the compacted list,
+	*- one VkDrawIndexedIndirectCommand per view and group, whose instanceCount is the number of visible slots,
+	*- the number of visible slots of each view.
+	*
+	* For a view, the CPU records one instanced vkCmdDrawIndexedIndirect per group, independent of the number of
+	* entities. The culled shader permutations (VESubrender::VE_SHADER_FEATURE_GPU_CULLING) look up the slot of an
+	* instance in the compacted list and read its data from the object buffer. Command buffers do not have to be
+	* recorded again when the visibility of entities changes, only when groups change.
+	* Only core Vulkan 1.0 features are used (no multiDrawIndirect, no drawIndirectFirstInstance, no drawIndirectCount),
+	* so this runs on software implementations too.
+	*
+	* Slot data are kept on the CPU too, and a slot is written to the buffer of a swapchain image only if it has
+	* changed since that buffer has last been written. The bounding spheres are also kept as structure of arrays,
+	* so cullOnCPU() can run the same test as the compute shader with the SIMD batch test of the cl library, e.g.
+	* for statistics of the current frame without waiting for the GPU.
+	*
+	* Entities created directly in the ECS, with world and render components but without scene node, also get slots,
+	* see updateECSEntities(). They join the group of a scene entity with the same mesh and material, e.g. a hidden
+	* prototype that provides subrenderer and descriptor sets, and are not drawn if there is no such group.
+	*
+	* The compute shader is loaded from shader/Forward/Cull/comp.spv, its GLSL source and the interface of the culled
+	* vertex shaders are listed in VEGPUCulling.cpp.
+	*
+	*/
+	class VEGPUCulling {
+
+	public:
+
+		///Bounding sphere and per object data of one slot, as seen by the compute and the culled vertex shaders
+		struct veCullObject {
+			glm::vec4	m_sphere;			///<World space center (xyz) and radius (w)
+			uint32_t	m_group;			///<Group of the slot
+			uint32_t	m_flags;			///<veCullFlags, 0 if the slot is not used
+			uint32_t	m_pad[2];			///<Padding to 16 bytes
+			glm::mat4	m_model;			///<Model matrix, like VEEntity::veUBOPerObject_t
+			glm::mat4	m_modelInvTrans;	///<Inverse transpose of the model matrix
+			glm::vec4	m_color;			///<Uniform color
+			glm::vec4	m_param;			///<Texture scaling and animation
+		};
+
+		///Range of a group in the compacted slot list, as seen by the compute shader
+		struct veCullGroupData {
+			uint32_t	m_offset;			///<First entry of the group in the slot list of a view
+			uint32_t	m_indexCount;		///<Number of indices of the mesh
+		};
+
+		///Entities drawn with one instanced indirect draw
+		struct veCullGroup {
+			VESubrender *			m_pSubrender = nullptr;		///<Subrenderer drawing the group in the light pass
+			VEMesh *				m_pMesh = nullptr;			///<Mesh of all entities
+			VEMaterial *			m_pMaterial = nullptr;		///<Material of all entities
+			std::vector<VEEntity *>	m_entities;					///<Entities of the group, the first one is bound for drawing
+			std::vector<uint32_t>	m_ecsSlots;					///<Slots of ECS entities without scene node in the group
+			uint32_t				m_offset = 0;				///<First entry of the group in the slot list of a view
+		};
+
+		///Frustum of one view, as seen by the compute shader
+		struct veCullView {
+			glm::vec4	m_planes[6];		///<Normalized frustum planes, inside if dot(n,p)+d >= 0
+			uint32_t	m_flags;			///<Objects must have one of these flags to be visible in this view
+			uint32_t	m_pad[3];			///<Padding to 16 bytes
+		};
+
+		///Flags of objects and views
+		enum veCullFlags {
+			VE_CULL_FLAG_DRAW = 1,			///<Object is drawn in the light pass
+			VE_CULL_FLAG_SHADOW = 2			///<Object is drawn in the shadow pass
+		};
+
+	protected:
+		uint32_t						m_maxObjects;								///<Number of slots in the buffers
+		std::vector<VEEntity *>			m_slots;									///<Entity of each slot, or nullptr
+		std::vector<uint32_t>			m_freeSlots;								///<Slots that can be reused
+		std::vector<veCullObject>		m_objects;									///<Current data of each slot
+		cl::clSphereSoA					m_spheres;									///<Bounding sphere of each slot, for culling on the CPU
+		std::vector<uint32_t>			m_dirtyImages;								///<Per slot: bit i is set if the buffer of image i is stale
+		std::vector<uint32_t>			m_groupIndices;								///<Per slot: index of the entity or ECS slot in its group
+		std::vector<veEntityHandle>		m_ecsHandles;								///<Per slot: ECS entity without scene node using the slot
+		std::vector<uint32_t>			m_ecsFrames;								///<Per slot: value of m_ecsFrame when the ECS entity was last seen
+		uint32_t						m_ecsFrame = 0;								///<Counts the calls of updateECSEntities()
+		std::vector<veCullGroup>		m_groups;									///<All groups, empty groups can be reused
+		std::vector<uint32_t>			m_freeGroups;								///<Groups that can be reused
+		std::map<std::tuple<VESubrender*, VEMesh*, VEMaterial*>, uint32_t> m_groupIDs;	///<Group of each subrenderer, mesh and material
+		uint32_t						m_dirtyGroupImages = 0;						///<Bit i is set if the group buffer of image i is stale
+		bool							m_groupsChanged = false;					///<Group offsets must be computed again
+		uint32_t						m_numViews = 0;								///<Number of views written by updateViews()
+		uint32_t						m_currentView = VE_CULL_NO_VIEW;			///<View of the draws that are recorded now
+
+		std::vector<VkBuffer>			m_objectBuffers;							///<Per swap chain image: veCullObject for each slot
+		std::vector<VmaAllocation>		m_objectAllocations;						///<Memory of the object buffers
+		std::vector<veCullObject *>		m_pObjects;									///<Mapped object buffers
+		std::vector<VkBuffer>			m_viewBuffers;								///<Per swap chain image: veCullView for each view
+		std::vector<VmaAllocation>		m_viewAllocations;							///<Memory of the view buffers
+		std::vector<veCullView *>		m_pViews;									///<Mapped view buffers
+		std::vector<VkBuffer>			m_indirectBuffers;							///<Per swap chain image: indirect draw commands for each view and slot
+		std::vector<VmaAllocation>		m_indirectAllocations;						///<Memory of the indirect buffers
+		std::vector<VkBuffer>			m_visibleBuffers;							///<Per swap chain image: visible count and compacted slot list for each view
+		std::vector<VmaAllocation>		m_visibleAllocations;						///<Memory of the visible buffers
+		std::vector<uint32_t *>			m_pVisible;									///<Mapped visible buffers
+		std::vector<VkBuffer>			m_groupBuffers;								///<Per swap chain image: veCullGroupData for each group
+		std::vector<VmaAllocation>		m_groupAllocations;							///<Memory of the group buffers
+		std::vector<veCullGroupData *>	m_pGroups;									///<Mapped group buffers
+
+		VkDescriptorPool				m_descriptorPool = VK_NULL_HANDLE;			///<Pool for the compute descriptor sets
+		VkDescriptorSetLayout			m_descriptorSetLayout = VK_NULL_HANDLE;		///<Layout of the compute descriptor sets
+		std::vector<VkDescriptorSet>	m_descriptorSets;							///<One compute descriptor set per swap chain image
+		std::vector<VkDescriptorSet>	m_drawDescriptorSets;						///<One descriptor set per swap chain image for the culled vertex shaders
+		VkPipelineLayout				m_pipelineLayout = VK_NULL_HANDLE;			///<Layout of the compute pipeline
+		VkPipeline						m_pipeline = VK_NULL_HANDLE;				///<The culling compute pipeline
+
+		void setView(uint32_t imageIndex, uint32_t view, VECamera *pCamera, uint32_t flags);	//write the frustum of a view
+		void updateGroups(uint32_t imageIndex);		//compute the group offsets and write the group buffer
+		uint32_t allocateSlot();					//take a free slot or append one
+		void freeSlot(uint32_t slot);				//clear a slot and put it on the free list
+		void setSphere(uint32_t slot, glm::vec3 center, float radius);	//bounding sphere of a changed slot
+		void writeSlot(uint32_t slot, uint32_t imageIndex);				//copy a slot to the buffer of an image if stale
+		uint32_t findGroup(VEMesh *pMesh, VEMaterial *pMaterial);		//group of a mesh and material
+		void removeECSEntity(uint32_t slot);		//free the slot of an ECS entity
+
+	public:
+		///Constructor
+		VEGPUCulling(uint32_t maxObjects = 10000) : m_maxObjects(maxObjects) {};
+		///Destructor
+		~VEGPUCulling() {};
+
+		void		initCulling();						//create buffers, descriptor sets and the compute pipeline
+		void		closeCulling();						//destroy all Vulkan resources
+
+		void		addEntity(VEEntity *pEntity);		//give an entity a slot
+		void		removeEntity(VEEntity *pEntity);	//free the slot of an entity
+		void		updateEntity(VEEntity *pEntity, uint32_t imageIndex);	//write the slot of an entity if it has changed
+		bool		updateECSEntities(uint32_t imageIndex);	//give ECS entities without scene node slots and write them
+		bool		updateViews(uint32_t imageIndex);	//write the frusta of the camera and all shadow cameras
+
+		void		recordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex);	//record the culling dispatch
+		void		drawGroup(	VkCommandBuffer commandBuffer, uint32_t imageIndex,
+								VkPipelineLayout pipelineLayout, uint32_t group);		//record the instanced draw of a group
+
+		///Select the view of the draws that are recorded next, or VE_CULL_NO_VIEW for normal draws
+		void		beginView(uint32_t view) { m_currentView = view < VE_CULL_MAX_VIEWS ? view : VE_CULL_NO_VIEW; };
+		///\returns true if draws of the current view are culled on the GPU
+		bool		isCulling() { return m_currentView != VE_CULL_NO_VIEW; };
+		///\returns the number of groups, including empty groups
+		uint32_t	getNumberGroups() { return (uint32_t)m_groups.size(); };
+		///\returns a group
+		veCullGroup & getGroup(uint32_t group) { return m_groups[group]; };
+		///\returns the descriptor set of the culled vertex shaders
+		VkDescriptorSet getDrawDescriptorSet(uint32_t imageIndex) { return m_drawDescriptorSets[imageIndex]; };
+		///\returns the view index of the jth shadow camera over all lights, views beyond VE_CULL_MAX_VIEWS are not culled
+		static uint32_t getShadowView(uint32_t j) { return 1 + j; };
+		uint32_t	getNumberVisible(uint32_t imageIndex, uint32_t view);	//visible entities of a view in the last frame
+		uint32_t	cullOnCPU(VECamera *pCamera, uint32_t flags, std::vector<uint32_t> &mask);	//test all slots against a camera on the CPU
+		///\returns the number of slots in use or freed, i.e. the number of slots tested by the compute shader
+		uint32_t	getNumberSlots() { return (uint32_t)m_slots.size(); };
+
+		static void getFrustumPlanes(glm::mat4 viewProj, glm::vec4 planes[6]);	//extract normalized frustum planes
+	};
+
+}
+
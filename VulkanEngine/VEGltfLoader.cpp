@@ -0,0 +1,866 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	//-------------------------------------------------------------------------------------------------
+	//JSON
+
+	///A JSON value, objects keep their members in file order
+	struct VEGltfLoader::veJson {
+		enum veType {
+			VE_JSON_NULL,
+			VE_JSON_BOOL,
+			VE_JSON_NUMBER,
+			VE_JSON_STRING,
+			VE_JSON_ARRAY,
+			VE_JSON_OBJECT
+		};
+
+		veType						m_type = VE_JSON_NULL;	///<Type of the value
+		double						m_number = 0.0;			///<Number, or 0/1 for bools
+		std::string					m_string;				///<String
+		std::vector<std::string>	m_keys;					///<Keys of the object members
+		std::vector<veJson>			m_items;				///<Array items or object member values
+
+		///\returns the member of an object with this key, or nullptr
+		const veJson * get(const char *key) const {
+			if (m_type != VE_JSON_OBJECT) return nullptr;
+			for (uint32_t i = 0; i < m_keys.size(); i++) if (m_keys[i] == key) return &m_items[i];
+			return nullptr;
+		};
+
+		///\returns a number member, or the default value
+		double getNumber(const char *key, double def) const {
+			const veJson *pValue = get(key);
+			return pValue != nullptr && pValue->m_type == VE_JSON_NUMBER ? pValue->m_number : def;
+		};
+
+		///\returns a member that is an index into another array, or VE_GLTF_NONE
+		uint32_t getIndex(const char *key) const {
+			double index = getNumber(key, -1.0);
+			return index >= 0.0 && index < (double)VE_GLTF_NONE ? (uint32_t)index : VE_GLTF_NONE;
+		};
+
+		///\returns a string member, or an empty string
+		std::string getString(const char *key) const {
+			const veJson *pValue = get(key);
+			return pValue != nullptr && pValue->m_type == VE_JSON_STRING ? pValue->m_string : "";
+		};
+
+		///\returns a bool member, or the default value
+		bool getBool(const char *key, bool def) const {
+			const veJson *pValue = get(key);
+			return pValue != nullptr && pValue->m_type == VE_JSON_BOOL ? pValue->m_number != 0.0 : def;
+		};
+
+		///\returns the number of items of an array member, 0 if there is no such array
+		uint32_t getSize(const char *key) const {
+			const veJson *pValue = get(key);
+			return pValue != nullptr && pValue->m_type == VE_JSON_ARRAY ? (uint32_t)pValue->m_items.size() : 0;
+		};
+
+		static bool parse(const char *&p, const char *end, veJson &value, uint32_t depth);
+		static bool parseString(const char *&p, const char *end, std::string &s);
+	};
+
+
+	///\returns p moved past white space
+	static inline const char * skipWhitespace(const char *p, const char *end) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+		return p;
+	}
+
+	///Append a unicode code point as UTF-8
+	static void appendUtf8(std::string &s, uint32_t c) {
+		if (c < 0x80) s += (char)c;
+		else if (c < 0x800) {
+			s += (char)(0xC0 | (c >> 6));
+			s += (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000) {
+			s += (char)(0xE0 | (c >> 12));
+			s += (char)(0x80 | ((c >> 6) & 0x3F));
+			s += (char)(0x80 | (c & 0x3F));
+		}
+		else {
+			s += (char)(0xF0 | (c >> 18));
+			s += (char)(0x80 | ((c >> 12) & 0x3F));
+			s += (char)(0x80 | ((c >> 6) & 0x3F));
+			s += (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	///\returns the value of 4 hex digits, or -1
+	static int32_t parseHex4(const char *p, const char *end) {
+		if (end - p < 4) return -1;
+		int32_t v = 0;
+		for (uint32_t i = 0; i < 4; i++) {
+			char c = p[i];
+			v <<= 4;
+			if (c >= '0' && c <= '9') v |= c - '0';
+			else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+			else return -1;
+		}
+		return v;
+	}
+
+	/**
+	*
+	* \brief Parse a JSON string
+	*
+	* \param[in,out] p Points to the opening quote, moved past the closing quote
+	* \param[in] end End of the text
+	* \param[out] s The string, escapes are resolved
+	* \returns false if the string is malformed
+	*
+	*/
+	bool VEGltfLoader::veJson::parseString(const char *&p, const char *end, std::string &s) {
+		if (p == end || *p != '"') return false;
+		p++;
+		while (p < end && *p != '"') {
+			if (*p != '\\') {
+				s += *p++;
+				continue;
+			}
+			if (++p == end) return false;
+			switch (*p++) {
+			case '"': s += '"'; break;
+			case '\\': s += '\\'; break;
+			case '/': s += '/'; break;
+			case 'b': s += '\b'; break;
+			case 'f': s += '\f'; break;
+			case 'n': s += '\n'; break;
+			case 'r': s += '\r'; break;
+			case 't': s += '\t'; break;
+			case 'u': {
+				int32_t c = parseHex4(p, end);
+				if (c < 0) return false;
+				p += 4;
+				if (c >= 0xD800 && c < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {	//surrogate pair
+					int32_t low = parseHex4(p + 2, end);
+					if (low >= 0xDC00 && low < 0xE000) {
+						c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+						p += 6;
+					}
+				}
+				appendUtf8(s, (uint32_t)c);
+				break;
+			}
+			default: return false;
+			}
+		}
+		if (p == end) return false;
+		p++;
+		return true;
+	}
+
+	/**
+	*
+	* \brief Parse a JSON value
+	*
+	* \param[in,out] p Start of the value, may be preceeded by white space, moved past the value
+	* \param[in] end End of the text
+	* \param[out] value The value
+	* \param[in] depth Nesting depth, to stop malformed files from exhausting the stack
+	* \returns false if the value is malformed
+	*
+	*/
+	bool VEGltfLoader::veJson::parse(const char *&p, const char *end, veJson &value, uint32_t depth) {
+		if (depth > 128) return false;
+		p = skipWhitespace(p, end);
+		if (p == end) return false;
+
+		switch (*p) {
+		case '{':
+			value.m_type = VE_JSON_OBJECT;
+			p = skipWhitespace(p + 1, end);
+			if (p < end && *p == '}') { p++; return true; }
+			while (true) {
+				p = skipWhitespace(p, end);
+				value.m_keys.push_back("");
+				if (!parseString(p, end, value.m_keys.back())) return false;
+				p = skipWhitespace(p, end);
+				if (p == end || *p++ != ':') return false;
+				value.m_items.push_back(veJson());
+				if (!parse(p, end, value.m_items.back(), depth + 1)) return false;
+				p = skipWhitespace(p, end);
+				if (p == end) return false;
+				if (*p == '}') { p++; return true; }
+				if (*p++ != ',') return false;
+			}
+
+		case '[':
+			value.m_type = VE_JSON_ARRAY;
+			p = skipWhitespace(p + 1, end);
+			if (p < end && *p == ']') { p++; return true; }
+			while (true) {
+				value.m_items.push_back(veJson());
+				if (!parse(p, end, value.m_items.back(), depth + 1)) return false;
+				p = skipWhitespace(p, end);
+				if (p == end) return false;
+				if (*p == ']') { p++; return true; }
+				if (*p++ != ',') return false;
+			}
+
+		case '"':
+			value.m_type = VE_JSON_STRING;
+			return parseString(p, end, value.m_string);
+
+		case 't':
+		case 'f':
+		case 'n': {
+			static const char *words[] = { "true", "false", "null" };
+			for (uint32_t i = 0; i < 3; i++) {
+				size_t length = strlen(words[i]);
+				if ((size_t)(end - p) >= length && memcmp(p, words[i], length) == 0) {
+					value.m_type = i < 2 ? VE_JSON_BOOL : VE_JSON_NULL;
+					value.m_number = i == 0 ? 1.0 : 0.0;
+					p += length;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		default: {
+			char buffer[64];
+			uint32_t length = 0;
+			while (p < end && length < sizeof(buffer) - 1 && (isdigit((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) {
+				buffer[length++] = *p++;
+			}
+			buffer[length] = 0;
+			char *pEnd;
+			value.m_type = VE_JSON_NUMBER;
+			value.m_number = strtod(buffer, &pEnd);
+			return length > 0 && pEnd == buffer + length;
+		}
+		}
+	}
+
+
+	//-------------------------------------------------------------------------------------------------
+	//URIs
+
+	///\returns the URI with %xx escapes resolved
+	static std::string decodeUri(std::string uri) {
+		std::string s;
+		for (size_t i = 0; i < uri.size(); i++) {
+			int32_t c = -1;
+			if (uri[i] == '%' && i + 2 < uri.size()) {
+				std::string hex = "00" + uri.substr(i + 1, 2);
+				c = parseHex4(hex.data(), hex.data() + hex.size());
+			}
+			if (c >= 0) {
+				s += (char)c;
+				i += 2;
+			}
+			else s += uri[i];
+		}
+		return s;
+	}
+
+	/**
+	*
+	* \brief Decode a base64 data URI
+	*
+	* \param[in] uri The URI, starting with data:
+	* \param[out] data The decoded bytes
+	* \returns false if the URI is not base64 encoded
+	*
+	*/
+	static bool decodeDataUri(const std::string &uri, std::vector<uint8_t> &data) {
+		size_t comma = uri.find(',');
+		if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos) return false;
+
+		data.reserve((uri.size() - comma) * 3 / 4);
+		uint32_t bits = 0, numBits = 0;
+		for (size_t i = comma + 1; i < uri.size(); i++) {
+			char c = uri[i];
+			uint32_t v;
+			if (c >= 'A' && c <= 'Z') v = c - 'A';
+			else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+			else if (c >= '0' && c <= '9') v = c - '0' + 52;
+			else if (c == '+') v = 62;
+			else if (c == '/') v = 63;
+			else if (c == '=') break;
+			else return false;
+
+			bits = (bits << 6) | v;
+			numBits += 6;
+			if (numBits >= 8) {
+				numBits -= 8;
+				data.push_back((uint8_t)(bits >> numBits));
+			}
+		}
+		return true;
+	}
+
+	///\returns whether the string ends with the suffix
+	static bool endsWith(const std::string &s, const char *suffix) {
+		size_t length = strlen(suffix);
+		return s.size() >= length && s.compare(s.size() - length, length, suffix) == 0;
+	}
+
+
+	//-------------------------------------------------------------------------------------------------
+	//reading accessors
+
+	///\returns the size of a GL component type in bytes, or 0 for unknown types
+	static uint32_t getComponentSize(uint32_t componentType) {
+		switch (componentType) {
+		case 5120: case 5121: return 1;		//byte, unsigned byte
+		case 5122: case 5123: return 2;		//short, unsigned short
+		case 5125: case 5126: return 4;		//unsigned int, float
+		default: return 0;
+		}
+	}
+
+	///\returns a component converted to float
+	static inline float readComponent(const uint8_t *p, uint32_t componentType, bool normalized) {
+		switch (componentType) {
+		case 5120: { int8_t v; memcpy(&v, p, 1); return normalized ? std::max(v / 127.0f, -1.0f) : (float)v; }
+		case 5121: { uint8_t v = *p; return normalized ? v / 255.0f : (float)v; }
+		case 5122: { int16_t v; memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+		case 5123: { uint16_t v; memcpy(&v, p, 2); return normalized ? v / 65535.0f : (float)v; }
+		case 5125: { uint32_t v; memcpy(&v, p, 4); return (float)v; }
+		default: { float v; memcpy(&v, p, 4); return v; }
+		}
+	}
+
+	///Read the first n components of an element into floats
+	static inline void readElement(const veGltfAccessor &accessor, uint32_t i, float *pDst, uint32_t n) {
+		const uint8_t *p = accessor.m_pData + (size_t)i * accessor.m_stride;
+		if (accessor.m_componentType == 5126) {
+			memcpy(pDst, p, n * sizeof(float));
+			return;
+		}
+		uint32_t size = getComponentSize(accessor.m_componentType);
+		for (uint32_t k = 0; k < n; k++) pDst[k] = readComponent(p + k * size, accessor.m_componentType, accessor.m_normalized);
+	}
+
+	///\returns an index
+	static inline uint32_t readIndex(const veGltfAccessor &accessor, uint32_t i) {
+		const uint8_t *p = accessor.m_pData + (size_t)i * accessor.m_stride;
+		switch (accessor.m_componentType) {
+		case 5121: return *p;
+		case 5123: { uint16_t v; memcpy(&v, p, 2); return v; }
+		default: { uint32_t v; memcpy(&v, p, 4); return v; }
+		}
+	}
+
+
+	//-------------------------------------------------------------------------------------------------
+	//loading
+
+	/**
+	*
+	* \brief Locate all buffers
+	*
+	* \param[in] doc The JSON document
+	* \param[in] pBin The binary chunk of a .glb file, or nullptr
+	* \param[in] binSize Size of the binary chunk
+	* \returns false if a buffer is missing or too small
+	*
+	*/
+	bool VEGltfLoader::loadBuffers(const veJson &doc, const uint8_t *pBin, size_t binSize) {
+		const veJson *pBuffers = doc.get("buffers");
+		if (pBuffers == nullptr) return true;
+
+		for (uint32_t i = 0; i < pBuffers->m_items.size(); i++) {
+			const veJson &buffer = pBuffers->m_items[i];
+			std::string uri = buffer.getString("uri");
+			size_t byteLength = (size_t)buffer.getNumber("byteLength", 0.0);
+
+			const uint8_t *pData = nullptr;
+			size_t size = 0;
+			if (uri.empty()) {											//the binary chunk of a .glb file
+				if (i > 0 || pBin == nullptr) return false;
+				pData = pBin;
+				size = binSize;
+			}
+			else if (uri.compare(0, 5, "data:") == 0) {
+				m_decoded.push_back(std::vector<uint8_t>());
+				if (!decodeDataUri(uri, m_decoded.back())) return false;
+				pData = m_decoded.back().data();
+				size = m_decoded.back().size();
+			}
+			else {
+				m_files.push_back(veFileData());
+				if (!getFileSystemPointer()->read(m_basedir + "/" + decodeUri(uri), m_files.back())) return false;
+				pData = (const uint8_t*)m_files.back().m_pData;
+				size = m_files.back().m_size;
+			}
+			if (size < byteLength) return false;
+
+			m_buffers.push_back(pData);
+			m_bufferSizes.push_back(byteLength);
+		}
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Locate a buffer view
+	*
+	* \param[in] doc The JSON document
+	* \param[in] index Index of the buffer view
+	* \param[out] pData Start of the buffer view
+	* \param[out] size Size of the buffer view
+	* \param[out] stride Byte stride, 0 if the elements are tightly packed
+	* \returns false if the buffer view does not exist or lies outside of its buffer
+	*
+	*/
+	bool VEGltfLoader::getBufferView(const veJson &doc, uint32_t index, const uint8_t *&pData, size_t &size, uint32_t &stride) {
+		const veJson *pViews = doc.get("bufferViews");
+		if (pViews == nullptr || index >= pViews->m_items.size()) return false;
+		const veJson &view = pViews->m_items[index];
+
+		uint32_t buffer = view.getIndex("buffer");
+		size_t offset = (size_t)view.getNumber("byteOffset", 0.0);
+		size = (size_t)view.getNumber("byteLength", 0.0);
+		stride = (uint32_t)view.getNumber("byteStride", 0.0);
+		if (buffer >= m_buffers.size() || offset + size > m_bufferSizes[buffer]) return false;
+
+		pData = m_buffers[buffer] + offset;
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Locate an accessor and check that its elements lie inside its buffer view
+	*
+	* \param[in] doc The JSON document
+	* \param[in] index Index of the accessor
+	* \param[in] numComponents Components per element the attribute must have
+	* \param[out] accessor The accessor. If it has no buffer view (all zero), its data pointer is nullptr.
+	* \returns false if the accessor does not exist, has the wrong type, is sparse or lies outside its buffer view
+	*
+	*/
+	bool VEGltfLoader::getAccessor(const veJson &doc, uint32_t index, uint32_t numComponents, veGltfAccessor &accessor) {
+		const veJson *pAccessors = doc.get("accessors");
+		if (pAccessors == nullptr || index >= pAccessors->m_items.size()) return false;
+		const veJson &acc = pAccessors->m_items[index];
+		if (acc.get("sparse") != nullptr) return false;
+
+		static const char *types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+		if (numComponents < 1 || numComponents > 4 || acc.getString("type") != types[numComponents - 1]) return false;
+
+		accessor.m_componentType = acc.getIndex("componentType");
+		accessor.m_numComponents = numComponents;
+		accessor.m_count = acc.getIndex("count");
+		accessor.m_normalized = acc.getBool("normalized", false);
+		uint32_t componentSize = getComponentSize(accessor.m_componentType);
+		if (componentSize == 0 || accessor.m_count == VE_GLTF_NONE) return false;
+
+		uint32_t view = acc.getIndex("bufferView");
+		if (view == VE_GLTF_NONE) {
+			accessor.m_pData = nullptr;
+			return true;
+		}
+
+		const uint8_t *pData;
+		size_t size;
+		uint32_t stride;
+		if (!getBufferView(doc, view, pData, size, stride)) return false;
+
+		uint32_t elementSize = componentSize * numComponents;
+		size_t offset = (size_t)acc.getNumber("byteOffset", 0.0);
+		accessor.m_stride = stride > 0 ? stride : elementSize;
+		if (accessor.m_count > 0 && offset + (size_t)accessor.m_stride * (accessor.m_count - 1) + elementSize > size) return false;
+
+		accessor.m_pData = pData + offset;
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Find the image of a texture reference
+	*
+	* \param[in] doc The JSON document
+	* \param[in] pTextureInfo The texture reference of a material, or nullptr
+	* \returns the index of the image, or VE_GLTF_NONE if there is none that can be loaded
+	*
+	*/
+	uint32_t VEGltfLoader::getImage(const veJson &doc, const veJson *pTextureInfo) {
+		if (pTextureInfo == nullptr) return VE_GLTF_NONE;
+
+		const veJson *pTextures = doc.get("textures");
+		uint32_t texture = pTextureInfo->getIndex("index");
+		if (pTextures == nullptr || texture >= pTextures->m_items.size()) return VE_GLTF_NONE;
+
+		uint32_t image = pTextures->m_items[texture].getIndex("source");		//KTX2 only textures have no source
+		if (image >= m_images.size()) return VE_GLTF_NONE;
+		if (m_images[image].m_uri.empty() && m_images[image].m_pData == nullptr) return VE_GLTF_NONE;
+		return image;
+	}
+
+
+	/**
+	*
+	* \brief Load the file and its buffers
+	*
+	* \returns false if the file cannot be read, is malformed, or needs an extension the loader does not support.
+	* The caller can then fall back to Assimp.
+	*
+	*/
+	bool VEGltfLoader::load() {
+		auto t_start = std::chrono::high_resolution_clock::now();
+
+		m_files.push_back(veFileData());
+		if (!getFileSystemPointer()->read(m_basedir + "/" + m_filename, m_files.back())) return false;
+		size_t fileSize = m_files.back().m_size;
+
+		//find the JSON and the binary chunk of .glb files
+		const uint8_t *pFile = (const uint8_t*)m_files.back().m_pData;
+		const char *pJson = m_files.back().m_pData;
+		size_t jsonSize = fileSize;
+		const uint8_t *pBin = nullptr;
+		size_t binSize = 0;
+
+		uint32_t header[3];
+		if (fileSize >= sizeof(header)) memcpy(header, pFile, sizeof(header));
+		if (fileSize >= sizeof(header) && header[0] == 0x46546C67) {			//"glTF"
+			if (header[1] != 2) return false;
+
+			pJson = nullptr;
+			size_t offset = sizeof(header);
+			size_t length = std::min((size_t)header[2], fileSize);
+			while (offset + 8 <= length) {
+				uint32_t chunk[2];												//length, type
+				memcpy(chunk, pFile + offset, sizeof(chunk));
+				if (offset + 8 + chunk[0] > length) return false;
+
+				if (chunk[1] == 0x4E4F534A && pJson == nullptr) {				//"JSON"
+					pJson = (const char*)pFile + offset + 8;
+					jsonSize = chunk[0];
+				}
+				else if (chunk[1] == 0x004E4942 && pBin == nullptr) {			//"BIN"
+					pBin = pFile + offset + 8;
+					binSize = chunk[0];
+				}
+				offset += 8 + chunk[0];
+			}
+			if (pJson == nullptr) return false;
+		}
+
+		veJson doc;
+		const char *p = pJson;
+		if (!veJson::parse(p, pJson + jsonSize, doc, 0) || doc.m_type != veJson::VE_JSON_OBJECT) return false;
+
+		const veJson *pAsset = doc.get("asset");
+		if (pAsset == nullptr || pAsset->getString("version").compare(0, 1, "2") != 0) return false;
+
+		const veJson *pRequired = doc.get("extensionsRequired");
+		if (pRequired != nullptr) {
+			for (auto &extension : pRequired->m_items) {
+				if (extension.m_string != "KHR_mesh_quantization" && extension.m_string != "KHR_texture_basisu" &&
+					extension.m_string != "KHR_materials_unlit") return false;
+			}
+		}
+
+		if (!loadBuffers(doc, pBin, binSize)) return false;
+
+		//images
+		const veJson *pImages = doc.get("images");
+		for (uint32_t i = 0; pImages != nullptr && i < pImages->m_items.size(); i++) {
+			const veJson &img = pImages->m_items[i];
+			std::string uri = img.getString("uri");
+			veGltfImage image;
+
+			if (img.getString("mimeType") == "image/ktx2" || endsWith(uri, ".ktx2")) {
+				//not supported, leave the image empty
+			}
+			else if (uri.compare(0, 5, "data:") == 0) {
+				m_decoded.push_back(std::vector<uint8_t>());
+				if (decodeDataUri(uri, m_decoded.back())) {
+					image.m_pData = m_decoded.back().data();
+					image.m_size = (uint32_t)m_decoded.back().size();
+				}
+			}
+			else if (!uri.empty()) {
+				image.m_uri = decodeUri(uri);
+			}
+			else {
+				const uint8_t *pData;
+				size_t size;
+				uint32_t stride;
+				if (getBufferView(doc, img.getIndex("bufferView"), pData, size, stride)) {
+					image.m_pData = pData;
+					image.m_size = (uint32_t)size;
+				}
+			}
+			m_images.push_back(image);
+		}
+
+		//materials and meshes get unique names, since the scene manager finds them by name
+		std::set<std::string> names;
+		auto makeUnique = [&](std::string name, std::string prefix, uint32_t i) {
+			if (name.empty() || names.count(name) > 0) name += prefix + std::to_string(i);
+			names.insert(name);
+			return name;
+		};
+
+		//materials
+		const veJson *pMaterials = doc.get("materials");
+		for (uint32_t i = 0; pMaterials != nullptr && i < pMaterials->m_items.size(); i++) {
+			const veJson &mat = pMaterials->m_items[i];
+			veGltfMaterial material;
+			material.m_name = makeUnique(mat.getString("name"), "material_", i);
+
+			const veJson *pPbr = mat.get("pbrMetallicRoughness");
+			if (pPbr != nullptr) {
+				const veJson *pColor = pPbr->get("baseColorFactor");
+				if (pColor != nullptr && pColor->m_items.size() == 4) {
+					for (uint32_t k = 0; k < 4; k++) material.m_color[k] = (float)pColor->m_items[k].m_number;
+				}
+				material.m_baseColorImage = getImage(doc, pPbr->get("baseColorTexture"));
+			}
+			material.m_normalImage = getImage(doc, mat.get("normalTexture"));
+			m_materials.push_back(material);
+		}
+
+		//meshes
+		const veJson *pMeshes = doc.get("meshes");
+		for (uint32_t i = 0; pMeshes != nullptr && i < pMeshes->m_items.size(); i++) {
+			const veJson &msh = pMeshes->m_items[i];
+			veGltfMesh mesh;
+			mesh.m_name = makeUnique(msh.getString("name"), "mesh_", i);
+
+			const veJson *pPrimitives = msh.get("primitives");
+			for (uint32_t k = 0; pPrimitives != nullptr && k < pPrimitives->m_items.size(); k++) {
+				const veJson &prim = pPrimitives->m_items[k];
+				const veJson *pAttributes = prim.get("attributes");
+				if (prim.getNumber("mode", 4.0) != 4.0 || pAttributes == nullptr) continue;	//only triangle lists
+
+				veGltfPrimitive primitive;
+				uint32_t position = pAttributes->getIndex("POSITION");
+				if (position == VE_GLTF_NONE) continue;
+				if (!getAccessor(doc, position, 3, primitive.m_position) || primitive.m_position.m_pData == nullptr) return false;
+				uint32_t count = primitive.m_position.m_count;
+
+				struct { const char *m_name; uint32_t m_numComponents; veGltfAccessor *m_pAccessor; } attributes[] = {
+					{ "NORMAL", 3, &primitive.m_normal },
+					{ "TANGENT", 4, &primitive.m_tangent },
+					{ "TEXCOORD_0", 2, &primitive.m_texCoord }
+				};
+				for (auto &attribute : attributes) {
+					uint32_t index = pAttributes->getIndex(attribute.m_name);
+					if (index == VE_GLTF_NONE) continue;
+					if (!getAccessor(doc, index, attribute.m_numComponents, *attribute.m_pAccessor)) return false;
+					if (attribute.m_pAccessor->m_count != count) return false;
+				}
+
+				uint32_t indices = prim.getIndex("indices");
+				if (indices != VE_GLTF_NONE) {
+					if (!getAccessor(doc, indices, 1, primitive.m_indices) || primitive.m_indices.m_pData == nullptr) return false;
+					if (primitive.m_indices.m_componentType != 5121 && primitive.m_indices.m_componentType != 5123 &&
+						primitive.m_indices.m_componentType != 5125) return false;
+				}
+
+				primitive.m_material = prim.getIndex("material");
+				if (primitive.m_material >= m_materials.size()) primitive.m_material = VE_GLTF_NONE;
+				if (getIndexCount(primitive) > 0) mesh.m_primitives.push_back(primitive);
+			}
+			m_meshes.push_back(mesh);
+		}
+
+		//nodes
+		const veJson *pNodes = doc.get("nodes");
+		uint32_t numNodes = pNodes != nullptr ? (uint32_t)pNodes->m_items.size() : 0;
+		std::vector<bool> isChild(numNodes, false);
+		for (uint32_t i = 0; i < numNodes; i++) {
+			const veJson &nd = pNodes->m_items[i];
+			veGltfNode node;
+			node.m_name = nd.getString("name");
+			if (node.m_name.empty()) node.m_name = "node_" + std::to_string(i);
+
+			node.m_mesh = nd.getIndex("mesh");
+			if (node.m_mesh >= m_meshes.size()) node.m_mesh = VE_GLTF_NONE;
+
+			const veJson *pChildren = nd.get("children");
+			for (uint32_t k = 0; pChildren != nullptr && k < pChildren->m_items.size(); k++) {
+				double child = pChildren->m_items[k].m_number;
+				if (child < 0.0 || child >= numNodes) return false;
+				node.m_children.push_back((uint32_t)child);
+				isChild[(uint32_t)child] = true;
+			}
+
+			const veJson *pMatrix = nd.get("matrix");
+			if (pMatrix != nullptr && pMatrix->m_items.size() == 16) {
+				for (uint32_t k = 0; k < 16; k++) node.m_transform[k / 4][k % 4] = (float)pMatrix->m_items[k].m_number;	//column major
+			}
+			else {
+				glm::vec3 t(0.0f), s(1.0f);
+				glm::vec4 r(0.0f, 0.0f, 0.0f, 1.0f);
+				const veJson *pT = nd.get("translation");
+				const veJson *pR = nd.get("rotation");
+				const veJson *pS = nd.get("scale");
+				if (pT != nullptr && pT->m_items.size() == 3) for (uint32_t k = 0; k < 3; k++) t[k] = (float)pT->m_items[k].m_number;
+				if (pR != nullptr && pR->m_items.size() == 4) for (uint32_t k = 0; k < 4; k++) r[k] = (float)pR->m_items[k].m_number;
+				if (pS != nullptr && pS->m_items.size() == 3) for (uint32_t k = 0; k < 3; k++) s[k] = (float)pS->m_items[k].m_number;
+
+				float x = r.x, y = r.y, z = r.z, w = r.w;					//quaternion to rotation matrix
+				glm::mat4 rotation(1.0f);
+				rotation[0][0] = 1.0f - 2.0f * (y*y + z*z);	rotation[0][1] = 2.0f * (x*y + w*z);		rotation[0][2] = 2.0f * (x*z - w*y);
+				rotation[1][0] = 2.0f * (x*y - w*z);		rotation[1][1] = 1.0f - 2.0f * (x*x + z*z);	rotation[1][2] = 2.0f * (y*z + w*x);
+				rotation[2][0] = 2.0f * (x*z + w*y);		rotation[2][1] = 2.0f * (y*z - w*x);		rotation[2][2] = 1.0f - 2.0f * (x*x + y*y);
+
+				node.m_transform = glm::translate(glm::mat4(1.0f), t) * rotation * glm::scale(glm::mat4(1.0f), s);
+			}
+			m_nodes.push_back(node);
+		}
+
+		//root nodes of the scene
+		const veJson *pScenes = doc.get("scenes");
+		uint32_t scene = doc.getIndex("scene");
+		if (scene == VE_GLTF_NONE) scene = 0;
+		if (pScenes != nullptr && scene < pScenes->m_items.size()) {
+			const veJson *pRoots = pScenes->m_items[scene].get("nodes");
+			for (uint32_t k = 0; pRoots != nullptr && k < pRoots->m_items.size(); k++) {
+				double root = pRoots->m_items[k].m_number;
+				if (root >= 0.0 && root < numNodes) m_rootNodes.push_back((uint32_t)root);
+			}
+		}
+		else {
+			for (uint32_t i = 0; i < numNodes; i++) if (!isChild[i]) m_rootNodes.push_back(i);
+		}
+
+		auto t_end = std::chrono::high_resolution_clock::now();
+		m_loadTime = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+		return true;
+	}
+
+
+	//-------------------------------------------------------------------------------------------------
+	//copying primitives
+
+	/**
+	* \param[in] primitive The primitive
+	* \returns whether the primitive has normals and tangents, so they need not be computed
+	*/
+	bool VEGltfLoader::hasAllAttributes(const veGltfPrimitive &primitive) {
+		return primitive.m_normal.m_pData != nullptr && primitive.m_tangent.m_pData != nullptr;
+	}
+
+	/**
+	* \param[in] primitive The primitive
+	* \returns the number of indices, a multiple of 3
+	*/
+	uint32_t VEGltfLoader::getIndexCount(const veGltfPrimitive &primitive) {
+		uint32_t count = primitive.m_indices.m_pData != nullptr ? primitive.m_indices.m_count : primitive.m_position.m_count;
+		return count - count % 3;
+	}
+
+	/**
+	*
+	* \brief Write the position stream of a primitive
+	*
+	* Tightly packed float positions are copied with one memcpy.
+	*
+	* \param[in] primitive The primitive
+	* \param[out] pPositions Room for one position per vertex
+	*
+	*/
+	void VEGltfLoader::copyPositions(const veGltfPrimitive &primitive, glm::vec3 *pPositions) {
+		const veGltfAccessor &position = primitive.m_position;
+		if (position.m_componentType == 5126 && position.m_stride == sizeof(glm::vec3)) {
+			memcpy(pPositions, position.m_pData, sizeof(glm::vec3) * position.m_count);
+			return;
+		}
+		for (uint32_t i = 0; i < position.m_count; i++) readElement(position, i, &pPositions[i].x, 3);
+	}
+
+	/**
+	*
+	* \brief Write the attribute stream of a primitive
+	*
+	* Missing attributes are set to zero. The handedness in the w component of tangents is dropped.
+	*
+	* \param[in] primitive The primitive
+	* \param[out] pAttributes Room for the attributes of each vertex
+	*
+	*/
+	void VEGltfLoader::copyAttributes(const veGltfPrimitive &primitive, vh::vhVertexAttributes *pAttributes) {
+		for (uint32_t i = 0; i < primitive.m_position.m_count; i++) {
+			vh::vhVertexAttributes &attributes = pAttributes[i];
+			attributes.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+			attributes.tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+			attributes.texCoord = glm::vec2(0.0f, 0.0f);
+			if (primitive.m_normal.m_pData != nullptr) readElement(primitive.m_normal, i, &attributes.normal.x, 3);
+			if (primitive.m_tangent.m_pData != nullptr) readElement(primitive.m_tangent, i, &attributes.tangent.x, 3);
+			if (primitive.m_texCoord.m_pData != nullptr) readElement(primitive.m_texCoord, i, &attributes.texCoord.x, 2);
+		}
+	}
+
+	/**
+	*
+	* \brief Write the indices of a primitive as 32 bit indices, reversing the winding order
+	*
+	* Indices outside the vertex range are set to 0.
+	*
+	* \param[in] primitive The primitive
+	* \param[out] pIndices Room for getIndexCount() indices
+	*
+	*/
+	void VEGltfLoader::copyIndices(const veGltfPrimitive &primitive, uint32_t *pIndices) {
+		uint32_t count = getIndexCount(primitive);
+		uint32_t numVertices = primitive.m_position.m_count;
+		bool indexed = primitive.m_indices.m_pData != nullptr;
+
+		for (uint32_t i = 0; i < count; i += 3) {
+			uint32_t tri[3];
+			for (uint32_t k = 0; k < 3; k++) {
+				tri[k] = indexed ? readIndex(primitive.m_indices, i + k) : i + k;
+				if (tri[k] >= numVertices) tri[k] = 0;
+			}
+			pIndices[i] = tri[0];
+			pIndices[i + 1] = tri[2];
+			pIndices[i + 2] = tri[1];
+		}
+	}
+
+	/**
+	*
+	* \brief Create a vertex and index list for a primitive that lacks normals or tangents
+	*
+	* The indices keep the winding order of the file, VEObjLoader::computeNormalsAndTangents() reverses it.
+	*
+	* \param[in] primitive The primitive
+	* \param[out] mesh Vertices with zero normals where the file has none, and indices
+	*
+	*/
+	void VEGltfLoader::buildMesh(const veGltfPrimitive &primitive, veObjMesh &mesh) {
+		uint32_t numVertices = primitive.m_position.m_count;
+		std::vector<glm::vec3> positions(numVertices);
+		std::vector<vh::vhVertexAttributes> attributes(numVertices);
+		copyPositions(primitive, positions.data());
+		copyAttributes(primitive, attributes.data());
+
+		mesh.m_vertices.resize(numVertices);
+		for (uint32_t i = 0; i < numVertices; i++) {
+			mesh.m_vertices[i].pos = positions[i];
+			mesh.m_vertices[i].normal = attributes[i].normal;
+			mesh.m_vertices[i].tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+			mesh.m_vertices[i].texCoord = attributes[i].texCoord;
+		}
+
+		mesh.m_indices.resize(getIndexCount(primitive));
+		copyIndices(primitive, mesh.m_indices.data());
+		for (uint32_t i = 0; i < mesh.m_indices.size(); i += 3) std::swap(mesh.m_indices[i + 1], mesh.m_indices[i + 2]);
+	}
+
+}
+
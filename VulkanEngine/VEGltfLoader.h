@@ -0,0 +1,134 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_GLTF_NONE = 0xFFFFFFFF;			///<Index of a missing mesh, material or image
+const uint32_t VE_GLTF_MAX_DEPTH = 64;				///<Max depth of the node tree, protects against cycles
+
+
+namespace ve {
+
+	///Elements of an accessor, pointing into a buffer of the file
+	struct veGltfAccessor {
+		const uint8_t *	m_pData = nullptr;			///<First element, nullptr if the attribute is missing
+		uint32_t		m_count = 0;				///<Number of elements
+		uint32_t		m_stride = 0;				///<Bytes from one element to the next
+		uint32_t		m_componentType = 0;		///<GL type of the components, e.g. 5126 for float
+		uint32_t		m_numComponents = 0;		///<Components per element
+		bool			m_normalized = false;		///<Integer components are mapped to 0..1 or -1..1
+	};
+
+	///Triangles with one material
+	struct veGltfPrimitive {
+		veGltfAccessor	m_position;					///<POSITION, always present
+		veGltfAccessor	m_normal;					///<NORMAL
+		veGltfAccessor	m_tangent;					///<TANGENT
+		veGltfAccessor	m_texCoord;					///<TEXCOORD_0
+		veGltfAccessor	m_indices;					///<Indices, missing for non indexed triangles
+		uint32_t		m_material = VE_GLTF_NONE;	///<Index of the material
+	};
+
+	///A mesh, each primitive becomes a VEMesh
+	struct veGltfMesh {
+		std::string						m_name;			///<Name of the mesh
+		std::vector<veGltfPrimitive>	m_primitives;	///<Triangle primitives of the mesh
+	};
+
+	///A node of the scene tree
+	struct veGltfNode {
+		std::string				m_name;							///<Name of the node
+		glm::mat4				m_transform = glm::mat4(1.0f);	///<Local to parent transform
+		uint32_t				m_mesh = VE_GLTF_NONE;			///<Index of the mesh
+		std::vector<uint32_t>	m_children;						///<Indices of the child nodes
+	};
+
+	///An image, either an external file or compressed image data inside a buffer
+	struct veGltfImage {
+		std::string		m_uri;						///<File name relative to the glTF file, empty if embedded
+		const uint8_t *	m_pData = nullptr;			///<Embedded image data
+		uint32_t		m_size = 0;					///<Size of the embedded image data
+	};
+
+	///Material parameters VEMaterial can use
+	struct veGltfMaterial {
+		std::string		m_name;										///<Name of the material
+		glm::vec4		m_color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);	///<Base color factor
+		uint32_t		m_baseColorImage = VE_GLTF_NONE;			///<Image of the base color texture
+		uint32_t		m_normalImage = VE_GLTF_NONE;				///<Image of the normal texture
+	};
+
+
+	/**
+	*
+	* \brief Loads glTF 2.0 files (.gltf and .glb) without Assimp
+	*
+	* The file and its external buffers are read through VEFileSystem and stay in memory while the loader exists. Accessors
+	* point straight into the mapped buffers, so VESceneManager can let VEMesh copy the data from there into the
+	* staging buffers. Positions stored as tightly packed floats are copied with a single memcpy, the other
+	* attributes are gathered into the attribute stream in the same pass.
+	*
+	* Buffers from data URIs are decoded once. Compressed buffers (EXT_meshopt_compression, KHR_draco_mesh_compression)
+	* are not decoded: if the file requires them, load() fails so the caller can fall back to Assimp; otherwise their
+	* uncompressed fallback data is used. KTX2 images (KHR_texture_basisu) are skipped, the material then uses the
+	* fallback image if there is one. Like the Assimp path the winding order is reversed.
+	*
+	*/
+	class VEGltfLoader {
+
+	protected:
+		struct veJson;
+
+		std::string						m_basedir;			///<Directory of the glTF file
+		std::string						m_filename;			///<Name of the glTF file
+		std::vector<veFileData>			m_files;			///<The glTF file and its external buffers
+		std::vector<std::vector<uint8_t>> m_decoded;		///<Buffers and images from data URIs
+		std::vector<const uint8_t *>	m_buffers;			///<Start of each buffer
+		std::vector<size_t>				m_bufferSizes;		///<Size of each buffer
+		std::vector<veGltfMesh>			m_meshes;			///<All meshes
+		std::vector<veGltfNode>			m_nodes;			///<All nodes
+		std::vector<veGltfImage>		m_images;			///<All images
+		std::vector<veGltfMaterial>		m_materials;		///<All materials
+		std::vector<uint32_t>			m_rootNodes;		///<Root nodes of the scene
+		double							m_loadTime = 0.0;	///<Duration of load() in ms
+
+		bool	loadBuffers(const veJson &doc, const uint8_t *pBin, size_t binSize);	//map or decode all buffers
+		bool	getBufferView(const veJson &doc, uint32_t index, const uint8_t *&pData, size_t &size, uint32_t &stride);	//locate a buffer view
+		bool	getAccessor(const veJson &doc, uint32_t index, uint32_t numComponents, veGltfAccessor &accessor);	//locate and check an accessor
+		uint32_t getImage(const veJson &doc, const veJson *pTextureInfo);		//image of a texture reference
+
+	public:
+		///Constructor
+		VEGltfLoader(std::string basedir, std::string filename) : m_basedir(basedir), m_filename(filename) {};
+		///Destructor
+		~VEGltfLoader() {};
+
+		bool	load();												//load the file and its buffers
+
+		static bool		hasAllAttributes(const veGltfPrimitive &primitive);	//normals and tangents present
+		static uint32_t	getIndexCount(const veGltfPrimitive &primitive);	//number of indices of the triangle list
+		static void		copyPositions(const veGltfPrimitive &primitive, glm::vec3 *pPositions);	//write the position stream
+		static void		copyAttributes(const veGltfPrimitive &primitive, vh::vhVertexAttributes *pAttributes);	//write the attribute stream
+		static void		copyIndices(const veGltfPrimitive &primitive, uint32_t *pIndices);	//write indices, reversing the winding order
+		static void		buildMesh(const veGltfPrimitive &primitive, veObjMesh &mesh);	//vertices and indices for computing normals and tangents
+
+		///\returns all meshes
+		std::vector<veGltfMesh> & getMeshes() { return m_meshes; };
+		///\returns all nodes
+		std::vector<veGltfNode> & getNodes() { return m_nodes; };
+		///\returns all images
+		std::vector<veGltfImage> & getImages() { return m_images; };
+		///\returns all materials
+		std::vector<veGltfMaterial> & getMaterials() { return m_materials; };
+		///\returns the root nodes of the scene
+		std::vector<uint32_t> & getRootNodes() { return m_rootNodes; };
+		///\returns the time load() took in ms
+		double	getLoadTime() { return m_loadTime; };
+	};
+
+}
+
@@ -0,0 +1,661 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#include "VEInclude.h"
+
+
+/*
+GLSL source of shader/Forward/ImpostorBake/vert.spv, compile with glslangValidator -V bake.vert -o vert.spv
+
+#version 450
+
+layout(push_constant) uniform Params { mat4 mvp; vec4 normalMatrix[3]; vec4 color; } params;
+
+layout(location = 0) in vec3 inPositionL;
+layout(location = 1) in vec3 inNormalL;
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormalR;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+	gl_Position = params.mvp * vec4(inPositionL, 1.0);
+	fragNormalR = mat3(params.normalMatrix[0].xyz, params.normalMatrix[1].xyz, params.normalMatrix[2].xyz) * inNormalL;
+	fragTexCoord = inTexCoord;
+}
+
+
+GLSL source of shader/Forward/ImpostorBake/frag.spv, compile with glslangValidator -V bake.frag -o frag.spv
+
+#version 450
+
+layout(push_constant) uniform Params { mat4 mvp; vec4 normalMatrix[3]; vec4 color; } params;
+
+layout(set = 0, binding = 0) uniform sampler2D texSampler;
+
+layout(location = 0) in vec3 fragNormalR;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+
+void main() {
+	vec4 albedo = texture(texSampler, fragTexCoord) * params.color;
+	if (albedo.a < 0.5) discard;
+	outAlbedo = vec4(albedo.rgb, 1.0);
+	outNormal = vec4(normalize(fragNormalR) * 0.5 + 0.5, 1.0);
+}
+*/
+
+
+namespace ve {
+
+	///Push constants of the bake shaders
+	struct veImpostorBakeParams {
+		glm::mat4 mvp;					///<Entity to clip space of the view
+		glm::vec4 normalMatrix[3];		///<Columns of the entity to root normal matrix
+		glm::vec4 color;				///<Multiplied with the diffuse texture
+	};
+
+	///Header of a cached atlas file, followed by the albedo and normal PNG files
+	struct veImpostorCacheHeader {
+		uint32_t	m_magic;			///<VE_IMPOSTOR_CACHE_MAGIC
+		uint32_t	m_version;			///<VE_IMPOSTOR_CACHE_VERSION
+		uint32_t	m_views;			///<VE_IMPOSTOR_VIEWS the atlases were baked with
+		uint32_t	m_cellSize;			///<VE_IMPOSTOR_CELL_SIZE the atlases were baked with
+		glm::vec4	m_sphere;			///<Bounding sphere of the model in root space
+		uint32_t	m_sizes[2];			///<Sizes of the albedo and normal PNG files
+	};
+
+
+	///Append the output of the PNG writer to a byte vector
+	static void vePNGWrite(void *context, void *data, int size) {
+		std::vector<uint8_t> *pPNG = (std::vector<uint8_t>*)context;
+		pPNG->insert(pPNG->end(), (uint8_t*)data, (uint8_t*)data + size);
+	}
+
+
+	/**
+	*
+	* \brief Get the direction of an atlas cell
+	*
+	* The upper hemisphere is mapped to the diamond |x|+|z|<=1, which is rotated by 45 degrees to fill the square.
+	*
+	* \param[in] uv Position in the atlas, from 0 to 1
+	* \returns the normalized direction, y is never negative
+	*
+	*/
+	static glm::vec3 veDecodeHemiOct(glm::vec2 uv) {
+		glm::vec2 e = uv * 2.0f - 1.0f;
+		glm::vec2 p = glm::vec2(e.x + e.y, e.x - e.y) * 0.5f;
+		return glm::normalize(glm::vec3(p.x, 1.0f - fabs(p.x) - fabs(p.y), p.y));
+	}
+
+
+	/**
+	*
+	* \brief Get the orthographic view projection matrix of a view of the model
+	*
+	* The view looks from direction dir at the sphere, which fills the view. Right and up are chosen like in the
+	* impostor vertex shader, so the shader can reproject into the view.
+	*
+	* \param[in] dir Direction from the sphere center towards the viewer
+	* \param[in] sphere The bounding sphere in root space
+	* \returns the matrix from root space to clip space
+	*
+	*/
+	static glm::mat4 veGetViewProj(glm::vec3 dir, glm::vec4 sphere) {
+		glm::vec3 up = fabs(dir.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 right = glm::normalize(glm::cross(dir, up));
+		up = glm::cross(right, dir);
+
+		glm::vec3 center = glm::vec3(sphere);
+		float radius = sphere.w;
+		glm::mat4 rows(	glm::vec4(right, -glm::dot(right, center)) / radius,
+						-glm::vec4(up, -glm::dot(up, center)) / radius,
+						glm::vec4(-dir, glm::dot(dir, center) + radius) / (2.0f * radius),
+						glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		return glm::transpose(rows);
+	}
+
+
+	/**
+	*
+	* \brief Create the quad shared by all impostors
+	*
+	* The corners are at -1 and 1 in x and y, the vertex shader turns the quad towards the camera.
+	*
+	* \returns a pointer to the new mesh
+	*
+	*/
+	VEMesh * VEImpostor::createQuadMesh() {
+		return new VEMesh(VE_IMPOSTOR_QUAD_MESH, 4, 6,
+			[&](glm::vec3 *pPositions, vh::vhVertexAttributes *pAttributes) {
+				glm::vec2 corners[4] = { {-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f} };
+				for (uint32_t i = 0; i < 4; i++) {
+					pPositions[i] = glm::vec3(corners[i], 0.0f);
+					pAttributes[i] = { glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 0.0f), corners[i] * 0.5f + 0.5f };
+				}
+			},
+			[&](uint32_t *pIndices) {
+				uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };		//front faces the camera, reversed winding like the model loaders
+				for (uint32_t i = 0; i < 6; i++) pIndices[i] = indices[i];
+			});
+	}
+
+
+	/**
+	*
+	* \brief Impostor constructor
+	*
+	* Loads the atlases from the mesh cache, or bakes them and stores them in the cache. The prototype is not
+	* an instance, call addInstance() if it is drawn too. The impostor casts no shadows and is not hit by ray casts.
+	*
+	* \param[in] name Name of the impostor
+	* \param[in] pQuadMesh The shared quad mesh, see createQuadMesh()
+	* \param[in] pMat An empty material, receives the albedo atlas as diffuse map and the normal atlas as normal map
+	* \param[in] pPrototype Root of the model, all entities below it are baked
+	* \param[in] distance Instances farther away than this are drawn as impostors
+	*
+	*/
+	VEImpostor::VEImpostor(std::string name, VEMesh *pQuadMesh, VEMaterial *pMat, VESceneNode *pPrototype, float distance) :
+								VEEntity(name, VE_ENTITY_TYPE_IMPOSTOR, pQuadMesh, pMat, glm::mat4(1.0f), nullptr),
+								m_distance(distance) {
+
+		m_castsShadow = false;
+		m_raycastMask = 0;
+
+		std::vector<vePart> parts;
+		collectParts(pPrototype, glm::mat4(1.0f), parts);
+		if (parts.size() == 0) {
+			throw std::runtime_error("Error: Impostor prototype " + pPrototype->getName() + " has no entities!");
+		}
+
+		std::vector<glm::vec4> spheres;											//spheres of the parts in root space
+		glm::vec3 bmin(std::numeric_limits<float>::max()), bmax(-std::numeric_limits<float>::max());
+		for (auto &part : parts) {
+			VEMesh *pMesh = part.m_pEntity->m_pMesh;
+			float scale = std::max(std::max(glm::length(glm::vec3(part.m_transform[0])), glm::length(glm::vec3(part.m_transform[1]))),
+									glm::length(glm::vec3(part.m_transform[2])));
+			glm::vec3 center = glm::vec3(part.m_transform * glm::vec4(pMesh->m_boundingSphereCenter, 1.0f));
+			float radius = pMesh->m_boundingSphereRadius * scale;
+			spheres.push_back(glm::vec4(center, radius));
+			bmin = glm::min(bmin, center - radius);
+			bmax = glm::max(bmax, center + radius);
+		}
+		m_sphere = glm::vec4((bmin + bmax) * 0.5f, 0.0f);
+		for (auto &sphere : spheres) {
+			m_sphere.w = std::max(m_sphere.w, glm::length(glm::vec3(sphere) - glm::vec3(m_sphere)) + sphere.w);
+		}
+
+		std::string cacheFile;
+		std::string cacheDir = getSceneManagerPointer()->getMeshCacheDir();
+		if (cacheDir.size() > 0) {
+			char hash[17];
+			snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)getCacheHash(parts));
+			cacheFile = cacheDir + "/" + hash + ".impostor";
+		}
+		if (cacheFile.size() == 0 || !loadAtlases(cacheFile)) {
+			bakeAtlases(parts);
+			if (cacheFile.size() > 0) saveAtlases(cacheFile);
+		}
+
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+		uint32_t numImages = getRendererPointer()->getSwapChainNumber();
+		VkDeviceSize bufferSize = VE_IMPOSTOR_INDIRECT_OFFSET + sizeof(VkDrawIndexedIndirectCommand);
+		m_buffers.resize(numImages);
+		m_allocations.resize(numImages);
+		m_pBuffers.resize(numImages);
+		for (uint32_t i = 0; i < numImages; i++) {
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+												VMA_MEMORY_USAGE_CPU_TO_GPU, &m_buffers[i], &m_allocations[i]), "Could not create impostor buffer");
+			VECHECKRESULT(vmaMapMemory(allocator, m_allocations[i], (void**)&m_pBuffers[i]), "Could not map impostor buffer");
+			memset(m_pBuffers[i], 0, (size_t)bufferSize);
+
+			veUBOImpostor_t *pUBO = (veUBOImpostor_t*)m_pBuffers[i];
+			pUBO->sphere = m_sphere;
+			pUBO->params = glm::vec4((float)VE_IMPOSTOR_VIEWS, 0.0f, 0.0f, 0.0f);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Impostor destructor, destroys the buffers
+	*
+	* The atlases belong to the material.
+	*
+	*/
+	VEImpostor::~VEImpostor() {
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+		for (uint32_t i = 0; i < m_buffers.size(); i++) {
+			vmaUnmapMemory(allocator, m_allocations[i]);
+			vmaDestroyBuffer(allocator, m_buffers[i], m_allocations[i]);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Collect the entities below a node that are drawn as meshes
+	*
+	* \param[in] pNode The node
+	* \param[in] transform Node to root transform
+	* \param[out] parts The entities and their entity to root transforms are appended
+	*
+	*/
+	void VEImpostor::collectParts(VESceneNode *pNode, glm::mat4 transform, std::vector<vePart> &parts) {
+		if (pNode->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY) {
+			VEEntity *pEntity = (VEEntity*)pNode;
+			if (pEntity->getEntityType() == VE_ENTITY_TYPE_NORMAL && pEntity->m_pMesh != nullptr && pEntity->m_pMaterial != nullptr) {
+				parts.push_back({ pEntity, transform });
+			}
+		}
+		for (auto pChild : pNode->m_children) {
+			collectParts(pChild, transform * pChild->getTransform(), parts);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Compute a 64 bit FNV-1a hash of everything the atlases depend on
+	*
+	* \param[in] parts The entities of the prototype
+	* \returns the hash, used as the name of the cached atlas file
+	*
+	*/
+	uint64_t VEImpostor::getCacheHash(const std::vector<vePart> &parts) {
+		uint64_t hash = 14695981039346656037ull;
+		auto addBytes = [&](const void *data, size_t size) {
+			const uint8_t *bytes = (const uint8_t*)data;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		uint32_t params[3] = { VE_IMPOSTOR_CACHE_VERSION, VE_IMPOSTOR_VIEWS, VE_IMPOSTOR_CELL_SIZE };
+		addBytes(params, sizeof(params));
+
+		for (auto &part : parts) {
+			VEMesh *pMesh = part.m_pEntity->m_pMesh;
+			VEMaterial *pMat = part.m_pEntity->m_pMaterial;
+			addBytes(pMesh->getName().data(), pMesh->getName().size());
+			addBytes(&pMesh->m_vertexCount, sizeof(uint32_t));
+			addBytes(&pMesh->m_indexCount, sizeof(uint32_t));
+			addBytes(&part.m_transform, sizeof(glm::mat4));
+			addBytes(pMat->getName().data(), pMat->getName().size());
+			addBytes(&pMat->color, sizeof(glm::vec4));
+		}
+		return hash;
+	}
+
+
+	/**
+	*
+	* \brief Load the atlases from a cached atlas file
+	*
+	* \param[in] filename Path of the cached atlas file
+	* \returns false if the file does not exist or was baked with other settings
+	*
+	*/
+	bool VEImpostor::loadAtlases(std::string filename) {
+		std::ifstream in(filename, std::ios::binary);
+		if (!in) return false;
+
+		veImpostorCacheHeader header;
+		in.read((char*)&header, sizeof(header));
+		if (!in || header.m_magic != VE_IMPOSTOR_CACHE_MAGIC || header.m_version != VE_IMPOSTOR_CACHE_VERSION ||
+			header.m_views != VE_IMPOSTOR_VIEWS || header.m_cellSize != VE_IMPOSTOR_CELL_SIZE) return false;
+
+		std::vector<uint8_t> pngs[2];
+		for (uint32_t i = 0; i < 2; i++) {
+			pngs[i].resize(header.m_sizes[i]);
+			in.read((char*)pngs[i].data(), header.m_sizes[i]);
+		}
+		if (!in) return false;
+
+		m_pMaterial->mapDiffuse = new VETexture(getName() + "/albedo", pngs[0].data(), header.m_sizes[0]);
+		m_pMaterial->mapNormal = new VETexture(getName() + "/normal", pngs[1].data(), header.m_sizes[1]);
+		m_sphere = header.m_sphere;
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Store the atlases in a cached atlas file
+	*
+	* The atlases are read back from the GPU and compressed as PNG. Failing to write the file is not an error.
+	*
+	* \param[in] filename Path of the cached atlas file
+	*
+	*/
+	void VEImpostor::saveAtlases(std::string filename) {
+		const uint32_t size = VE_IMPOSTOR_VIEWS * VE_IMPOSTOR_CELL_SIZE;
+		std::vector<uint8_t> pixels(size * size * 4);
+		std::vector<uint8_t> pngs[2];
+		VETexture *pAtlases[2] = { m_pMaterial->mapDiffuse, m_pMaterial->mapNormal };
+
+		for (uint32_t i = 0; i < 2; i++) {
+			VECHECKRESULT(vh::vhBufCopyImageToHost(getRendererPointer()->getDevice(), getRendererPointer()->getVmaAllocator(),
+												getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
+												pAtlases[i]->m_image, pAtlases[i]->m_format, VK_IMAGE_ASPECT_COLOR_BIT,
+												VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, (gli::byte*)pixels.data(), size, size, size * size * 4),
+						"Could not read back impostor atlas");
+			stbi_write_png_to_func(vePNGWrite, &pngs[i], size, size, 4, pixels.data(), size * 4);
+		}
+
+		std::ofstream out(filename, std::ios::binary);
+		if (!out) return;
+
+		veImpostorCacheHeader header = {	VE_IMPOSTOR_CACHE_MAGIC, VE_IMPOSTOR_CACHE_VERSION, VE_IMPOSTOR_VIEWS, VE_IMPOSTOR_CELL_SIZE,
+											m_sphere, { (uint32_t)pngs[0].size(), (uint32_t)pngs[1].size() } };
+		out.write((const char*)&header, sizeof(header));
+		for (uint32_t i = 0; i < 2; i++) {
+			out.write((const char*)pngs[i].data(), pngs[i].size());
+		}
+	}
+
+
+	/**
+	*
+	* \brief Render the model into the albedo and normal atlases
+	*
+	* Each cell of the atlases is one orthographic view of the bounding sphere, the direction of cell (i, j) is
+	* the hemi-octahedral direction of (i, j)/(VE_IMPOSTOR_VIEWS-1), so the outer cells look along the horizon.
+	* All views are rendered in one render pass, with the viewport set to the cell. Entities without a diffuse
+	* texture are drawn with their material color. Normals are stored in root space, mapped to 0..1.
+	*
+	* \param[in] parts The entities of the prototype
+	*
+	*/
+	void VEImpostor::bakeAtlases(const std::vector<vePart> &parts) {
+		VkDevice device = getRendererPointer()->getDevice();
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+		VkQueue queue = getRendererPointer()->getGraphicsQueue();
+		VkCommandPool commandPool = getRendererPointer()->getCommandPool();
+		const uint32_t size = VE_IMPOSTOR_VIEWS * VE_IMPOSTOR_CELL_SIZE;
+		VkExtent2D extent = { size, size };
+		VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		VkFormat depthFormat = vh::vhDevFindDepthFormat(getRendererPointer()->getPhysicalDevice());
+
+		//the atlases, owned by the material from now on
+
+		VETexture *pAtlases[2] = { new VETexture(getName() + "/albedo"), new VETexture(getName() + "/normal") };
+		m_pMaterial->mapDiffuse = pAtlases[0];
+		m_pMaterial->mapNormal = pAtlases[1];
+		for (auto pAtlas : pAtlases) {
+			pAtlas->m_format = colorFormat;
+			pAtlas->m_extent = extent;
+			VECHECKRESULT(vh::vhBufCreateImage(allocator, size, size, 1, 1, colorFormat, VK_IMAGE_TILING_OPTIMAL,
+											VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 0,
+											&pAtlas->m_image, &pAtlas->m_deviceAllocation), "Could not create impostor atlas");
+			VECHECKRESULT(vh::vhBufCreateImageView(device, pAtlas->m_image, colorFormat, VK_IMAGE_VIEW_TYPE_2D, 1,
+											VK_IMAGE_ASPECT_COLOR_BIT, &pAtlas->m_imageView), "Could not create impostor atlas view");
+			VECHECKRESULT(vh::vhBufCreateTextureSampler(device, &pAtlas->m_sampler), "Could not create impostor atlas sampler");
+		}
+
+		//depth buffer, render pass and framebuffer
+
+		VkImage depthImage;
+		VmaAllocation depthAllocation;
+		VkImageView depthImageView;
+		VECHECKRESULT(vh::vhBufCreateImage(allocator, size, size, 1, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL,
+										VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, &depthImage, &depthAllocation), "Could not create impostor depth image");
+		VECHECKRESULT(vh::vhBufCreateImageView(device, depthImage, depthFormat, VK_IMAGE_VIEW_TYPE_2D, 1,
+										VK_IMAGE_ASPECT_DEPTH_BIT, &depthImageView), "Could not create impostor depth image view");
+
+		VkRenderPass renderPass;
+		VECHECKRESULT(vh::vhRenderCreateRenderPassOffscreen(device, { colorFormat, colorFormat }, depthFormat, &renderPass),
+						"Could not create impostor render pass");
+
+		VkImageView attachments[3] = { pAtlases[0]->m_imageView, pAtlases[1]->m_imageView, depthImageView };
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = 3;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = size;
+		framebufferInfo.height = size;
+		framebufferInfo.layers = 1;
+		VkFramebuffer framebuffer;
+		VECHECKRESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer), "Could not create impostor framebuffer");
+
+		//a white texture for materials without diffuse map, and a descriptor set for each material
+
+		std::vector<uint8_t> whitePNG;
+		uint8_t whitePixel[4] = { 255, 255, 255, 255 };
+		stbi_write_png_to_func(vePNGWrite, &whitePNG, 1, 1, 4, whitePixel, 4);
+		VETexture white(getName() + "/white", whitePNG.data(), (uint32_t)whitePNG.size());
+
+		std::vector<VEMaterial *> materials;
+		for (auto &part : parts) {
+			if (std::find(materials.begin(), materials.end(), part.m_pEntity->m_pMaterial) == materials.end()) {
+				materials.push_back(part.m_pEntity->m_pMaterial);
+			}
+		}
+
+		VkDescriptorSetLayout descriptorSetLayout;
+		VECHECKRESULT(vh::vhRenderCreateDescriptorSetLayout(device, { 1 }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER },
+						{ VK_SHADER_STAGE_FRAGMENT_BIT }, &descriptorSetLayout), "Could not create impostor descriptor set layout");
+
+		VkDescriptorPool descriptorPool;
+		VECHECKRESULT(vh::vhRenderCreateDescriptorPool(device, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER }, { (uint32_t)materials.size() },
+						&descriptorPool), "Could not create impostor descriptor pool");
+
+		std::unordered_map<VEMaterial *, VkDescriptorSet> descriptorSets;
+		for (auto pMat : materials) {
+			std::vector<VkDescriptorSet> sets;
+			VECHECKRESULT(vh::vhRenderCreateDescriptorSets(device, 1, descriptorSetLayout, descriptorPool, sets),
+							"Could not create impostor descriptor set");
+
+			VETexture *pTexture = pMat->mapDiffuse != nullptr ? pMat->mapDiffuse : &white;
+			VECHECKRESULT(vh::vhRenderUpdateDescriptorSet(device, sets[0], { VK_NULL_HANDLE }, { 0 },
+							{ { pTexture->m_imageView } }, { { pTexture->m_sampler } }), "Could not update impostor descriptor set");
+			descriptorSets[pMat] = sets[0];
+		}
+
+		//the pipeline
+
+		VkPipelineLayout pipelineLayout;
+		VkPushConstantRange pushConstantRange = { VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(veImpostorBakeParams) };
+		VECHECKRESULT(vh::vhPipeCreateGraphicsPipelineLayout(device, { descriptorSetLayout }, { pushConstantRange }, &pipelineLayout),
+						"Could not create impostor pipeline layout");
+
+		VkPipeline pipeline;
+		VECHECKRESULT(vh::vhPipeCreateGraphicsOffscreenPipeline(device,
+						{ "shader/Forward/ImpostorBake/vert.spv", "shader/Forward/ImpostorBake/frag.spv" },
+						pipelineLayout, renderPass, 2, &pipeline), "Could not create impostor bake pipeline");
+
+		//render all views
+
+		VkClearValue clearValues[3] = {};
+		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+		clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+		clearValues[2].depthStencil = { 1.0f, 0 };
+
+		VkCommandBuffer commandBuffer = vh::vhCmdBeginSingleTimeCommands(device, commandPool);
+		vh::vhRenderBeginRenderPass(commandBuffer, renderPass, framebuffer, vh::vhSpan<const VkClearValue>(clearValues, 3), extent);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+		for (uint32_t j = 0; j < VE_IMPOSTOR_VIEWS; j++) {
+			for (uint32_t i = 0; i < VE_IMPOSTOR_VIEWS; i++) {
+				glm::vec3 dir = veDecodeHemiOct(glm::vec2((float)i, (float)j) / (float)(VE_IMPOSTOR_VIEWS - 1));
+				glm::mat4 viewProj = veGetViewProj(dir, m_sphere);
+
+				VkViewport viewport = { (float)(i * VE_IMPOSTOR_CELL_SIZE), (float)(j * VE_IMPOSTOR_CELL_SIZE),
+										(float)VE_IMPOSTOR_CELL_SIZE, (float)VE_IMPOSTOR_CELL_SIZE, 0.0f, 1.0f };
+				VkRect2D scissor = { { (int32_t)(i * VE_IMPOSTOR_CELL_SIZE), (int32_t)(j * VE_IMPOSTOR_CELL_SIZE) },
+									{ VE_IMPOSTOR_CELL_SIZE, VE_IMPOSTOR_CELL_SIZE } };
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+				for (auto &part : parts) {
+					VEMesh *pMesh = part.m_pEntity->m_pMesh;
+					VEMaterial *pMat = part.m_pEntity->m_pMaterial;
+
+					veImpostorBakeParams params;
+					params.mvp = viewProj * part.m_transform;
+					glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(part.m_transform)));
+					for (uint32_t k = 0; k < 3; k++) params.normalMatrix[k] = glm::vec4(normalMatrix[k], 0.0f);
+					params.color = pMat->mapDiffuse != nullptr ? glm::vec4(1.0f) : glm::vec4(glm::vec3(pMat->color), 1.0f);
+
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[pMat], 0, nullptr);
+					vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+										0, sizeof(params), &params);
+
+					VkBuffer vertexBuffers[] = { pMesh->m_vertexBuffer, pMesh->m_vertexBuffer };
+					VkDeviceSize offsets[] = { 0, pMesh->m_attributeOffset };
+					vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+					vkCmdBindIndexBuffer(commandBuffer, pMesh->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+					vkCmdDrawIndexed(commandBuffer, pMesh->m_indexCount, 1, 0, 0, 0);
+				}
+			}
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+		VECHECKRESULT(vh::vhCmdEndSingleTimeCommands(device, queue, commandPool, commandBuffer), "Could not bake impostor atlases");
+
+		vkDestroyPipeline(device, pipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
+		vkDestroyImageView(device, depthImageView, nullptr);
+		vmaDestroyImage(allocator, depthImage, depthAllocation);
+	}
+
+
+	/**
+	*
+	* \brief Add an instance of the model
+	*
+	* The instance should have the same entities as the prototype, e.g. be loaded from the same file. It stays
+	* registered until removeInstance() is called, so remove it before deleting it.
+	*
+	* \param[in] pRoot Root of the instance
+	*
+	*/
+	void VEImpostor::addInstance(VESceneNode *pRoot) {
+		std::vector<vePart> parts;
+		collectParts(pRoot, glm::mat4(1.0f), parts);
+
+		veInstance instance;
+		instance.m_pRoot = pRoot;
+		for (auto &part : parts) instance.m_entities.push_back(part.m_pEntity);
+		m_instances.push_back(instance);
+	}
+
+
+	/**
+	*
+	* \brief Remove an instance, its entities are drawn again
+	*
+	* \param[in] pRoot Root of the instance
+	*
+	*/
+	void VEImpostor::removeInstance(VESceneNode *pRoot) {
+		for (uint32_t i = 0; i < m_instances.size(); i++) {
+			if (m_instances[i].m_pRoot != pRoot) continue;
+
+			if (m_instances[i].m_impostor) {
+				for (auto pEntity : m_instances[i].m_entities) pEntity->m_drawEntity = true;
+				getRendererForwardPointer()->deleteCmdBuffers();
+			}
+			m_instances.erase(m_instances.begin() + i);
+			return;
+		}
+	}
+
+
+	/**
+	*
+	* \brief Switch instances between mesh and impostor, and write the visible impostors
+	*
+	* Instances farther from the camera than the switch distance become impostors, impostors closer than
+	* VE_IMPOSTOR_HYSTERESIS times the distance become meshes again, so instances do not flicker at the threshold.
+	* If an instance switches, the command buffers are recorded again. Impostors outside the camera frustum are
+	* not written. The number of written impostors is the instance count of the indirect draw.
+	*
+	* \param[in] worldMatrix The world matrix of the impostor entity
+	* \param[in] imageIndex Index of the swapchain image that is currently used
+	*
+	*/
+	void VEImpostor::updateUBO(glm::mat4 worldMatrix, uint32_t imageIndex) {
+		VEEntity::updateUBO(worldMatrix, imageIndex);
+
+		veUBOImpostor_t *pUBO = (veUBOImpostor_t*)m_pBuffers[imageIndex];
+		VkDrawIndexedIndirectCommand *pDraw = (VkDrawIndexedIndirectCommand*)(m_pBuffers[imageIndex] + VE_IMPOSTOR_INDIRECT_OFFSET);
+		m_numImpostors = 0;
+
+		VECamera *pCamera = getSceneManagerPointer()->getCamera();
+		if (pCamera != nullptr && m_drawEntity) {
+			glm::mat4 cameraWorld = pCamera->getWorldTransform();
+			glm::vec3 cameraPos = glm::vec3(cameraWorld[3]);
+			glm::vec4 planes[6];
+			VEGPUCulling::getFrustumPlanes(pCamera->getProjectionMatrix() * glm::inverse(cameraWorld), planes);
+
+			bool switched = false;
+			uint32_t numImpostorInstances = 0;
+			for (auto &instance : m_instances) {
+				glm::mat4 rootWorld = instance.m_pRoot->getWorldTransform();
+				float scale = glm::length(glm::vec3(rootWorld[0]));
+				glm::vec3 center = glm::vec3(rootWorld * glm::vec4(glm::vec3(m_sphere), 1.0f));
+				float radius = m_sphere.w * scale;
+				float distance = glm::length(center - cameraPos);
+
+				bool impostor = distance > (instance.m_impostor ? m_distance * VE_IMPOSTOR_HYSTERESIS : m_distance);
+				if (impostor && numImpostorInstances >= VE_IMPOSTOR_MAX_INSTANCES) impostor = false;	//the UBO is full
+				if (impostor != instance.m_impostor) {
+					instance.m_impostor = impostor;
+					for (auto pEntity : instance.m_entities) pEntity->m_drawEntity = !impostor;
+					switched = true;
+				}
+				if (!impostor) continue;
+				numImpostorInstances++;
+
+				bool visible = true;
+				for (uint32_t p = 0; p < 6 && visible; p++) {
+					visible = glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius;
+				}
+				if (!visible) continue;
+
+				glm::quat rotation = glm::quat_cast(glm::mat3(rootWorld) / scale);
+				pUBO->instances[m_numImpostors++] = {	glm::vec4(glm::vec3(rootWorld[3]), scale),
+														glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w) };
+			}
+			if (switched) getRendererForwardPointer()->deleteCmdBuffers();	//hidden entities must not be recorded
+		}
+
+		*pDraw = { m_pMesh->m_indexCount, m_numImpostors, 0, 0, 0 };
+	}
+
+
+	/**
+	*
+	* \brief Record the instanced draw of all impostors
+	*
+	* The descriptor sets of the impostor must be bound. The instance count is written each frame by updateUBO(),
+	* so the command buffer stays valid when impostors come into or leave the view.
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] imageIndex Index of the swapchain image the command buffer is used with
+	*
+	*/
+	void VEImpostor::recordDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+		VkBuffer vertexBuffers[] = { m_pMesh->m_vertexBuffer, m_pMesh->m_vertexBuffer };
+		VkDeviceSize offsets[] = { 0, m_pMesh->m_attributeOffset };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, m_pMesh->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+		vkCmdDrawIndexedIndirect(commandBuffer, m_buffers[imageIndex], VE_IMPOSTOR_INDIRECT_OFFSET, 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+
+}
+
@@ -0,0 +1,109 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_IMPOSTOR_VIEWS = 8;				///<Views along each side of the octahedral atlas
+const uint32_t VE_IMPOSTOR_CELL_SIZE = 128;			///<Texels along each side of a view in the atlas
+const uint32_t VE_IMPOSTOR_MAX_INSTANCES = 511;		///<Max instances drawn as impostors, so the UBO has 16 KB
+const VkDeviceSize VE_IMPOSTOR_INDIRECT_OFFSET = 16384;	///<Offset of the indirect draw in the impostor buffers, after the UBO
+const float VE_IMPOSTOR_HYSTERESIS = 0.9f;			///<Impostors switch back to meshes below this fraction of the distance
+const uint32_t VE_IMPOSTOR_CACHE_MAGIC = 0x504D4956;	///<"VIMP", first bytes of a cached atlas file
+const uint32_t VE_IMPOSTOR_CACHE_VERSION = 1;		///<Version of the cached atlas file
+const std::string VE_IMPOSTOR_QUAD_MESH = "VEImpostorQuad";	///<Name of the shared quad mesh in the scene manager
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief An impostor standing in for distant instances of a model
+	*
+	* When the impostor is created, the model below a prototype scene node is rendered from VE_IMPOSTOR_VIEWS^2
+	* directions of the upper hemisphere into two atlases: the albedo with coverage in alpha, and the normals in
+	* the space of the prototype root. The views are laid out as a hemi-octahedral map, so the cell of a view
+	* direction is found without a search. If the scene manager has a mesh cache directory, the atlases are stored
+	* there as PNG files and loaded instead of baked the next time.
+	*
+	* Instances are scene nodes holding a copy of the model, see addInstance(). Each frame, instances farther from
+	* the camera than the switch distance hide their entities and are drawn as a camera facing quad instead, which
+	* shows the atlas cell closest to the view direction. All impostors of a model are one instanced indirect draw.
+	* The instance data are written to a buffer per swapchain image, so command buffers are recorded again only
+	* when an instance switches between mesh and impostor.
+	*
+	* Instances are assumed to be scaled uniformly.
+	*
+	*/
+	class VEImpostor : public VEEntity {
+
+	public:
+		///Data of an instance drawn as impostor
+		struct veImpostorInstance_t {
+			glm::vec4 positionScale;		///<World position of the instance root, and its scale
+			glm::vec4 rotation;				///<Rotation of the instance root as quaternion (x, y, z, w)
+		};
+
+		///UBO of the impostor shaders, followed by the indirect draw in the same buffer
+		struct veUBOImpostor_t {
+			glm::vec4 sphere;				///<Bounding sphere of the model in root space
+			glm::vec4 params;				///<param[0]: views along each side of the atlas
+			veImpostorInstance_t instances[VE_IMPOSTOR_MAX_INSTANCES];	///<Instances drawn as impostors
+		};
+
+	protected:
+		///An instance of the model
+		struct veInstance {
+			VESceneNode *			m_pRoot;					///<Root of the instance
+			std::vector<VEEntity *>	m_entities;					///<Entities of the instance, hidden while it is an impostor
+			bool					m_impostor = false;			///<Drawn as impostor
+		};
+
+		///An entity of the prototype
+		struct vePart {
+			VEEntity *				m_pEntity;					///<The entity
+			glm::mat4				m_transform;				///<Entity to root transform
+		};
+
+		glm::vec4					m_sphere;					///<Bounding sphere of the model in root space
+		float						m_distance = 100.0f;		///<Instances farther away are drawn as impostors
+		std::vector<veInstance>		m_instances;				///<All instances
+		uint32_t					m_numImpostors = 0;			///<Instances drawn as impostors in the last frame
+
+		std::vector<VkBuffer>		m_buffers;					///<UBO and indirect draw for each swapchain image
+		std::vector<VmaAllocation>	m_allocations;				///<VMA information for the buffers
+		std::vector<uint8_t *>		m_pBuffers;					///<Mapped buffers
+
+		static void	collectParts(VESceneNode *pNode, glm::mat4 transform, std::vector<vePart> &parts);	//entities drawn as meshes below a node
+		uint64_t	getCacheHash(const std::vector<vePart> &parts);		//hash of everything the atlases depend on
+		bool		loadAtlases(std::string filename);					//load cached atlases
+		void		saveAtlases(std::string filename);					//store the atlases as PNG files
+		void		bakeAtlases(const std::vector<vePart> &parts);		//render the model into the atlases
+
+	public:
+		VEImpostor(std::string name, VEMesh *pQuadMesh, VEMaterial *pMat, VESceneNode *pPrototype, float distance);
+		virtual ~VEImpostor();
+
+		static VEMesh * createQuadMesh();								//the quad shared by all impostors
+
+		virtual void updateUBO(glm::mat4 worldMatrix, uint32_t imageIndex);	//switch instances and write the impostor instances
+
+		void		addInstance(VESceneNode *pRoot);					//add an instance of the model
+		void		removeInstance(VESceneNode *pRoot);					//remove an instance, it is drawn as mesh again
+		void		recordDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex);	//record the instanced draw of all impostors
+
+		///\returns the buffer holding the UBO and the indirect draw of a swapchain image
+		VkBuffer	getBuffer(uint32_t imageIndex) { return m_buffers[imageIndex]; };
+		///\param[in] distance Instances farther away than this are drawn as impostors
+		void		setDistance(float distance) { m_distance = distance; };
+		///\returns the number of instances drawn as impostors in the last frame
+		uint32_t	getNumImpostors() { return m_numImpostors; };
+		///\returns the number of instances
+		uint32_t	getNumInstances() { return (uint32_t)m_instances.size(); };
+	};
+
+}
+
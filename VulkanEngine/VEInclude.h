@@ -10,6 +10,7 @@
 #include "VHHelper.h"
 
 #include "VENamedClass.h"
+#include "VEFileSystem.h"
 #include "VEEventListener.h"
 #include "VEEventListenerGLFW.h"
 #include "VEEventListenerNuklear.h"
@@ -18,9 +19,20 @@
 #include "VEWindow.h"
 #include "VEWindowGLFW.h"
 #include "VEEngine.h"
+#include "VEBVH.h"
 #include "VEMaterial.h"
+#include "VEObjLoader.h"
+#include "VEGltfLoader.h"
+#include "VEECS.h"
+#include "VEGPUCulling.h"
+#include "VEBroadphase.h"
+#include "VEOctree.h"
 #include "VEEntity.h"
+#include "VETerrain.h"
+#include "VEImpostor.h"
 #include "VESceneManager.h"
+#include "VERenderQueue.h"
+#include "VERenderGraph.h"
 #include "VESubrender.h"
 #include "VESubrenderFW_C1.h"
 #include "VESubrenderFW_Cubemap.h"
@@ -30,6 +42,8 @@
 #include "VESubrenderFW_DN.h"
 #include "VESubrenderFW_Nuklear.h"
 #include "VESubrenderFW_Shadow.h"
+#include "VESubrenderFW_Terrain.h"
+#include "VESubrenderFW_Impostor.h"
 #include "VERenderer.h"
 #include "VERendererForward.h"
 
@@ -77,7 +77,7 @@ namespace ve {
 		//create the vertex buffer
 		VECHECKRESULT(vh::vhBufCreateVertexBuffer(	getRendererPointer()->getDevice(), getRendererPointer()->getVmaAllocator(),
 													getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
-													vertices, &m_vertexBuffer, &m_vertexBufferAllocation),
+													vertices, &m_vertexBuffer, &m_vertexBufferAllocation, &m_attributeOffset),
 					"Could not create vertex buffer for " + name );
 
 		//create the index buffer
@@ -86,6 +86,7 @@ namespace ve {
 													indices, &m_indexBuffer, &m_indexBufferAllocation),
 					"Could not create index buffer for " + name);
 
+		retainGeometry(vertices, indices);
 	}
 
 
@@ -103,6 +104,7 @@ namespace ve {
 
 		//copy the mesh vertex data
 		m_vertexCount = (uint32_t)vertices.size();
+		m_indexCount = (uint32_t)indices.size();
 		m_boundingSphereRadius = 0.0f;
 		m_boundingSphereCenter = glm::vec3(0.0f, 0.0f, 0.0f);
 		for (uint32_t i = 0; i < vertices.size(); i++) {
@@ -117,7 +119,7 @@ namespace ve {
 		//create the vertex buffer
 		VECHECKRESULT( vh::vhBufCreateVertexBuffer(	getRendererPointer()->getDevice(), getRendererPointer()->getVmaAllocator(),
 													getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
-													vertices, &m_vertexBuffer, &m_vertexBufferAllocation),
+													vertices, &m_vertexBuffer, &m_vertexBufferAllocation, &m_attributeOffset),
 						"Could not create vertex buffer for " + name);
 
 		//create the index buffer
@@ -125,6 +127,61 @@ namespace ve {
 													getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
 													indices, &m_indexBuffer, &m_indexBufferAllocation),
 						"Could not create index buffer for " + name);
+
+		retainGeometry(vertices, indices);
+	}
+
+
+	/**
+	*
+	* \brief VEMesh constructor from functions writing the vertices and indices
+	*
+	* The functions write directly into the staging buffers, so data that is already in the right layout,
+	* e.g. in a file mapped into memory, is copied only once. Bounds and the retained geometry are computed
+	* from the staging buffers after the functions returned.
+	*
+	* \param[in] name The name of the mesh.
+	* \param[in] vertexCount Number of vertices
+	* \param[in] indexCount Number of indices, 3 per triangle
+	* \param[in] fillVertices Writes the position and the attribute stream
+	* \param[in] fillIndices Writes the indices
+	*
+	*/
+	VEMesh::VEMesh(	std::string name, uint32_t vertexCount, uint32_t indexCount,
+					std::function<void(glm::vec3 *pPositions, vh::vhVertexAttributes *pAttributes)> fillVertices,
+					std::function<void(uint32_t *pIndices)> fillIndices) : VENamedClass(name) {
+
+		m_vertexCount = vertexCount;
+		m_indexCount = indexCount;
+		m_boundingSphereCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+
+		std::vector<glm::vec3> positions;
+		VECHECKRESULT( vh::vhBufCreateVertexBuffer(	getRendererPointer()->getDevice(), getRendererPointer()->getVmaAllocator(),
+													getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
+													vertexCount,
+													[&](glm::vec3 *pPos, vh::vhVertexAttributes *pAttributes) {
+														fillVertices(pPos, pAttributes);
+														positions.assign(pPos, pPos + vertexCount);
+													},
+													&m_vertexBuffer, &m_vertexBufferAllocation, &m_attributeOffset),
+						"Could not create vertex buffer for " + name);
+
+		std::vector<uint32_t> indices;
+		VECHECKRESULT( vh::vhBufCreateIndexBuffer(	getRendererPointer()->getDevice(), getRendererPointer()->getVmaAllocator(),
+													getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
+													indexCount,
+													[&](uint32_t *pIndices) {
+														fillIndices(pIndices);
+														if (getSceneManagerPointer()->getRetainMeshGeometry()) indices.assign(pIndices, pIndices + indexCount);
+													},
+													&m_indexBuffer, &m_indexBufferAllocation),
+						"Could not create index buffer for " + name);
+
+		m_boundingSphereRadius = 0.0f;
+		for (auto &pos : positions) m_boundingSphereRadius = std::max(m_boundingSphereRadius, glm::dot(pos, pos));
+		m_boundingSphereRadius = sqrt(m_boundingSphereRadius);
+
+		retainGeometry(positions.data(), vertexCount, indices.data(), (uint32_t)indices.size());
 	}
 
 
@@ -138,6 +195,145 @@ namespace ve {
 	}
 
 
+	/**
+	*
+	* \brief Keep the vertex positions and indices on the CPU and build the triangle BVH
+	*
+	* The local bounding box is always computed. The geometry is only retained if the scene manager allows it.
+	* If the scene manager has a mesh cache directory, the BVH is loaded from a file named after the geometry hash,
+	* or built and written to this file if it does not exist yet.
+	*
+	* \param[in] vertices The vertices of the mesh
+	* \param[in] indices The indices of the mesh, 3 per triangle
+	*
+	*/
+	void VEMesh::retainGeometry(std::vector<vh::vhVertex> &vertices, std::vector<uint32_t> &indices) {
+		retainGeometry(	vertices.empty() ? nullptr : &vertices[0].pos, (uint32_t)vertices.size(),
+						indices.data(), (uint32_t)indices.size(), sizeof(vh::vhVertex));
+	}
+
+
+	/**
+	*
+	* \brief Keep the vertex positions and indices on the CPU and build the triangle BVH
+	*
+	* \param[in] pPositions The vertex positions of the mesh
+	* \param[in] vertexCount Number of vertices
+	* \param[in] pIndices The indices of the mesh, 3 per triangle
+	* \param[in] indexCount Number of indices
+	* \param[in] stride Bytes from one position to the next
+	*
+	*/
+	void VEMesh::retainGeometry(const glm::vec3 *pPositions, uint32_t vertexCount, const uint32_t *pIndices, uint32_t indexCount, size_t stride) {
+		auto position = [&](uint32_t i) -> const glm::vec3 & { return *(const glm::vec3 *)((const uint8_t *)pPositions + i * stride); };
+
+		glm::vec3 bmin(std::numeric_limits<float>::max()), bmax(-std::numeric_limits<float>::max());
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			bmin = glm::min(bmin, position(i));
+			bmax = glm::max(bmax, position(i));
+		}
+		if (vertexCount > 0) m_boundingBox = cl::clAABB((bmin + bmax) * 0.5f, (bmax - bmin) * 0.5f);
+
+		if (!getSceneManagerPointer()->getRetainMeshGeometry()) return;
+
+		m_positions.resize(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++) m_positions[i] = position(i);
+		m_indices.assign(pIndices, pIndices + indexCount);
+		uint32_t numTriangles = (uint32_t)m_indices.size() / 3;
+
+		std::string cacheFile;
+		std::string cacheDir = getSceneManagerPointer()->getMeshCacheDir();
+		if (cacheDir.size() > 0) {
+			char hash[17];
+			snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)getGeometryHash());
+			cacheFile = cacheDir + "/" + hash + ".bvh";
+
+			std::ifstream in(cacheFile, std::ios::binary);
+			if (in && m_bvh.load(in, numTriangles)) return;
+		}
+
+		std::vector<cl::clAABB> boxes(numTriangles);
+		for (uint32_t i = 0; i < numTriangles; i++) {
+			glm::vec3 &p0 = m_positions[m_indices[3 * i]];
+			glm::vec3 &p1 = m_positions[m_indices[3 * i + 1]];
+			glm::vec3 &p2 = m_positions[m_indices[3 * i + 2]];
+			glm::vec3 tmin = glm::min(glm::min(p0, p1), p2), tmax = glm::max(glm::max(p0, p1), p2);
+			boxes[i] = cl::clAABB((tmin + tmax) * 0.5f, (tmax - tmin) * 0.5f);
+		}
+		m_bvh.build(boxes);
+
+		if (cacheFile.size() > 0) {
+			std::ofstream out(cacheFile, std::ios::binary);
+			if (out) m_bvh.save(out);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Compute a 64 bit FNV-1a hash of the retained positions and indices
+	*
+	* \returns the hash, used as the name of the cached BVH file
+	*
+	*/
+	uint64_t VEMesh::getGeometryHash() {
+		uint64_t hash = 14695981039346656037ull;
+		auto addBytes = [&](const void *data, size_t size) {
+			const uint8_t *bytes = (const uint8_t*)data;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		addBytes(m_positions.data(), m_positions.size() * sizeof(glm::vec3));
+		addBytes(m_indices.data(), m_indices.size() * sizeof(uint32_t));
+		return hash;
+	}
+
+
+	/**
+	*
+	* \brief Find the closest triangle hit by a ray
+	*
+	* Triangles are hit from both sides (Moeller-Trumbore test).
+	*
+	* \param[in] ray The ray in the local space of the mesh
+	* \param[in,out] maxT Only hits closer than this are found, set to the ray parameter of the hit
+	* \param[out] triangle Index of the triangle that was hit
+	* \param[out] barycentrics Barycentric coordinates of the hit point with respect to the second and third triangle vertex
+	* \returns whether a triangle was hit
+	*
+	*/
+	bool VEMesh::raycast(cl::clRay &ray, float &maxT, uint32_t &triangle, glm::vec2 &barycentrics) {
+		return m_bvh.traverse(ray, maxT, [&](uint32_t tri, float &tmax) {
+			glm::vec3 &p0 = m_positions[m_indices[3 * tri]];
+			glm::vec3 e1 = m_positions[m_indices[3 * tri + 1]] - p0;
+			glm::vec3 e2 = m_positions[m_indices[3 * tri + 2]] - p0;
+
+			glm::vec3 pvec = glm::cross(ray.direction, e2);
+			float det = glm::dot(e1, pvec);
+			if (fabs(det) < 1.0e-12f) return false;			//ray is parallel to the triangle
+			float invDet = 1.0f / det;
+
+			glm::vec3 tvec = ray.origin - p0;
+			float u = glm::dot(tvec, pvec) * invDet;
+			if (u < 0.0f || u > 1.0f) return false;
+
+			glm::vec3 qvec = glm::cross(tvec, e1);
+			float v = glm::dot(ray.direction, qvec) * invDet;
+			if (v < 0.0f || u + v > 1.0f) return false;
+
+			float t = glm::dot(e2, qvec) * invDet;
+			if (t < 0.0f || t > tmax) return false;
+
+			tmax = t;
+			triangle = tri;
+			barycentrics = glm::vec2(u, v);
+			return true;
+		});
+	}
+
+
 	//---------------------------------------------------------------------
 	//Material
 
@@ -188,6 +384,30 @@ namespace ve {
 					"Could not create texture sampler for " + basedir + "/" + texNames[0]);
 	}
 
+	/**
+	*
+	* \brief VETexture constructor from a compressed image (png, jpg, ...) in memory
+	*
+	* \param[in] name The name of the texture.
+	* \param[in] pData The image file contents
+	* \param[in] size Size of the image file
+	*
+	*/
+	VETexture::VETexture(std::string name, const uint8_t *pData, uint32_t size) : VENamedClass(name) {
+		VECHECKRESULT(vh::vhBufCreateTextureImage(getRendererPointer()->getDevice(), getRendererPointer()->getVmaAllocator(),
+							getRendererPointer()->getGraphicsQueue(), getRendererPointer()->getCommandPool(),
+							pData, size, &m_image, &m_deviceAllocation, &m_extent),
+					"Could not create texture image for " + name);
+
+		m_format = VK_FORMAT_R8G8B8A8_UNORM;
+		VECHECKRESULT(vh::vhBufCreateImageView(getRendererPointer()->getDevice(), m_image,
+							m_format, VK_IMAGE_VIEW_TYPE_2D, 1, VK_IMAGE_ASPECT_COLOR_BIT, &m_imageView),
+					"Could not create image view for " + name);
+
+		VECHECKRESULT(vh::vhBufCreateTextureSampler(getRendererPointer()->getDevice(), &m_sampler),
+					"Could not create texture sampler for " + name);
+	}
+
 	/**
 	*
 	* \brief VETexture constructor from a GLI cube map file.
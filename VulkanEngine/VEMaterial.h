@@ -29,6 +29,7 @@ namespace ve {
 
 		VETexture(std::string name, gli::texture_cube &texCube, VkImageCreateFlags flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_CUBE);
 		VETexture(std::string name, std::string &basedir, std::vector<std::string> texNames, VkImageCreateFlags flags = 0, VkImageViewType viewtype = VK_IMAGE_VIEW_TYPE_2D);
+		VETexture(std::string name, const uint8_t *pData, uint32_t size);
 		///Empty constructor
 		VETexture(std::string name) : VENamedClass(name) {};
 		~VETexture();
@@ -63,7 +64,10 @@ namespace ve {
 	* \brief Store a mesh in a Vulkan vertex and index buffer
 	*
 	* VEMesh stores a mesh in a Vulkan vertex and index buffer. For both buffers, also the VMA
-	* allocation information is stored.
+	* allocation information is stored. The vertex buffer holds a position stream and an attribute stream,
+	* so depth and shadow passes can fetch positions only. Unless switched off in the scene manager, vertex positions and indices
+	* are also kept on the CPU, together with a triangle BVH for ray casts. If the scene manager has a mesh cache
+	* directory, the BVH is loaded from there if it was built before for the same geometry.
 	*
 	*/
 
@@ -73,14 +77,29 @@ namespace ve {
 		uint32_t		m_indexCount = 0;					///<Number of indices in the index buffer
 		VkBuffer		m_vertexBuffer = VK_NULL_HANDLE;	///<Vulkan vertex buffer handle
 		VmaAllocation	m_vertexBufferAllocation = nullptr;	///<VMA allocation info
+		VkDeviceSize	m_attributeOffset = 0;				///<Offset of the attribute stream in the vertex buffer, positions start at 0
 		VkBuffer		m_indexBuffer = VK_NULL_HANDLE;		///<Vulkan index buffer handle
 		VmaAllocation	m_indexBufferAllocation = nullptr;	///<VMA allocation info
 		glm::vec3		m_boundingSphereCenter = glm::vec3(0.0f, 0.0f, 0.0f);	///<center of bounding sphere in local space
 		float			m_boundingSphereRadius = 1.0;		///<Radius of bounding sphere in local space
+		cl::clAABB		m_boundingBox;						///<Box holding all vertices in local space
+
+		std::vector<glm::vec3>	m_positions;				///<CPU copy of the vertex positions
+		std::vector<uint32_t>	m_indices;					///<CPU copy of the indices, 3 per triangle
+		VEBVH					m_bvh;						///<BVH over the triangles, in local space
 
 		VEMesh(std::string name, const aiMesh *paiMesh);
 		VEMesh(std::string name, std::vector<vh::vhVertex> vertices, std::vector<uint32_t> indices);
+		VEMesh(	std::string name, uint32_t vertexCount, uint32_t indexCount,
+				std::function<void(glm::vec3 *pPositions, vh::vhVertexAttributes *pAttributes)> fillVertices,
+				std::function<void(uint32_t *pIndices)> fillIndices);
 		~VEMesh();
+
+		void	retainGeometry(std::vector<vh::vhVertex> &vertices, std::vector<uint32_t> &indices);	//keep a CPU copy and build or load the BVH
+		void	retainGeometry(const glm::vec3 *pPositions, uint32_t vertexCount, const uint32_t *pIndices, uint32_t indexCount,
+								size_t stride = sizeof(glm::vec3));	//keep a CPU copy and build or load the BVH
+		uint64_t getGeometryHash();									//hash of the retained positions and indices
+		bool	raycast(cl::clRay &ray, float &maxT, uint32_t &triangle, glm::vec2 &barycentrics);	//closest triangle hit by a local space ray
 	};
 }
 
@@ -10,11 +10,162 @@
 
 namespace ve {
 
+	///An interned string
+	struct veNameEntry {
+		std::string	m_string;			///<The string
+		uint64_t	m_hash = 0;			///<Hash of the string
+	};
+
+	///The global table of interned strings
+	struct veNameTable {
+		std::mutex				m_mutex;						///<Guards adding strings
+		std::atomic<veNameEntry*> m_chunks[VE_NAME_MAX_CHUNKS];	///<Chunks of entries, indexed by id / VE_NAME_CHUNK_SIZE
+		uint32_t				m_numNames = 0;					///<Number of strings
+		std::vector<uint32_t>	m_slots;						///<Open addressing hash table, id + 1 or 0 if empty
+
+		///Constructor, adds the empty string as id 0
+		veNameTable() : m_slots(1024, 0) {
+			for (auto &chunk : m_chunks) chunk.store(nullptr, std::memory_order_relaxed);
+			add("", hash("", 0));
+		};
+		///Destructor
+		~veNameTable() {
+			for (auto &chunk : m_chunks) delete[] chunk.load(std::memory_order_relaxed);
+		};
+
+		///\returns the entry of an id
+		veNameEntry & entry(uint32_t id) {
+			return m_chunks[id / VE_NAME_CHUNK_SIZE].load(std::memory_order_acquire)[id % VE_NAME_CHUNK_SIZE];
+		};
+
+		///\returns the FNV-1a hash of a string
+		static uint64_t hash(const char *pStr, size_t length) {
+			uint64_t h = 14695981039346656037ULL;
+			for (size_t i = 0; i < length; i++) {
+				h ^= (uint8_t)pStr[i];
+				h *= 1099511628211ULL;
+			}
+			return h;
+		};
+
+		///\returns the slot holding the string, or the empty slot where it belongs. The mutex must be locked.
+		uint32_t findSlot(const char *pStr, size_t length, uint64_t h) {
+			uint32_t mask = (uint32_t)m_slots.size() - 1;
+			for (uint32_t slot = (uint32_t)h & mask; ; slot = (slot + 1) & mask) {
+				if (m_slots[slot] == 0) return slot;
+				veNameEntry &e = entry(m_slots[slot] - 1);
+				if (e.m_hash == h && e.m_string.size() == length && e.m_string.compare(0, length, pStr, length) == 0) return slot;
+			}
+		};
+
+		///Add a new string. The mutex must be locked.
+		uint32_t add(const char *pStr, uint64_t h) {
+			if (m_numNames == VE_NAME_CHUNK_SIZE * VE_NAME_MAX_CHUNKS) {
+				throw std::runtime_error("Error: Too many different names!");
+			}
+
+			uint32_t id = m_numNames;
+			veNameEntry *pChunk = m_chunks[id / VE_NAME_CHUNK_SIZE].load(std::memory_order_relaxed);
+			if (pChunk == nullptr) {
+				pChunk = new veNameEntry[VE_NAME_CHUNK_SIZE];
+				m_chunks[id / VE_NAME_CHUNK_SIZE].store(pChunk, std::memory_order_release);
+			}
+			pChunk[id % VE_NAME_CHUNK_SIZE].m_string = pStr;
+			pChunk[id % VE_NAME_CHUNK_SIZE].m_hash = h;
+			m_numNames++;
+
+			if (2 * m_numNames > m_slots.size()) {						//keep the load factor below 1/2
+				std::vector<uint32_t> slots(2 * m_slots.size(), 0);
+				uint32_t mask = (uint32_t)slots.size() - 1;
+				for (uint32_t i = 0; i < m_numNames; i++) {
+					uint32_t slot = (uint32_t)entry(i).m_hash & mask;
+					while (slots[slot] != 0) slot = (slot + 1) & mask;
+					slots[slot] = i + 1;
+				}
+				m_slots.swap(slots);
+			}
+			else {
+				m_slots[findSlot(pStr, strlen(pStr), h)] = id + 1;
+			}
+			return id;
+		};
+	};
+
+	///\returns the table of interned strings, created on first use
+	static veNameTable & veGetNameTable() {
+		static veNameTable table;
+		return table;
+	}
+
+
+	/**
+	*
+	* \brief Intern a string
+	*
+	* \param[in] str The string
+	*
+	*/
+	veName::veName(const std::string &str) {
+		if (str.empty()) return;
+		veNameTable &table = veGetNameTable();
+		uint64_t h = veNameTable::hash(str.data(), str.size());
+
+		std::lock_guard<std::mutex> lock(table.m_mutex);
+		uint32_t slot = table.findSlot(str.data(), str.size(), h);
+		m_id = table.m_slots[slot] != 0 ? table.m_slots[slot] - 1 : table.add(str.c_str(), h);
+	}
+
+	/**
+	* \returns the interned string
+	*/
+	const std::string & veName::str() const {
+		return veGetNameTable().entry(m_id).m_string;
+	}
+
+	/**
+	* \returns the hash of the string, computed once when it was interned
+	*/
+	uint64_t veName::hash() const {
+		return veGetNameTable().entry(m_id).m_hash;
+	}
+
+	/**
+	*
+	* \brief Look up a string without adding it to the table
+	*
+	* Use this for lookups with names that may not exist, so they do not fill the table.
+	*
+	* \param[in] str The string
+	* \param[out] name The name of the string if it was found
+	* \returns true if the string has been interned before
+	*
+	*/
+	bool veName::find(const std::string &str, veName &name) {
+		veNameTable &table = veGetNameTable();
+		uint64_t h = veNameTable::hash(str.data(), str.size());
+
+		std::lock_guard<std::mutex> lock(table.m_mutex);
+		uint32_t slot = table.findSlot(str.data(), str.size(), h);
+		if (table.m_slots[slot] == 0) return false;
+		name.m_id = table.m_slots[slot] - 1;
+		return true;
+	}
+
+	/**
+	* \returns the number of different strings interned so far
+	*/
+	uint32_t veName::getNumNames() {
+		veNameTable &table = veGetNameTable();
+		std::lock_guard<std::mutex> lock(table.m_mutex);
+		return table.m_numNames;
+	}
+
+
 	/**
 	* \returns the name of this instance.
 	*/
-	std::string VENamedClass::getName() {
-		return m_name;
+	const std::string & VENamedClass::getName() {
+		return m_name.str();
 	}
 
-}
\ No newline at end of file
+}
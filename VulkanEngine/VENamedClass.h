@@ -7,27 +7,85 @@
 
 #pragma once
 
+const uint32_t VE_NAME_CHUNK_SIZE = 1 << 12;		///<Interned strings per chunk, chunks never move
+const uint32_t VE_NAME_MAX_CHUNKS = 1 << 8;		///<Max number of chunks, so at most 1M different names
+
 
 namespace ve {
 
+	/**
+	*
+	* \brief An interned string
+	*
+	* A veName is the index of a string in a global table. Each different string is stored only once, together with
+	* its hash, so comparing and hashing names are integer operations and a name takes 4 bytes. Creating a veName
+	* from a string looks the string up in the table and adds it if it is new. Index 0 is the empty string.
+	*
+	* Names can be created on any thread. Interned strings are never removed, so str() stays valid. To keep the table
+	* from growing, lookups with strings that may not exist use find(), and only names of objects are interned.
+	* There is no implicit conversion from string literals, so they select the std::string overloads of lookup
+	* functions. Interning more than VE_NAME_CHUNK_SIZE * VE_NAME_MAX_CHUNKS different strings throws an exception.
+	*
+	*/
+	class veName {
+	protected:
+		uint32_t m_id = 0;		///<Index of the string in the table
+
+	public:
+		///Constructor, the empty name
+		veName() {};
+		veName(const std::string &str);
+
+		const std::string & str() const;			//the interned string
+		uint64_t	hash() const;					//precomputed hash of the string
+		///\returns the index of the string in the table
+		uint32_t	id() const { return m_id; };
+		///\returns true if this is the empty name
+		bool		empty() const { return m_id == 0; };
+
+		///\returns true if both are the same string
+		bool operator==(const veName &other) const { return m_id == other.m_id; };
+		///\returns true if the strings differ
+		bool operator!=(const veName &other) const { return m_id != other.m_id; };
+		///\returns an order for ordered containers, this is the order of interning, not the alphabetical order
+		bool operator<(const veName &other) const { return m_id < other.m_id; };
+
+		static bool		find(const std::string &str, veName &name);	//look up a string without adding it
+		static uint32_t	getNumNames();								//number of interned strings
+	};
+
+
 	/**
 	*
 	* \brief Base class of all classes that need a name.
 	*
 	* Names do not have to be unique, only if they are used to identify things in a collection.
+	* The name is interned, so collections can compare names as integers.
 	*
 	*/
 	class VENamedClass {
 	protected:
-		std::string m_name;		///<Name of this instance
+		veName m_name;		///<Name of this instance
 
 	public:
 		///Constructor
-		VENamedClass(std::string name) { m_name = name;	};
+		VENamedClass(veName name) : m_name(name) {};
 		///Destructor
 		~VENamedClass() { };
-		std::string getName();								//get the name
+		const std::string & getName();						//get the name
+		///\returns the interned name
+		veName		getNameID() { return m_name; };
 	};
 
 
-}
\ No newline at end of file
+}
+
+
+namespace std {
+
+	///Hash of a veName for unordered containers, precomputed when the string was interned
+	template<> struct hash<ve::veName> {
+		size_t operator()(const ve::veName &name) const { return (size_t)name.hash(); };
+	};
+
+}
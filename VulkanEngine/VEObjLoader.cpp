@@ -0,0 +1,760 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	//-------------------------------------------------------------------------------------------------
+	//parsing numbers and names
+
+	///Kinds of lines the loader cares about
+	enum veLineType {
+		VE_OBJ_LINE_OTHER,
+		VE_OBJ_LINE_POSITION,
+		VE_OBJ_LINE_TEXCOORD,
+		VE_OBJ_LINE_NORMAL
+	};
+
+	///\returns whether the character separates tokens on a line
+	static inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+	///\returns p moved past blanks
+	static inline const char * skipBlanks(const char *p, const char *end) {
+		while (p < end && isBlank(*p)) p++;
+		return p;
+	}
+
+	///\returns p moved to the start of the next line
+	static inline const char * nextLine(const char *p, const char *end) {
+		const char *pEol = (const char*)memchr(p, '\n', end - p);
+		return pEol != nullptr ? pEol + 1 : end;
+	}
+
+	///\returns the vertex data type of the line starting at p (after blanks). Counting and parsing must agree on this.
+	static inline veLineType getLineType(const char *p, const char *end) {
+		if (end - p < 2 || p[0] != 'v') return VE_OBJ_LINE_OTHER;
+		if (isBlank(p[1])) return VE_OBJ_LINE_POSITION;
+		if (end - p < 3 || !isBlank(p[2])) return VE_OBJ_LINE_OTHER;
+		if (p[1] == 't') return VE_OBJ_LINE_TEXCOORD;
+		if (p[1] == 'n') return VE_OBJ_LINE_NORMAL;
+		return VE_OBJ_LINE_OTHER;
+	}
+
+	///\returns whether the line starting at p begins with a keyword followed by a blank
+	static inline bool isKeyword(const char *p, const char *end, const char *keyword, size_t length) {
+		return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && isBlank(p[length]);
+	}
+
+	///\returns the rest of the line starting at p, without leading and trailing blanks
+	static std::string getRestOfLine(const char *p, const char *end) {
+		p = skipBlanks(p, end);
+		const char *pEol = (const char*)memchr(p, '\n', end - p);
+		if (pEol == nullptr) pEol = end;
+		while (pEol > p && isBlank(pEol[-1])) pEol--;
+		return std::string(p, pEol);
+	}
+
+	///\returns whether the 8 bytes are all decimal digits
+	static inline bool isEightDigits(uint64_t v) {
+		return (((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+	}
+
+	///\returns the value of 8 decimal digits loaded little endian into a 64 bit word
+	static inline uint32_t parseEightDigits(uint64_t v) {
+		v -= 0x3030303030303030ull;
+		v = (v * 10) + (v >> 8);
+		v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+			(((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+		return (uint32_t)v;
+	}
+
+	///\returns whether the machine stores words little endian, needed for parseEightDigits()
+	static inline bool isLittleEndian() {
+		uint16_t v = 1;
+		return *(uint8_t*)&v == 1;
+	}
+
+	/**
+	*
+	* \brief Read decimal digits into a mantissa
+	*
+	* Runs of eight digits are converted with a few integer operations instead of one multiply per digit.
+	* Digits that do not fit into the 19 digit mantissa are dropped, and counted in dropped.
+	*
+	* \param[in,out] p Position in the text, moved past the digits
+	* \param[in] end End of the text
+	* \param[in,out] mantissa The digits read so far
+	* \param[in,out] numDigits Number of significant digits in the mantissa
+	* \param[out] dropped Number of digits that were dropped
+	* \returns the number of digits read
+	*
+	*/
+	static inline uint32_t parseDigits(const char *&p, const char *end, uint64_t &mantissa, uint32_t &numDigits, uint32_t &dropped) {
+		static const bool littleEndian = isLittleEndian();
+		const char *start = p;
+		dropped = 0;
+
+		if (littleEndian) {
+			while (end - p >= 8 && numDigits + 8 <= 19) {
+				uint64_t v;
+				memcpy(&v, p, 8);
+				if (!isEightDigits(v)) break;
+				mantissa = mantissa * 100000000ull + parseEightDigits(v);
+				if (mantissa > 0 || numDigits > 0) numDigits += 8;
+				p += 8;
+			}
+		}
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (numDigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa > 0) numDigits++;
+			}
+			else dropped++;
+			p++;
+		}
+		return (uint32_t)(p - start);
+	}
+
+	/**
+	*
+	* \brief Parse a floating point number
+	*
+	* \param[in] p Start of the number, may be preceeded by blanks
+	* \param[in] end End of the text
+	* \param[out] value The number
+	* \returns pointer behind the number, or nullptr if there is no number
+	*
+	*/
+	static const char * parseFloat(const char *p, const char *end, float &value) {
+		static const double powers[] = {	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+											1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		p = skipBlanks(p, end);
+		if (p == end) return nullptr;
+
+		bool negative = false;
+		if (*p == '-' || *p == '+') {
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		uint32_t numDigits = 0;
+		uint32_t dropped = 0;
+		int32_t exponent = 0;
+		uint32_t count = parseDigits(p, end, mantissa, numDigits, dropped);
+		exponent += dropped;
+
+		if (p < end && *p == '.') {
+			p++;
+			uint32_t fraction = parseDigits(p, end, mantissa, numDigits, dropped);
+			exponent -= (int32_t)(fraction - dropped);
+			count += fraction;
+		}
+		if (count == 0) return nullptr;
+
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			p++;
+			bool negativeExp = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negativeExp = *p == '-';
+				p++;
+			}
+			int32_t e = 0;
+			if (p == end || *p < '0' || *p > '9') return nullptr;
+			while (p < end && *p >= '0' && *p <= '9') {
+				if (e < 10000) e = e * 10 + (*p - '0');
+				p++;
+			}
+			exponent += negativeExp ? -e : e;
+		}
+
+		double d = (double)mantissa;
+		if (exponent >= -22 && exponent <= 22) {
+			d = exponent < 0 ? d / powers[-exponent] : d * powers[exponent];
+		}
+		else {
+			d = d * std::pow(10.0, (double)exponent);
+		}
+		value = (float)(negative ? -d : d);
+		return p;
+	}
+
+	/**
+	*
+	* \brief Parse an integer
+	*
+	* \param[in] p Start of the number
+	* \param[in] end End of the text
+	* \param[out] value The number
+	* \returns pointer behind the number, or nullptr if there is no number
+	*
+	*/
+	static inline const char * parseInt(const char *p, const char *end, int64_t &value) {
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+		if (p == end || *p < '0' || *p > '9') return nullptr;
+
+		int64_t v = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (v < 0x7FFFFFFF) v = v * 10 + (*p - '0');
+			p++;
+		}
+		value = negative ? -v : v;
+		return p;
+	}
+
+
+	//-------------------------------------------------------------------------------------------------
+	//parsing the OBJ file
+
+	///Change of object or material between faces
+	struct veObjState {
+		uint32_t	m_face;					///<First face the state applies to
+		bool		m_object;				///<true for o and g, false for usemtl
+		std::string	m_name;					///<The new object or material name
+	};
+
+	///A part of the file, parsed by one thread
+	struct VEObjLoader::veChunk {
+		const char *			m_begin = nullptr;			///<First byte of the chunk
+		const char *			m_end = nullptr;			///<Behind the last byte of the chunk
+		uint32_t				m_numPositions = 0;			///<Number of v lines
+		uint32_t				m_numTexCoords = 0;			///<Number of vt lines
+		uint32_t				m_numNormals = 0;			///<Number of vn lines
+		uint32_t				m_firstPosition = 0;		///<Global index of the first v line
+		uint32_t				m_firstTexCoord = 0;		///<Global index of the first vt line
+		uint32_t				m_firstNormal = 0;			///<Global index of the first vn line
+		std::vector<uint32_t>	m_corners;					///<Position, texture coordinate and normal index of each face corner
+		std::vector<uint32_t>	m_faces;					///<First corner of each face, plus the end of the last face
+		std::vector<veObjState>	m_states;					///<Object and material changes
+		std::vector<std::string> m_mtllibs;					///<mtllib files
+	};
+
+	///Faces of the file belonging to one object and material
+	struct VEObjLoader::veGroup {
+		///Consecutive faces of a chunk
+		struct veRange {
+			uint32_t	m_chunk;			///<Index of the chunk
+			uint32_t	m_firstFace;		///<First face in the chunk
+			uint32_t	m_lastFace;			///<Behind the last face in the chunk
+		};
+
+		std::string				m_object;	///<Object name
+		std::string				m_material;	///<Material name
+		std::vector<veRange>	m_ranges;	///<The faces
+	};
+
+
+	/**
+	*
+	* \brief Call a function for a number of work items, using the thread pool of the engine
+	*
+	* Must only be called from the main thread, since it waits for the thread pool.
+	*
+	* \param[in] count Number of work items
+	* \param[in] function Called with each index from 0 to count-1
+	*
+	*/
+	void VEObjLoader::parallelRun(uint32_t count, std::function<void(uint32_t)> function) {
+		uint32_t numThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+		if (numThreads == 1 || count < 2) {
+			for (uint32_t i = 0; i < count; i++) function(i);
+			return;
+		}
+
+		std::vector<std::future<void>> futures;
+		for (uint32_t i = 0; i < count; i++) {
+			futures.push_back(getEnginePointer()->m_threadPool->submit([&, i]() { function(i); }));
+		}
+		for (auto &future : futures) future.get();
+	}
+
+
+	/**
+	*
+	* \brief Parse all lines of a chunk
+	*
+	* Vertex data is written into the global arrays, starting at the indices computed from the counts of
+	* the previous chunks. Face corners are stored as global zero based indices.
+	*
+	* \param[in,out] chunk The chunk
+	* \returns false if the chunk contains malformed lines or indices out of range
+	*
+	*/
+	bool VEObjLoader::parseChunk(veChunk &chunk) {
+		const char *p = chunk.m_begin;
+		const char *end = chunk.m_end;
+		uint32_t numPositions = chunk.m_firstPosition;
+		uint32_t numTexCoords = chunk.m_firstTexCoord;
+		uint32_t numNormals = chunk.m_firstNormal;
+		int64_t totals[3] = { (int64_t)m_positions.size(), (int64_t)m_texCoords.size(), (int64_t)m_normals.size() };
+
+		chunk.m_faces.reserve((end - p) / 64);
+		chunk.m_corners.reserve((end - p) / 8);
+
+		while (p < end) {
+			p = skipBlanks(p, end);
+			if (p == end) break;
+
+			switch (getLineType(p, end)) {
+			case VE_OBJ_LINE_POSITION: {
+				glm::vec3 &v = m_positions[numPositions++];
+				if ((p = parseFloat(p + 1, end, v.x)) == nullptr) return false;
+				if ((p = parseFloat(p, end, v.y)) == nullptr) return false;
+				if ((p = parseFloat(p, end, v.z)) == nullptr) return false;
+				break;
+			}
+			case VE_OBJ_LINE_TEXCOORD: {
+				glm::vec2 &t = m_texCoords[numTexCoords++];
+				if ((p = parseFloat(p + 2, end, t.x)) == nullptr) return false;
+				const char *q = parseFloat(p, end, t.y);
+				if (q != nullptr) p = q;
+				else t.y = 0.0f;
+				break;
+			}
+			case VE_OBJ_LINE_NORMAL: {
+				glm::vec3 &n = m_normals[numNormals++];
+				if ((p = parseFloat(p + 2, end, n.x)) == nullptr) return false;
+				if ((p = parseFloat(p, end, n.y)) == nullptr) return false;
+				if ((p = parseFloat(p, end, n.z)) == nullptr) return false;
+				break;
+			}
+			default:
+				if (isKeyword(p, end, "f", 1)) {
+					p += 1;
+					uint32_t firstCorner = (uint32_t)chunk.m_corners.size();
+					int64_t counts[3] = { numPositions, numTexCoords, numNormals };
+
+					while (true) {
+						p = skipBlanks(p, end);
+						if (p == end || *p == '\n' || *p == '#') break;
+
+						for (uint32_t k = 0; k < 3; k++) {
+							uint32_t index = VE_OBJ_NO_INDEX;
+							int64_t value;
+							const char *q = parseInt(p, end, value);
+							if (q != nullptr) {
+								int64_t i = value > 0 ? value - 1 : counts[k] + value;	//1-based or relative to the current end
+								if (value == 0 || i < 0 || i >= totals[k]) return false;
+								index = (uint32_t)i;
+								p = q;
+							}
+							else if (k == 0) return false;
+							chunk.m_corners.push_back(index);
+
+							if (k < 2 && p < end && *p == '/') p++;
+							else {
+								for (k++; k < 3; k++) chunk.m_corners.push_back(VE_OBJ_NO_INDEX);
+							}
+						}
+						if (p < end && !isBlank(*p) && *p != '\n') return false;
+					}
+					if (chunk.m_corners.size() - firstCorner >= 9) chunk.m_faces.push_back(firstCorner / 3);
+					else chunk.m_corners.resize(firstCorner);				//points and lines are ignored
+				}
+				else if (isKeyword(p, end, "o", 1) || isKeyword(p, end, "g", 1)) {
+					chunk.m_states.push_back({ (uint32_t)chunk.m_faces.size(), true, getRestOfLine(p + 1, end) });
+				}
+				else if (isKeyword(p, end, "usemtl", 6)) {
+					chunk.m_states.push_back({ (uint32_t)chunk.m_faces.size(), false, getRestOfLine(p + 6, end) });
+				}
+				else if (isKeyword(p, end, "mtllib", 6)) {
+					chunk.m_mtllibs.push_back(getRestOfLine(p + 6, end));
+				}
+				break;
+			}
+			p = nextLine(p, end);
+		}
+
+		chunk.m_faces.push_back((uint32_t)chunk.m_corners.size() / 3);
+		return true;
+	}
+
+
+	///Position, texture coordinate and normal index of a face corner
+	struct veCornerKey {
+		uint32_t	m_indices[3];
+
+		bool operator==(const veCornerKey &key) const {
+			return m_indices[0] == key.m_indices[0] && m_indices[1] == key.m_indices[1] && m_indices[2] == key.m_indices[2];
+		};
+	};
+
+	///Hash function for corner keys
+	struct veCornerHash {
+		size_t operator()(const veCornerKey &key) const {
+			uint64_t h = key.m_indices[0] * 0x9E3779B97F4A7C15ull;
+			h ^= (key.m_indices[1] + 0x7F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+			h ^= (key.m_indices[2] + 0x27D4EB4Full) * 0x165667B19E3779F9ull;
+			return (size_t)(h ^ (h >> 29));
+		};
+	};
+
+
+	/**
+	*
+	* \brief Create the vertices and triangles of a mesh
+	*
+	* Corners with the same position, texture coordinate and normal share a vertex. Polygons are triangulated as
+	* fans in the winding order of the file. Texture coordinates are flipped vertically. Corners without a normal
+	* get a zero normal, which is replaced in computeNormalsAndTangents().
+	*
+	* \param[in] group The faces of the mesh
+	* \param[in] chunks All parsed chunks
+	* \param[out] mesh The mesh
+	*
+	*/
+	void VEObjLoader::buildMesh(veGroup &group, std::vector<veChunk> &chunks, veObjMesh &mesh) {
+		mesh.m_object = group.m_object;
+		mesh.m_material = group.m_material;
+
+		uint32_t numCorners = 0;
+		for (auto &range : group.m_ranges) {
+			veChunk &chunk = chunks[range.m_chunk];
+			numCorners += chunk.m_faces[range.m_lastFace] - chunk.m_faces[range.m_firstFace];
+		}
+
+		std::unordered_map<veCornerKey, uint32_t, veCornerHash> vertexMap;
+		vertexMap.reserve(numCorners);
+		mesh.m_vertices.reserve(numCorners);
+		mesh.m_indices.reserve(numCorners * 3);
+
+		std::vector<uint32_t> polygon;
+		for (auto &range : group.m_ranges) {
+			veChunk &chunk = chunks[range.m_chunk];
+
+			for (uint32_t f = range.m_firstFace; f < range.m_lastFace; f++) {
+				polygon.clear();
+
+				for (uint32_t c = chunk.m_faces[f]; c < chunk.m_faces[f + 1]; c++) {
+					veCornerKey key;
+					memcpy(key.m_indices, &chunk.m_corners[c * 3], sizeof(key.m_indices));
+
+					auto it = vertexMap.find(key);
+					if (it != vertexMap.end()) {
+						polygon.push_back(it->second);
+						continue;
+					}
+
+					vh::vhVertex vertex;
+					vertex.pos = m_positions[key.m_indices[0]];
+					vertex.texCoord = glm::vec2(0.0f, 0.0f);
+					if (key.m_indices[1] != VE_OBJ_NO_INDEX) {
+						glm::vec2 &t = m_texCoords[key.m_indices[1]];
+						vertex.texCoord = glm::vec2(t.x, 1.0f - t.y);
+					}
+					vertex.normal = key.m_indices[2] != VE_OBJ_NO_INDEX ? m_normals[key.m_indices[2]] : glm::vec3(0.0f, 0.0f, 0.0f);
+					vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+
+					uint32_t index = (uint32_t)mesh.m_vertices.size();
+					mesh.m_vertices.push_back(vertex);
+					vertexMap[key] = index;
+					polygon.push_back(index);
+				}
+
+				for (uint32_t k = 1; k + 1 < polygon.size(); k++) {
+					mesh.m_indices.push_back(polygon[0]);
+					mesh.m_indices.push_back(polygon[k]);
+					mesh.m_indices.push_back(polygon[k + 1]);
+				}
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Compute missing normals and all tangents, then reverse the winding order
+	*
+	* Work is split into batches of VE_OBJ_BATCH_SIZE triangles or vertices over all meshes, so a single large
+	* mesh is also spread over the thread pool. First each triangle computes its area weighted normal and its
+	* tangent. Then a list of triangles per vertex is built, and finally each vertex sums up its triangles.
+	* Normals from the file are kept, tangents are made orthogonal to the normal.
+	*
+	* \param[in,out] meshes The meshes, vertices without normal must have a zero normal
+	*
+	*/
+	void VEObjLoader::computeNormalsAndTangents(std::vector<veObjMesh> &meshes) {
+		uint32_t numMeshes = (uint32_t)meshes.size();
+		std::vector<std::vector<glm::vec3>> faceNormals(numMeshes);
+		std::vector<std::vector<glm::vec3>> faceTangents(numMeshes);
+		std::vector<std::vector<uint32_t>> vertexStart(numMeshes);		//first entry of each vertex in vertexFaces
+		std::vector<std::vector<uint32_t>> vertexFaces(numMeshes);		//triangles of each vertex
+
+		std::vector<std::pair<uint32_t, uint32_t>> faceBatches;
+		std::vector<std::pair<uint32_t, uint32_t>> vertexBatches;
+		for (uint32_t m = 0; m < numMeshes; m++) {
+			uint32_t numFaces = (uint32_t)meshes[m].m_indices.size() / 3;
+			uint32_t numVertices = (uint32_t)meshes[m].m_vertices.size();
+			faceNormals[m].resize(numFaces);
+			faceTangents[m].resize(numFaces);
+			for (uint32_t f = 0; f < numFaces; f += VE_OBJ_BATCH_SIZE) faceBatches.push_back({ m, f });
+			for (uint32_t v = 0; v < numVertices; v += VE_OBJ_BATCH_SIZE) vertexBatches.push_back({ m, v });
+		}
+
+		//normal and tangent of each triangle, then reverse the winding order
+		parallelRun((uint32_t)faceBatches.size(), [&](uint32_t b) {
+			uint32_t m = faceBatches[b].first;
+			veObjMesh &mesh = meshes[m];
+			uint32_t numFaces = (uint32_t)mesh.m_indices.size() / 3;
+			uint32_t last = std::min(faceBatches[b].second + VE_OBJ_BATCH_SIZE, numFaces);
+
+			for (uint32_t f = faceBatches[b].second; f < last; f++) {
+				uint32_t *tri = &mesh.m_indices[f * 3];
+				vh::vhVertex &v0 = mesh.m_vertices[tri[0]];
+				vh::vhVertex &v1 = mesh.m_vertices[tri[1]];
+				vh::vhVertex &v2 = mesh.m_vertices[tri[2]];
+
+				glm::vec3 e1 = v1.pos - v0.pos;
+				glm::vec3 e2 = v2.pos - v0.pos;
+				faceNormals[m][f] = glm::cross(e1, e2);
+
+				glm::vec2 d1 = v1.texCoord - v0.texCoord;
+				glm::vec2 d2 = v2.texCoord - v0.texCoord;
+				float det = d1.x * d2.y - d2.x * d1.y;
+				faceTangents[m][f] = std::abs(det) > 1e-12f ? (e1 * d2.y - e2 * d1.y) / det : glm::vec3(0.0f, 0.0f, 0.0f);
+
+				std::swap(tri[1], tri[2]);
+			}
+		});
+
+		//triangles of each vertex
+		parallelRun(numMeshes, [&](uint32_t m) {
+			veObjMesh &mesh = meshes[m];
+			std::vector<uint32_t> &start = vertexStart[m];
+			start.assign(mesh.m_vertices.size() + 1, 0);
+			for (auto index : mesh.m_indices) start[index + 1]++;
+			for (uint32_t v = 0; v < mesh.m_vertices.size(); v++) start[v + 1] += start[v];
+
+			std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+			vertexFaces[m].resize(mesh.m_indices.size());
+			for (uint32_t i = 0; i < mesh.m_indices.size(); i++) vertexFaces[m][fill[mesh.m_indices[i]]++] = i / 3;
+		});
+
+		//sum up per vertex
+		parallelRun((uint32_t)vertexBatches.size(), [&](uint32_t b) {
+			uint32_t m = vertexBatches[b].first;
+			veObjMesh &mesh = meshes[m];
+			uint32_t last = std::min(vertexBatches[b].second + VE_OBJ_BATCH_SIZE, (uint32_t)mesh.m_vertices.size());
+
+			for (uint32_t v = vertexBatches[b].second; v < last; v++) {
+				vh::vhVertex &vertex = mesh.m_vertices[v];
+				glm::vec3 normal(0.0f, 0.0f, 0.0f);
+				glm::vec3 tangent(0.0f, 0.0f, 0.0f);
+				for (uint32_t i = vertexStart[m][v]; i < vertexStart[m][v + 1]; i++) {
+					normal += faceNormals[m][vertexFaces[m][i]];
+					tangent += faceTangents[m][vertexFaces[m][i]];
+				}
+
+				if (glm::dot(vertex.normal, vertex.normal) == 0.0f) vertex.normal = normal;
+				float length = glm::length(vertex.normal);
+				vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+				tangent -= vertex.normal * glm::dot(vertex.normal, tangent);
+				length = glm::length(tangent);
+				if (length < 1e-6f) {										//no texture coordinates, any orthogonal direction will do
+					tangent = std::abs(vertex.normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+					tangent -= vertex.normal * glm::dot(vertex.normal, tangent);
+					length = glm::length(tangent);
+				}
+				vertex.tangent = tangent / length;
+			}
+		});
+	}
+
+
+	/**
+	*
+	* \brief Parse an MTL file
+	*
+	* Reads diffuse color, opacity, illumination model and the texture maps VEMaterial can use. For texture
+	* maps only the last token of the line is used as file name, options before it are ignored.
+	* Like Assimp, bump maps become height maps and displacement maps become bump maps.
+	*
+	* \param[in] filename Name of the MTL file, relative to the directory of the OBJ file
+	* \returns false if the file could not be read
+	*
+	*/
+	bool VEObjLoader::loadMtl(std::string filename) {
+		veFileData file;
+		if (!getFileSystemPointer()->read(m_basedir + "/" + filename, file)) return false;
+
+		auto lastToken = [](std::string line) {
+			size_t pos = line.find_last_of(" \t");
+			return pos == std::string::npos ? line : line.substr(pos + 1);
+		};
+
+		veObjMaterial *pMat = nullptr;
+		const char *p = file.m_pData;
+		const char *end = p + file.m_size;
+		while (p < end) {
+			p = skipBlanks(p, end);
+
+			if (isKeyword(p, end, "newmtl", 6)) {
+				m_materials.push_back(veObjMaterial());
+				pMat = &m_materials.back();
+				pMat->m_name = getRestOfLine(p + 6, end);
+			}
+			else if (pMat != nullptr) {
+				if (isKeyword(p, end, "Kd", 2)) {
+					const char *q = p + 2;
+					for (uint32_t i = 0; i < 3 && q != nullptr; i++) q = parseFloat(q, end, pMat->m_color[i]);
+				}
+				else if (isKeyword(p, end, "d", 1)) {
+					parseFloat(p + 1, end, pMat->m_color.a);
+				}
+				else if (isKeyword(p, end, "Tr", 2)) {
+					float tr;
+					if (parseFloat(p + 2, end, tr) != nullptr) pMat->m_color.a = 1.0f - tr;
+				}
+				else if (isKeyword(p, end, "illum", 5)) {
+					int64_t illum;
+					if (parseInt(skipBlanks(p + 5, end), end, illum) != nullptr) pMat->m_illum = (uint32_t)illum;
+				}
+				else if (isKeyword(p, end, "map_Kd", 6)) {
+					pMat->m_mapDiffuse = lastToken(getRestOfLine(p, end));
+				}
+				else if (isKeyword(p, end, "norm", 4) || isKeyword(p, end, "map_Kn", 6)) {
+					pMat->m_mapNormal = lastToken(getRestOfLine(p, end));
+				}
+				else if (isKeyword(p, end, "disp", 4)) {
+					pMat->m_mapBump = lastToken(getRestOfLine(p, end));
+				}
+				else if (isKeyword(p, end, "bump", 4) || isKeyword(p, end, "map_bump", 8) || isKeyword(p, end, "map_Bump", 8)) {
+					pMat->m_mapHeight = lastToken(getRestOfLine(p, end));
+				}
+			}
+			p = nextLine(p, end);
+		}
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Load the OBJ file and its MTL files
+	*
+	* \returns false if the file could not be opened, contains malformed lines, or has no faces. The caller can then
+	* fall back to Assimp.
+	*
+	*/
+	bool VEObjLoader::load() {
+		auto t_start = std::chrono::high_resolution_clock::now();
+
+		veFileData file;
+		if (!getFileSystemPointer()->read(m_basedir + "/" + m_filename, file)) return false;
+
+		//cut the file into chunks at line ends
+		uint32_t numThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+		uint32_t numChunks = (uint32_t)std::max((size_t)1, std::min(file.m_size / VE_OBJ_MIN_CHUNK_SIZE, (size_t)numThreads * 4));
+
+		std::vector<veChunk> chunks(numChunks);
+		const char *end = file.m_pData + file.m_size;
+		const char *p = file.m_pData;
+		for (uint32_t i = 0; i < numChunks; i++) {
+			chunks[i].m_begin = p;
+			p = i + 1 < numChunks ? nextLine(std::max(file.m_pData + file.m_size * (i + 1) / numChunks, p), end) : end;
+			chunks[i].m_end = p;
+		}
+
+		//count vertex data lines, so each chunk knows where its data goes
+		parallelRun(numChunks, [&](uint32_t i) {
+			veChunk &chunk = chunks[i];
+			const char *q = chunk.m_begin;
+			while (q < chunk.m_end) {
+				q = skipBlanks(q, chunk.m_end);
+				switch (getLineType(q, chunk.m_end)) {
+				case VE_OBJ_LINE_POSITION: chunk.m_numPositions++; break;
+				case VE_OBJ_LINE_TEXCOORD: chunk.m_numTexCoords++; break;
+				case VE_OBJ_LINE_NORMAL: chunk.m_numNormals++; break;
+				default: break;
+				}
+				q = nextLine(q, chunk.m_end);
+			}
+		});
+
+		uint32_t numPositions = 0, numTexCoords = 0, numNormals = 0;
+		for (auto &chunk : chunks) {
+			chunk.m_firstPosition = numPositions;	numPositions += chunk.m_numPositions;
+			chunk.m_firstTexCoord = numTexCoords;	numTexCoords += chunk.m_numTexCoords;
+			chunk.m_firstNormal = numNormals;		numNormals += chunk.m_numNormals;
+		}
+		m_positions.resize(numPositions);
+		m_texCoords.resize(numTexCoords);
+		m_normals.resize(numNormals);
+
+		//parse
+		std::vector<uint8_t> ok(numChunks, 0);
+		parallelRun(numChunks, [&](uint32_t i) { ok[i] = parseChunk(chunks[i]) ? 1 : 0; });
+		file.release();
+		for (auto o : ok) if (!o) return false;
+
+		//materials
+		for (auto &chunk : chunks) {
+			for (auto &mtllib : chunk.m_mtllibs) {
+				if (std::find(m_mtllibs.begin(), m_mtllibs.end(), mtllib) != m_mtllibs.end()) continue;
+				m_mtllibs.push_back(mtllib);
+				loadMtl(mtllib);											//a missing MTL file leaves the default materials
+			}
+		}
+
+		//group the faces by object and material
+		std::vector<veGroup> groups;
+		std::map<std::pair<std::string, std::string>, uint32_t> groupMap;
+		std::string object = "default";
+		std::string material = "";
+		auto addRange = [&](uint32_t c, uint32_t firstFace, uint32_t lastFace) {
+			if (firstFace == lastFace) return;
+			auto it = groupMap.find({ object, material });
+			if (it == groupMap.end()) {
+				it = groupMap.insert({ { object, material }, (uint32_t)groups.size() }).first;
+				groups.push_back(veGroup());
+				groups.back().m_object = object;
+				groups.back().m_material = material;
+			}
+			std::vector<veGroup::veRange> &ranges = groups[it->second].m_ranges;
+			if (!ranges.empty() && ranges.back().m_chunk == c && ranges.back().m_lastFace == firstFace) ranges.back().m_lastFace = lastFace;
+			else ranges.push_back({ c, firstFace, lastFace });
+		};
+
+		for (uint32_t c = 0; c < numChunks; c++) {
+			uint32_t face = 0;
+			for (auto &state : chunks[c].m_states) {
+				addRange(c, face, state.m_face);
+				face = state.m_face;
+				if (state.m_object) object = state.m_name.empty() ? "default" : state.m_name;
+				else material = state.m_name;
+			}
+			addRange(c, face, (uint32_t)chunks[c].m_faces.size() - 1);
+		}
+		if (groups.empty()) return false;
+
+		//build the meshes
+		m_meshes.resize(groups.size());
+		parallelRun((uint32_t)groups.size(), [&](uint32_t g) { buildMesh(groups[g], chunks, m_meshes[g]); });
+		chunks.clear();
+
+		computeNormalsAndTangents(m_meshes);
+
+		m_positions = std::vector<glm::vec3>();
+		m_texCoords = std::vector<glm::vec2>();
+		m_normals = std::vector<glm::vec3>();
+
+		auto t_end = std::chrono::high_resolution_clock::now();
+		m_loadTime = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+		return true;
+	}
+
+}
+
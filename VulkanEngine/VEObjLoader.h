@@ -0,0 +1,93 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_OBJ_NO_INDEX = 0xFFFFFFFF;		///<Face corner without texture coordinate or normal
+const uint32_t VE_OBJ_MIN_CHUNK_SIZE = 1 << 16;		///<Files are split into chunks of at least this many bytes for parsing
+const uint32_t VE_OBJ_BATCH_SIZE = 1 << 14;			///<Triangles or vertices per batch when computing normals and tangents
+
+
+namespace ve {
+
+	///A material read from an MTL file
+	struct veObjMaterial {
+		std::string	m_name;											///<Name after newmtl
+		glm::vec4	m_color = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);	///<Diffuse color Kd, alpha from d or Tr
+		uint32_t	m_illum = 2;									///<Illumination model
+		std::string	m_mapDiffuse;									///<map_Kd
+		std::string	m_mapNormal;									///<norm, map_Kn
+		std::string	m_mapBump;										///<disp
+		std::string	m_mapHeight;									///<bump, map_bump
+	};
+
+	///The faces of one object using one material, ready to be turned into a VEMesh. Also used by VEGltfLoader.
+	struct veObjMesh {
+		std::string						m_object;					///<Name after o or g
+		std::string						m_material;					///<Name after usemtl, empty if none
+		std::vector<vh::vhVertex>		m_vertices;					///<Vertex array
+		std::vector<uint32_t>			m_indices;					///<Triangle list
+	};
+
+
+	/**
+	*
+	* \brief Loads Wavefront OBJ and MTL files without Assimp
+	*
+	* The file is read through VEFileSystem, i.e. mapped or taken from a pack, and cut into chunks at line ends. A first parallel pass counts the v, vt and vn
+	* lines of each chunk, so the second parallel pass can write vertex data straight into the global arrays and
+	* resolve relative indices. Numbers are parsed eight digits at a time where possible.
+	*
+	* Faces are grouped by object and material. Each group becomes one mesh, built in parallel: corners are
+	* deduplicated, polygons triangulated as fans, then missing normals and all tangents are computed in
+	* parallel batches. Like the Assimp path in VESceneManager::loadModel(), texture coordinates are flipped
+	* vertically and the winding order is reversed.
+	*
+	* The loader does not touch Vulkan, VESceneManager creates meshes and materials from the result.
+	*
+	*/
+	class VEObjLoader {
+
+	protected:
+		struct veChunk;
+		struct veGroup;
+
+		std::string					m_basedir;						///<Directory of the OBJ file
+		std::string					m_filename;						///<Name of the OBJ file
+		std::vector<glm::vec3>		m_positions;					///<All v lines
+		std::vector<glm::vec2>		m_texCoords;					///<All vt lines
+		std::vector<glm::vec3>		m_normals;						///<All vn lines
+		std::vector<std::string>	m_mtllibs;						///<All mtllib files
+		std::vector<veObjMesh>		m_meshes;						///<Result meshes
+		std::vector<veObjMaterial>	m_materials;					///<Result materials
+		double						m_loadTime = 0.0;				///<Duration of load() in ms
+
+		bool		parseChunk(veChunk &chunk);						//parse all lines of a chunk
+		void		buildMesh(veGroup &group, std::vector<veChunk> &chunks, veObjMesh &mesh);	//dedup corners and triangulate
+		bool		loadMtl(std::string filename);					//parse an MTL file
+
+	public:
+		///Constructor
+		VEObjLoader(std::string basedir, std::string filename) : m_basedir(basedir), m_filename(filename) {};
+		///Destructor
+		~VEObjLoader() {};
+
+		bool	load();												//load the OBJ file and its MTL files
+
+		static void	parallelRun(uint32_t count, std::function<void(uint32_t)> function);	//call function(i) for i<count on the thread pool
+		static void	computeNormalsAndTangents(std::vector<veObjMesh> &meshes);	//fill in missing normals and all tangents
+
+		///\returns the meshes, one per object and material
+		std::vector<veObjMesh> & getMeshes() { return m_meshes; };
+		///\returns the materials of all MTL files
+		std::vector<veObjMaterial> & getMaterials() { return m_materials; };
+		///\returns the time load() took in ms
+		double	getLoadTime() { return m_loadTime; };
+	};
+
+}
+
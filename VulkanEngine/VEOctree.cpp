@@ -0,0 +1,320 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief Constructor of the octree
+	*
+	* \param[in] center Center of the root cube, should be the center of the scene
+	* \param[in] halfSize Half edge length of the root cube, should cover the whole scene
+	* \param[in] maxDepth Deepest level of nodes, at most VE_OCTREE_MAX_DEPTH
+	*
+	*/
+	VEOctree::VEOctree(glm::vec3 center, float halfSize, uint32_t maxDepth) :
+		m_center(center), m_halfSize(halfSize), m_maxDepth(std::min(maxDepth, VE_OCTREE_MAX_DEPTH)) {
+
+		veNode root;
+		root.m_center = center;
+		root.m_halfSize = halfSize;
+		root.m_cell = glm::uvec3(0);
+		root.m_depth = 0;
+		root.m_parent = VE_OCTREE_NO_NODE;
+		for (uint32_t i = 0; i < 8; i++) root.m_children[i] = VE_OCTREE_NO_NODE;
+		root.m_numEntities = 0;
+		m_nodes.push_back(root);
+	}
+
+
+	/**
+	*
+	* \brief Store an entity in the octree
+	*
+	* \param[in] pEntity Pointer to the entity
+	*
+	*/
+	void VEOctree::addEntity(VEEntity *pEntity) {
+		if (pEntity->m_octreeProxy != VE_OCTREE_NO_PROXY) return;
+
+		uint32_t proxy;
+		if (m_freeProxies.size() > 0) {
+			proxy = m_freeProxies.back();
+			m_freeProxies.pop_back();
+		}
+		else {
+			proxy = (uint32_t)m_proxies.size();
+			m_proxies.push_back(veProxy());
+		}
+
+		m_proxies[proxy].m_pEntity = pEntity;
+		m_proxies[proxy].m_box = pEntity->getWorldBoundingBox(pEntity->getWorldTransform());
+		pEntity->m_octreeProxy = proxy;
+		insertProxy(proxy);
+	}
+
+
+	/**
+	*
+	* \brief Remove an entity from the octree
+	*
+	* \param[in] pEntity Pointer to the entity
+	*
+	*/
+	void VEOctree::removeEntity(VEEntity *pEntity) {
+		uint32_t proxy = pEntity->m_octreeProxy;
+		if (proxy == VE_OCTREE_NO_PROXY) return;
+
+		removeProxy(proxy);
+		m_proxies[proxy].m_pEntity = nullptr;
+		m_freeProxies.push_back(proxy);
+		pEntity->m_octreeProxy = VE_OCTREE_NO_PROXY;
+	}
+
+
+	/**
+	*
+	* \brief Compute the world space box of an entity and move the entity if it belongs to another node now
+	*
+	* \param[in] pEntity Pointer to the entity
+	* \param[in] worldMatrix The current world matrix of the entity
+	*
+	*/
+	void VEOctree::updateEntity(VEEntity *pEntity, glm::mat4 worldMatrix) {
+		cl::clAABB box = pEntity->getWorldBoundingBox(worldMatrix);
+
+		uint32_t proxy = pEntity->m_octreeProxy;
+		if (box.center == m_proxies[proxy].m_box.center && box.extent == m_proxies[proxy].m_box.extent) return;
+		m_proxies[proxy].m_box = box;
+
+		uint32_t depth;
+		glm::uvec3 cell;
+		getCell(box, depth, cell);
+		veNode &node = m_nodes[m_proxies[proxy].m_node];
+		if (node.m_depth == depth && node.m_cell == cell) return;		//still in the same node
+
+		removeProxy(proxy);
+		insertProxy(proxy);
+	}
+
+
+	/**
+	*
+	* \brief Find the node level and the cube on this level a box belongs to
+	*
+	* The box goes to the deepest level whose cubes are at least twice as large as the box,
+	* into the cube containing its center. Boxes whose center lies outside the root go to the root.
+	*
+	* \param[in] box The box
+	* \param[out] depth The level
+	* \param[out] cell Integer coordinates of the cube on this level
+	*
+	*/
+	void VEOctree::getCell(cl::clAABB &box, uint32_t &depth, glm::uvec3 &cell) {
+		depth = 0;
+		cell = glm::uvec3(0);
+
+		glm::vec3 rel = box.center - (m_center - glm::vec3(m_halfSize));
+		if (glm::any(glm::lessThan(rel, glm::vec3(0.0f))) || glm::any(glm::greaterThan(rel, glm::vec3(2.0f * m_halfSize)))) return;
+
+		float extent = std::max(std::max(box.extent.x, box.extent.y), box.extent.z);
+		float halfSize = m_halfSize;
+		while (depth < m_maxDepth && extent <= 0.5f * halfSize) {
+			halfSize *= 0.5f;
+			depth++;
+		}
+
+		uint32_t maxCell = (1u << depth) - 1;
+		cell = glm::min(glm::uvec3(rel / (2.0f * halfSize)), glm::uvec3(maxCell));
+	}
+
+
+	/**
+	*
+	* \brief Create a child of a node
+	*
+	* \param[in] parent The parent node
+	* \param[in] octant Index of the child, bits 0, 1, 2 are set for the upper half along x, y, z
+	* \returns the index of the new node
+	*
+	*/
+	uint32_t VEOctree::createNode(uint32_t parent, uint32_t octant) {
+		uint32_t node;
+		if (m_freeNodes.size() > 0) {
+			node = m_freeNodes.back();
+			m_freeNodes.pop_back();
+		}
+		else {
+			node = (uint32_t)m_nodes.size();
+			m_nodes.push_back(veNode());
+		}
+
+		veNode &p = m_nodes[parent];
+		veNode &n = m_nodes[node];
+		glm::uvec3 bits((octant & 1), (octant >> 1) & 1, (octant >> 2) & 1);
+		n.m_halfSize = 0.5f * p.m_halfSize;
+		n.m_center = p.m_center + (glm::vec3(bits) * 2.0f - 1.0f) * n.m_halfSize;
+		n.m_cell = p.m_cell * 2u + bits;
+		n.m_depth = p.m_depth + 1;
+		n.m_parent = parent;
+		for (uint32_t i = 0; i < 8; i++) n.m_children[i] = VE_OCTREE_NO_NODE;
+		n.m_proxies.clear();
+		n.m_numEntities = 0;
+		p.m_children[octant] = node;
+		return node;
+	}
+
+
+	/**
+	*
+	* \brief Store a proxy in the node its box belongs to, creating the nodes on the path to it
+	*
+	* \param[in] proxy The proxy
+	*
+	*/
+	void VEOctree::insertProxy(uint32_t proxy) {
+		uint32_t depth;
+		glm::uvec3 cell;
+		getCell(m_proxies[proxy].m_box, depth, cell);
+
+		uint32_t node = 0;
+		m_nodes[node].m_numEntities++;
+		for (uint32_t d = 1; d <= depth; d++) {
+			glm::uvec3 bits = (cell >> (depth - d)) & 1u;
+			uint32_t octant = bits.x | (bits.y << 1) | (bits.z << 2);
+			uint32_t child = m_nodes[node].m_children[octant];
+			node = child != VE_OCTREE_NO_NODE ? child : createNode(node, octant);
+			m_nodes[node].m_numEntities++;
+		}
+
+		m_proxies[proxy].m_node = node;
+		m_proxies[proxy].m_slot = (uint32_t)m_nodes[node].m_proxies.size();
+		m_nodes[node].m_proxies.push_back(proxy);
+	}
+
+
+	/**
+	*
+	* \brief Remove a proxy from its node, and free all nodes that become empty
+	*
+	* \param[in] proxy The proxy
+	*
+	*/
+	void VEOctree::removeProxy(uint32_t proxy) {
+		uint32_t node = m_proxies[proxy].m_node;
+		std::vector<uint32_t> &proxies = m_nodes[node].m_proxies;
+		uint32_t slot = m_proxies[proxy].m_slot;
+		proxies[slot] = proxies.back();
+		m_proxies[proxies[slot]].m_slot = slot;
+		proxies.pop_back();
+		m_proxies[proxy].m_node = VE_OCTREE_NO_NODE;
+
+		for (uint32_t n = node; n != VE_OCTREE_NO_NODE; n = m_nodes[n].m_parent) {
+			m_nodes[n].m_numEntities--;
+		}
+
+		while (node != 0 && m_nodes[node].m_numEntities == 0) {	//empty nodes have no children
+			veNode &n = m_nodes[node];
+			uint32_t octant = (n.m_cell.x & 1) | ((n.m_cell.y & 1) << 1) | ((n.m_cell.z & 1) << 2);
+			uint32_t parent = n.m_parent;
+			m_nodes[parent].m_children[octant] = VE_OCTREE_NO_NODE;
+			n.m_parent = VE_OCTREE_NO_NODE;
+			m_freeNodes.push_back(node);
+			node = parent;
+		}
+	}
+
+
+	/**
+	*
+	* \brief Add all entities of a node and its children to the query results
+	*
+	* \param[in] node The node
+	*
+	*/
+	void VEOctree::addSubtree(uint32_t node) {
+		uint32_t stack[8 * VE_OCTREE_MAX_DEPTH + 8];
+		uint32_t top = 0;
+		stack[top++] = node;
+		while (top > 0) {
+			veNode &n = m_nodes[stack[--top]];
+			for (auto proxy : n.m_proxies) m_results.push_back(m_proxies[proxy].m_pEntity);
+			for (uint32_t i = 0; i < 8; i++) {
+				if (n.m_children[i] != VE_OCTREE_NO_NODE) stack[top++] = n.m_children[i];
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Find all entities whose world boxes intersect a sphere
+	*
+	* \param[in] center Center of the sphere
+	* \param[in] radius Radius of the sphere
+	* \returns the entities found, valid until the next query
+	*
+	*/
+	VEOctree::veEntitySpan VEOctree::queryRadius(glm::vec3 center, float radius) {
+		float r2 = radius * radius;
+		return query([&](cl::clAABB &box) {
+			glm::vec3 d = glm::abs(center - box.center);
+			glm::vec3 closest = glm::max(d - box.extent, glm::vec3(0.0f));
+			if (glm::dot(closest, closest) > r2) return 0;
+			glm::vec3 farthest = d + box.extent;
+			return glm::dot(farthest, farthest) <= r2 ? 2 : 1;
+		}, [](cl::clAABB &) { return true; });
+	}
+
+
+	/**
+	*
+	* \brief Find all entities whose world boxes intersect a box
+	*
+	* \param[in] box The box
+	* \returns the entities found, valid until the next query
+	*
+	*/
+	VEOctree::veEntitySpan VEOctree::queryBox(cl::clAABB &box) {
+		return query([&](cl::clAABB &other) {
+			glm::vec3 d = glm::abs(box.center - other.center);
+			if (glm::any(glm::greaterThan(d, box.extent + other.extent))) return 0;
+			return glm::all(glm::lessThanEqual(d + other.extent, box.extent)) ? 2 : 1;
+		}, [](cl::clAABB &) { return true; });
+	}
+
+
+	/**
+	*
+	* \brief Find all entities whose world boxes intersect a frustum
+	*
+	* Nodes are tested against the frustum planes only. Entity boxes cutting a plane are tested exactly.
+	*
+	* \param[in] frustum The frustum
+	* \returns the entities found, valid until the next query
+	*
+	*/
+	VEOctree::veEntitySpan VEOctree::queryFrustum(cl::clFrustumPlanes &frustum) {
+		return query([&](cl::clAABB &box) {
+			int32_t result = 2;
+			for (uint32_t i = 0; i < 6; i++) {
+				cl::clPlane &plane = frustum.planes[i];
+				float r = glm::dot(glm::abs(plane.normal), box.extent);
+				float s = glm::dot(plane.normal, box.center) - plane.d;
+				if (s < -r) return 0;
+				if (s < r) result = 1;
+			}
+			return result;
+		}, [&](cl::clAABB &box) { return cl::clIntersect(box, frustum); });
+	}
+
+}
+
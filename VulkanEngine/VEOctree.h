@@ -0,0 +1,159 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_OCTREE_NO_PROXY = 0xFFFFFFFF;		///<Entity is not stored in the octree
+const uint32_t VE_OCTREE_NO_NODE = 0xFFFFFFFF;		///<Child does not exist
+const uint32_t VE_OCTREE_MAX_DEPTH = 20;			///<Upper limit for the depth of the octree, bounds the query stack
+
+
+namespace ve {
+
+	class VEEntity;
+
+	/**
+	*
+	* \brief A loose octree holding the world space bounding boxes of entities
+	*
+	* Each node covers a cube, but holds entities whose boxes reach up to half a cube size beyond it (looseness 2).
+	* Thus an entity is stored in exactly one node, which is found from the size and center of its box alone:
+	* the smaller the box, the deeper the node. Entities whose center lies outside the root cube are stored in the root.
+	* Nodes are only created along the paths to their entities and are freed again as soon as their subtree is empty.
+	*
+	* When the box of an entity changes, the entity is only moved if it now belongs to another node, which
+	* costs O(depth). Queries descend only into nodes whose loose bounds overlap the query volume, so their cost
+	* depends on the number of entities near the query, not on the size of the scene. Nodes completely inside
+	* the query volume are accepted with all their entities without further tests.
+	*
+	* Query results are stored in a buffer of the octree that is reused, and remain valid until the next query.
+	*
+	*/
+	class VEOctree {
+
+	public:
+
+		///Entities found by a query, valid until the next query
+		struct veEntitySpan {
+			VEEntity * const *	m_pData = nullptr;		///<First entity
+			uint32_t			m_size = 0;				///<Number of entities
+
+			///\returns pointer to the first entity
+			VEEntity * const * begin() const { return m_pData; };
+			///\returns pointer behind the last entity
+			VEEntity * const * end() const { return m_pData + m_size; };
+			///\returns the number of entities
+			uint32_t size() const { return m_size; };
+			///\returns entity i
+			VEEntity * operator[](uint32_t i) const { return m_pData[i]; };
+		};
+
+		///A node of the octree
+		struct veNode {
+			glm::vec3				m_center;						///<Center of the node cube
+			float					m_halfSize;						///<Half edge length of the node cube, loose bounds are twice as large
+			glm::uvec3				m_cell;							///<Integer coordinates of the cube on its level
+			uint32_t				m_depth;						///<Depth of the node, the root has depth 0
+			uint32_t				m_parent;						///<Parent node, VE_OCTREE_NO_NODE for the root
+			uint32_t				m_children[8];					///<Child nodes, VE_OCTREE_NO_NODE if empty
+			std::vector<uint32_t>	m_proxies;						///<Proxies stored in this node
+			uint32_t				m_numEntities;					///<Number of entities in this node and all its children
+		};
+
+	protected:
+
+		///An entity and its bounds
+		struct veProxy {
+			VEEntity *	m_pEntity = nullptr;						///<Entity, or nullptr if the proxy is free
+			cl::clAABB	m_box;										///<World space bounding box
+			uint32_t	m_node = VE_OCTREE_NO_NODE;					///<Node holding the proxy
+			uint32_t	m_slot = 0;									///<Index of the proxy in the list of the node
+		};
+
+		glm::vec3					m_center;						///<Center of the root cube
+		float						m_halfSize;						///<Half edge length of the root cube
+		uint32_t					m_maxDepth;						///<Deepest level of nodes
+		std::vector<veNode>			m_nodes;						///<All nodes, the root is node 0
+		std::vector<uint32_t>		m_freeNodes;					///<Nodes that can be reused
+		std::vector<veProxy>		m_proxies;						///<All proxies
+		std::vector<uint32_t>		m_freeProxies;					///<Proxies that can be reused
+		std::vector<VEEntity*>		m_results;						///<Result buffer of the last query
+
+		void		getCell(cl::clAABB &box, uint32_t &depth, glm::uvec3 &cell);	//node level and cube a box belongs to
+		uint32_t	createNode(uint32_t parent, uint32_t octant);	//create a child of a node
+		void		insertProxy(uint32_t proxy);					//store a proxy in the node its box belongs to
+		void		removeProxy(uint32_t proxy);					//remove a proxy from its node and free empty nodes
+		void		addSubtree(uint32_t node);						//add all entities below a node to the results
+
+		/**
+		*
+		* \brief Collect all entities whose boxes pass a test
+		*
+		* \param[in] testBox Function int(cl::clAABB &box) returning 0 if the box is outside the query volume,
+		* 1 if it intersects the volume, and 2 if it is completely inside
+		* \param[in] testEntity Function bool(cl::clAABB &box) returning whether an intersecting entity box is a result
+		* \returns the entities found
+		*
+		*/
+		template<typename FB, typename FE> veEntitySpan query(FB testBox, FE testEntity) {
+			m_results.clear();
+
+			uint32_t stack[8 * VE_OCTREE_MAX_DEPTH + 8];		//each level pushes at most 8 nodes
+			uint32_t top = 0;
+			stack[top++] = 0;
+			while (top > 0) {
+				veNode &node = m_nodes[stack[--top]];
+
+				if (node.m_depth > 0) {							//the root holds entities anywhere, so it is always visited
+					cl::clAABB loose(node.m_center, glm::vec3(2.0f * node.m_halfSize));
+					int32_t result = testBox(loose);
+					if (result == 0) continue;
+					if (result == 2) {
+						addSubtree((uint32_t)(&node - m_nodes.data()));
+						continue;
+					}
+				}
+
+				for (auto proxy : node.m_proxies) {
+					cl::clAABB &box = m_proxies[proxy].m_box;
+					int32_t result = testBox(box);
+					if (result == 2 || (result == 1 && testEntity(box))) m_results.push_back(m_proxies[proxy].m_pEntity);
+				}
+				for (uint32_t i = 0; i < 8; i++) {
+					if (node.m_children[i] != VE_OCTREE_NO_NODE) stack[top++] = node.m_children[i];
+				}
+			}
+
+			veEntitySpan span;
+			span.m_pData = m_results.data();
+			span.m_size = (uint32_t)m_results.size();
+			return span;
+		};
+
+	public:
+		VEOctree(glm::vec3 center, float halfSize, uint32_t maxDepth = 8);
+		///Destructor
+		~VEOctree() {};
+
+		void		addEntity(VEEntity *pEntity);				//store an entity in the octree
+		void		removeEntity(VEEntity *pEntity);			//remove an entity from the octree
+		void		updateEntity(VEEntity *pEntity, glm::mat4 worldMatrix);	//move an entity to the node of its new box
+
+		veEntitySpan queryRadius(glm::vec3 center, float radius);	//entities whose boxes intersect a sphere
+		veEntitySpan queryBox(cl::clAABB &box);					//entities whose boxes intersect a box
+		veEntitySpan queryFrustum(cl::clFrustumPlanes &frustum);	//entities whose boxes intersect a frustum
+
+		///\returns the node list, free nodes have no entities and no parent
+		std::vector<veNode> & getNodes() { return m_nodes; };
+		///\returns the number of entities in the octree
+		uint32_t	getNumEntities() { return m_nodes[0].m_numEntities; };
+		///\returns the number of nodes in use
+		uint32_t	getNumNodes() { return (uint32_t)(m_nodes.size() - m_freeNodes.size()); };
+	};
+
+}
+
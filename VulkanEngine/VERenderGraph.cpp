@@ -0,0 +1,447 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	///All access flags that write to memory
+	const VkAccessFlags VE_RG_WRITE_ACCESS =	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+												VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+												VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	const uint32_t VE_RG_UNUSED = std::numeric_limits<uint32_t>::max();	///<Marks images that are not used
+
+
+	/**
+	* \returns true if two image descriptions are equal
+	*/
+	static bool isDescEqual(const VERenderGraph::veImageDesc &a, const VERenderGraph::veImageDesc &b) {
+		return	a.m_format == b.m_format && a.m_extent.width == b.m_extent.width && a.m_extent.height == b.m_extent.height &&
+				a.m_usage == b.m_usage && a.m_aspect == b.m_aspect;
+	}
+
+
+	/**
+	* \brief Remove all passes and images from the graph. Physical images are kept for the next compile.
+	*/
+	void VERenderGraph::clear() {
+		m_passes.clear();
+		m_resources.clear();
+	}
+
+
+	/**
+	*
+	* \brief Import an image that is owned by someone else
+	*
+	* Imported images are never culled, i.e. all passes writing into them are executed.
+	*
+	* \param[in] name Name of the image
+	* \param[in] image The Vulkan image
+	* \param[in] imageView The image view
+	* \param[in] desc Description of the image, only format, extent and aspect are used
+	* \param[in] initialLayout Layout of the image when the graph starts
+	* \param[in] initialStages Pipeline stages that used the image before the graph starts
+	* \param[in] initialAccess Access of the image before the graph starts
+	* \returns the index of the image in the graph
+	*
+	*/
+	uint32_t VERenderGraph::importImage(std::string name, VkImage image, VkImageView imageView, veImageDesc desc,
+										VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkAccessFlags initialAccess) {
+		veResource res;
+		res.m_name = name;
+		res.m_imported = true;
+		res.m_desc = desc;
+		res.m_image = image;
+		res.m_imageView = imageView;
+		res.m_initialLayout = initialLayout;
+		res.m_initialStages = initialStages;
+		res.m_initialAccess = initialAccess;
+		m_resources.push_back(res);
+		return (uint32_t)m_resources.size() - 1;
+	}
+
+
+	/**
+	*
+	* \brief Create a transient image
+	*
+	* The image is created when the graph is compiled. Its contents are valid only between
+	* its first and last use in the graph.
+	*
+	* \param[in] name Name of the image
+	* \param[in] desc Description of the image
+	* \returns the index of the image in the graph
+	*
+	*/
+	uint32_t VERenderGraph::createImage(std::string name, veImageDesc desc) {
+		veResource res;
+		res.m_name = name;
+		res.m_desc = desc;
+		m_resources.push_back(res);
+		return (uint32_t)m_resources.size() - 1;
+	}
+
+
+	/**
+	*
+	* \brief Add a pass to the graph. Passes are executed in the order they are added.
+	*
+	* \param[in] name Name of the pass
+	* \param[in] execute Function that records the pass into a command buffer
+	* \param[in] sideEffect If true the pass is never culled
+	* \returns the index of the pass in the graph
+	*
+	*/
+	uint32_t VERenderGraph::addPass(std::string name, std::function<void(VkCommandBuffer)> execute, bool sideEffect) {
+		vePass pass;
+		pass.m_name = name;
+		pass.m_execute = execute;
+		pass.m_sideEffect = sideEffect;
+		m_passes.push_back(pass);
+		return (uint32_t)m_passes.size() - 1;
+	}
+
+
+	/**
+	*
+	* \brief Declare that a pass uses an image
+	*
+	* \param[in] pass Index of the pass
+	* \param[in] use How the image is used
+	*
+	*/
+	void VERenderGraph::useImage(uint32_t pass, veImageUse use) {
+		m_passes[pass].m_uses.push_back(use);
+	}
+
+
+	/**
+	*
+	* \brief Compile the graph
+	*
+	* Culls unused passes, computes the image lifetimes, maps transient images to physical images and
+	* computes the barriers of all passes.
+	*
+	* \returns true if the physical images had to be created again. In this case all command buffers
+	* and descriptor sets that refer to transient images of earlier compiles are invalid.
+	*
+	*/
+	bool VERenderGraph::compile() {
+		cullPasses();
+
+		for (auto &res : m_resources) {
+			res.m_firstUse = VE_RG_UNUSED;
+			res.m_lastUse = 0;
+			res.m_physical = VE_RG_UNUSED;
+		}
+
+		for (uint32_t p = 0; p < m_passes.size(); p++) {
+			if (m_passes[p].m_culled) continue;
+			for (auto &use : m_passes[p].m_uses) {
+				veResource &res = m_resources[use.m_resource];
+				res.m_firstUse = std::min(res.m_firstUse, p);
+				res.m_lastUse = std::max(res.m_lastUse, p);
+			}
+		}
+
+		std::vector<vePhysicalImage> physicalImages;
+		assignPhysicalImages(physicalImages);
+		bool recreated = createPhysicalImages(physicalImages);
+
+		for (auto &res : m_resources) {
+			if (res.m_imported || res.m_physical == VE_RG_UNUSED) continue;
+			res.m_image = m_physicalImages[res.m_physical].m_pTexture->m_image;
+			res.m_imageView = m_physicalImages[res.m_physical].m_pTexture->m_imageView;
+		}
+
+		computeBarriers();
+
+		return recreated;
+	}
+
+
+	/**
+	*
+	* \brief Mark all passes whose results are never used as culled
+	*
+	* Goes backwards through the passes. A pass is needed if it has side effects, writes into an imported image,
+	* or writes into a transient image that is read later by a needed pass.
+	*
+	*/
+	void VERenderGraph::cullPasses() {
+		std::vector<bool> needed(m_resources.size(), false);
+		for (uint32_t r = 0; r < m_resources.size(); r++) needed[r] = m_resources[r].m_imported;
+
+		for (int32_t p = (int32_t)m_passes.size() - 1; p >= 0; p--) {
+			vePass &pass = m_passes[p];
+
+			bool alive = pass.m_sideEffect;
+			for (auto &use : pass.m_uses) {
+				if ((use.m_access & VE_RG_WRITE_ACCESS) && needed[use.m_resource]) alive = true;
+			}
+			pass.m_culled = !alive;
+			if (!alive) continue;
+
+			for (auto &use : pass.m_uses) {						//written images are produced here
+				if ((use.m_access & VE_RG_WRITE_ACCESS) && !m_resources[use.m_resource].m_imported)
+					needed[use.m_resource] = false;
+			}
+			for (auto &use : pass.m_uses) {						//read images must be produced before
+				if (!(use.m_access & VE_RG_WRITE_ACCESS) || !use.m_discard)
+					needed[use.m_resource] = true;
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Map transient images to physical images
+	*
+	* Transient images are visited in the order of their first use. An image reuses the physical image
+	* with the lowest index that has the same description and is no longer used. Thus the mapping is
+	* the same each time the same graph is compiled.
+	*
+	* \param[out] physicalImages The list of needed physical images
+	*
+	*/
+	void VERenderGraph::assignPhysicalImages(std::vector<vePhysicalImage> &physicalImages) {
+		std::vector<uint32_t> order;
+		for (uint32_t r = 0; r < m_resources.size(); r++) {
+			if (!m_resources[r].m_imported && m_resources[r].m_firstUse != VE_RG_UNUSED) order.push_back(r);
+		}
+		std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+			return m_resources[a].m_firstUse < m_resources[b].m_firstUse;
+		});
+
+		for (auto r : order) {
+			veResource &res = m_resources[r];
+
+			uint32_t phys = VE_RG_UNUSED;
+			for (uint32_t i = 0; i < physicalImages.size(); i++) {
+				if (isDescEqual(physicalImages[i].m_desc, res.m_desc) && physicalImages[i].m_lastUse < res.m_firstUse) {
+					phys = i;
+					break;
+				}
+			}
+
+			if (phys == VE_RG_UNUSED) {
+				vePhysicalImage physImage;
+				physImage.m_desc = res.m_desc;
+				physImage.m_firstUse = res.m_firstUse;
+				physicalImages.push_back(physImage);
+				phys = (uint32_t)physicalImages.size() - 1;
+			}
+
+			physicalImages[phys].m_lastUse = res.m_lastUse;
+			res.m_physical = phys;
+		}
+	}
+
+
+	/**
+	*
+	* \brief Create the physical images
+	*
+	* If the physical images have the same descriptions as the ones of the last compile, they are reused.
+	* Otherwise the old images are destroyed after waiting for the device to become idle, and new ones are created.
+	* Each image has its own memory. Shadow map cascades, the only transient images so far, are all read by the
+	* same light pass, so sharing memory between images would not save anything.
+	*
+	* \param[in] physicalImages The physical images needed by the graph
+	* \returns true if the images have been created again
+	*
+	*/
+	bool VERenderGraph::createPhysicalImages(std::vector<vePhysicalImage> &physicalImages) {
+		bool same = physicalImages.size() == m_physicalImages.size();
+		for (uint32_t i = 0; same && i < physicalImages.size(); i++) {
+			same = isDescEqual(physicalImages[i].m_desc, m_physicalImages[i].m_desc);
+		}
+
+		if (same) {
+			for (uint32_t i = 0; i < physicalImages.size(); i++) {
+				m_physicalImages[i].m_firstUse = physicalImages[i].m_firstUse;
+				m_physicalImages[i].m_lastUse = physicalImages[i].m_lastUse;
+			}
+			return false;
+		}
+
+		VkDevice device = getRendererPointer()->getDevice();
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+
+		if (m_physicalImages.size() > 0) {
+			vkDeviceWaitIdle(device);
+			destroyPhysicalImages();
+		}
+
+		for (uint32_t i = 0; i < physicalImages.size(); i++) {
+			vePhysicalImage &phys = physicalImages[i];
+			phys.m_pTexture = new VETexture("RenderGraphImage" + std::to_string(i));
+			phys.m_pTexture->m_extent = phys.m_desc.m_extent;
+			phys.m_pTexture->m_format = phys.m_desc.m_format;
+
+			VECHECKRESULT(vh::vhBufCreateImage(	allocator, phys.m_desc.m_extent.width, phys.m_desc.m_extent.height, 1, 1,
+												phys.m_desc.m_format, VK_IMAGE_TILING_OPTIMAL, phys.m_desc.m_usage, 0,
+												&phys.m_pTexture->m_image, &phys.m_pTexture->m_deviceAllocation),
+						"Could not create render graph image");
+
+			VkMemoryRequirements memReq;
+			vkGetImageMemoryRequirements(device, phys.m_pTexture->m_image, &memReq);
+			phys.m_size = memReq.size;
+
+			VECHECKRESULT(vh::vhBufCreateImageView(device, phys.m_pTexture->m_image, phys.m_desc.m_format, VK_IMAGE_VIEW_TYPE_2D, 1,
+													phys.m_desc.m_aspect, &phys.m_pTexture->m_imageView),
+						"Could not create render graph image view");
+
+			if (phys.m_desc.m_usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+				VECHECKRESULT(vh::vhBufCreateTextureSampler(device, &phys.m_pTexture->m_sampler),
+							"Could not create render graph sampler");
+			}
+		}
+
+		m_physicalImages = physicalImages;
+		return true;
+	}
+
+
+	/**
+	* \brief Destroy all physical images and free their memory
+	*/
+	void VERenderGraph::destroyPhysicalImages() {
+		for (auto &phys : m_physicalImages) {
+			delete phys.m_pTexture;
+		}
+		m_physicalImages.clear();
+	}
+
+
+	/**
+	*
+	* \brief Compute the barriers that have to be recorded before each pass
+	*
+	* The graph keeps track of layout, pipeline stages and access of each image. Imported images start with the state
+	* given when importing them. Transient images share physical images, thus stages and access are tracked
+	* per physical image. Since the same graph runs again in the next frame, each physical image starts with the state
+	* of its last use in the frame. At its first use a transient image is transitioned from VK_IMAGE_LAYOUT_UNDEFINED.
+	*
+	* A barrier is needed if the layout changes, if the image has been written before (read/write after write),
+	* or if it is written after having been read (write after read).
+	*
+	*/
+	void VERenderGraph::computeBarriers() {
+		uint32_t numRes = (uint32_t)m_resources.size();
+		std::vector<VkImageLayout> layouts(numRes, VK_IMAGE_LAYOUT_UNDEFINED);
+		std::vector<VkPipelineStageFlags> stages(numRes + m_physicalImages.size(), 0);	//imported images, then physical images
+		std::vector<VkAccessFlags> access(numRes + m_physicalImages.size(), 0);
+
+		for (uint32_t r = 0; r < numRes; r++) {
+			if (!m_resources[r].m_imported) continue;
+			layouts[r] = m_resources[r].m_initialLayout;
+			stages[r] = m_resources[r].m_initialStages;
+			access[r] = m_resources[r].m_initialAccess;
+		}
+
+		for (auto &pass : m_passes) {							//state at the end of the previous frame
+			if (pass.m_culled) continue;
+			for (auto &use : pass.m_uses) {
+				veResource &res = m_resources[use.m_resource];
+				if (res.m_imported) continue;
+				uint32_t slot = numRes + res.m_physical;
+				stages[slot] = use.m_stages;
+				access[slot] = use.m_access;
+			}
+		}
+
+		for (uint32_t p = 0; p < m_passes.size(); p++) {
+			vePass &pass = m_passes[p];
+			pass.m_barriers.clear();
+			pass.m_srcStages = 0;
+			pass.m_dstStages = 0;
+			if (pass.m_culled) continue;
+
+			for (auto &use : pass.m_uses) {
+				veResource &res = m_resources[use.m_resource];
+				uint32_t slot = res.m_imported ? use.m_resource : numRes + res.m_physical;
+				bool first = !res.m_imported && res.m_firstUse == p;
+
+				VkImageLayout oldLayout = first ? VK_IMAGE_LAYOUT_UNDEFINED : layouts[use.m_resource];
+				bool prevWrite = (access[slot] & VE_RG_WRITE_ACCESS) != 0;
+				bool curWrite = (use.m_access & VE_RG_WRITE_ACCESS) != 0;
+				bool transition = oldLayout != use.m_layout;
+				bool hazard = prevWrite || (curWrite && stages[slot] != 0);
+
+				if (transition || hazard) {
+					VkImageMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					barrier.oldLayout = (transition && use.m_discard) ? VK_IMAGE_LAYOUT_UNDEFINED : oldLayout;
+					barrier.newLayout = use.m_layout;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.image = res.m_image;
+					barrier.subresourceRange.aspectMask = res.m_desc.m_aspect;
+					barrier.subresourceRange.baseMipLevel = 0;
+					barrier.subresourceRange.levelCount = 1;
+					barrier.subresourceRange.baseArrayLayer = 0;
+					barrier.subresourceRange.layerCount = 1;
+					barrier.srcAccessMask = access[slot] & VE_RG_WRITE_ACCESS;
+					barrier.dstAccessMask = use.m_access;
+					pass.m_barriers.push_back(barrier);
+
+					pass.m_srcStages |= stages[slot] != 0 ? stages[slot] : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					pass.m_dstStages |= use.m_stages;
+				}
+
+				layouts[use.m_resource] = use.m_layoutAfter;
+				if (!curWrite && !prevWrite && !transition) {	//several reads in a row, a later write must wait for all of them
+					stages[slot] |= use.m_stages;
+					access[slot] |= use.m_access;
+				}
+				else {
+					stages[slot] = use.m_stages;
+					access[slot] = use.m_access;
+				}
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Record all passes that have not been culled, each preceded by its barriers
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	*
+	*/
+	void VERenderGraph::execute(VkCommandBuffer commandBuffer) {
+		for (auto &pass : m_passes) {
+			if (pass.m_culled) continue;
+
+			if (pass.m_barriers.size() > 0) {
+				vkCmdPipelineBarrier(	commandBuffer, pass.m_srcStages, pass.m_dstStages, 0,
+										0, nullptr, 0, nullptr,
+										(uint32_t)pass.m_barriers.size(), pass.m_barriers.data());
+			}
+
+			pass.m_execute(commandBuffer);
+		}
+	}
+
+
+	/**
+	* \returns the memory that is allocated for transient images
+	*/
+	VkDeviceSize VERenderGraph::getTransientMemorySize() {
+		VkDeviceSize size = 0;
+		for (auto &phys : m_physicalImages) size += phys.m_size;
+		return size;
+	}
+
+}
@@ -0,0 +1,128 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief A render graph that schedules passes, synchronizes them and manages transient images
+	*
+	* Each pass declares which images it uses and how. Images are either imported (swap chain images, depth maps)
+	* or transient, i.e. they are created by the graph and live only during one frame. When compiling,
+	* the graph
+	*- culls all passes whose results are never used,
+	*- computes the pipeline barriers and layout transitions needed before each pass,
+	*- maps transient images to physical images. Transient images with the same description whose lifetimes do not
+	*  overlap share one physical image.
+	*
+	* Since the same graph is executed again in the next frame, the first use of a transient image is synchronized
+	* with its last use in the previous frame. Physical images are kept across compiles as long as the graph structure
+	* does not change. A graph must not be executed by two frames in flight at the same time, renderers keep one
+	* graph per swap chain image.
+	*
+	*/
+	class VERenderGraph {
+
+	public:
+
+		///Description of a transient image
+		struct veImageDesc {
+			VkFormat			m_format = VK_FORMAT_UNDEFINED;			///<Image format
+			VkExtent2D			m_extent = { 0, 0 };					///<Image extent
+			VkImageUsageFlags	m_usage = 0;							///<Vulkan usage flags
+			VkImageAspectFlags	m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;	///<Aspect used for views and barriers
+		};
+
+		///How a pass uses an image
+		struct veImageUse {
+			uint32_t				m_resource;				///<Index of the image
+			VkImageLayout			m_layout;				///<Layout the image must have when the pass starts
+			VkImageLayout			m_layoutAfter;			///<Layout the pass leaves the image in, e.g. the final layout of a render pass
+			VkPipelineStageFlags	m_stages;				///<Stages that access the image
+			VkAccessFlags			m_access;				///<Type of access
+			bool					m_discard;				///<If true, old contents are not needed
+		};
+
+	protected:
+
+		///An image known to the graph
+		struct veResource {
+			std::string				m_name;								///<Name of the image
+			bool					m_imported = false;					///<Imported or transient
+			veImageDesc				m_desc;								///<Image description
+			VkImage					m_image = VK_NULL_HANDLE;			///<Image handle, set for imported images or after compile
+			VkImageView				m_imageView = VK_NULL_HANDLE;		///<Image view, set for imported images or after compile
+			VkImageLayout			m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;	///<Layout of an imported image at graph start
+			VkPipelineStageFlags	m_initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;	///<Stages that used an imported image before the graph
+			VkAccessFlags			m_initialAccess = 0;				///<Access of an imported image before the graph
+			uint32_t				m_firstUse = 0;						///<First pass using the image
+			uint32_t				m_lastUse = 0;						///<Last pass using the image
+			uint32_t				m_physical = 0;						///<Physical image of a transient image
+		};
+
+		///A pass of the graph
+		struct vePass {
+			std::string							m_name;						///<Name of the pass
+			std::function<void(VkCommandBuffer)> m_execute;					///<Records the pass
+			std::vector<veImageUse>				m_uses;						///<Images used by the pass
+			bool								m_sideEffect = false;		///<Never cull this pass
+			bool								m_culled = false;			///<Pass is not executed
+			std::vector<VkImageMemoryBarrier>	m_barriers;					///<Barriers before the pass
+			VkPipelineStageFlags				m_srcStages = 0;			///<Source stages of the barriers
+			VkPipelineStageFlags				m_dstStages = 0;			///<Destination stages of the barriers
+		};
+
+		///A physical image that holds one or more transient images
+		struct vePhysicalImage {
+			veImageDesc				m_desc;							///<Image description
+			uint32_t				m_firstUse = 0;					///<First pass using the image
+			uint32_t				m_lastUse = 0;					///<Last pass using the image
+			VETexture *				m_pTexture = nullptr;			///<Image, view, sampler and memory
+			VkDeviceSize			m_size = 0;						///<Memory size of the image
+		};
+
+		std::vector<veResource>			m_resources;			///<All images of the graph
+		std::vector<vePass>				m_passes;				///<All passes in execution order
+		std::vector<vePhysicalImage>	m_physicalImages;		///<Physical images of the transient images
+
+		void	cullPasses();															//mark passes whose results are not used
+		void	assignPhysicalImages(std::vector<vePhysicalImage> &physicalImages);		//map transient images to physical images
+		bool	createPhysicalImages(std::vector<vePhysicalImage> &physicalImages);		//create images, if the mapping changed
+		void	computeBarriers();														//compute barriers for all passes
+
+	public:
+		///Constructor
+		VERenderGraph() {};
+		///Destructor
+		~VERenderGraph() {};
+
+		void		clear();						//remove passes and images, keep physical images
+		uint32_t	importImage(std::string name, VkImage image, VkImageView imageView, veImageDesc desc,
+								VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkAccessFlags initialAccess);
+		uint32_t	createImage(std::string name, veImageDesc desc);	//create a transient image
+		uint32_t	addPass(std::string name, std::function<void(VkCommandBuffer)> execute, bool sideEffect = false);
+		void		useImage(uint32_t pass, veImageUse use);			//declare an image use of a pass
+		bool		compile();						//cull, map to physical images and synchronize
+		void		execute(VkCommandBuffer commandBuffer);	//record all passes that have not been culled
+		void		destroyPhysicalImages();		//free all images and memory of the graph
+
+		///\returns the image of a resource, valid after compile()
+		VkImage		getImage(uint32_t resource) { return m_resources[resource].m_image; };
+		///\returns the image view of a resource, valid after compile()
+		VkImageView	getImageView(uint32_t resource) { return m_resources[resource].m_imageView; };
+		///\returns the texture holding a transient resource, valid after compile()
+		VETexture *	getTexture(uint32_t resource) { return m_physicalImages[m_resources[resource].m_physical].m_pTexture; };
+		///\returns whether a pass has been culled
+		bool		isCulled(uint32_t pass) { return m_passes[pass].m_culled; };
+		VkDeviceSize getTransientMemorySize();			//memory used by transient images
+	};
+
+}
+
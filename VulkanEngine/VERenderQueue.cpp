@@ -0,0 +1,209 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	* \brief Remove all draw items and forget the IDs of pipelines, materials and meshes
+	*/
+	void VERenderQueue::clear() {
+		m_drawItems.clear();
+		m_pipelineIDs.clear();
+		m_materialIDs.clear();
+		m_meshIDs.clear();
+	}
+
+
+	/**
+	*
+	* \brief Get a dense ID for a pointer
+	*
+	* Pointers are mapped to small consecutive numbers in the order they are first seen.
+	* If there are more pointers than the key bits can hold, IDs wrap around. This only means that
+	* some state changes are not saved, it does not change the result of rendering.
+	*
+	* \param[in] ids The map holding the IDs given so far
+	* \param[in] ptr The pointer to get an ID for
+	* \param[in] bits The number of key bits that are available for the ID
+	* \returns the ID of the pointer
+	*
+	*/
+	uint32_t VERenderQueue::getID(std::unordered_map<void*, uint32_t> &ids, void *ptr, uint32_t bits) {
+		auto it = ids.find(ptr);
+		if (it != ids.end()) return it->second;
+
+		uint32_t id = (uint32_t)ids.size() & ((1u << bits) - 1);
+		ids[ptr] = id;
+		return id;
+	}
+
+
+	/**
+	*
+	* \brief Pack the parts of a sort key into a 64 bit number
+	*
+	* \param[in] pass The pass the draw belongs to
+	* \param[in] pipeline The ID of the pipeline (subrenderer)
+	* \param[in] layer The coarse depth layer
+	* \param[in] material The ID of the material
+	* \param[in] mesh The ID of the mesh
+	* \param[in] depth The depth bucket
+	* \returns the sort key
+	*
+	*/
+	uint64_t VERenderQueue::makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t layer, uint32_t material, uint32_t mesh, uint32_t depth) {
+		uint64_t key = pass & ((1u << VE_SORTKEY_BITS_PASS) - 1);
+		key = (key << VE_SORTKEY_BITS_PIPELINE) | (pipeline & ((1u << VE_SORTKEY_BITS_PIPELINE) - 1));
+		key = (key << VE_SORTKEY_BITS_LAYER) | (layer & ((1u << VE_SORTKEY_BITS_LAYER) - 1));
+		key = (key << VE_SORTKEY_BITS_MATERIAL) | (material & ((1u << VE_SORTKEY_BITS_MATERIAL) - 1));
+		key = (key << VE_SORTKEY_BITS_MESH) | (mesh & ((1u << VE_SORTKEY_BITS_MESH) - 1));
+		key = (key << VE_SORTKEY_BITS_DEPTH) | (depth & ((1u << VE_SORTKEY_BITS_DEPTH) - 1));
+		return key;
+	}
+
+
+	/**
+	*
+	* \brief Compute the depth of an entity
+	*
+	* The distance of the entity's bounding sphere center along the camera view direction is
+	* divided by the far plane distance and clamped to [0, 1].
+	*
+	* \param[in] pEntity Pointer to the entity
+	* \param[in] pCamera Pointer to the camera that is used for drawing
+	* \returns the depth, 0 is closest to the camera
+	*
+	*/
+	float VERenderQueue::getDepth(VEEntity *pEntity, VECamera *pCamera) {
+		glm::vec3 center;
+		float radius;
+		pEntity->getBoundingSphere(&center, &radius);
+
+		glm::vec4 centerW = pEntity->getWorldTransform() * glm::vec4(center, 1.0f);
+		glm::mat4 camW = pCamera->getWorldTransform();
+		glm::vec3 camPos = glm::vec3(camW[3]);
+		glm::vec3 camDir = glm::normalize(glm::vec3(camW[2]));
+
+		float depth = glm::dot(glm::vec3(centerW) - camPos, camDir) / pCamera->m_farPlane;
+		return glm::clamp(depth, 0.0f, 1.0f);
+	}
+
+
+	/**
+	*
+	* \brief Add an entity or a culled group to the render queue
+	*
+	* The depth layers are spaced by the square root of the depth, so layers near the camera are thinner.
+	* A culled group is sorted like its first entity.
+	*
+	* \param[in] pass The pass of the draw, lower passes are drawn first
+	* \param[in] pSubrender Pointer to the subrenderer that draws the entity
+	* \param[in] pEntity Pointer to the entity, or the first entity of the group
+	* \param[in] pCamera Pointer to the camera that is used for drawing
+	* \param[in] cullGroup The VEGPUCulling group, or VE_CULL_NO_GROUP to draw only the entity
+	*
+	*/
+	void VERenderQueue::addDrawItem(uint32_t pass, VESubrender *pSubrender, VEEntity *pEntity, VECamera *pCamera, uint32_t cullGroup) {
+		uint32_t pipeline = (getID(m_pipelineIDs, pSubrender, VE_SORTKEY_BITS_PIPELINE - 1) << 1) | (cullGroup != VE_CULL_NO_GROUP ? 1 : 0);
+		uint32_t material = getID(m_materialIDs, pEntity->m_pMaterial, VE_SORTKEY_BITS_MATERIAL);
+		uint32_t mesh = getID(m_meshIDs, pEntity->m_pMesh, VE_SORTKEY_BITS_MESH);
+		float depth = getDepth(pEntity, pCamera);
+		uint32_t layer = (uint32_t)(sqrt(depth) * (float)((1u << VE_SORTKEY_BITS_LAYER) - 1));
+		uint32_t bucket = (uint32_t)(depth * (float)((1u << VE_SORTKEY_BITS_DEPTH) - 1));
+
+		m_drawItems.push_back({ makeSortKey(pass, pipeline, layer, material, mesh, bucket), pSubrender, pEntity, cullGroup });
+	}
+
+
+	/**
+	*
+	* \brief Sort the draw items by their keys
+	*
+	* An LSD radix sort with 8 bit digits is used. The sort is stable, so items with equal keys stay in the order
+	* they have been added. Digits that are equal for all items are skipped, this is the common case for the upper
+	* bits of the key.
+	*
+	*/
+	void VERenderQueue::sort() {
+		uint32_t size = (uint32_t)m_drawItems.size();
+		if (size < 2) return;
+
+		m_sortBuffer.resize(size);
+		veDrawItem *pSrc = m_drawItems.data();
+		veDrawItem *pDst = m_sortBuffer.data();
+
+		for (uint32_t shift = 0; shift < 64; shift += 8) {
+			uint32_t count[256] = {};
+			for (uint32_t i = 0; i < size; i++) {
+				count[(pSrc[i].m_sortKey >> shift) & 0xFF]++;
+			}
+
+			if (count[(pSrc[0].m_sortKey >> shift) & 0xFF] == size) continue;	//all items have the same digit
+
+			uint32_t offset = 0;
+			for (uint32_t d = 0; d < 256; d++) {
+				uint32_t c = count[d];
+				count[d] = offset;
+				offset += c;
+			}
+
+			for (uint32_t i = 0; i < size; i++) {
+				pDst[count[(pSrc[i].m_sortKey >> shift) & 0xFF]++] = pSrc[i];
+			}
+
+			std::swap(pSrc, pDst);
+		}
+
+		if (pSrc != m_drawItems.data()) m_drawItems.swap(m_sortBuffer);
+	}
+
+
+	/**
+	*
+	* \brief Record all draw items into a command buffer
+	*
+	* The sorted items are split into runs that share the same subrenderer and are either all culled groups or
+	* all single entities, and each run is handed to its subrenderer for drawing.
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	*
+	*/
+	void VERenderQueue::draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+								VECamera *pCamera, VELight *pLight,
+								vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {
+
+		uint32_t size = (uint32_t)m_drawItems.size();
+		uint32_t first = 0;
+		while (first < size) {
+			VESubrender *pSub = m_drawItems[first].m_pSubrender;
+			bool culled = m_drawItems[first].m_cullGroup != VE_CULL_NO_GROUP;
+			uint32_t last = first + 1;
+			while (last < size && m_drawItems[last].m_pSubrender == pSub &&
+					(m_drawItems[last].m_cullGroup != VE_CULL_NO_GROUP) == culled) last++;
+
+			if (culled) {
+				pSub->drawCulled(	commandBuffer, imageIndex, numPass, pCamera, pLight, descriptorSetsShadow,
+									&m_drawItems[first], last - first);
+			}
+			else {
+				pSub->drawSorted(	commandBuffer, imageIndex, numPass, pCamera, pLight, descriptorSetsShadow,
+									&m_drawItems[first], last - first);
+			}
+			first = last;
+		}
+	}
+
+}
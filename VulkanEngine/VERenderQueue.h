@@ -0,0 +1,89 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+
+namespace ve {
+
+	class VESubrender;
+	class VEEntity;
+	class VECamera;
+	class VELight;
+
+	/**
+	*
+	* \brief A list of draw items that is sorted by a 64 bit key before recording
+	*
+	* Each visible entity of a pass is added as one draw item, and so is each group of entities culled on the GPU.
+	* Its sort key holds, from the most to the least significant bits: pass (4 bits), pipeline/subrenderer (8 bits),
+	* depth layer (4 bits), material (16 bits), mesh (16 bits) and depth bucket (16 bits). The lowest pipeline bit
+	* separates the culled groups of a subrenderer from its other draws, since they use another pipeline.
+	* After sorting, all draws using the same pipeline are contiguous, so per frame descriptor sets are bound only
+	* once per pipeline. Within a pipeline, draws are sorted front to back by coarse depth layers, which improves early
+	* depth rejection. Within a layer, draws sharing a material are contiguous, so material resources are bound only once
+	* per material, and draws sharing a mesh are contiguous, so vertex and index buffers are bound only once per mesh.
+	* The depth bucket orders the draws of a mesh front to back.
+	* Sorting is done with an LSD radix sort, which is linear in the number of draw items.
+	*
+	*/
+	class VERenderQueue {
+
+	public:
+
+		///One draw of one entity
+		struct veDrawItem {
+			uint64_t		m_sortKey;			///<The 64 bit sort key
+			VESubrender *	m_pSubrender;		///<The subrenderer that draws the entity
+			VEEntity *		m_pEntity;			///<The entity to draw, or the first entity of a culled group
+			uint32_t		m_cullGroup;		///<The VEGPUCulling group, or VE_CULL_NO_GROUP for a single entity
+		};
+
+		///Number of bits of each part of the sort key
+		enum veSortKeyBits {
+			VE_SORTKEY_BITS_PASS = 4,			///<Bits for the pass (e.g. background or object)
+			VE_SORTKEY_BITS_PIPELINE = 8,		///<Bits for the pipeline, i.e. the subrenderer
+			VE_SORTKEY_BITS_LAYER = 4,			///<Bits for the coarse depth layer
+			VE_SORTKEY_BITS_MATERIAL = 16,		///<Bits for the material
+			VE_SORTKEY_BITS_MESH = 16,			///<Bits for the mesh
+			VE_SORTKEY_BITS_DEPTH = 16			///<Bits for the depth bucket
+		};
+
+	protected:
+		std::vector<veDrawItem>					m_drawItems;		///<Draw items of the current pass
+		std::vector<veDrawItem>					m_sortBuffer;		///<Second buffer needed by the radix sort
+		std::unordered_map<void*, uint32_t>		m_pipelineIDs;		///<Dense IDs of subrenderers in this queue
+		std::unordered_map<void*, uint32_t>		m_materialIDs;		///<Dense IDs of materials in this queue
+		std::unordered_map<void*, uint32_t>		m_meshIDs;			///<Dense IDs of meshes in this queue
+
+		uint32_t getID(std::unordered_map<void*, uint32_t> &ids, void *ptr, uint32_t bits);	//get a dense ID for a pointer
+
+	public:
+		///Constructor
+		VERenderQueue() {};
+		///Destructor
+		~VERenderQueue() {};
+
+		void		clear();											//remove all draw items
+		void		addDrawItem(uint32_t pass, VESubrender *pSubrender, VEEntity *pEntity, VECamera *pCamera,
+								uint32_t cullGroup = VE_CULL_NO_GROUP);	//add an entity or a culled group to the queue
+		void		sort();												//sort the draw items by their keys
+		void		draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+							VECamera *pCamera, VELight *pLight,
+							vh::vhSpan<VkDescriptorSet> descriptorSetsShadow);	//record all draw items
+
+		static uint64_t makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t layer, uint32_t material, uint32_t mesh, uint32_t depth);	//pack a sort key
+		static float	getDepth(VEEntity *pEntity, VECamera *pCamera);		//distance of an entity to a camera, relative to the far plane
+
+		///\returns the number of draw items in the queue
+		uint32_t	getNumberDrawItems() { return (uint32_t)m_drawItems.size(); };
+		///\returns the sorted draw items
+		std::vector<veDrawItem> & getDrawItems() { return m_drawItems; };
+	};
+
+}
+
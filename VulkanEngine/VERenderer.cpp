@@ -30,6 +30,42 @@ namespace ve {
 	*/
 	void VERenderer::addSubrenderer(VESubrender *pSub) {
 		pSub->initSubrenderer();
+		registerSubrenderer(pSub);
+	}
+
+	/**
+	*
+	* \brief Initialize several subrenderers in parallel and register them
+	*
+	* Initializing a subrenderer mostly means compiling its pipelines, so subrenderers are initialized on the thread pool.
+	* Subrenderers that need the main thread are initialized on the calling thread meanwhile. Afterwards all are
+	* registered in the given order, so the draw order is the same as when calling addSubrenderer() one by one.
+	*
+	* \param[in] subrenderers The new subrenderers
+	*
+	*/
+	void VERenderer::addSubrenderers(std::vector<VESubrender*> subrenderers) {
+		std::vector<std::future<void>> futures;
+		for (auto pSub : subrenderers) {
+			if (!pSub->needsMainThread())
+				futures.push_back(getEnginePointer()->m_threadPool->submit([pSub]() { pSub->initSubrenderer(); }));
+		}
+		for (auto pSub : subrenderers) {
+			if (pSub->needsMainThread()) pSub->initSubrenderer();
+		}
+		for (auto &future : futures) future.get();
+
+		for (auto pSub : subrenderers) registerSubrenderer(pSub);
+	}
+
+	/**
+	*
+	* \brief Register an initialized subrenderer
+	*
+	* \param[in] pSub Pointer to the subrenderer
+	*
+	*/
+	void VERenderer::registerSubrenderer(VESubrender *pSub) {
 		if (pSub->getClass() == VESubrender::VE_SUBRENDERER_CLASS_SHADOW) {
 			m_subrenderShadow = pSub;
 			return;
@@ -112,6 +148,10 @@ namespace ve {
 			type = VESubrender::VE_SUBRENDERER_TYPE_SKYPLANE;
 			break;
 		case VEEntity::VE_ENTITY_TYPE_TERRAIN_HEIGHTMAP:
+			type = VESubrender::VE_SUBRENDERER_TYPE_TERRAIN_WITH_HEIGHTMAP;
+			break;
+		case VEEntity::VE_ENTITY_TYPE_IMPOSTOR:
+			type = VESubrender::VE_SUBRENDERER_TYPE_IMPOSTOR;
 			break;
 		default: return;
 		}
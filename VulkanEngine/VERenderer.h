@@ -63,6 +63,8 @@ namespace ve {
 		///Base class does not create subrennderers directly
 		virtual void createSubrenderers() {};
 		virtual void addSubrenderer( VESubrender *pSub);
+		virtual void addSubrenderers( std::vector<VESubrender*> subrenderers );
+		virtual void registerSubrenderer( VESubrender *pSub);
 		virtual VESubrender * getSubrenderer( VESubrender::veSubrenderType );
 		virtual void destroySubrenderers();
 		///Draw one frame
@@ -10,7 +10,6 @@
 
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
-const uint32_t SHADOW_MAP_DIM = 4096;
 
 
 namespace ve {
@@ -46,6 +45,9 @@ namespace ve {
 
 		vh::vhMemCreateVMAAllocator(m_physicalDevice, m_device, m_vmaAllocator);
 
+		VECHECKRESULT(vh::vhPipeCreatePipelineCache(m_physicalDevice, m_device, VE_PIPELINE_CACHE_FILE, &m_pipelineCache),
+					"Error: Could not create pipeline cache");
+
 		vh::vhSwapCreateSwapChain(	m_physicalDevice, m_surface, m_device, getWindowPointer()->getExtent(),
 									&m_swapChain, m_swapChainImages, m_swapChainImageViews,
 									&m_swapChainImageFormat, &m_swapChainExtent);
@@ -85,34 +87,11 @@ namespace ve {
 		//shadow render pass
 		vh::vhRenderCreateRenderPassShadow( m_device, m_depthMap->m_format, &m_renderPassShadow);
 
-		//shadow maps
-		m_shadowMaps.resize(m_swapChainImageViews.size());
-		m_shadowFramebuffers.resize(m_swapChainImageViews.size());
-		for (uint32_t i = 0; i < m_swapChainImageViews.size(); i++) {
-			for (uint32_t j = 0; j < NUM_SHADOW_CASCADE; j++) {						//point light has 6 shadow maps, thats the max
-				VkExtent2D extent = { SHADOW_MAP_DIM, SHADOW_MAP_DIM };
-
-				VETexture *pShadowMap = new VETexture("ShadowMap");
-				pShadowMap->m_extent = extent;
-				pShadowMap->m_format = m_depthMap->m_format;
-
-				//create the depth images
-				vh::vhBufCreateDepthResources(m_device, m_vmaAllocator, m_graphicsQueue, m_commandPool,
-					extent, pShadowMap->m_format,
-					&pShadowMap->m_image, &pShadowMap->m_deviceAllocation, &pShadowMap->m_imageView);
-
-				vh::vhBufCreateTextureSampler(getRendererPointer()->getDevice(), &pShadowMap->m_sampler);
-
-				m_shadowMaps[i].push_back(pShadowMap);
-
-				//create the framebuffers holding only the depth images for the shadow maps
-				std::vector<VkFramebuffer> frameBuffers;
-				vh::vhBufCreateFramebuffers(m_device, { VK_NULL_HANDLE }, { pShadowMap->m_imageView },
-											m_renderPassShadow, extent, frameBuffers);
-
-				m_shadowFramebuffers[i].push_back(frameBuffers[0]);
-			}
-		}
+		//shadow maps and their framebuffers are transient images of the render graphs, created when recording
+		m_renderGraphs.resize(m_swapChainImages.size());
+		m_shadowMaps.resize(m_swapChainImages.size());
+		m_shadowFramebuffers.resize(m_swapChainImages.size());
+		createDummyShadowMap();
 
 		//------------------------------------------------------------------------------------------------------------
 		//create descriptor pool, layout and sets
@@ -143,32 +122,19 @@ namespace ve {
 												{ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT , },
 												&m_descriptorSetLayoutPerObject);
 
+		//set 4 or 5, binding 0 : objects, binding 1 : visible slots, the GPU culling buffers read by culled permutations
+		vh::vhRenderCreateDescriptorSetLayout(m_device,
+											{ 1, 1 },
+											{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+											{ VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_VERTEX_BIT },
+											&m_descriptorSetLayoutCulling);
 
 
 		//vh::vhRenderCreateDescriptorSets(m_device, (uint32_t)m_swapChainImages.size(),	m_descriptorSetLayoutPerFrame, getDescriptorPool(), m_descriptorSetsPerFrame);
 
 		vh::vhRenderCreateDescriptorSets(m_device, (uint32_t)m_swapChainImages.size(), m_descriptorSetLayoutShadow,   getDescriptorPool(), m_descriptorSetsShadow);
 
-		//update the descriptor set for light pass - array of shadow maps
-		for (uint32_t i = 0; i < m_swapChainImageViews.size(); i++) {
-
-			std::vector<std::vector<VkImageView>>	imageViews;
-			std::vector<std::vector<VkSampler>>		samplers;
-			imageViews.resize(1);
-			samplers.resize(1);
-			
-			for (uint32_t j = 0; j < NUM_SHADOW_CASCADE; j++) {
-				imageViews[0].push_back(m_shadowMaps[i][j]->m_imageView);
-				samplers[0].push_back(m_shadowMaps[i][j]->m_sampler);
-			}
-
-			vh::vhRenderUpdateDescriptorSet(m_device, m_descriptorSetsShadow[i],
-											{ VK_NULL_HANDLE },		//UBOs
-											{ 0 },					//UBO sizes
-											{ imageViews },			//textureImageViews
-											{ samplers }			//samplers
-			);
-		}
+		m_descriptorSetsShadowValid.resize(m_swapChainImages.size(), false);	//written after the render graph has been compiled
 
 
 		//------------------------------------------------------------------------------------------------------------
@@ -182,14 +148,20 @@ namespace ve {
 	* \brief Create and register all known subrenderers for this VERenderer
 	*/
 	void VERendererForward::createSubrenderers() {
-		addSubrenderer(new VESubrenderFW_C1());
-		addSubrenderer(new VESubrenderFW_D());
-		addSubrenderer(new VESubrenderFW_DN());
-		addSubrenderer(new VESubrenderFW_Cubemap());
-		addSubrenderer(new VESubrenderFW_Cubemap2());
-		addSubrenderer(new VESubrenderFW_Skyplane());
-		addSubrenderer( new VESubrenderFW_Shadow());
-		addSubrenderer(new VESubrenderFW_Nuklear());
+		std::chrono::high_resolution_clock::time_point t_start = vh::vhTimeNow();
+		addSubrenderers({	new VESubrenderFW_C1(),
+							new VESubrenderFW_D(),
+							new VESubrenderFW_DN(),
+							new VESubrenderFW_Cubemap(),
+							new VESubrenderFW_Cubemap2(),
+							new VESubrenderFW_Skyplane(),
+							new VESubrenderFW_Terrain(),
+							new VESubrenderFW_Impostor(),
+							new VESubrenderFW_Shadow(),
+							new VESubrenderFW_Nuklear() });
+		getEnginePointer()->addStartupPhase("subrenderers", vh::vhTimeDuration(t_start) * 1000.0);
+
+		for (auto pSub : m_subrenderers) pSub->warmPermutations();		//remaining shader permutations in the background
 	}
 
 
@@ -223,26 +195,25 @@ namespace ve {
 
 		deleteCmdBuffers();
 
-		cleanupSwapChain();
+		enableGPUCulling(false);
 
-		for (auto framebufferList : m_shadowFramebuffers) {
-			for (auto fb : framebufferList) {
-				vkDestroyFramebuffer(m_device, fb, nullptr);
-			}
-		}
+		cleanupSwapChain();
 
 		//destroy shadow maps
-		for (auto pShadowMapList : m_shadowMaps) {
-			for (auto pS : pShadowMapList) {
-				delete pS;
-			}
+		for (uint32_t i = 0; i < m_renderGraphs.size(); i++) {
+			destroyShadowFramebuffers(i);
+			m_renderGraphs[i].destroyPhysicalImages();
 		}
+		m_shadowMaps.clear();
+		delete m_dummyShadowMap;
+
 		vkDestroyRenderPass(m_device, m_renderPassShadow, nullptr);
 
 		//destroy per frame resources
 		vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayoutPerObject, nullptr);
 		vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayoutShadow, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayoutCulling, nullptr);
 
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
@@ -252,6 +223,11 @@ namespace ve {
 
 		vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 
+		if (vh::vhPipeSavePipelineCache(m_device, m_pipelineCache, VE_PIPELINE_CACHE_FILE) != VK_SUCCESS) {
+			VHLOGWARNING("Could not write pipeline cache %s", VE_PIPELINE_CACHE_FILE);
+		}
+		vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+
 		vmaDestroyAllocator(m_vmaAllocator);
 
 		vkDestroyDevice(m_device, nullptr);
@@ -286,6 +262,7 @@ namespace ve {
 		vh::vhBufCreateFramebuffers(m_device, m_swapChainImageViews, depthMaps, m_renderPassClear, m_swapChainExtent, m_swapChainFramebuffers);
 
 		for (auto pSub : m_subrenderers) pSub->recreateResources();
+		for (auto pSub : m_subrenderers) pSub->warmPermutations();
 
 		deleteCmdBuffers();
 	}
@@ -333,36 +310,252 @@ namespace ve {
 
 
 	/**
-	* \brief Create a new command buffer and record the whole scene into it, then end it
+	*
+	* \brief Check whether an entity can be drawn by GPU culling
+	*
+	* \param[in] pEntity Pointer to the entity
+	* \returns true if the entity is drawn by an object subrenderer with culled shader permutations
+	*
 	*/
-	void VERendererForward::recordCmdBuffers() {
-		VECamera *pCamera = getSceneManagerPointer()->getCamera();
-		pCamera->setExtent(getWindowPointer()->getExtent());
+	bool VERendererForward::isCulledEntity(VEEntity *pEntity) {
+		return	pEntity->m_pSubrenderer != nullptr &&
+				pEntity->m_pSubrenderer->getClass() == VESubrender::VE_SUBRENDERER_CLASS_OBJECT &&
+				(pEntity->m_pSubrenderer->getFeatureMask() & VESubrender::VE_SHADER_FEATURE_GPU_CULLING) != 0 &&
+				pEntity->getEntityType() == VEEntity::VE_ENTITY_TYPE_NORMAL;		//terrains and impostors select their own draws
+	}
 
-		vh::vhCmdCreateCommandBuffers(	m_device, m_commandPool,
-										VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-										1, &m_commandBuffers[imageIndex]);
 
-		vh::vhCmdBeginCommandBuffer(m_device, m_commandBuffers[imageIndex], VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+	/**
+	*
+	* \brief Add a new entity to a subrenderer
+	*
+	* If GPU culling is enabled, entities of object subrenderers also get a slot in the culling buffers.
+	* Since recorded command buffers push the ranges of the culling groups, they must be recorded again.
+	*
+	* \param[in] pEntity Pointer to the entity to be added
+	*
+	*/
+	void VERendererForward::addEntityToSubrenderer(VEEntity *pEntity) {
+		VERenderer::addEntityToSubrenderer(pEntity);
+
+		if (m_pGPUCulling != nullptr && isCulledEntity(pEntity)) {
+			m_pGPUCulling->addEntity(pEntity);
+			deleteCmdBuffers();
+		}
+	}
+
+
+	/**
+	*
+	* \brief Remove an entity from all subrenderers and from GPU culling
+	*
+	* Since recorded command buffers push the ranges of the culling groups, they must be recorded again.
+	*
+	* \param[in] pEntity Pointer to the entity to be removed
+	*
+	*/
+	void VERendererForward::removeEntityFromSubrenderers(VEEntity *pEntity) {
+		VERenderer::removeEntityFromSubrenderers(pEntity);
+
+		if (m_pGPUCulling != nullptr && pEntity->m_cullSlot != VE_CULL_NO_SLOT) {
+			m_pGPUCulling->removeEntity(pEntity);
+			deleteCmdBuffers();
+		}
+	}
+
+
+	/**
+	*
+	* \brief Turn the GPU culling stage on or off
+	*
+	* When enabled, a compute pass tests the bounding spheres of all object entities against the camera and all
+	* shadow cameras, and each group of entities sharing mesh and material is drawn with one instanced indirect draw.
+	* Recorded command buffers then stay valid when entities move in or out of view. All command buffers are recorded again.
+	*
+	* \param[in] enable If true, create the culling stage, otherwise destroy it
+	*
+	*/
+	void VERendererForward::enableGPUCulling(bool enable) {
+		if (enable == (m_pGPUCulling != nullptr)) return;
+
+		vkDeviceWaitIdle(m_device);
+		deleteCmdBuffers();
+
+		if (!enable) {
+			m_pGPUCulling->closeCulling();
+			delete m_pGPUCulling;
+			m_pGPUCulling = nullptr;
+			return;
+		}
+
+		m_pGPUCulling = new VEGPUCulling();
+		m_pGPUCulling->initCulling();
+
+		for (auto node : getSceneManagerPointer()->m_sceneNodes) {
+			if (node.second->getNodeType() != VESceneNode::VE_OBJECT_TYPE_ENTITY) continue;
+
+			VEEntity *pEntity = (VEEntity*)node.second;
+			if (isCulledEntity(pEntity)) m_pGPUCulling->addEntity(pEntity);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Get the framebuffer for rendering into a shadow map
+	*
+	* Shadow maps are transient images of the render graph of the current swap chain image. Framebuffers are
+	* created when a shadow map image view is used for the first time, and kept until that render graph creates
+	* new images.
+	*
+	* \param[in] imageView The image view of the shadow map
+	* \returns the framebuffer holding only the shadow map as depth attachment
+	*
+	*/
+	VkFramebuffer VERendererForward::getShadowFramebuffer(VkImageView imageView) {
+		auto it = m_shadowFramebuffers[imageIndex].find(imageView);
+		if (it != m_shadowFramebuffers[imageIndex].end()) return it->second;
+
+		std::vector<VkFramebuffer> frameBuffers;
+		vh::vhBufCreateFramebuffers(m_device, { VK_NULL_HANDLE }, { imageView },
+									m_renderPassShadow, getShadowMapExtent(), frameBuffers);
+
+		m_shadowFramebuffers[imageIndex][imageView] = frameBuffers[0];
+		return frameBuffers[0];
+	}
+
+
+	/**
+	*
+	* \brief Destroy the framebuffers of the shadow maps of a swap chain image
+	*
+	* \param[in] idx Index of the swap chain image
+	*
+	*/
+	void VERendererForward::destroyShadowFramebuffers(uint32_t idx) {
+		for (auto fb : m_shadowFramebuffers[idx]) {
+			vkDestroyFramebuffer(m_device, fb.second, nullptr);
+		}
+		m_shadowFramebuffers[idx].clear();
+	}
+
+
+	/**
+	*
+	* \brief Create the shadow map that is bound if there are no shadow cameras
+	*
+	* The shadow descriptor set of each swap chain image is always written, so the light pass never samples
+	* from a stale image. The dummy map is cleared to the far plane, so nothing is in shadow.
+	*
+	*/
+	void VERendererForward::createDummyShadowMap() {
+		m_dummyShadowMap = new VETexture("DummyShadowMap");
+		m_dummyShadowMap->m_format = m_depthMap->m_format;
+		m_dummyShadowMap->m_extent = { 1, 1 };
+
+		VECHECKRESULT(vh::vhBufCreateImage(	m_vmaAllocator, 1, 1, 1, 1, m_dummyShadowMap->m_format, VK_IMAGE_TILING_OPTIMAL,
+											VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0,
+											&m_dummyShadowMap->m_image, &m_dummyShadowMap->m_deviceAllocation),
+					"Could not create dummy shadow map");
+
+		VECHECKRESULT(vh::vhBufCreateImageView(	m_device, m_dummyShadowMap->m_image, m_dummyShadowMap->m_format,
+												VK_IMAGE_VIEW_TYPE_2D, 1, VK_IMAGE_ASPECT_DEPTH_BIT, &m_dummyShadowMap->m_imageView),
+					"Could not create dummy shadow map view");
+
+		VECHECKRESULT(vh::vhBufCreateTextureSampler(m_device, &m_dummyShadowMap->m_sampler), "Could not create dummy shadow map sampler");
+
+		VkCommandBuffer commandBuffer = vh::vhCmdBeginSingleTimeCommands(m_device, m_commandPool);
+
+		VECHECKRESULT(vh::vhBufTransitionImageLayout(	m_device, m_graphicsQueue, commandBuffer, m_dummyShadowMap->m_image,
+														m_dummyShadowMap->m_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1, 1,
+														VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+					"Could not transition dummy shadow map");
+
+		VkClearDepthStencilValue clearValue = { 1.0f, 0 };
+		VkImageSubresourceRange range = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		vkCmdClearDepthStencilImage(commandBuffer, m_dummyShadowMap->m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &range);
+
+		VECHECKRESULT(vh::vhBufTransitionImageLayout(	m_device, m_graphicsQueue, commandBuffer, m_dummyShadowMap->m_image,
+														m_dummyShadowMap->m_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1, 1,
+														VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+					"Could not transition dummy shadow map");
+
+		VECHECKRESULT(vh::vhCmdEndSingleTimeCommands(m_device, m_graphicsQueue, m_commandPool, commandBuffer),
+					"Could not clear dummy shadow map");
+	}
+
+
+	/**
+	*
+	* \brief Add the passes of the current frame to the render graph
+	*
+	* For each light, there is one shadow pass for each shadow camera, writing into a transient shadow map,
+	* followed by a light pass that reads the shadow maps and blends the lit scene onto the swap chain image.
+	* Since the shadow maps of one light are not used any more when the next light starts, the render graph
+	* lets all lights use the same physical shadow maps. Each swap chain image has its own render graph, so frames
+	* in flight never render into the shadow maps another frame is still reading.
+	* If GPU culling is enabled, a culling pass comes first, and the shadow and light passes draw indirectly.
+	*
+	* \param[in] pCamera Pointer to the current camera
+	*
+	*/
+	void VERendererForward::buildRenderGraph(VECamera *pCamera) {
+		VERenderGraph *pGraph = &m_renderGraphs[imageIndex];
+		pGraph->clear();
 
 		//-----------------------------------------------------------------------------------------
 		//set clear values for shadow and light passes
 
-		std::vector<VkClearValue> clearValuesShadow = {};	//shadow map should be cleared every time
-		VkClearValue cv;
-		cv.depthStencil = { 1.0f, 0 };
-		clearValuesShadow.push_back(cv);
+		VkClearValue clearValuesShadow[1];					//shadow map should be cleared every time
+		clearValuesShadow[0].depthStencil = { 1.0f, 0 };
 
-		std::vector<VkClearValue> clearValuesLight = {};	//render target and depth buffer should be cleared only first time
-		VkClearValue cv1, cv2;
-		cv1.color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValuesLight.push_back(cv1);
-		cv2.depthStencil = { 1.0f, 0 };
-		clearValuesLight.push_back(cv2);
+		VkClearValue clearValuesLight[2];					//render target and depth buffer should be cleared only first time
+		clearValuesLight[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+		clearValuesLight[1].depthStencil = { 1.0f, 0 };
 
-		//go through all active lights in the scene
+		//-----------------------------------------------------------------------------------------
+		//images
+
+		VERenderGraph::veImageDesc colorDesc;
+		colorDesc.m_format = m_swapChainImageFormat;
+		colorDesc.m_extent = m_swapChainExtent;
+		colorDesc.m_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		colorDesc.m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		uint32_t colorImage = pGraph->importImage("SwapChainImage", m_swapChainImages[imageIndex], m_swapChainImageViews[imageIndex],
+														colorDesc, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0);
+
+		VERenderGraph::veImageDesc depthDesc;
+		depthDesc.m_format = m_depthMap->m_format;
+		depthDesc.m_extent = m_swapChainExtent;
+		depthDesc.m_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		depthDesc.m_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		uint32_t depthImage = pGraph->importImage("DepthMap", m_depthMap->m_image, m_depthMap->m_imageView, depthDesc,
+														VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+														VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+														VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+		VERenderGraph::veImageDesc shadowDesc;
+		shadowDesc.m_format = m_depthMap->m_format;
+		shadowDesc.m_extent = getShadowMapExtent();
+		shadowDesc.m_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		shadowDesc.m_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		VkAccessFlags depthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		//-----------------------------------------------------------------------------------------
+		//GPU culling pass, writes the indirect draws of all following passes
 
-		std::chrono::high_resolution_clock::time_point t_now;
+		if (m_pGPUCulling != nullptr) {
+			pGraph->addPass("Cull",
+				[=](VkCommandBuffer commandBuffer) {
+					m_pGPUCulling->recordCulling(commandBuffer, imageIndex);
+				}, true);
+		}
+
+		uint32_t numShadowCameras = 0;
+
+		//go through all active lights in the scene
 
 		for (uint32_t i = 0; i < getSceneManagerPointer()->getLights().size(); i++) {
 
@@ -371,48 +564,147 @@ namespace ve {
 			//-----------------------------------------------------------------------------------------
 			//shadow passes
 
-			t_now = vh::vhTimeNow();
-			{
-				for (unsigned i = 0; i < pLight->m_shadowCameras.size(); i++) {
+			vh::vhSpan<uint32_t> shadowMaps = getEnginePointer()->getFrameArena().allocate<uint32_t>(pLight->m_shadowCameras.size());
+			for (uint32_t j = 0; j < pLight->m_shadowCameras.size(); j++) {
+				uint32_t shadowMap = pGraph->createImage("ShadowMap" + std::to_string(i) + "_" + std::to_string(j), shadowDesc);
+				shadowMaps[j] = shadowMap;
+
+				uint32_t cullView = VEGPUCulling::getShadowView(numShadowCameras++);
+
+				uint32_t pass = pGraph->addPass("Shadow" + std::to_string(i) + "_" + std::to_string(j),
+					[=](VkCommandBuffer commandBuffer) {
+						std::chrono::high_resolution_clock::time_point t_now = vh::vhTimeNow();
+						vh::vhRenderBeginRenderPass(commandBuffer,
+							m_renderPassShadow,
+							getShadowFramebuffer(pGraph->getImageView(shadowMap)),
+							clearValuesShadow,
+							getShadowMapExtent());
+
+						if (m_pGPUCulling != nullptr) m_pGPUCulling->beginView(cullView);
+
+						m_renderQueue.clear();
+						m_subrenderShadow->addToRenderQueue(m_renderQueue, j, pLight->m_shadowCameras[j]);
+						m_renderQueue.sort();
 
-					vh::vhRenderBeginRenderPass(m_commandBuffers[imageIndex],
-						m_renderPassShadow,
-						m_shadowFramebuffers[imageIndex][i],
-						clearValuesShadow,
-						m_shadowMaps[0][i]->m_extent);	//all shadow maps have the same extent
+						m_renderQueue.draw(commandBuffer, imageIndex, j, pLight->m_shadowCameras[j], pLight, vh::vhSpan<VkDescriptorSet>());
 
-					m_subrenderShadow->draw(m_commandBuffers[imageIndex], imageIndex, i, pLight->m_shadowCameras[i], pLight, {});
+						if (m_pGPUCulling != nullptr) m_pGPUCulling->beginView(VE_CULL_NO_VIEW);
 
-					vkCmdEndRenderPass(m_commandBuffers[imageIndex]);
-				}
+						vkCmdEndRenderPass(commandBuffer);
+						m_AvgCmdShadowTime = vh::vhAverage(vh::vhTimeDuration(t_now), m_AvgCmdShadowTime);
+					});
+
+				pGraph->useImage(pass, {	shadowMap, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+												VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,				//final layout of the shadow render pass
+												depthStages, depthAccess, true });
 			}
-			m_AvgCmdShadowTime = vh::vhAverage( vh::vhTimeDuration(t_now), m_AvgCmdShadowTime );
 
 			//-----------------------------------------------------------------------------------------
 			//light pass
 
-			t_now = vh::vhTimeNow();
-			{
-				vh::vhRenderBeginRenderPass(m_commandBuffers[imageIndex],
-					i == 0 ? m_renderPassClear : m_renderPassLoad,
-					m_swapChainFramebuffers[imageIndex],
-					clearValuesLight,
-					m_swapChainExtent);
-
-				for (auto pSub : m_subrenderers) {
-					if (i == 0 || pSub->getClass() == VESubrender::VE_SUBRENDERER_CLASS_OBJECT) {
-						pSub->prepareDraw();
-						pSub->draw(m_commandBuffers[imageIndex], imageIndex, i, pCamera, pLight, m_descriptorSetsShadow);
+			uint32_t pass = pGraph->addPass("Light" + std::to_string(i),
+				[=](VkCommandBuffer commandBuffer) {
+					std::chrono::high_resolution_clock::time_point t_now = vh::vhTimeNow();
+					vh::vhSpan<const VkClearValue> clearValues(clearValuesLight, i == 0 ? 2 : 0);	//since we blend the images onto each other, do not clear them for passes 2 and further
+
+					vh::vhRenderBeginRenderPass(commandBuffer,
+						i == 0 ? m_renderPassClear : m_renderPassLoad,
+						m_swapChainFramebuffers[imageIndex],
+						clearValues,
+						m_swapChainExtent);
+
+					if (m_pGPUCulling != nullptr) m_pGPUCulling->beginView(0);
+
+					m_renderQueue.clear();
+					for (auto pSub : m_subrenderers) {
+						if (i == 0 || pSub->getClass() == VESubrender::VE_SUBRENDERER_CLASS_OBJECT) {
+							pSub->prepareDraw();
+							pSub->addToRenderQueue(m_renderQueue, i, pCamera);
+						}
 					}
-				}
+					m_renderQueue.sort();		//group by pipeline, material and mesh, then front to back
+
+					m_renderQueue.draw(commandBuffer, imageIndex, i, pCamera, pLight, m_descriptorSetsShadow);
+
+					if (m_pGPUCulling != nullptr) m_pGPUCulling->beginView(VE_CULL_NO_VIEW);
+
+					vkCmdEndRenderPass(commandBuffer);
+					m_AvgCmdLightTime = vh::vhAverage(vh::vhTimeDuration(t_now), m_AvgCmdLightTime);
+				});
+
+			for (auto shadowMap : shadowMaps) {
+				pGraph->useImage(pass, {	shadowMap, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+												VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false });
+			}
+			pGraph->useImage(pass, {	colorImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+											VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+											VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, i == 0 });
+			pGraph->useImage(pass, {	depthImage, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+											depthStages, depthAccess, i == 0 });
+
+			//remember which shadow maps the light pass samples from, cascade j always maps to the same physical image
+
+			for (uint32_t j = 0; j < shadowMaps.size(); j++) {
+				if (j >= m_shadowMapResources.size()) m_shadowMapResources.push_back(shadowMaps[j]);
+			}
+		}
+	}
+
+
+	/**
+	* \brief Create a new command buffer and record the whole scene into it, then end it
+	*/
+	void VERendererForward::recordCmdBuffers() {
+		VECamera *pCamera = getSceneManagerPointer()->getCamera();
+		pCamera->setExtent(getWindowPointer()->getExtent());
+
+		m_shadowMapResources.clear();
+		buildRenderGraph(pCamera);
+
+		if (m_renderGraphs[imageIndex].compile()) {	//new physical images: framebuffers and shadow descriptor set of this image are invalid
+			destroyShadowFramebuffers(imageIndex);
+			m_descriptorSetsShadowValid[imageIndex] = false;
+		}
+
+		std::vector<VETexture *> shadowMaps;
+		for (auto shadowMap : m_shadowMapResources) shadowMaps.push_back(m_renderGraphs[imageIndex].getTexture(shadowMap));
+		if (shadowMaps != m_shadowMaps[imageIndex]) {
+			m_shadowMaps[imageIndex] = shadowMaps;
+			m_descriptorSetsShadowValid[imageIndex] = false;	//e.g. the first shadow camera has been added
+		}
+
+		//update the descriptor set for light pass - array of shadow maps, the dummy map if there are none
+
+		if (!m_descriptorSetsShadowValid[imageIndex]) {
+			std::vector<std::vector<VkImageView>>	imageViews;
+			std::vector<std::vector<VkSampler>>		samplers;
+			imageViews.resize(1);
+			samplers.resize(1);
 
-				vkCmdEndRenderPass(m_commandBuffers[imageIndex]);
+			for (uint32_t j = 0; j < NUM_SHADOW_CASCADE; j++) {
+				VETexture *pShadowMap = m_dummyShadowMap;
+				if (shadowMaps.size() > 0) pShadowMap = j < shadowMaps.size() ? shadowMaps[j] : shadowMaps[0];	//unused cascades
+				imageViews[0].push_back(pShadowMap->m_imageView);
+				samplers[0].push_back(pShadowMap->m_sampler);
 			}
-			m_AvgCmdLightTime = vh::vhAverage( vh::vhTimeDuration(t_now), m_AvgCmdLightTime );
 
-			clearValuesLight.clear();		//since we blend the images onto each other, do not clear them for passes 2 and further
+			vh::vhRenderUpdateDescriptorSet(m_device, m_descriptorSetsShadow[imageIndex],
+											{ VK_NULL_HANDLE },		//UBOs
+											{ 0 },					//UBO sizes
+											{ imageViews },			//textureImageViews
+											{ samplers }			//samplers
+			);
+			m_descriptorSetsShadowValid[imageIndex] = true;
 		}
 
+		vh::vhCmdCreateCommandBuffers(	m_device, m_commandPool,
+										VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+										1, &m_commandBuffers[imageIndex]);
+
+		vh::vhCmdBeginCommandBuffer(m_device, m_commandBuffers[imageIndex], VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+
+		m_renderGraphs[imageIndex].execute(m_commandBuffers[imageIndex]);
+
 		vkEndCommandBuffer(m_commandBuffers[imageIndex]);
 
 		m_overlaySemaphores[m_currentFrame] = m_renderFinishedSemaphores[m_currentFrame];
@@ -430,6 +722,13 @@ namespace ve {
 	void VERendererForward::drawFrame() {
 		vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
 
+		if (m_pGPUCulling != nullptr) {
+			bool viewsChanged = m_pGPUCulling->updateViews(imageIndex);		//same image index as used by updateSceneNodes()
+			if (m_pGPUCulling->updateECSEntities(imageIndex) || viewsChanged) {
+				deleteCmdBuffers();							//view count or group ranges of ECS entities have changed
+			}
+		}
+
 		//acquire the next image
 		VkResult result = vkAcquireNextImageKHR(m_device, m_swapChain, std::numeric_limits<uint64_t>::max(),
 												m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -12,6 +12,8 @@
 #endif
 
 const uint32_t NUM_SHADOW_CASCADE = 6;
+const uint32_t SHADOW_MAP_DIM = 4096;
+const std::string VE_PIPELINE_CACHE_FILE = "pipelinecache.bin";	///<Pipeline cache of the last run, shader permutations are created faster
 
 namespace ve {
 
@@ -38,22 +40,30 @@ namespace ve {
 
 		std::vector<VkFramebuffer>	m_swapChainFramebuffers;			///<Framebuffers for light pass
 		VETexture *					m_depthMap = nullptr;				///<the image depth map	
-		std::vector<std::vector<VETexture *>>	m_shadowMaps;			///<the shadow maps - a list of map cascades
+		std::vector<std::vector<VETexture *>>	m_shadowMaps;			///<the shadow map cascades of each swap chain image, owned by the render graphs
+		std::vector<uint32_t>		m_shadowMapResources;				///<render graph images of the shadow map cascades
+		VETexture *					m_dummyShadowMap = nullptr;			///<cleared 1x1 shadow map, bound if there are no shadow cameras
 
 		//per frame render resources for the shadow pass
 		VkRenderPass				 m_renderPassShadow;				///<The shadow render pass 
-		std::vector<std::vector<VkFramebuffer>>	 m_shadowFramebuffers;	///<list of Framebuffers for shadow pass (up to 6)
+		std::vector<std::map<VkImageView, VkFramebuffer>> m_shadowFramebuffers;	///<Framebuffers for shadow pass, per swap chain image one for each shadow map image view
 		VkDescriptorSetLayout		 m_descriptorSetLayoutShadow;		///<Descriptor set layout for using shadow maps in the light pass
 		std::vector<VkDescriptorSet> m_descriptorSetsShadow;			///<Descriptor sets for usage of shadow maps in the light pass
+		std::vector<bool>			 m_descriptorSetsShadowValid;		///<true if the descriptor set refers to the current shadow maps
 
 		VkDescriptorPool			m_descriptorPool;					///<Descriptor pool for creating descriptor sets
 		VkDescriptorSetLayout		m_descriptorSetLayoutPerObject;		///<Descriptor set layout for each scene object
+		VkDescriptorSetLayout		m_descriptorSetLayoutCulling;		///<Descriptor set layout of the culled instances, see VEGPUCulling
 
 		std::vector<VkSemaphore>	m_imageAvailableSemaphores;			///<sem for waiting for the next swapchain image
 		std::vector<VkSemaphore>	m_renderFinishedSemaphores;			///<sem for signalling that rendering done
 		std::vector<VkSemaphore>	m_overlaySemaphores;				///<sem for signalling that rendering done
 		std::vector<VkFence>		m_inFlightFences;					///<fences for halting the next image render until this one is done
 		size_t						m_currentFrame = 0;					///<int for the fences
+		VERenderQueue				m_renderQueue;						///<sorts draws of a pass to minimize state changes
+		std::vector<VERenderGraph>	m_renderGraphs;						///<schedule and synchronize the shadow and light passes, one per swap chain image
+		VEGPUCulling *				m_pGPUCulling = nullptr;			///<optional compute stage culling entities on the GPU
+		VkPipelineCache				m_pipelineCache = VK_NULL_HANDLE;	///<shared by all pipelines and shader permutations
 		bool						m_framebufferResized = false;		///<signal that window size is changing
 
 		void createSyncObjects();					//create the sync objects
@@ -62,6 +72,10 @@ namespace ve {
 		virtual void initRenderer();				//init the renderer
 		virtual void createSubrenderers();			//create the subrenderers
 		virtual void recordCmdBuffers();			//record the command buffers
+		virtual void buildRenderGraph(VECamera *pCamera);	//add shadow and light passes to the render graph
+		VkFramebuffer getShadowFramebuffer(VkImageView imageView);	//framebuffer for rendering into a shadow map
+		void destroyShadowFramebuffers(uint32_t idx);	//destroy the shadow map framebuffers of a swap chain image
+		void createDummyShadowMap();				//create the shadow map bound if there are no shadow cameras
 		virtual void drawFrame();					//draw one frame
 		virtual void prepareOverlay();				//prepare to draw the overlay
 		virtual void drawOverlay();					//Draw the overlay (GUI)
@@ -78,12 +92,18 @@ namespace ve {
 		///Destructor of class VERendererForward
 		virtual ~VERendererForward() {};
 		virtual void deleteCmdBuffers();
+		bool isCulledEntity(VEEntity *pEntity);							//can the entity be drawn by GPU culling
+		virtual void addEntityToSubrenderer(VEEntity *pEntity);			//add an entity to a subrenderer and to GPU culling
+		virtual void removeEntityFromSubrenderers(VEEntity *pEntity);	//remove an entity from subrenderers and GPU culling
+		void enableGPUCulling(bool enable);								//turn the GPU culling stage on or off
 		///\returns the per frame descriptor set layout
 		virtual VkDescriptorSetLayout	getDescriptorSetLayoutPerObject() { return m_descriptorSetLayoutPerObject; };
 		///\returns the shadow descriptor set layout for the shadow
 		virtual VkDescriptorSetLayout	getDescriptorSetLayoutShadow() { return m_descriptorSetLayoutShadow; };
 		///\returns the per frame descriptor set
 		virtual std::vector<VkDescriptorSet> &getDescriptorSetsShadow() { return m_descriptorSetsShadow; };
+		///\returns the descriptor set layout of the culled instances
+		VkDescriptorSetLayout			getDescriptorSetLayoutCulling() { return m_descriptorSetLayoutCulling; };
 		///\returns pointer to the swap chain framebuffer vector
 		virtual std::vector<VkFramebuffer> &getSwapChainFrameBuffers() { return m_swapChainFramebuffers;  };
 		///\returns the descriptor pool of the per frame descriptors
@@ -94,10 +114,16 @@ namespace ve {
 		virtual VkRenderPass			getRenderPassShadow() { return m_renderPassShadow; };
 		///\returns the depth map vector
 		VETexture *						getDepthMap() { return m_depthMap; };
-		///\returns a specific depth map from the whole set
+		///\returns the shadow map cascades of a swap chain image, empty if there are none yet
 		std::vector<VETexture *>		getShadowMap( uint32_t idx) { return m_shadowMaps[idx]; };
 		///\returns the 2D extent of the shadow map
-		virtual VkExtent2D				getShadowMapExtent() { return m_shadowMaps[0][0]->m_extent; };
+		virtual VkExtent2D				getShadowMapExtent() { return { SHADOW_MAP_DIM, SHADOW_MAP_DIM }; };
+		///\returns the render graph of a swap chain image
+		VERenderGraph &					getRenderGraph( uint32_t idx) { return m_renderGraphs[idx]; };
+		///\returns the GPU culling stage, or nullptr if it is disabled
+		VEGPUCulling *					getGPUCulling() { return m_pGPUCulling; };
+		///\returns the pipeline cache
+		VkPipelineCache					getPipelineCache() { return m_pipelineCache; };
 	};
 
 }
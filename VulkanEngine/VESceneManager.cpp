@@ -27,16 +27,22 @@ namespace ve {
 	*
 	* In this function the scene manager loads standard shapes like cubes and planes. 
 	* Then it creates a standard camera system (camera + parent) and a standard light.
+	* The standard shapes are imported by prefetchStandardAssets(), here only their meshes and materials are created.
 	*
 	*/
 	void VESceneManager::initSceneManager() {
 		std::vector<VEMesh*> meshes;
 		std::vector<VEMaterial*> materials;
 
-		loadAssets("models/standard", "cube.obj", 0, meshes, materials);
-		loadAssets("models/standard", "invcube.obj", aiProcess_FlipWindingOrder, meshes, materials);
-		loadAssets("models/standard", "plane.obj", 0, meshes, materials);
-		loadAssets("models/standard", "sphere.obj", 0, meshes, materials);
+		if (m_standardAssets.empty()) prefetchStandardAssets();
+		for (auto &asset : m_standardAssets) {
+			Assimp::Importer *pImporter = asset.second.get();
+			std::string filekey = "models/standard/" + asset.first;
+			createMeshes(pImporter->GetScene(), filekey, meshes);
+			createMaterials(pImporter->GetScene(), "models/standard", filekey, materials);
+			delete pImporter;
+		}
+		m_standardAssets.clear();
 
 		//camera parent is used for translation rotations
 		VESceneNode *cameraParent = createSceneNode("StandardCameraParent", glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 3.0f, 1.0f)) );
@@ -81,29 +87,50 @@ namespace ve {
 	};
 
 
+	/**
+	*
+	* \brief Start importing the standard shapes on the thread pool
+	*
+	* Importing only parses the files, it does not touch Vulkan. So it is started by VEEngine::initEngine() before
+	* the window and the renderer are created, and overlaps with them. initSceneManager() then waits for the result.
+	*
+	*/
+	void VESceneManager::prefetchStandardAssets() {
+		std::vector<std::pair<std::string, uint32_t>> assets = {
+			{ "cube.obj", 0 }, { "invcube.obj", aiProcess_FlipWindingOrder }, { "plane.obj", 0 }, { "sphere.obj", 0 } };
+
+		for (auto &asset : assets) {
+			std::string filename = asset.first;
+			uint32_t aiFlags = asset.second;
+			m_standardAssets.push_back({ filename, getEnginePointer()->m_threadPool->submit([this, filename, aiFlags]() {
+				return importAssets("models/standard", filename, aiFlags);
+			}) });
+		}
+	}
+
+
 	//-----------------------------------------------------------------------------------------------------------------------
 	//load stuff using Assimp
 
 	/**
 	*
-	* \brief Load assets from file ussing Assimp
+	* \brief Import a file with Assimp
 	*
-	* The scene manager loads assets from a file and creates the contained meshes and materials.
-	* It does not create entities. Meshes and materials are stored in the scene manager's member variables.
+	* Only reads the file, does not create meshes or materials, so it can run on any thread.
 	*
 	* \param[in] basedir Name of directory the file is in
 	* \param[in] filename Name of the file containing the assets
-	* \param[in] aiFlags Import flags for Assimp, see code below for some examples
-	* \param[out] meshes A list containing pointers to the loaded meshes
-	* \param[out] materials A list of pointers to the loaded materials
+	* \param[in] aiFlags Import flags for Assimp, added to the standard flags
+	* \returns the importer holding the scene, must be deleted by the caller
 	*
 	*/
-	const aiScene* VESceneManager::loadAssets(std::string basedir, std::string filename, uint32_t aiFlags, std::vector<VEMesh*> &meshes, std::vector<VEMaterial*> &materials) {
-		Assimp::Importer importer;
+	Assimp::Importer * VESceneManager::importAssets(std::string basedir, std::string filename, uint32_t aiFlags) {
+		Assimp::Importer *pImporter = new Assimp::Importer();
+		pImporter->SetIOHandler(getFileSystemPointer()->createAssimpIOSystem());	//read through the file system
 
 		std::string filekey = basedir + "/" + filename;
 
-		const aiScene* pScene = importer.ReadFile( filekey, 
+		const aiScene* pScene = pImporter->ReadFile( filekey, 
 			//aiProcess_FlipWindingOrder |
 			//aiProcess_RemoveRedundantMaterials |
 			//aiProcess_PreTransformVertices |
@@ -115,10 +142,34 @@ namespace ve {
 			aiFlags);
 
 		if (pScene == nullptr) {
+			delete pImporter;
 			throw std::runtime_error("Error: Could not load asset file " + filekey + "!");
 		}
+		return pImporter;
+	}
+
+	/**
+	*
+	* \brief Load assets from file ussing Assimp
+	*
+	* The scene manager loads assets from a file and creates the contained meshes and materials.
+	* It does not create entities. Meshes and materials are stored in the scene manager's member variables.
+	*
+	* \param[in] basedir Name of directory the file is in
+	* \param[in] filename Name of the file containing the assets
+	* \param[in] aiFlags Import flags for Assimp, see code below for some examples
+	* \param[out] meshes A list containing pointers to the loaded meshes
+	* \param[out] materials A list of pointers to the loaded materials
+	*
+	*/
+	const aiScene* VESceneManager::loadAssets(std::string basedir, std::string filename, uint32_t aiFlags, std::vector<VEMesh*> &meshes, std::vector<VEMaterial*> &materials) {
+		Assimp::Importer *pImporter = importAssets(basedir, filename, aiFlags);
+		const aiScene* pScene = pImporter->GetScene();
+
+		std::string filekey = basedir + "/" + filename;
 		createMeshes(pScene, filekey, meshes);
 		createMaterials(pScene, basedir, filekey, materials);
+		delete pImporter;
 
 		return pScene;
 	}
@@ -130,7 +181,8 @@ namespace ve {
 	*
 	* The scene manager loads assets from a file and creates the contained meshes and materials.
 	* Meshes and materials are stored in the scene manager's member variables. It then followsa the entity
-	* tree recursively and creates the contained entities.
+	* tree recursively and creates the contained entities. Finally the new tree is flattened.
+	* OBJ and glTF files without extra import flags are read by loadObjModel() and loadGltfModel(), Assimp is used if that fails.
 	*
 	* \param[in] entityName The name of the new entity (its the parent of all created entities)
 	* \param[in] basedir Name of directory the file is in
@@ -140,7 +192,20 @@ namespace ve {
 	*
 	*/
 	VESceneNode * VESceneManager::loadModel(std::string entityName, std::string basedir, std::string filename, uint32_t aiFlags, VESceneNode *parent) {
+		size_t dot = filename.find_last_of('.');
+		std::string extension = dot != std::string::npos ? filename.substr(dot) : "";
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (m_useObjLoader && aiFlags == 0 && extension == ".obj") {		//extra Assimp flags need Assimp
+			VESceneNode *pMO = loadObjModel(entityName, basedir, filename, parent);
+			if (pMO != nullptr) return pMO;
+		}
+		if (m_useGltfLoader && aiFlags == 0 && (extension == ".gltf" || extension == ".glb")) {
+			VESceneNode *pMO = loadGltfModel(entityName, basedir, filename, parent);
+			if (pMO != nullptr) return pMO;
+		}
+
 		Assimp::Importer importer;
+		importer.SetIOHandler(getFileSystemPointer()->createAssimpIOSystem());	//read through the file system
 
 		std::string filekey = basedir + "/" + filename;
 
@@ -171,11 +236,249 @@ namespace ve {
 
 		pMO = createSceneNode(entityName, glm::mat4(1.0f), parent);
 
-		copyAiNodes( pScene, meshes, materials, pScene->mRootNode, pMO);
+		std::string nameBuffer;				//one buffer for building all node names
+		nameBuffer.reserve(1024);
+		nameBuffer.assign(entityName);
+		copyAiNodes( pScene, meshes, materials, pScene->mRootNode, pMO, nameBuffer);
+
+		flattenSceneNodes(pMO);
+
+		return pMO;
+	}
+
+	/**
+	*
+	* \brief Load an OBJ file with VEObjLoader, create entities from it
+	*
+	* Meshes and materials get the same names as if loaded by Assimp. Each object of the file becomes a scene node,
+	* with one entity for each material the object uses. Finally the new tree is flattened.
+	*
+	* \param[in] entityName The name of the new entity (its the parent of all created entities)
+	* \param[in] basedir Name of directory the file is in
+	* \param[in] filename Name of the OBJ file
+	* \param[in] parent Make the new entity a child of this parent entity
+	* \returns the new entity, or nullptr if the file could not be parsed
+	*
+	*/
+	VESceneNode * VESceneManager::loadObjModel(std::string entityName, std::string basedir, std::string filename, VESceneNode *parent) {
+		VEObjLoader loader(basedir, filename);
+		if (!loader.load()) return nullptr;
+
+		std::string filekey = basedir + "/" + filename;
+
+		std::map<std::string, VEMaterial*> materials;
+		for (auto &objMat : loader.getMaterials()) {
+			std::string name = filekey + "/" + objMat.m_name;
+			VEMaterial *pMat = m_materials[name];
+			if (pMat == nullptr) {
+				pMat = new VEMaterial(name);
+				m_materials[name] = pMat;
+				pMat->shading = objMat.m_illum == 0 ? aiShadingMode_NoShading : (objMat.m_illum == 1 ? aiShadingMode_Gouraud : aiShadingMode_Phong);
+				pMat->color = objMat.m_color;
+
+				if (!objMat.m_mapDiffuse.empty()) pMat->mapDiffuse = new VETexture(filekey + "/" + objMat.m_mapDiffuse, basedir, { objMat.m_mapDiffuse });
+				if (!objMat.m_mapNormal.empty()) pMat->mapNormal = new VETexture(filekey + "/" + objMat.m_mapNormal, basedir, { objMat.m_mapNormal });
+				if (!objMat.m_mapBump.empty()) pMat->mapBump = new VETexture(filekey + "/" + objMat.m_mapBump, basedir, { objMat.m_mapBump });
+				if (!objMat.m_mapHeight.empty()) pMat->mapHeight = new VETexture(filekey + "/" + objMat.m_mapHeight, basedir, { objMat.m_mapHeight });
+			}
+			materials[objMat.m_name] = pMat;
+		}
+
+		std::vector<VEMesh*> meshes;
+		for (auto &objMesh : loader.getMeshes()) {
+			std::string name = filekey + "/" + objMesh.m_object + "/" + objMesh.m_material;
+			VEMesh *pMesh = m_meshes[name];
+			if (pMesh == nullptr) {
+				pMesh = new VEMesh(name, std::move(objMesh.m_vertices), std::move(objMesh.m_indices));
+				m_meshes[name] = pMesh;
+			}
+			meshes.push_back(pMesh);
+
+			if (materials[objMesh.m_material] == nullptr) {			//usemtl without MTL entry, or no usemtl at all
+				std::string matname = filekey + "/" + (objMesh.m_material.empty() ? std::string("DefaultMaterial") : objMesh.m_material);
+				VEMaterial *pMat = m_materials[matname];
+				if (pMat == nullptr) {
+					pMat = new VEMaterial(matname);
+					m_materials[matname] = pMat;
+				}
+				materials[objMesh.m_material] = pMat;
+			}
+		}
+
+		VESceneNode *pMO = m_sceneNodes[entityName];
+		if (pMO != nullptr) return pMO;
+
+		pMO = createSceneNode(entityName, glm::mat4(1.0f), parent);
+
+		for (uint32_t i = 0; i < meshes.size(); i++) {
+			veObjMesh &objMesh = loader.getMeshes()[i];
+			std::string nodeName = entityName + "/" + objMesh.m_object;
+			VESceneNode *pObject = createSceneNode(nodeName, glm::mat4(1.0f), pMO);
+			createEntity(nodeName + "/Entity_" + std::to_string(i), meshes[i], materials[objMesh.m_material], glm::mat4(1.0f), pObject);
+		}
+
+		flattenSceneNodes(pMO);
+
+		return pMO;
+	}
+
+	/**
+	*
+	* \brief Load a glTF 2.0 file (.gltf or .glb) with VEGltfLoader, create entities from it
+	*
+	* Each primitive becomes a mesh. Primitives with normals and tangents are copied straight from the mapped
+	* file into the staging buffers of their meshes. For the others, normals and tangents are computed first.
+	* The node tree of the file is copied, then flattened.
+	*
+	* \param[in] entityName The name of the new entity (its the parent of all created entities)
+	* \param[in] basedir Name of directory the file is in
+	* \param[in] filename Name of the glTF file
+	* \param[in] parent Make the new entity a child of this parent entity
+	* \returns the new entity, or nullptr if the file could not be loaded
+	*
+	*/
+	VESceneNode * VESceneManager::loadGltfModel(std::string entityName, std::string basedir, std::string filename, VESceneNode *parent) {
+		VEGltfLoader loader(basedir, filename);
+		if (!loader.load()) return nullptr;
+
+		std::string filekey = basedir + "/" + filename;
+
+		std::vector<VEMaterial*> materials;
+		std::vector<veGltfImage> &images = loader.getImages();
+		auto createTexture = [&](uint32_t image) -> VETexture * {
+			if (image == VE_GLTF_NONE) return nullptr;
+			if (images[image].m_pData != nullptr) {
+				return new VETexture(filekey + "/image_" + std::to_string(image), images[image].m_pData, images[image].m_size);
+			}
+			return new VETexture(filekey + "/" + images[image].m_uri, basedir, { images[image].m_uri });
+		};
+
+		for (auto &gltfMat : loader.getMaterials()) {
+			std::string name = filekey + "/" + gltfMat.m_name;
+			VEMaterial *pMat = m_materials[name];
+			if (pMat == nullptr) {
+				pMat = new VEMaterial(name);
+				m_materials[name] = pMat;
+				pMat->color = gltfMat.m_color;
+				pMat->mapDiffuse = createTexture(gltfMat.m_baseColorImage);
+				pMat->mapNormal = createTexture(gltfMat.m_normalImage);
+			}
+			materials.push_back(pMat);
+		}
+
+		std::string defaultName = filekey + "/DefaultMaterial";			//for primitives without material
+		VEMaterial *pDefault = m_materials[defaultName];
+		if (pDefault == nullptr) {
+			pDefault = new VEMaterial(defaultName);
+			m_materials[defaultName] = pDefault;
+		}
+		materials.push_back(pDefault);
+
+		//primitives without normals or tangents get them computed in parallel
+		std::vector<veObjMesh> computed;
+		std::vector<std::pair<uint32_t, uint32_t>> computedPrimitives;
+		std::vector<std::vector<VEMesh*>> meshes(loader.getMeshes().size());
+		for (uint32_t m = 0; m < meshes.size(); m++) {
+			veGltfMesh &gltfMesh = loader.getMeshes()[m];
+			meshes[m].resize(gltfMesh.m_primitives.size(), nullptr);
+			for (uint32_t p = 0; p < gltfMesh.m_primitives.size(); p++) {
+				std::string name = filekey + "/" + gltfMesh.m_name + "/" + std::to_string(p);
+				meshes[m][p] = m_meshes[name];
+				if (meshes[m][p] != nullptr || VEGltfLoader::hasAllAttributes(gltfMesh.m_primitives[p])) continue;
+
+				computed.push_back(veObjMesh());
+				VEGltfLoader::buildMesh(gltfMesh.m_primitives[p], computed.back());
+				computedPrimitives.push_back({ m, p });
+			}
+		}
+		VEObjLoader::computeNormalsAndTangents(computed);
+		for (uint32_t i = 0; i < computed.size(); i++) {
+			uint32_t m = computedPrimitives[i].first, p = computedPrimitives[i].second;
+			std::string name = filekey + "/" + loader.getMeshes()[m].m_name + "/" + std::to_string(p);
+			meshes[m][p] = new VEMesh(name, std::move(computed[i].m_vertices), std::move(computed[i].m_indices));
+			m_meshes[name] = meshes[m][p];
+		}
+
+		for (uint32_t m = 0; m < meshes.size(); m++) {
+			veGltfMesh &gltfMesh = loader.getMeshes()[m];
+			for (uint32_t p = 0; p < gltfMesh.m_primitives.size(); p++) {
+				if (meshes[m][p] != nullptr) continue;
+
+				veGltfPrimitive &primitive = gltfMesh.m_primitives[p];
+				std::string name = filekey + "/" + gltfMesh.m_name + "/" + std::to_string(p);
+				meshes[m][p] = new VEMesh(	name, primitive.m_position.m_count, VEGltfLoader::getIndexCount(primitive),
+											[&](glm::vec3 *pPositions, vh::vhVertexAttributes *pAttributes) {
+												VEGltfLoader::copyPositions(primitive, pPositions);
+												VEGltfLoader::copyAttributes(primitive, pAttributes);
+											},
+											[&](uint32_t *pIndices) { VEGltfLoader::copyIndices(primitive, pIndices); });
+				m_meshes[name] = meshes[m][p];
+			}
+		}
+
+		VESceneNode *pMO = m_sceneNodes[entityName];
+		if (pMO != nullptr) return pMO;
+
+		pMO = createSceneNode(entityName, glm::mat4(1.0f), parent);
+
+		std::string nameBuffer;				//one buffer for building all node names
+		nameBuffer.reserve(1024);
+		nameBuffer.assign(entityName);
+		for (auto root : loader.getRootNodes()) {
+			copyGltfNodes(loader, meshes, materials, root, pMO, nameBuffer, 0);
+		}
+
+		flattenSceneNodes(pMO);
 
 		return pMO;
 	}
 
+	/**
+	*
+	* \brief Follow the glTF tree of nodes and create entities from them.
+	*
+	* Each node becomes a scene node, with one entity for each primitive of its mesh.
+	*
+	* \param[in] loader The loader holding the file
+	* \param[in] meshes The meshes of each glTF mesh, one per primitive
+	* \param[in] materials The materials of the file, the last one is used for primitives without material
+	* \param[in] node Index of the glTF node currently being processed
+	* \param[in] parent The parent entity of the new entity
+	* \param[in,out] nameBuffer Holds the name of the parent, names of children are appended and removed again
+	* \param[in] depth Depth of the node in the tree
+	*
+	*/
+	void VESceneManager::copyGltfNodes(	VEGltfLoader &loader, std::vector<std::vector<VEMesh*>> &meshes,
+										std::vector<VEMaterial*> &materials, uint32_t node, VESceneNode *parent,
+										std::string &nameBuffer, uint32_t depth) {
+		if (depth > VE_GLTF_MAX_DEPTH) return;
+		veGltfNode &gltfNode = loader.getNodes()[node];
+
+		size_t parentLength = nameBuffer.size();
+		nameBuffer.append("/").append(gltfNode.m_name);
+		size_t nodeLength = nameBuffer.size();
+
+		VESceneNode *pObject = createSceneNode(nameBuffer, gltfNode.m_transform, parent);
+
+		if (gltfNode.m_mesh != VE_GLTF_NONE) {
+			veGltfMesh &gltfMesh = loader.getMeshes()[gltfNode.m_mesh];
+			for (uint32_t p = 0; p < gltfMesh.m_primitives.size(); p++) {
+				uint32_t material = gltfMesh.m_primitives[p].m_material;
+				VEMaterial *pMaterial = material != VE_GLTF_NONE ? materials[material] : materials.back();
+
+				nameBuffer.append("/Entity_").append(std::to_string(p));
+				createEntity(nameBuffer, meshes[gltfNode.m_mesh][p], pMaterial, glm::mat4(1.0f), pObject);
+				nameBuffer.resize(nodeLength);
+			}
+		}
+
+		for (auto child : gltfNode.m_children) {
+			copyGltfNodes(loader, meshes, materials, child, pObject, nameBuffer, depth + 1);
+		}
+
+		nameBuffer.resize(parentLength);
+	}
+
 	/**
 	*
 	* \brief Follow the Assimp tree of nodes and create entities from them.
@@ -189,16 +492,21 @@ namespace ve {
 	* \param[in] materials The materials that were loaded by Assimp from the file
 	* \param[in] node The Assimp node currently being processed
 	* \param[in] parent The parent entity of the new entity
+	* \param[in,out] nameBuffer Holds the name of the parent, names of children are appended and removed again
 	*
 	*/
 	void VESceneManager::copyAiNodes(	const aiScene* pScene, 
 										std::vector<VEMesh*> &meshes, 
 										std::vector<VEMaterial*> &materials, 
 										aiNode* node, 
-										VESceneNode *parent ) {
+										VESceneNode *parent,
+										std::string &nameBuffer ) {
+
+		size_t parentLength = nameBuffer.size();
+		nameBuffer.append("/").append(node->mName.C_Str());
+		size_t nodeLength = nameBuffer.size();
 
-		VESceneNode *pObject = createSceneNode(	parent->getName() + "/" + node->mName.C_Str(),
-												glm::mat4(1.0f), parent);
+		VESceneNode *pObject = createSceneNode(	nameBuffer, glm::mat4(1.0f), parent);
 
 		for (uint32_t i = 0; i < node->mNumMeshes; i++) {	//go through the meshes of the Assimp node
 
@@ -214,16 +522,317 @@ namespace ve {
 
 			glm::mat4 *pMatrix = (glm::mat4*) &node->mTransformation;
 
-			VEEntity *pEnt = createEntity(	pObject->getName() + "/Entity_" + std::to_string(i), //create the new entity
+			nameBuffer.append("/Entity_").append(std::to_string(i));
+			VEEntity *pEnt = createEntity(	nameBuffer, //create the new entity
 											pMesh, pMaterial, *pMatrix, pObject);
+			nameBuffer.resize(nodeLength);
 		}
 
 		for (uint32_t i = 0; i < node->mNumChildren; i++) {		//recursivly go down the node tree
-			copyAiNodes(pScene, meshes, materials, node->mChildren[i], pObject);
+			copyAiNodes(pScene, meshes, materials, node->mChildren[i], pObject, nameBuffer);
+		}
+
+		nameBuffer.resize(parentLength);
+	}
+
+
+	/**
+	*
+	* \brief Flatten a tree of scene nodes, e.g. after importing a model
+	*
+	* Plain scene nodes (no entities, cameras or lights) below the root are removed if
+	*- they have no children,
+	*- their transform is the identity, their children are then moved to their parent,
+	*- they have only one child, their transform is then multiplied into the child's transform.
+	*
+	* The root itself is kept. Names of removed nodes are remembered, so getSceneNode() still finds the node that
+	* replaced them.
+	*
+	* \param[in] root Pointer to the root of the tree
+	*
+	*/
+	void VESceneManager::flattenSceneNodes(VESceneNode *root) {
+		std::vector<VESceneNode*> children = root->m_children;		//the list changes while flattening
+		for (auto pChild : children) {
+			flattenSceneNode(pChild);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Flatten the subtree of a scene node, then remove the node if possible
+	*
+	* \param[in] pNode Pointer to the scene node, must have a parent
+	*
+	*/
+	void VESceneManager::flattenSceneNode(VESceneNode *pNode) {
+		std::vector<VESceneNode*> children = pNode->m_children;		//the list changes while flattening
+		for (auto pChild : children) {
+			flattenSceneNode(pChild);
+		}
+
+		if (pNode->getNodeType() != VESceneNode::VE_OBJECT_TYPE_SCENENODE) return;
+
+		VESceneNode *pParent = pNode->m_parent;
+		VESceneNode *pReplacement = pParent;
+		glm::mat4 transf = pNode->getTransform();
+
+		if (pNode->m_children.size() == 1 && transf != glm::mat4(1.0f)) {	//transform only node: move transform into the child
+			pReplacement = pNode->m_children[0];
+			pReplacement->setTransform(transf * pReplacement->getTransform());
+		}
+		else if (pNode->m_children.size() > 0 && transf != glm::mat4(1.0f)) {
+			return;
+		}
+
+		children = pNode->m_children;
+		for (auto pChild : children) {
+			pParent->addChild(pChild);
 		}
 
+		pParent->removeChild(pNode);
+		m_sceneNodes.erase(pNode->getNameID());
+		m_sceneNodeAliases[pNode->getNameID()] = pReplacement->getNameID();
+		delete pNode;
 	}
 
+	/**
+	*
+	* \brief Load a static model from file and merge its meshes by material
+	*
+	* Instead of one scene node per Assimp node and one entity per Assimp mesh, all node transforms are baked into
+	* the vertices, and all meshes sharing a material are merged into a single VEMesh. The result is one scene node with
+	* one entity per material. Use this for scenery that never moves its parts relative to each other.
+	* Merged meshes are named after the file, so loading the same file again reuses them.
+	*
+	* \param[in] entityName The name of the new scene node holding the entities
+	* \param[in] basedir Name of directory the file is in
+	* \param[in] filename Name of the file containing the assets
+	* \param[in] aiFlags Additional import flags for Assimp
+	* \param[in] parent Make the new scene node a child of this parent
+	* \returns the new scene node
+	*
+	*/
+	VESceneNode * VESceneManager::loadModelBatched(std::string entityName, std::string basedir, std::string filename, uint32_t aiFlags, VESceneNode *parent) {
+		VESceneNode *pMO = m_sceneNodes[entityName];
+		if (pMO != nullptr) return pMO;
+
+		std::vector<veBatchGeometry> batches;
+		std::vector<glm::mat4> transforms = { glm::mat4(1.0f) };
+		std::string filekey = basedir + "/" + filename;
+		Assimp::Importer *pImporter = importAssets(basedir, filename, aiProcess_FlipUVs | aiProcess_FlipWindingOrder | aiFlags);
+		batchModel(pImporter->GetScene(), basedir, filekey, transforms, batches);
+		delete pImporter;
+
+		return createBatchedEntities(entityName, filekey + "/Batch", batches, parent);
+	}
+
+
+	/**
+	*
+	* \brief Load several static models and merge all their meshes by material
+	*
+	* Each model is placed with its own transform, which is baked into the vertices together with the node transforms.
+	* All meshes of all models sharing a material are merged into a single VEMesh, e.g. all houses of a street chunk.
+	* A file listed several times is imported only once. Imported files are also kept for later calls, e.g. for the
+	* next street chunk, until clearBatchImports() is called.
+	*
+	* \param[in] entityName The name of the new scene node holding the entities, also used for naming the meshes
+	* \param[in] basedir Name of directory the files are in
+	* \param[in] filenames Names of the files containing the models
+	* \param[in] transforms Placement of each model relative to the new scene node
+	* \param[in] aiFlags Additional import flags for Assimp
+	* \param[in] parent Make the new scene node a child of this parent
+	* \returns the new scene node
+	*
+	*/
+	VESceneNode * VESceneManager::loadModelsBatched(std::string entityName, std::string basedir,
+													std::vector<std::string> filenames, std::vector<glm::mat4> transforms,
+													uint32_t aiFlags, VESceneNode *parent) {
+		VESceneNode *pMO = m_sceneNodes[entityName];
+		if (pMO != nullptr) return pMO;
+
+		std::vector<std::string> files;							//different files, in the order they are first listed
+		std::unordered_map<std::string, std::vector<glm::mat4>> placements;	//transforms of all copies of each file
+		for (uint32_t i = 0; i < filenames.size(); i++) {
+			std::vector<glm::mat4> &fileTransforms = placements[filenames[i]];
+			if (fileTransforms.empty()) files.push_back(filenames[i]);
+			fileTransforms.push_back(i < transforms.size() ? transforms[i] : glm::mat4(1.0f));
+		}
+
+		std::vector<veBatchGeometry> batches;
+		for (auto &filename : files) {
+			const aiScene *pScene = getBatchImport(basedir, filename, aiFlags);
+			batchModel(pScene, basedir, basedir + "/" + filename, placements[filename], batches);
+		}
+
+		return createBatchedEntities(entityName, entityName + "/Batch", batches, parent);
+	}
+
+
+	/**
+	*
+	* \brief Import a file for batching, or return the scene imported by an earlier call
+	*
+	* \param[in] basedir Name of directory the file is in
+	* \param[in] filename Name of the file containing the model
+	* \param[in] aiFlags Additional import flags for Assimp
+	* \returns the imported scene, owned by the scene manager
+	*
+	*/
+	const aiScene * VESceneManager::getBatchImport(std::string basedir, std::string filename, uint32_t aiFlags) {
+		std::string key = basedir + "/" + filename + "|" + std::to_string(aiFlags);
+		Assimp::Importer *&pImporter = m_batchImports[key];
+		if (pImporter == nullptr) {
+			pImporter = importAssets(basedir, filename, aiProcess_FlipUVs | aiProcess_FlipWindingOrder | aiFlags);
+		}
+		return pImporter->GetScene();
+	}
+
+
+	/**
+	*
+	* \brief Free the files kept by loadModelsBatched()
+	*
+	* Call this when no more batches of the same files will be loaded. Meshes and materials are not affected.
+	*
+	*/
+	void VESceneManager::clearBatchImports() {
+		for (auto &import : m_batchImports) delete import.second;
+		m_batchImports.clear();
+	}
+
+
+	/**
+	*
+	* \brief Add the geometry of an imported model to a list of batches, once for each placement
+	*
+	* \param[in] pScene The Assimp scene of the model
+	* \param[in] basedir Name of directory the file is in
+	* \param[in] filekey Path of the file, used for naming the materials
+	* \param[in] transforms Placements of the model, each is baked into the vertices of one copy
+	* \param[in,out] batches Merged geometry, one entry per material
+	*
+	*/
+	void VESceneManager::batchModel(const aiScene *pScene, std::string basedir, std::string filekey,
+									std::vector<glm::mat4> &transforms, std::vector<veBatchGeometry> &batches) {
+
+		std::vector<VEMaterial*> materials;
+		createMaterials(pScene, basedir, filekey, materials);
+
+		for (auto &transf : transforms) {
+			batchAiNodes(pScene, materials, pScene->mRootNode, transf, batches);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Follow the Assimp tree of nodes and merge the meshes into batches
+	*
+	* Node transforms are accumulated down the tree. Positions are transformed by the accumulated transform,
+	* normals and tangents by its inverse transpose. If the transform mirrors the geometry, the winding of
+	* the triangles is reversed, so front faces stay front faces.
+	*
+	* \param[in] pScene A pointer to the Assimp scene
+	* \param[in] materials The materials that were loaded by Assimp from the file
+	* \param[in] node The Assimp node currently being processed
+	* \param[in] parentTransf The accumulated transform of the parent node
+	* \param[in,out] batches Merged geometry, one entry per material
+	*
+	*/
+	void VESceneManager::batchAiNodes(	const aiScene* pScene, std::vector<VEMaterial*> &materials,
+										aiNode* node, glm::mat4 parentTransf, std::vector<veBatchGeometry> &batches) {
+
+		glm::mat4 transf = parentTransf * glm::transpose(*(glm::mat4*)&node->mTransformation);	//Assimp matrices are row major
+		glm::mat3 normalTransf = glm::transpose(glm::inverse(glm::mat3(transf)));
+		bool mirrored = glm::determinant(glm::mat3(transf)) < 0.0f;
+
+		for (uint32_t i = 0; i < node->mNumMeshes; i++) {
+			aiMesh * paiMesh = pScene->mMeshes[node->mMeshes[i]];
+			VEMaterial * pMaterial = materials[paiMesh->mMaterialIndex];
+
+			uint32_t b = 0;
+			while (b < batches.size() && batches[b].m_pMaterial != pMaterial) b++;
+			if (b == batches.size()) batches.push_back({ pMaterial, {}, {} });
+			veBatchGeometry &batch = batches[b];
+
+			uint32_t base = (uint32_t)batch.m_vertices.size();
+			batch.m_vertices.reserve(base + paiMesh->mNumVertices);
+
+			for (uint32_t j = 0; j < paiMesh->mNumVertices; j++) {
+				vh::vhVertex vertex = {};
+				glm::vec3 pos(paiMesh->mVertices[j].x, paiMesh->mVertices[j].y, paiMesh->mVertices[j].z);
+				vertex.pos = glm::vec3(transf * glm::vec4(pos, 1.0f));
+
+				if (paiMesh->HasNormals()) {
+					glm::vec3 normal = normalTransf * glm::vec3(paiMesh->mNormals[j].x, paiMesh->mNormals[j].y, paiMesh->mNormals[j].z);
+					if (glm::length(normal) > 0.0f) vertex.normal = glm::normalize(normal);
+				}
+
+				if (paiMesh->HasTangentsAndBitangents() && paiMesh->mTangents) {
+					glm::vec3 tangent = glm::mat3(transf) * glm::vec3(paiMesh->mTangents[j].x, paiMesh->mTangents[j].y, paiMesh->mTangents[j].z);
+					if (glm::length(tangent) > 0.0f) vertex.tangent = glm::normalize(tangent);
+				}
+
+				if (paiMesh->HasTextureCoords(0)) {
+					vertex.texCoord = glm::vec2(paiMesh->mTextureCoords[0][j].x, paiMesh->mTextureCoords[0][j].y);
+				}
+
+				batch.m_vertices.push_back(vertex);
+			}
+
+			for (uint32_t j = 0; j < paiMesh->mNumFaces; j++) {
+				aiFace &face = paiMesh->mFaces[j];
+				for (uint32_t k = 0; k < face.mNumIndices; k++) {
+					uint32_t corner = mirrored && face.mNumIndices == 3 ? (3 - k) % 3 : k;	//0, 2, 1 if mirrored
+					batch.m_indices.push_back(base + face.mIndices[corner]);
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i < node->mNumChildren; i++) {
+			batchAiNodes(pScene, materials, node->mChildren[i], transf, batches);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Create one scene node with one entity per batch
+	*
+	* If a mesh with the same name exists already, it is reused and no new vertex and index buffers are created.
+	*
+	* \param[in] entityName The name of the new scene node
+	* \param[in] meshPrefix Prefix for the names of the merged meshes
+	* \param[in] batches Merged geometry, one entry per material
+	* \param[in] parent Make the new scene node a child of this parent
+	* \returns the new scene node
+	*
+	*/
+	VESceneNode * VESceneManager::createBatchedEntities(std::string entityName, std::string meshPrefix,
+														std::vector<veBatchGeometry> &batches, VESceneNode *parent) {
+
+		VESceneNode *pMO = createSceneNode(entityName, glm::mat4(1.0f), parent);
+
+		for (uint32_t i = 0; i < batches.size(); i++) {
+			std::string name = meshPrefix + "_" + std::to_string(i);
+
+			VEMesh *pMesh = m_meshes[name];
+			if (pMesh == nullptr) {
+				if (batches[i].m_indices.size() == 0) continue;
+				pMesh = new VEMesh(name, batches[i].m_vertices, batches[i].m_indices);
+				m_meshes[name] = pMesh;
+			}
+
+			createEntity(pMO->getName() + "/Entity_" + std::to_string(i), pMesh, batches[i].m_pMaterial, glm::mat4(1.0f), pMO);
+		}
+
+		return pMO;
+	}
+
+
 	/**
 	*
 	* \brief Create all VEMesh instances from a file loaded by Assimp
@@ -402,6 +1011,9 @@ namespace ve {
 		if (pMesh != nullptr && pMat != nullptr) {
 			getRendererPointer()->addEntityToSubrenderer(pEntity);
 		}
+		if (m_pOctree != nullptr && type == VEEntity::VE_ENTITY_TYPE_NORMAL) {
+			m_pOctree->addEntity(pEntity);
+		}
 		return pEntity;
 	}
 
@@ -436,14 +1048,18 @@ namespace ve {
 
 		std::string filekey = basedir + "/" + filename;
 
-		VEMesh * pMesh = m_meshes[STANDARD_MESH_INVCUBE];
+		VEMesh * pMesh = getMesh(STANDARD_MESH_INVCUBE);
 
 		VEMaterial *pMat = m_materials[filekey];
 		if (pMat == nullptr) {
 			pMat = new VEMaterial(filekey);
 			m_materials[filekey] = pMat;
 
-			gli::texture_cube texCube(gli::load(filekey));
+			veFileData file;
+			if (!getFileSystemPointer()->read(filekey, file)) {
+				throw std::runtime_error("Error: Could not load cubemap file " + filekey + "!");
+			}
+			gli::texture_cube texCube(gli::load(file.m_pData, file.m_size));
 			if (texCube.empty()) {
 				throw std::runtime_error("Error: Could not load cubemap file " + filekey + "!");
 			}
@@ -490,7 +1106,7 @@ namespace ve {
 			addstring = "+";
 		}
 
-		VEMesh * pMesh = m_meshes[STANDARD_MESH_INVCUBE];
+		VEMesh * pMesh = getMesh(STANDARD_MESH_INVCUBE);
 
 		VEMaterial *pMat = m_materials[filekey];
 		if (pMat == nullptr) {
@@ -520,7 +1136,7 @@ namespace ve {
 	VEEntity *	VESceneManager::createSkyplane(std::string entityName, std::string basedir, std::string texName) {
 
 		std::string filekey = basedir + "/" + texName;
-		VEMesh * pMesh = m_meshes[STANDARD_MESH_PLANE];
+		VEMesh * pMesh = getMesh(STANDARD_MESH_PLANE);
 
 		VEMaterial *pMat = m_materials[filekey];
 		if (pMat == nullptr) {
@@ -605,6 +1221,94 @@ namespace ve {
 	}
 
 
+	/**
+	*
+	* \brief Create a terrain from a heightmap
+	*
+	* The patch mesh is shared by all terrains and created with the first one. The texture is stretched over the
+	* whole terrain, use setParam() to repeat it.
+	*
+	* \param[in] entityName Name of the new entity.
+	* \param[in] basedir Name of the directory the heightmap and texture files are in
+	* \param[in] heightmap Name of the heightmap file, a square 16 bit raw file (.r16, .raw) or an image
+	* \param[in] texName Name of the diffuse texture file
+	* \param[in] size Extent of the terrain along x and z
+	* \param[in] heightScale Height of the max heightmap value
+	* \param[in] transf Local to parent transform, should not scale
+	* \param[in] parent Pointer to entity to be used as parent.
+	* \returns a pointer to the new terrain
+	*
+	*/
+	VETerrain * VESceneManager::createTerrain(	std::string entityName, std::string basedir,
+												std::string heightmap, std::string texName,
+												float size, float heightScale,
+												glm::mat4 transf, VESceneNode *parent) {
+
+		VEMesh *pMesh = m_meshes[VE_TERRAIN_PATCH_MESH];
+		if (pMesh == nullptr) {
+			pMesh = VETerrain::createPatchMesh();
+			m_meshes[VE_TERRAIN_PATCH_MESH] = pMesh;
+		}
+
+		std::string filekey = basedir + "/" + texName;
+		VEMaterial *pMat = m_materials[filekey];
+		if (pMat == nullptr) {
+			pMat = new VEMaterial(filekey);
+			m_materials[filekey] = pMat;
+
+			pMat->mapDiffuse = new VETexture(entityName, basedir, { texName });
+		}
+
+		VETerrain *pTerrain = new VETerrain(entityName, pMesh, pMat, basedir + "/" + heightmap, size, heightScale, transf, parent);
+		addSceneNode(pTerrain);
+		getRendererPointer()->addEntityToSubrenderer(pTerrain);
+
+		return pTerrain;
+	}
+
+
+	/**
+	*
+	* \brief Create an impostor for distant instances of a model
+	*
+	* The quad mesh is shared by all impostors and created with the first one. The atlases are baked from the
+	* prototype, or loaded from the mesh cache directory. Add the instances with VEImpostor::addInstance().
+	* The impostor gets its own material, so no material with the name of the entity may exist yet.
+	*
+	* \param[in] entityName Name of the new entity, also the name of its material
+	* \param[in] pPrototype Root of the model, e.g. returned by loadModel()
+	* \param[in] distance Instances farther away than this are drawn as impostors
+	* \returns a pointer to the new impostor
+	*
+	*/
+	VEImpostor * VESceneManager::createImpostor(std::string entityName, VESceneNode *pPrototype, float distance) {
+		VEMesh *pMesh = m_meshes[VE_IMPOSTOR_QUAD_MESH];
+		if (pMesh == nullptr) {
+			pMesh = VEImpostor::createQuadMesh();
+			m_meshes[VE_IMPOSTOR_QUAD_MESH] = pMesh;
+		}
+
+		if (getMaterial(entityName) != nullptr) {				//the atlases would replace the maps of the existing material
+			throw std::runtime_error("Error: Material " + entityName + " for impostor exists already!");
+		}
+
+		VEMaterial *pMat = new VEMaterial(entityName);
+		VEImpostor *pImpostor = nullptr;
+		try {
+			pImpostor = new VEImpostor(entityName, pMesh, pMat, pPrototype, distance);
+		}
+		catch (...) {
+			delete pMat;
+			throw;
+		}
+		m_materials[entityName] = pMat;
+		addSceneNode(pImpostor);
+		getRendererPointer()->addEntityToSubrenderer(pImpostor);
+
+		return pImpostor;
+	}
+
+
 	//----------------------------------------------------------------------------------------------------------------
 	//scene management stuff
 
@@ -612,7 +1316,8 @@ namespace ve {
 	*
 	* \brief Find all scene nodes without a parent, then update them and their children
 	*
-	* Makes this nodes and their children to copy their data to the GPU
+	* Makes this nodes and their children to copy their data to the GPU. Then the ECS computes the transforms
+	* of its entities without scene nodes and runs its systems.
 	*
 	* \param[in] imageIndex Index of the swapchain image that is currently used.
 	*
@@ -623,6 +1328,251 @@ namespace ve {
 				pSceneNode.second->update(imageIndex);
 			}
 		}
+
+		m_ecs.updateTransforms();							//entities without scene nodes
+		m_ecs.runSystems(getEnginePointer()->m_dt);
+
+		if (m_pBroadphase != nullptr) {
+			m_pBroadphase->update();						//entity boxes are up to date now
+
+			for (auto &pair : m_pBroadphase->getChangedPairs()) {	//send begin and end of collisions to the event listeners
+				veEvent event(VE_EVENT_COLLISION);
+				event.ptr = &pair;
+				event.idata1 = pair.m_begin ? 1 : 0;
+				getEnginePointer()->callListeners(getEnginePointer()->m_dt, event);
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Create the broadphase collision detection
+	*
+	* After this, entities can be added with getBroadphase()->addEntity(). In each call of updateSceneNodes(),
+	* pairs that began or ended to overlap are sent as VE_EVENT_COLLISION events, idata1 is 1 for begin and 0 for end.
+	*
+	* \param[in] type Sweep and prune or spatial hash
+	* \param[in] cellSize Edge length of the hash cells, with sweep and prune only used for finding large proxies
+	*
+	*/
+	void VESceneManager::enableBroadphase(VEBroadphase::veBroadphaseType type, float cellSize) {
+		disableBroadphase();
+		m_pBroadphase = new VEBroadphase(type, cellSize);
+	}
+
+
+	/**
+	*
+	* \brief Delete the broadphase collision detection
+	*
+	*/
+	void VESceneManager::disableBroadphase() {
+		if (m_pBroadphase == nullptr) return;
+
+		for (auto pSceneNode : m_sceneNodes) {
+			if (pSceneNode.second->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY) {
+				((VEEntity*)pSceneNode.second)->m_broadphaseProxy = VE_BROADPHASE_NO_PROXY;
+			}
+		}
+		delete m_pBroadphase;
+		m_pBroadphase = nullptr;
+	}
+
+
+	/**
+	*
+	* \brief Create the octree and add all normal entities to it
+	*
+	* Normal entities created later are added automatically. The octree follows the entities as they move,
+	* and can then be queried for all entities in a sphere, box or frustum with getOctree().
+	*
+	* \param[in] center Center of the root cube, should be the center of the scene
+	* \param[in] halfSize Half edge length of the root cube, should cover the whole scene
+	* \param[in] maxDepth Deepest level of nodes
+	*
+	*/
+	void VESceneManager::enableOctree(glm::vec3 center, float halfSize, uint32_t maxDepth) {
+		disableOctree();
+		m_pOctree = new VEOctree(center, halfSize, maxDepth);
+
+		for (auto pSceneNode : m_sceneNodes) {
+			if (pSceneNode.second->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY &&
+				((VEEntity*)pSceneNode.second)->getEntityType() == VEEntity::VE_ENTITY_TYPE_NORMAL) {
+				m_pOctree->addEntity((VEEntity*)pSceneNode.second);
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Delete the octree
+	*
+	*/
+	void VESceneManager::disableOctree() {
+		if (m_pOctree == nullptr) return;
+
+		for (auto pSceneNode : m_sceneNodes) {
+			if (pSceneNode.second->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY) {
+				((VEEntity*)pSceneNode.second)->m_octreeProxy = VE_OCTREE_NO_PROXY;
+			}
+		}
+		delete m_pOctree;
+		m_pOctree = nullptr;
+	}
+
+
+	/**
+	*
+	* \brief Build or refit the BVH over all entities that can be hit by rays
+	*
+	* The BVH is built again only if scene nodes have been added or removed, or if refitting made it
+	* VE_BVH_MAX_REFIT_COST times as expensive as right after the build. Otherwise, it is refitted to the
+	* current entity boxes, at most once per render loop. Entities moved after this in the same loop
+	* are found at their old place.
+	*
+	*/
+	void VESceneManager::updateSceneBVH() {
+		uint32_t loop = getEnginePointer()->getLoopCount();
+		if (!m_sceneBVHDirty && loop == m_sceneBVHLoop) return;
+
+		VEBVH::veBuildStats &stats = m_sceneBVH.getStats();
+		if (!m_sceneBVHDirty && stats.m_sahCost <= VE_BVH_MAX_REFIT_COST * stats.m_buildSahCost) {
+			std::vector<cl::clAABB> boxes(m_sceneBVHEntities.size());
+			for (uint32_t i = 0; i < m_sceneBVHEntities.size(); i++) {
+				glm::mat4 worldMatrix = m_sceneBVHEntities[i]->getWorldTransform();
+				boxes[i] = m_sceneBVHEntities[i]->getWorldBoundingBox(worldMatrix);
+				m_sceneBVHInvWorld[i] = glm::inverse(worldMatrix);
+			}
+			m_sceneBVH.refit(boxes);
+			m_sceneBVHLoop = loop;
+			return;
+		}
+
+		m_sceneBVHEntities.clear();
+		m_sceneBVHInvWorld.clear();
+		std::vector<cl::clAABB> boxes;
+
+		for (auto pSceneNode : m_sceneNodes) {
+			if (pSceneNode.second->getNodeType() != VESceneNode::VE_OBJECT_TYPE_ENTITY) continue;
+
+			VEEntity *pEntity = (VEEntity*)pSceneNode.second;
+			if (pEntity->getEntityType() != VEEntity::VE_ENTITY_TYPE_NORMAL ||			//no sky boxes
+				pEntity->m_pMesh == nullptr || pEntity->m_pMesh->m_bvh.empty()) continue;
+
+			glm::mat4 worldMatrix = pEntity->getWorldTransform();
+			boxes.push_back(pEntity->getWorldBoundingBox(worldMatrix));
+			m_sceneBVHEntities.push_back(pEntity);
+			m_sceneBVHInvWorld.push_back(glm::inverse(worldMatrix));
+		}
+
+		m_sceneBVH.m_maxLeafSize = 2;
+		m_sceneBVH.build(boxes);
+		m_sceneBVHLoop = loop;
+		m_sceneBVHDirty = false;
+	}
+
+
+	/**
+	*
+	* \brief Find the closest entity triangle hit by a ray
+	*
+	* Entity boxes are found with the scene BVH. Then the ray is transformed into the local space of the entity
+	* and tested against the triangle BVH of its mesh. Only entities of type VE_ENTITY_TYPE_NORMAL are hit.
+	*
+	* \param[in] origin World space start of the ray
+	* \param[in] dir World space direction of the ray, does not have to be normalized
+	* \param[in] maxDist Maximum distance of a hit from the origin
+	* \param[in] mask Only entities whose m_raycastMask shares a bit with this are hit
+	* \param[out] hit Entity, triangle, distance, barycentric coordinates and position of the closest hit
+	* \returns whether an entity was hit
+	*
+	*/
+	bool VESceneManager::raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, uint32_t mask, veRayHit &hit) {
+		updateSceneBVH();
+		return raycastSceneBVH(origin, dir, maxDist, mask, hit);
+	}
+
+
+	/**
+	*
+	* \brief Cast many rays
+	*
+	* Large batches are split among the threads of the engine thread pool.
+	*
+	* \param[in] origins World space start of each ray
+	* \param[in] dirs World space direction of each ray
+	* \param[in] maxDist Maximum distance of a hit from the origin
+	* \param[in] mask Only entities whose m_raycastMask shares a bit with this are hit
+	* \param[out] hits Closest hit of each ray, m_pEntity is nullptr if the ray hit nothing
+	*
+	*/
+	void VESceneManager::raycast(	std::vector<glm::vec3> &origins, std::vector<glm::vec3> &dirs, float maxDist,
+									uint32_t mask, std::vector<veRayHit> &hits) {
+		updateSceneBVH();
+
+		uint32_t numRays = (uint32_t)std::min(origins.size(), dirs.size());
+		hits.resize(numRays);
+
+		uint32_t numThreads = numRays >= 256 ? std::max(1u, std::min(std::thread::hardware_concurrency(), 16u)) : 1;
+		if (numThreads == 1) {
+			for (uint32_t i = 0; i < numRays; i++) raycastSceneBVH(origins[i], dirs[i], maxDist, mask, hits[i]);
+			return;
+		}
+
+		std::vector<std::future<void>> futures;
+		uint32_t raysPerThread = (numRays + numThreads - 1) / numThreads;
+		for (uint32_t start = 0; start < numRays; start += raysPerThread) {
+			uint32_t end = std::min(start + raysPerThread, numRays);
+			futures.push_back(getEnginePointer()->m_threadPool->submit([&, start, end]() {
+				for (uint32_t i = start; i < end; i++) raycastSceneBVH(origins[i], dirs[i], maxDist, mask, hits[i]);
+			}));
+		}
+		for (auto &future : futures) future.get();
+	}
+
+
+	/**
+	*
+	* \brief Cast a ray using the current scene BVH, can be called from several threads at once
+	*
+	* \param[in] origin World space start of the ray
+	* \param[in] dir World space direction of the ray
+	* \param[in] maxDist Maximum distance of a hit from the origin
+	* \param[in] mask Only entities whose m_raycastMask shares a bit with this are hit
+	* \param[out] hit The closest hit
+	* \returns whether an entity was hit
+	*
+	*/
+	bool VESceneManager::raycastSceneBVH(glm::vec3 origin, glm::vec3 dir, float maxDist, uint32_t mask, veRayHit &hit) {
+		hit = veRayHit();
+		float len = glm::length(dir);
+		if (len == 0.0f) return false;
+
+		cl::clRay ray(origin, dir / len);		//ray parameters are distances
+		float maxT = maxDist;
+
+		m_sceneBVH.traverse(ray, maxT, [&](uint32_t item, float &tmax) {
+			VEEntity *pEntity = m_sceneBVHEntities[item];
+			if ((pEntity->m_raycastMask & mask) == 0) return false;
+
+			glm::mat4 &invWorld = m_sceneBVHInvWorld[item];		//affine, so ray parameters stay the same
+			cl::clRay local(glm::vec3(invWorld * glm::vec4(ray.origin, 1.0f)), glm::vec3(invWorld * glm::vec4(ray.direction, 0.0f)));
+			uint32_t triangle;
+			glm::vec2 barycentrics;
+			if (!pEntity->m_pMesh->raycast(local, tmax, triangle, barycentrics)) return false;
+
+			hit.m_pEntity = pEntity;
+			hit.m_triangle = triangle;
+			hit.m_barycentrics = barycentrics;
+			hit.m_distance = tmax;
+			return true;
+		});
+
+		if (hit.m_pEntity == nullptr) return false;
+		hit.m_position = ray.origin + hit.m_distance * ray.direction;
+		return true;
 	}
 
 
@@ -631,12 +1581,22 @@ namespace ve {
 	*
 	* \brief Find an entity using its name
 	*
+	* If the scene node has been removed by flattenSceneNodes(), the node that replaced it is returned.
+	*
 	* \param[in] name Name of the entity.
 	* \returns a pointer to the entity
 	*
 	*/
-	VESceneNode * VESceneManager::getSceneNode(std::string name) {
-		if (m_sceneNodes.count(name) > 0) return m_sceneNodes[name];
+	VESceneNode * VESceneManager::getSceneNode(veName name) {
+		auto node = m_sceneNodes.find(name);
+		if (node != m_sceneNodes.end()) return node->second;
+
+		auto alias = m_sceneNodeAliases.find(name);			//node may have been removed by flattening
+		while (alias != m_sceneNodeAliases.end()) {
+			auto it = m_sceneNodes.find(alias->second);
+			if (it != m_sceneNodes.end()) return it->second;
+			alias = m_sceneNodeAliases.find(alias->second);
+		}
 		return nullptr;
 	}
 
@@ -645,26 +1605,38 @@ namespace ve {
 	*
 	* \brief Delete an entity and all its subentities
 	*
+	* Names of flattened scene nodes that were replaced by one of the deleted nodes are forgotten.
+	*
 	* \param[in] name Name of the entity.
 	*
 	*/
-	void VESceneManager::deleteSceneNodeAndChildren(std::string name) {
-		VESceneNode * pObject = m_sceneNodes[name];
-		if (pObject == nullptr) return;
+	void VESceneManager::deleteSceneNodeAndChildren(veName name) {
+		auto it = m_sceneNodes.find(name);
+		if (it == m_sceneNodes.end() || it->second == nullptr) return;
+		VESceneNode * pObject = it->second;
 		if (pObject->m_parent != nullptr) pObject->m_parent->removeChild(pObject);
 
-		std::vector<std::string> namelist;	//first create a list of all child names
+		m_sceneBVHDirty = true;
+		std::vector<veName> namelist;	//first create a list of all child names
 		createSceneNodeList(pObject, namelist);
 
 		//go through the list and delete all children
 		for (uint32_t i = 0; i < namelist.size(); i++) {
 			pObject = m_sceneNodes[namelist[i]];
 
-			if( pObject->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY )
+			if (pObject->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY) {
 				getRendererPointer()->removeEntityFromSubrenderers((VEEntity*)pObject);
+				if (m_pBroadphase != nullptr) m_pBroadphase->removeEntity((VEEntity*)pObject);
+				if (m_pOctree != nullptr) m_pOctree->removeEntity((VEEntity*)pObject);
+			}
 			m_sceneNodes.erase(namelist[i]);
 			delete pObject;
 		}
+
+		for (auto it = m_sceneNodeAliases.begin(); it != m_sceneNodeAliases.end(); ) {	//forget names of flattened nodes replaced by deleted nodes
+			if (getSceneNode(it->first) == nullptr) it = m_sceneNodeAliases.erase(it);
+			else ++it;
+		}
 	}
 
 	/**
@@ -675,8 +1647,8 @@ namespace ve {
 	* \param[out] namelist List of names of children of the entity.
 	*
 	*/
-	void VESceneManager::createSceneNodeList(VESceneNode *pObject, std::vector<std::string> &namelist) {
-		namelist.push_back(pObject->getName());
+	void VESceneManager::createSceneNodeList(VESceneNode *pObject, std::vector<veName> &namelist) {
+		namelist.push_back(pObject->getNameID());
 
 		for( uint32_t i=0; i<pObject->m_children.size(); i++ ) {
 			createSceneNodeList(pObject->m_children[i], namelist );
@@ -690,12 +1662,12 @@ namespace ve {
 	* \param[in] name Name of the mesh.
 	*
 	*/
-	void VESceneManager::deleteMesh(std::string name) {
-		VEMesh * pMesh = m_meshes[name];
-		if (pMesh != nullptr) {
-			m_meshes.erase(name);
-			delete pMesh;
-		}
+	void VESceneManager::deleteMesh(veName name) {
+		auto it = m_meshes.find(name);
+		if (it == m_meshes.end()) return;
+		VEMesh * pMesh = it->second;
+		m_meshes.erase(it);
+		delete pMesh;
 	}
 
 	/**
@@ -705,12 +1677,12 @@ namespace ve {
 	* \param[in] name Name of the material.
 	*
 	*/
-	void VESceneManager::deleteMaterial(std::string name) {
-		VEMaterial * pMat = m_materials[name];
-		if (pMat != nullptr) {
-			m_materials.erase(name);
-			delete pMat;
-		}
+	void VESceneManager::deleteMaterial(veName name) {
+		auto it = m_materials.find(name);
+		if (it == m_materials.end()) return;
+		VEMaterial * pMat = it->second;
+		m_materials.erase(it);
+		delete pMat;
 	}
 
 
@@ -753,34 +1725,78 @@ namespace ve {
 	* \brief Close down the scene manager and delete all its assets.
 	*/
 	void VESceneManager::closeSceneManager() {
+		disableBroadphase();
+		disableOctree();
 		for (auto ent : m_sceneNodes) 
 			delete ent.second;
 		for (auto mesh : m_meshes) delete mesh.second;
 		for (auto mat : m_materials) delete mat.second;
+		clearBatchImports();
 	}
 
 	/**
-	* \brief Print a list of all entities to the console.
+	* \brief Log a list of all entities.
 	*/
 	void VESceneManager::printSceneNodes() {
 		for (auto pEnt : m_sceneNodes) {
-			std::cout << pEnt.second->getName() << "\n";
+			VHLOGINFO("%s", pEnt.second->getName());
 		}
 	}
 
 	/**
 	*
-	* \brief Print a list of all entities in an entity tree to the console.
+	* \brief Log a list of all entities in an entity tree.
 	*
 	* \param[in] root Pointer to the root entity of the tree.
 	*
 	*/
 	void VESceneManager::printTree(VESceneNode *root ) {
-		std::cout << root->getName() << "\n";
+		VHLOGINFO("%s", root->getName());
 		for (uint32_t i = 0; i < root->m_children.size(); i++) {
 			printTree( root->m_children[i] );
 		}
 	}
 
-}
+	/**
+	*
+	* \brief Log all meshes with the build time and quality of their triangle BVHs.
+	*
+	*/
+	void VESceneManager::printMeshes() {
+		for (auto pMesh : m_meshes) {
+			VEBVH::veBuildStats &stats = pMesh.second->m_bvh.getStats();
+			if (pMesh.second->m_bvh.empty()) {
+				VHLOGINFO("%s triangles %u no BVH", pMesh.second->getName(), stats.m_numItems);
+				continue;
+			}
+			VHLOGINFO("%s triangles %u %s %g ms nodes %u leaves %u depth %u leaf size %g SAH cost %g",
+					pMesh.second->getName(), stats.m_numItems, stats.m_loaded ? "loaded" : "built", stats.m_buildTime,
+					stats.m_numNodes, stats.m_numLeaves, stats.m_maxDepth, stats.m_avgLeafSize, stats.m_sahCost);
+		}
+	}
+
 
+	/**
+	*
+	* \brief Log all nodes of the octree with their entity counts.
+	*
+	* Each line shows the depth and cube of a node, the entities stored in it, and the entities in its whole subtree.
+	*
+	*/
+	void VESceneManager::printOctree() {
+		if (m_pOctree == nullptr) return;
+
+		std::vector<VEOctree::veNode> &nodes = m_pOctree->getNodes();
+		std::vector<uint32_t> stack = { 0 };
+		while (!stack.empty()) {
+			VEOctree::veNode &node = nodes[stack.back()];
+			stack.pop_back();
+
+			VHLOGINFO("%*sdepth %u cell %u %u %u entities %u subtree %u", (int)(2 * node.m_depth), "", node.m_depth,
+					node.m_cell.x, node.m_cell.y, node.m_cell.z, (uint32_t)node.m_proxies.size(), node.m_numEntities);
+			for (int32_t i = 7; i >= 0; i--) {
+				if (node.m_children[i] != VE_OCTREE_NO_NODE) stack.push_back(node.m_children[i]);
+			}
+		}
+	}
+}
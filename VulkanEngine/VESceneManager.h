@@ -37,19 +37,68 @@ namespace ve {
 		friend VERendererForward;
 		friend VESubrenderFW_Shadow;
 
+	public:
+
+		///Result of a ray cast
+		struct veRayHit {
+			VEEntity *	m_pEntity = nullptr;		///<Entity that was hit, or nullptr
+			uint32_t	m_triangle = 0;				///<Triangle of the entity mesh that was hit
+			float		m_distance = 0.0f;			///<Distance of the hit point from the ray origin
+			glm::vec2	m_barycentrics;				///<Barycentric coordinates of the hit point in the triangle
+			glm::vec3	m_position;					///<World space hit point
+		};
+
 	protected:
-		std::map<std::string, VEMesh *>		m_meshes = {};		///<Storage of all meshes currently in the engine
-		std::map<std::string, VEMaterial*>	m_materials = {};	///<Storage of all materials currently in the engine
-		std::map<std::string, VESceneNode*>	m_sceneNodes = {};	///<Storage of all scene nodes currently in the engine
+		std::unordered_map<veName, VEMesh *>		m_meshes = {};		///<Storage of all meshes currently in the engine
+		std::unordered_map<veName, VEMaterial*>		m_materials = {};	///<Storage of all materials currently in the engine
+		std::unordered_map<veName, VESceneNode*>	m_sceneNodes = {};	///<Storage of all scene nodes currently in the engine
+		std::unordered_map<veName, veName>			m_sceneNodeAliases = {};	///<Names of flattened scene nodes mapped to the nodes that replaced them
 
 		VECamera *				m_camera = nullptr;			///<entity ptr of the current camera
 		std::vector<VELight*>	m_lights = {};				///<ptrs to the lights to use
+		VEBroadphase *			m_pBroadphase = nullptr;	///<Finds overlapping entities, or nullptr
+		VEOctree *				m_pOctree = nullptr;		///<Spatial index of all normal entities, or nullptr
+		VEECS					m_ecs;						///<Component storage of all scene nodes and ECS entities
+
+		VEBVH					m_sceneBVH;					///<BVH over the world boxes of all entities with a mesh
+		std::vector<VEEntity*>	m_sceneBVHEntities;			///<Entity of each item of the scene BVH
+		std::vector<glm::mat4>	m_sceneBVHInvWorld;			///<Inverse world matrix of each item of the scene BVH
+		uint32_t				m_sceneBVHLoop = 0xFFFFFFFF;	///<Render loop in which the scene BVH was built or refitted
+		bool					m_sceneBVHDirty = true;		///<Scene nodes have been added or removed since
+		bool					m_retainMeshGeometry = false;	///<New meshes keep a CPU copy and a triangle BVH
+		std::string				m_meshCacheDir = "";		///<Directory for cached mesh BVHs, empty for no caching
+		bool					m_useObjLoader = true;		///<loadModel() reads OBJ files with VEObjLoader instead of Assimp
+		bool					m_useGltfLoader = true;		///<loadModel() reads glTF files with VEGltfLoader instead of Assimp
+		std::vector<std::pair<std::string, std::future<Assimp::Importer*>>> m_standardAssets;	///<Standard meshes being imported on the thread pool
+		std::unordered_map<std::string, Assimp::Importer*> m_batchImports = {};	///<Files imported by loadModelsBatched(), by file key and flags
 
+		///Merged geometry of all meshes of a model that share one material
+		struct veBatchGeometry {
+			VEMaterial *				m_pMaterial = nullptr;	///<Material of all merged meshes
+			std::vector<vh::vhVertex>	m_vertices = {};		///<Vertices with node transforms baked in
+			std::vector<uint32_t>		m_indices = {};			///<Indices into m_vertices
+		};
+
+		virtual void prefetchStandardAssets();
 		virtual void initSceneManager();
+		Assimp::Importer * importAssets(std::string basedir, std::string filename, uint32_t aiFlags);
 		virtual void closeSceneManager();
 		void copyAiNodes(	const aiScene* pScene, 
 							std::vector<VEMesh*> &meshes, std::vector<VEMaterial*> &materials, 
-							aiNode* node, VESceneNode *parent);
+							aiNode* node, VESceneNode *parent, std::string &nameBuffer);
+		void copyGltfNodes(	VEGltfLoader &loader, std::vector<std::vector<VEMesh*>> &meshes,
+							std::vector<VEMaterial*> &materials, uint32_t node, VESceneNode *parent,
+							std::string &nameBuffer, uint32_t depth);
+		void flattenSceneNode(VESceneNode *pNode);
+		void updateSceneBVH();
+		bool raycastSceneBVH(glm::vec3 origin, glm::vec3 dir, float maxDist, uint32_t mask, veRayHit &hit);
+		const aiScene * getBatchImport(std::string basedir, std::string filename, uint32_t aiFlags);
+		void batchModel(	const aiScene *pScene, std::string basedir, std::string filekey,
+							std::vector<glm::mat4> &transforms, std::vector<veBatchGeometry> &batches);
+		void batchAiNodes(	const aiScene* pScene, std::vector<VEMaterial*> &materials,
+							aiNode* node, glm::mat4 parentTransf, std::vector<veBatchGeometry> &batches);
+		VESceneNode * createBatchedEntities(std::string entityName, std::string meshPrefix,
+											std::vector<veBatchGeometry> &batches, VESceneNode *parent);
 
 	public:
 		///Constructor
@@ -65,6 +114,13 @@ namespace ve {
 		void			createMeshes(const aiScene* pScene,std::string filekey, std::vector<VEMesh*> &meshes);
 		void			createMaterials(const aiScene* pScene,  std::string basedir, std::string filekey, std::vector<VEMaterial*> &materials);
 		VESceneNode *	loadModel(std::string entityName, std::string basedir, std::string filename, uint32_t aiFlags=0, VESceneNode *parent=nullptr);
+		VESceneNode *	loadObjModel(std::string entityName, std::string basedir, std::string filename, VESceneNode *parent = nullptr);
+		VESceneNode *	loadGltfModel(std::string entityName, std::string basedir, std::string filename, VESceneNode *parent = nullptr);
+		VESceneNode *	loadModelBatched(std::string entityName, std::string basedir, std::string filename, uint32_t aiFlags = 0, VESceneNode *parent = nullptr);
+		VESceneNode *	loadModelsBatched(	std::string entityName, std::string basedir,
+											std::vector<std::string> filenames, std::vector<glm::mat4> transforms,
+											uint32_t aiFlags = 0, VESceneNode *parent = nullptr);
+		void			clearBatchImports();			//free the files kept by loadModelsBatched()
 
 		//-------------------------------------------------------------------------------------
 		//Create scene nodes and entities
@@ -81,15 +137,50 @@ namespace ve {
 		VEEntity *		createSkyplane(std::string entityName, std::string basedir, std::string texName);
 		VESceneNode *	createSkybox(std::string entityName, std::string basedir, std::vector<std::string> texNames);
 
+		//-------------------------------------------------------------------------------------
+		//Create terrains
+
+		VETerrain *		createTerrain(	std::string entityName, std::string basedir, std::string heightmap, std::string texName,
+										float size, float heightScale, glm::mat4 transf = glm::mat4(1.0f), VESceneNode *parent = nullptr);
+
+		//-------------------------------------------------------------------------------------
+		//Create impostors
+
+		VEImpostor *	createImpostor(std::string entityName, VESceneNode *pPrototype, float distance);
+
 		//-------------------------------------------------------------------------------------
 		//Manage scene nodes and entities
 
 		void			updateSceneNodes( uint32_t imageIndex );
 		///Add a scene node to the scene
-		void			addSceneNode(VESceneNode *entity) { m_sceneNodes[entity->getName()] = entity; };
-		VESceneNode *	getSceneNode(std::string entityName);
-		void			deleteSceneNodeAndChildren(std::string name);
-		void			createSceneNodeList(VESceneNode *pObject, std::vector<std::string> &namelist);
+		void			addSceneNode(VESceneNode *entity) { m_sceneNodes[entity->getNameID()] = entity; m_sceneBVHDirty = true; };
+		VESceneNode *	getSceneNode(veName entityName);
+		///\returns the scene node of a name, or nullptr. The string is looked up without interning it.
+		VESceneNode *	getSceneNode(const std::string &entityName) { veName name; return veName::find(entityName, name) ? getSceneNode(name) : nullptr; };
+		void			deleteSceneNodeAndChildren(veName name);
+		///Delete a scene node and its children, if the name exists
+		void			deleteSceneNodeAndChildren(const std::string &name) { veName id; if (veName::find(name, id)) deleteSceneNodeAndChildren(id); };
+		void			createSceneNodeList(VESceneNode *pObject, std::vector<veName> &namelist);
+		void			flattenSceneNodes(VESceneNode *root);
+		///\returns the ECS holding the data of all scene nodes and entities without scene nodes
+		VEECS *			getECS() { return &m_ecs; };
+
+		//-------------------------------------------------------------------------------------
+		//Collision detection
+
+		void			enableBroadphase(VEBroadphase::veBroadphaseType type, float cellSize = 10.0f);	//create the broadphase
+		void			disableBroadphase();				//delete the broadphase
+		///\returns the broadphase, or nullptr if it is not enabled
+		VEBroadphase *	getBroadphase() { return m_pBroadphase; };
+
+		void			enableOctree(glm::vec3 center, float halfSize, uint32_t maxDepth = 8);	//create the octree
+		void			disableOctree();					//delete the octree
+		///\returns the octree, or nullptr if it is not enabled
+		VEOctree *		getOctree() { return m_pOctree; };
+
+		bool			raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, uint32_t mask, veRayHit &hit);	//closest entity triangle hit by a ray
+		void			raycast(std::vector<glm::vec3> &origins, std::vector<glm::vec3> &dirs, float maxDist,
+								uint32_t mask, std::vector<veRayHit> &hits);	//cast many rays in parallel
 
 		//-------------------------------------------------------------------------------------
 		//Manage meshes, materials, cameras, lights
@@ -97,17 +188,57 @@ namespace ve {
 		/**
 		* \brief Find a mesh by its name and return a pointer to it
 		* \param[in] name The name of mesh
-		* \returns a mesh given its name
+		* \returns a mesh given its name, or nullptr
 		*/
-		VEMesh *		getMesh(std::string name) { return m_meshes[name]; };
-		void			deleteMesh(std::string name);
+		VEMesh *		getMesh(veName name) { auto it = m_meshes.find(name); return it != m_meshes.end() ? it->second : nullptr; };
+		///\returns the mesh of a name, or nullptr. The string is looked up without interning it.
+		VEMesh *		getMesh(const std::string &name) { veName id; return veName::find(name, id) ? getMesh(id) : nullptr; };
+		void			deleteMesh(veName name);
+		///Delete a mesh, if the name exists
+		void			deleteMesh(const std::string &name) { veName id; if (veName::find(name, id)) deleteMesh(id); };
 		/**
 		* \brief Find a material by its name and return a pointer to it
 		* \param[in] name The name of material
-		* \returns a material given its name
+		* \returns a material given its name, or nullptr
+		*/
+		VEMaterial *	getMaterial(veName name) { auto it = m_materials.find(name); return it != m_materials.end() ? it->second : nullptr; };
+		///\returns the material of a name, or nullptr. The string is looked up without interning it.
+		VEMaterial *	getMaterial(const std::string &name) { veName id; return veName::find(name, id) ? getMaterial(id) : nullptr; };
+		void			deleteMaterial(veName name);
+		///Delete a material, if the name exists
+		void			deleteMaterial(const std::string &name) { veName id; if (veName::find(name, id)) deleteMaterial(id); };
+
+		/**
+		* \brief Choose whether new meshes keep a CPU copy of their geometry and a triangle BVH, needed for ray casts
+		*
+		* Off by default. Ray casts do not hit entities whose mesh was created while it was off.
+		*
+		* \param[in] retain If true, the geometry of new meshes is retained
+		*/
+		void			setRetainMeshGeometry(bool retain) { m_retainMeshGeometry = retain; };
+		///\returns whether new meshes keep a CPU copy of their geometry
+		bool			getRetainMeshGeometry() { return m_retainMeshGeometry; };
+		/**
+		* \brief Set the directory where mesh BVHs are cached, the directory must exist
+		* \param[in] dir The directory, an empty string switches caching off
+		*/
+		void			setMeshCacheDir(std::string dir) { m_meshCacheDir = dir; };
+		///\returns the directory where mesh BVHs are cached
+		std::string		getMeshCacheDir() { return m_meshCacheDir; };
+		/**
+		* \brief Choose whether loadModel() reads OBJ files with VEObjLoader, Assimp is still used if this fails
+		* \param[in] use If true, OBJ files are read with VEObjLoader
+		*/
+		void			setUseObjLoader(bool use) { m_useObjLoader = use; };
+		///\returns whether loadModel() reads OBJ files with VEObjLoader
+		bool			getUseObjLoader() { return m_useObjLoader; };
+		/**
+		* \brief Choose whether loadModel() reads .gltf and .glb files with VEGltfLoader, Assimp is still used if this fails
+		* \param[in] use If true, glTF files are read with VEGltfLoader
 		*/
-		VEMaterial *	getMaterial(std::string name) { return m_materials[name]; };
-		void			deleteMaterial(std::string name);
+		void			setUseGltfLoader(bool use) { m_useGltfLoader = use; };
+		///\returns whether loadModel() reads glTF files with VEGltfLoader
+		bool			getUseGltfLoader() { return m_useGltfLoader; };
 
 		///\returns a pointer to the current camera
 		VECamera*		getCamera() { return m_camera; };
@@ -126,6 +257,8 @@ namespace ve {
 
 		void			printSceneNodes();
 		void			printTree(VESceneNode *root);
+		void			printMeshes();
+		void			printOctree();
 	};
 
 }
@@ -25,6 +25,8 @@ namespace ve {
 	* \brief Close down the subrenderer and destroy all local resources.
 	*/
 	void VESubrender::closeSubrenderer() {
+		destroyPermutations();
+
 		for (auto pipeline : m_pipelines) {
 			vkDestroyPipeline(getRendererPointer()->getDevice(), pipeline, nullptr);
 		}
@@ -37,19 +39,177 @@ namespace ve {
 
 
 	/**
+	*
+	* \brief Fill in the specialization constants of a feature key
+	*
+	* \param[in] featureKey The feature key, a combination of veShaderFeature bits
+	*
+	*/
+	veSpecialization::veSpecialization(uint32_t featureKey) {
+		m_constants[0] = featureKey & VESubrender::VE_SHADER_FEATURE_LIGHT_TYPE_MASK;
+		m_constants[1] = (featureKey & VESubrender::VE_SHADER_FEATURE_SHADOWS) != 0 ? VK_TRUE : VK_FALSE;
+		m_constants[2] = featureKey;
+
+		for (uint32_t i = 0; i < 3; i++) {
+			m_entries[i].constantID = i;
+			m_entries[i].offset = i * sizeof(uint32_t);
+			m_entries[i].size = sizeof(uint32_t);
+		}
+
+		m_info.mapEntryCount = 3;
+		m_info.pMapEntries = m_entries;
+		m_info.dataSize = sizeof(m_constants);
+		m_info.pData = m_constants;
+	}
+
+
+	/**
+	*
 	* \brief Bind the subrenderer's pipeline to a commandbuffer
 	*
+	* If the subrenderer has shader permutations, the permutation for the light is bound. It is created now
+	* if neither initSubrenderer() nor warmPermutations() have created it.
+	*
 	* \param[in] commandBuffer The command buffer to bind the pipeline to
+	* \param[in] pLight Pointer to the light of the pass, may be nullptr
 	*
 	*/
-	void VESubrender::bindPipeline( VkCommandBuffer commandBuffer ) {
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[0]);	//bind the PSO
+	void VESubrender::bindPipeline(VkCommandBuffer commandBuffer, VELight *pLight) {
+		VkPipeline pipeline = m_shaderFileNames.empty() ? m_pipelines[0] : getPermutation(getFeatureKey(pLight));
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);	//bind the PSO
+	}
+
+
+	/**
+	*
+	* \brief Get the features needed to draw with a light
+	*
+	* \param[in] pLight Pointer to the light, may be nullptr
+	* \returns the feature key, only bits in m_featureMask are set
+	*
+	*/
+	uint32_t VESubrender::getFeatureKey(VELight *pLight) {
+		if (pLight == nullptr) return 0;
+
+		uint32_t featureKey = (uint32_t)pLight->getLightType();
+		if (pLight->m_shadowCameras.size() > 0) featureKey |= VE_SHADER_FEATURE_SHADOWS;
+		return featureKey & m_featureMask;
+	}
+
+
+	/**
+	*
+	* \brief Get the pipeline of a shader permutation, create it if it does not exist yet
+	*
+	* Can be called from any thread. If another thread is creating the permutation, this waits for it,
+	* so each permutation is created only once.
+	*
+	* \param[in] featureKey The feature key, bits outside m_featureMask are ignored
+	* \returns the pipeline
+	*
+	*/
+	VkPipeline VESubrender::getPermutation(uint32_t featureKey) {
+		featureKey &= m_featureMask;
+
+		std::promise<VkPipeline> promise;
+		std::shared_future<VkPipeline> result = promise.get_future().share();
+		{
+			std::unique_lock<std::mutex> lock(m_permutationMutex);
+			auto it = m_permutations.find(featureKey);
+			if (it != m_permutations.end()) {
+				std::shared_future<VkPipeline> pipeline = it->second;
+				lock.unlock();
+				return pipeline.get();
+			}
+			m_permutations[featureKey] = result;
+		}
+
+		try {
+			promise.set_value(createPermutation(featureKey));		//outside the lock, this may take long
+		}
+		catch (...) {
+			promise.set_exception(std::current_exception());		//threads waiting for it get the error too
+			std::lock_guard<std::mutex> lock(m_permutationMutex);
+			m_permutations.erase(featureKey);
+			throw;
+		}
+		return result.get();
+	}
+
+
+	/**
+	*
+	* \brief Create the pipeline of a shader permutation
+	*
+	* The default uses m_shaderFileNames and m_dynamicStates for the light pass. Permutations share the pipeline cache
+	* of the renderer, so permutations created in an earlier run are fast to create.
+	*
+	* \param[in] featureKey The feature key, turned into specialization constants
+	* \returns the new pipeline
+	*
+	*/
+	VkPipeline VESubrender::createPermutation(uint32_t featureKey) {
+		veSpecialization specialization(featureKey);
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VECHECKRESULT(vh::vhPipeCreateGraphicsPipeline(	getRendererForwardPointer()->getDevice(),
+														m_shaderFileNames,
+														getRendererForwardPointer()->getSwapChainExtent(),
+														m_pipelineLayout, getRendererForwardPointer()->getRenderPass(),
+														m_dynamicStates, &pipeline,
+														&specialization.m_info, getRendererForwardPointer()->getPipelineCache()),
+						"Error: Could not create shader permutation");
+		return pipeline;
+	}
+
+
+	/**
+	*
+	* \brief Create all permutations of the shaders on the thread pool
+	*
+	* Creates a permutation for each combination of the bits in m_featureMask. Must be called from the main thread,
+	* since it submits to the thread pool. Permutations that are needed before their warmup is done are
+	* created right away or waited for.
+	*
+	*/
+	void VESubrender::warmPermutations() {
+		if (m_shaderFileNames.empty()) return;
+
+		for (uint32_t featureKey = 0; featureKey <= m_featureMask; featureKey++) {
+			if ((featureKey & ~m_featureMask) != 0) continue;
+			if ((featureKey & VE_SHADER_FEATURE_LIGHT_TYPE_MASK) > VELight::VE_LIGHT_TYPE_SPOT) continue;
+			if ((featureKey & VE_SHADER_FEATURE_GPU_CULLING) != 0 && getGPUCulling() == nullptr) continue;	//created when culling is used
+
+			m_warmups.push_back(getEnginePointer()->m_threadPool->submit([this, featureKey]() {
+				getPermutation(featureKey);
+			}));
+		}
+	}
+
+
+	/**
+	*
+	* \brief Wait for all warmups, then destroy all permutations
+	*
+	* Failed warmups are ignored, the permutation is created again when it is used.
+	*
+	*/
+	void VESubrender::destroyPermutations() {
+		for (auto &warmup : m_warmups) warmup.wait();
+		m_warmups.clear();
+
+		for (auto &permutation : m_permutations) {
+			vkDestroyPipeline(getRendererPointer()->getDevice(), permutation.second.get(), nullptr);
+		}
+		m_permutations.clear();
 	}
 
 
 	/**
 	* \brief Bind per frame descriptor sets to the pipeline layout
 	*
+	* This starts a run of draws, so the per object state bound by the previous run is forgotten.
+	*
 	* \param[in] commandBuffer The command buffer that is used for recording commands
 	* \param[in] imageIndex The index of the swapchain image that is currently used
 	* \param[in] pCamera Pointer to the current light camera
@@ -59,7 +219,7 @@ namespace ve {
 	*/
 	void VESubrender::bindDescriptorSetsPerFrame(	VkCommandBuffer commandBuffer, uint32_t imageIndex,
 													VECamera *pCamera, VELight *pLight, 
-													std::vector<VkDescriptorSet> descriptorSetsShadow ) {
+													vh::vhSpan<VkDescriptorSet> descriptorSetsShadow ) {
 
 		//set 0...cam UBO
 		//set 1...light resources
@@ -67,14 +227,18 @@ namespace ve {
 		//set 3...per object UBO
 		//set 4...additional per object resources
 
-		std::vector<VkDescriptorSet> set =
-			{ pCamera->m_descriptorSetsUBO[imageIndex], pLight->m_descriptorSetsUBO[imageIndex] };
+		VkDescriptorSet set[3] =
+			{ pCamera->m_descriptorSetsUBO[imageIndex], pLight->m_descriptorSetsUBO[imageIndex], VK_NULL_HANDLE };
+		uint32_t numSets = 2;
 
 		if(descriptorSetsShadow.size()>0) {
-			set.push_back(descriptorSetsShadow[imageIndex]);
+			set[numSets++] = descriptorSetsShadow[imageIndex];
 		}
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, (uint32_t)set.size(), set.data(), 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, numSets, set, 0, nullptr);
+
+		m_pBoundMaterial = nullptr;
+		m_pBoundMesh = nullptr;
 	}
 
 
@@ -82,7 +246,9 @@ namespace ve {
 	*
 	* \brief Bind default descriptor sets
 	*
-	* The function binds the default descriptor sets. Can be overloaded.
+	* The function binds the default descriptor sets. Can be overloaded. The resource set holds only material
+	* resources, so it is bound only if the material differs from the previous entity of the run.
+	* Entities without a material always bind their resource set, since nothing tells whether it is the same.
 	*
 	* \param[in] commandBuffer The command buffer to record into all draw calls
 	* \param[in] imageIndex Index of the current swap chain image
@@ -97,12 +263,14 @@ namespace ve {
 		//set 3...per object UBO
 		//set 4...additional per object resources
 
-		std::vector<VkDescriptorSet> sets = { entity->m_descriptorSetsUBO[imageIndex] };
-		if (entity->m_descriptorSetsResources.size() > 0) {
-			sets.push_back( entity->m_descriptorSetsResources[imageIndex] );
+		VkDescriptorSet sets[2] = { entity->m_descriptorSetsUBO[imageIndex], VK_NULL_HANDLE };
+		uint32_t numSets = 1;
+		if (entity->m_descriptorSetsResources.size() > 0 && (entity->m_pMaterial == nullptr || entity->m_pMaterial != m_pBoundMaterial)) {
+			sets[numSets++] = entity->m_descriptorSetsResources[imageIndex];
 		}
+		m_pBoundMaterial = entity->m_pMaterial;
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 3, (uint32_t)sets.size(), sets.data(), 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 3, numSets, sets, 0, nullptr);
 	}
 
 
@@ -123,32 +291,39 @@ namespace ve {
 	void VESubrender::draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex,
 							uint32_t numPass,
 							VECamera *pCamera, VELight *pLight,
-							std::vector<VkDescriptorSet> descriptorSetsShadow) {
+							vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {
 
 		if (m_entities.size() == 0) return;
 
 		if (numPass > 0 && getClass() != VE_SUBRENDERER_CLASS_OBJECT) return;
 
-		bindPipeline(commandBuffer);
+		bindPipeline(commandBuffer, pLight);
 
 		setDynamicPipelineState( commandBuffer, numPass );
 
 		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow );
 
+		VEGPUCulling *pCulling = getGPUCulling();
+		bool culling = pCulling != nullptr && pCulling->isCulling();
+
 		//go through all entities and draw them
 		for (auto pEntity : m_entities) {
+			if (culling && pEntity->m_cullSlot != VE_CULL_NO_SLOT) continue;		//drawn with its group
 			if (pEntity->m_drawEntity ) {
 				bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pEntity);	//bind the entity's descriptor sets
 				drawEntity(commandBuffer, imageIndex, pEntity);
 			}
 		}
+
+		drawCulledGroups(commandBuffer, imageIndex, numPass, pCamera, pLight, descriptorSetsShadow, false);
 	}
 
 	/**
 	*
 	* \brief Draw one entity
 	*
-	* The function binds the vertex buffer, index buffer, and descriptor set of the entity, then commits a draw call 
+	* The function binds the vertex buffer and index buffer of the entity if its mesh differs from the previous
+	* entity of the run, then commits a draw call.
 	*
 	* \param[in] commandBuffer The command buffer to record into all draw calls
 	* \param[in] imageIndex Index of the current swap chain image
@@ -157,16 +332,213 @@ namespace ve {
 	*/
 	void VESubrender::drawEntity(VkCommandBuffer commandBuffer, uint32_t imageIndex, VEEntity *entity) {
 
-		VkBuffer vertexBuffers[] = { entity->m_pMesh->m_vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);	//bind vertex buffer
+		if (entity->m_pMesh != m_pBoundMesh) {
+			m_pBoundMesh = entity->m_pMesh;
 
-		vkCmdBindIndexBuffer(commandBuffer, entity->m_pMesh->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32); //bind index buffer
+			bindVertexBuffers(commandBuffer, entity->m_pMesh);		//bind vertex buffer
+
+			vkCmdBindIndexBuffer(commandBuffer, entity->m_pMesh->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32); //bind index buffer
+		}
 
 		vkCmdDrawIndexed(commandBuffer, entity->m_pMesh->m_indexCount, 1, 0, 0, 0); //record the draw call
 	}
 
 
+	/**
+	*
+	* \brief Bind the position and attribute streams of a mesh
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] pMesh Pointer to the mesh
+	*
+	*/
+	void VESubrender::bindVertexBuffers(VkCommandBuffer commandBuffer, VEMesh *pMesh) {
+		VkBuffer vertexBuffers[] = { pMesh->m_vertexBuffer, pMesh->m_vertexBuffer };
+		VkDeviceSize offsets[] = { 0, pMesh->m_attributeOffset };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+	}
+
+
+	/**
+	*
+	* \brief Add all entities that should be drawn in this pass to a render queue
+	*
+	* Background subrenderers are put into a lower pass than object subrenderers, so the background is drawn first
+	* as before. Background subrenderers take part only in the first light pass.
+	* If the view is culled on the GPU, entities with a culling slot are not added, instead each group of this
+	* subrenderer is added once.
+	*
+	* \param[in] queue The render queue to add the entities to
+	* \param[in] numPass The number of the light that is rendered
+	* \param[in] pCamera Pointer to the camera, used for sorting front to back
+	*
+	*/
+	void VESubrender::addToRenderQueue(VERenderQueue &queue, uint32_t numPass, VECamera *pCamera) {
+		if (numPass > 0 && getClass() != VE_SUBRENDERER_CLASS_OBJECT) return;
+
+		uint32_t pass = getClass() == VE_SUBRENDERER_CLASS_BACKGROUND ? 0 : 1;
+
+		VEGPUCulling *pCulling = getGPUCulling();
+		bool culling = pCulling != nullptr && pCulling->isCulling();
+
+		for (auto pEntity : m_entities) {
+			if (culling && pEntity->m_cullSlot != VE_CULL_NO_SLOT) continue;		//drawn with its group
+			if (pEntity->m_drawEntity) {
+				queue.addDrawItem(pass, this, pEntity, pCamera);
+			}
+		}
+
+		if (!culling) return;
+		for (uint32_t i = 0; i < pCulling->getNumberGroups(); i++) {
+			VEGPUCulling::veCullGroup &group = pCulling->getGroup(i);
+			if (group.m_pSubrender == this && !group.m_entities.empty()) {
+				queue.addDrawItem(pass, this, group.m_entities[0], pCamera, i);
+			}
+		}
+	}
+
+
+	/**
+	*
+	* \brief Draw a sorted run of draw items
+	*
+	* All items have been sorted by the render queue and belong to this subrenderer. The pipeline and per frame
+	* descriptor sets are bound once for the whole run. Each entity is drawn with bindDescriptorSetsPerEntity() and
+	* drawEntity(), so derived subrenderers can override them. Since the items are sorted, material resources and
+	* vertex and index buffers are bound only when the material or mesh changes.
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	* \param[in] pDrawItems Pointer to the first draw item of the run
+	* \param[in] numDrawItems Number of draw items in the run
+	*
+	*/
+	void VESubrender::drawSorted(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+									VECamera *pCamera, VELight *pLight,
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+									VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems) {
+
+		if (numDrawItems == 0) return;
+
+		bindPipeline(commandBuffer, pLight);
+
+		setDynamicPipelineState(commandBuffer, numPass);
+
+		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+		for (uint32_t i = 0; i < numDrawItems; i++) {
+			bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pDrawItems[i].m_pEntity);	//bind the entity's descriptor sets
+			drawEntity(commandBuffer, imageIndex, pDrawItems[i].m_pEntity);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Draw a sorted run of culled groups
+	*
+	* All items have been sorted by the render queue, belong to this subrenderer and are groups of the GPU culling.
+	* The culled permutation of the pipeline, the per frame descriptor sets and the culling set are bound once for
+	* the whole run. Each group binds the sets of its first entity and its mesh, and is drawn with one instanced
+	* indirect draw, whose instances are the entities of the group that are visible in the current view.
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	* \param[in] pDrawItems Pointer to the first draw item of the run
+	* \param[in] numDrawItems Number of draw items in the run
+	*
+	*/
+	void VESubrender::drawCulled(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+									VECamera *pCamera, VELight *pLight,
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+									VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems) {
+
+		if (numDrawItems == 0) return;
+
+		VEGPUCulling *pCulling = getGPUCulling();
+
+		VkPipeline pipeline = getPermutation(getFeatureKey(pLight) | VE_SHADER_FEATURE_GPU_CULLING);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+		setDynamicPipelineState(commandBuffer, numPass);
+
+		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+		VkDescriptorSet set = pCulling->getDrawDescriptorSet(imageIndex);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, getCullingSet(), 1, &set, 0, nullptr);
+
+		for (uint32_t i = 0; i < numDrawItems; i++) {
+			VEEntity *pEntity = pDrawItems[i].m_pEntity;
+			bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pEntity);
+
+			if (pEntity->m_pMesh != m_pBoundMesh) {
+				m_pBoundMesh = pEntity->m_pMesh;
+				bindVertexBuffers(commandBuffer, pEntity->m_pMesh);
+				vkCmdBindIndexBuffer(commandBuffer, pEntity->m_pMesh->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			}
+
+			pCulling->drawGroup(commandBuffer, imageIndex, m_pipelineLayout, pDrawItems[i].m_cullGroup);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Draw the culled groups of the current view without a render queue
+	*
+	* Used by draw(), which does not sort. Does nothing if the current view is not culled on the GPU.
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	* \param[in] allGroups If true, draw the groups of all subrenderers (shadow pass), otherwise only the own groups
+	*
+	*/
+	void VESubrender::drawCulledGroups(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+										VECamera *pCamera, VELight *pLight,
+										vh::vhSpan<VkDescriptorSet> descriptorSetsShadow, bool allGroups) {
+
+		VEGPUCulling *pCulling = getGPUCulling();
+		if (pCulling == nullptr || !pCulling->isCulling()) return;
+
+		vh::vhSpan<VERenderQueue::veDrawItem> items =
+			getEnginePointer()->getFrameArena().allocate<VERenderQueue::veDrawItem>(pCulling->getNumberGroups());
+		uint32_t numItems = 0;
+		for (uint32_t i = 0; i < pCulling->getNumberGroups(); i++) {
+			VEGPUCulling::veCullGroup &group = pCulling->getGroup(i);
+			if (group.m_entities.empty() || (!allGroups && group.m_pSubrender != this)) continue;
+			items[numItems++] = { 0, this, group.m_entities[0], i };
+		}
+
+		drawCulled(commandBuffer, imageIndex, numPass, pCamera, pLight, descriptorSetsShadow, items.data(), numItems);
+	}
+
+
+	/**
+	*
+	* \brief Get the GPU culling of the forward renderer
+	*
+	* Defined here so that subrenderer templates in the header do not depend on VERendererForward.
+	*
+	* \returns the GPU culling, or nullptr if culling is disabled
+	*
+	*/
+	VEGPUCulling * VESubrender::getGPUCulling() {
+		return getRendererForwardPointer()->getGPUCulling();
+	}
+
+
 	/**
 	*
 	* \brief Add an entity to the list of associated entities.
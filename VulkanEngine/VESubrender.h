@@ -11,6 +11,55 @@ class VERenderer;
 
 namespace ve {
 
+	/**
+	*
+	* \brief Compile time properties of a subrenderer, used to specialize its draw loop
+	*
+	* \tparam NumResourceSets Per object resource sets bound after the per object UBO set, 0 or 1
+	* \tparam NumVertexStreams 1 for positions only, 2 for positions and attributes
+	* \tparam IndexType Type of the indices in the index buffers
+	* \tparam PushConstants If true, veDrawRecord::m_pushConstant is pushed to the vertex shader at offset 0
+	*
+	*/
+	template<uint32_t NumResourceSets, uint32_t NumVertexStreams, VkIndexType IndexType, bool PushConstants>
+	struct veSubrenderTraits {
+		static const uint32_t		m_numResourceSets = NumResourceSets;	///<Resource sets after the UBO set
+		static const uint32_t		m_numVertexStreams = NumVertexStreams;	///<Bound vertex streams
+		static const VkIndexType	m_indexType = IndexType;				///<Type of the indices
+		static const bool			m_pushConstants = PushConstants;		///<Push a uint32_t per draw
+	};
+
+	/**
+	*
+	* \brief Specialization constants of a shader permutation
+	*
+	* Shaders declare the constants they need, constants they do not declare are ignored:
+	* - constant_id 0: int, the light type, see VELight::veLightType
+	* - constant_id 1: bool, the light casts shadows
+	* - constant_id 2: uint, the whole feature key, for features added by derived subrenderers
+	*
+	* The info points into the struct itself, so it must not be copied while it is in use.
+	*
+	*/
+	struct veSpecialization {
+		uint32_t					m_constants[3];		///<Values of the constants
+		VkSpecializationMapEntry	m_entries[3];		///<Map of the constants
+		VkSpecializationInfo		m_info;				///<Passed to pipeline creation
+
+		veSpecialization(uint32_t featureKey);		//constants of a feature key
+	};
+
+	///Everything needed to record one draw, gathered from the entity before recording starts
+	struct veDrawRecord {
+		VkDescriptorSet	m_descriptorSets[2];	///<Per object UBO set and resource set, bound to sets 3 and 4
+		VEMaterial *	m_pMaterial;			///<Material of the entity, the resource set is bound only if it changes
+		VkBuffer		m_vertexBuffer;			///<Buffer with the position and attribute streams
+		VkDeviceSize	m_attributeOffset;		///<Start of the attribute stream
+		VkBuffer		m_indexBuffer;			///<Index buffer of the mesh
+		uint32_t		m_indexCount;			///<Number of indices
+		uint32_t		m_pushConstant;			///<Value pushed if the subrenderer uses push constants, 0 unless set by a derived subrenderer
+	};
+
 
 	/**
 	*
@@ -47,7 +96,18 @@ namespace ve {
 			VE_SUBRENDERER_TYPE_SKYPLANE,					///<Use a skyplane to create a sky box
 			VE_SUBRENDERER_TYPE_TERRAIN_WITH_HEIGHTMAP,		///<A tesselated terrain using a height map
 			VE_SUBRENDERER_TYPE_NUKLEAR,					///<A Nuklear based GUI
-			VE_SUBRENDERER_TYPE_SHADOW						///<Draw entities for the shadow pass
+			VE_SUBRENDERER_TYPE_SHADOW,						///<Draw entities for the shadow pass
+			VE_SUBRENDERER_TYPE_IMPOSTOR					///<Instanced impostors sampling a baked atlas
+		};
+
+		/**
+		* \brief Bits of a feature key, each key selects one permutation of the shaders
+		*/
+		enum veShaderFeature {
+			VE_SHADER_FEATURE_LIGHT_TYPE_MASK = 3,			///<Two bits holding the VELight::veLightType
+			VE_SHADER_FEATURE_SHADOWS = 4,					///<The light casts shadows
+			VE_SHADER_FEATURE_GPU_CULLING = 8,				///<Instances of a VEGPUCulling group, the subrenderer supports GPU culling if set in m_featureMask
+			VE_SHADER_FEATURE_USER = 16						///<First bit free for derived subrenderers
 		};
 
 	protected:
@@ -57,6 +117,25 @@ namespace ve {
 
 		std::vector<VEEntity *> m_entities;											///<List of associated entities
 
+		std::vector<std::string>	m_shaderFileNames;								///<Shaders of the permutations, empty if only m_pipelines is used
+		std::vector<VkDynamicState>	m_dynamicStates;								///<Dynamic states of the permutations
+		uint32_t					m_featureMask = 0;								///<Features the shaders depend on, other bits are cleared from keys
+		std::unordered_map<uint32_t, std::shared_future<VkPipeline>> m_permutations;	///<Pipelines created or being created, by feature key
+		std::mutex					m_permutationMutex;								///<Guards m_permutations, permutations are also created by warmups
+		std::vector<std::future<void>> m_warmups;									///<Permutations being created in the background
+
+		VEMaterial *				m_pBoundMaterial = nullptr;						///<Material whose resource set is bound in the current run, nullptr if none or unknown
+		VEMesh *					m_pBoundMesh = nullptr;							///<Mesh whose buffers are bound in the current run
+
+		VEGPUCulling *	getGPUCulling();		//the GPU culling of the forward renderer, or nullptr
+		void			drawCulledGroups(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+											VECamera *pCamera, VELight *pLight,
+											vh::vhSpan<VkDescriptorSet> descriptorSetsShadow, bool allGroups);	//draw the culled groups of the current view
+		///\returns the index of the descriptor set of the culled instances, it follows the per object sets
+		uint32_t		getCullingSet() { return m_descriptorSetLayoutResources != VK_NULL_HANDLE ? 5 : 4; };
+		virtual VkPipeline createPermutation(uint32_t featureKey);	//create the pipeline of a shader permutation
+		void			destroyPermutations();	//wait for warmups and destroy all permutations
+
 	public:
 		///Constructor of subrender class
 		VESubrender() {};
@@ -67,16 +146,23 @@ namespace ve {
 		virtual veSubrenderClass getClass() = 0;
 		///\returns the type of the subrenderer
 		virtual veSubrenderType getType() = 0;
+		///\returns true if initSubrenderer() must run on the main thread, otherwise it may run on the thread pool
+		virtual bool needsMainThread() { return false; };
 
 		///Create descriptor set layout, pipeline layout and PSO
 		virtual void	initSubrenderer() {};
 		virtual void	closeSubrenderer();
 		virtual void	recreateResources();
 
-		virtual void	bindPipeline(VkCommandBuffer commandBuffer);
+		virtual void	bindPipeline(VkCommandBuffer commandBuffer, VELight *pLight);
+		virtual uint32_t getFeatureKey(VELight *pLight);			//features needed to draw with a light
+		VkPipeline		getPermutation(uint32_t featureKey);		//get or create the pipeline of a feature key
+		void			warmPermutations();							//create all permutations in the background
+		///\returns the number of permutations created or being created
+		uint32_t		getNumPermutations() { std::lock_guard<std::mutex> lock(m_permutationMutex); return (uint32_t)m_permutations.size(); };
 		virtual void	bindDescriptorSetsPerFrame(	VkCommandBuffer commandBuffer, uint32_t imageIndex,
 													VECamera *pCamera, VELight *pLight,
-													std::vector<VkDescriptorSet> descriptorSetsShadow);
+													vh::vhSpan<VkDescriptorSet> descriptorSetsShadow);
 		virtual void	bindDescriptorSetsPerEntity(VkCommandBuffer commandBuffer, uint32_t imageIndex, VEEntity *entity);
 
 		///Set the dynamic state of the pipeline - does nothing for the base class
@@ -85,7 +171,7 @@ namespace ve {
 		//Draw all entities that are managed by this subrenderer
 		virtual void	draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
 								VECamera *pCamera, VELight *pLight,
-								std::vector<VkDescriptorSet> descriptorSetsShadow);
+								vh::vhSpan<VkDescriptorSet> descriptorSetsShadow);
 
 		///Prepare to perform draw operation
 		virtual void prepareDraw() {};
@@ -95,15 +181,186 @@ namespace ve {
 		virtual VkSemaphore	draw(uint32_t imageIndex, VkSemaphore wait_semaphore) { return VK_NULL_HANDLE; };
 
 		virtual void	drawEntity(VkCommandBuffer commandBuffer, uint32_t imageIndex, VEEntity *entity);
+		virtual void	bindVertexBuffers(VkCommandBuffer commandBuffer, VEMesh *pMesh);
+
+		//Add all entities to draw in this pass to a render queue
+		virtual void	addToRenderQueue(VERenderQueue &queue, uint32_t numPass, VECamera *pCamera);
+
+		//Draw a sorted run of draw items from a render queue
+		virtual void	drawSorted(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+									VECamera *pCamera, VELight *pLight,
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+									VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems);
+
+		//Draw a sorted run of culled groups from a render queue
+		virtual void	drawCulled(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+									VECamera *pCamera, VELight *pLight,
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+									VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems);
 		
 		virtual void	addEntity( VEEntity *pEntity );
 		virtual void	removeEntity(VEEntity *pEntity);
 		///\returns the number of entities that this sub renderer manages
 		uint32_t		getNumberEntities() { return (uint32_t)m_entities.size(); };
+		///\returns the features the shaders depend on
+		uint32_t		getFeatureMask() { return m_featureMask; };
 		
 		///return the layout of the local pipeline
 		VkPipelineLayout getPipelineLayout() { return m_pipelineLayout; };
 	};
 
 
+	/**
+	*
+	* \brief A subrenderer whose draw loop is specialized for its traits
+	*
+	* drawSorted() and draw() first gather a contiguous array of veDrawRecord in the frame arena, then record
+	* all draws in a loop that is compiled for the traits: the number of descriptor sets, vertex streams, the index
+	* type and whether push constants are used are constants, and there are no virtual calls per draw.
+	* Entities culled on the GPU are not drawn one by one, their groups are drawn by VESubrender::drawCulled().
+	*
+	* Subrenderers derived from this class must not rely on overriding bindDescriptorSetsPerEntity(),
+	* bindVertexBuffers() or drawEntity() for these two functions, the traits describe what they bind instead.
+	*
+	* \tparam Traits A veSubrenderTraits instance
+	*
+	*/
+	template<typename Traits>
+	class VESubrenderT : public VESubrender {
+
+	protected:
+
+		/**
+		* \brief Gather the draw record of an entity
+		* \param[in] pEntity Pointer to the entity
+		* \param[in] imageIndex Index of the current swap chain image
+		* \param[out] record The draw record
+		*/
+		static void gatherDrawRecord(VEEntity *pEntity, uint32_t imageIndex, veDrawRecord &record) {
+			VEMesh *pMesh = pEntity->m_pMesh;
+			record.m_descriptorSets[0] = pEntity->m_descriptorSetsUBO[imageIndex];
+			record.m_descriptorSets[1] = Traits::m_numResourceSets > 0 ? pEntity->m_descriptorSetsResources[imageIndex] : VK_NULL_HANDLE;
+			record.m_pMaterial = pEntity->m_pMaterial;
+			record.m_vertexBuffer = pMesh->m_vertexBuffer;
+			record.m_attributeOffset = pMesh->m_attributeOffset;
+			record.m_indexBuffer = pMesh->m_indexBuffer;
+			record.m_indexCount = pMesh->m_indexCount;
+			record.m_pushConstant = 0;
+		}
+
+		/**
+		*
+		* \brief Record the draws of an array of draw records
+		*
+		* The resource set is bound only if the material differs from the previous record, since it holds only
+		* material resources. Records without a material always bind it. Vertex and index buffers are bound
+		* only if they differ from the previous record.
+		*
+		* \param[in] commandBuffer The command buffer to record into
+		* \param[in] pipelineLayout Layout of the bound pipeline
+		* \param[in] records The draw records
+		*
+		*/
+		static void recordDraws(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, vh::vhSpan<const veDrawRecord> records) {
+
+			VkBuffer vertexBuffer = VK_NULL_HANDLE;
+			VkBuffer indexBuffer = VK_NULL_HANDLE;
+			VEMaterial *pMaterial = nullptr;
+			for (const veDrawRecord &record : records) {
+				uint32_t numSets = 1;
+				if (Traits::m_numResourceSets > 0 && (record.m_pMaterial == nullptr || record.m_pMaterial != pMaterial)) {
+					numSets += Traits::m_numResourceSets;
+				}
+				pMaterial = record.m_pMaterial;
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 3,
+										numSets, record.m_descriptorSets, 0, nullptr);
+
+				if (record.m_vertexBuffer != vertexBuffer || record.m_indexBuffer != indexBuffer) {
+					vertexBuffer = record.m_vertexBuffer;
+					indexBuffer = record.m_indexBuffer;
+
+					VkBuffer vertexBuffers[] = { vertexBuffer, vertexBuffer };
+					VkDeviceSize offsets[] = { 0, record.m_attributeOffset };
+					vkCmdBindVertexBuffers(commandBuffer, 0, Traits::m_numVertexStreams, vertexBuffers, offsets);
+					vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, Traits::m_indexType);
+				}
+
+				if (Traits::m_pushConstants) {
+					vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &record.m_pushConstant);
+				}
+
+				vkCmdDrawIndexed(commandBuffer, record.m_indexCount, 1, 0, 0, 0);
+			}
+		}
+
+	public:
+		typedef Traits veTraits;	///<Traits of this subrenderer
+
+		///Constructor
+		VESubrenderT() {};
+		///Destructor
+		virtual ~VESubrenderT() {};
+
+		/**
+		*
+		* \brief Draw all entities that are managed by this subrenderer, see VESubrender::draw()
+		*
+		*/
+		virtual void draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+							VECamera *pCamera, VELight *pLight,
+							vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {
+
+			if (m_entities.size() == 0) return;
+
+			if (numPass > 0 && getClass() != VE_SUBRENDERER_CLASS_OBJECT) return;
+
+			bindPipeline(commandBuffer, pLight);
+
+			setDynamicPipelineState(commandBuffer, numPass);
+
+			bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+			VEGPUCulling *pCulling = getGPUCulling();
+			bool culling = pCulling != nullptr && pCulling->isCulling();
+
+			vh::vhSpan<veDrawRecord> records = getEnginePointer()->getFrameArena().allocate<veDrawRecord>(m_entities.size());
+			uint32_t numRecords = 0;
+			for (auto pEntity : m_entities) {
+				if (culling && pEntity->m_cullSlot != VE_CULL_NO_SLOT) continue;		//drawn with its group
+				if (pEntity->m_drawEntity) gatherDrawRecord(pEntity, imageIndex, records[numRecords++]);
+			}
+
+			recordDraws(commandBuffer, m_pipelineLayout, vh::vhSpan<const veDrawRecord>(records.data(), numRecords));
+
+			drawCulledGroups(commandBuffer, imageIndex, numPass, pCamera, pLight, descriptorSetsShadow, false);
+		}
+
+		/**
+		*
+		* \brief Draw a sorted run of draw items, see VESubrender::drawSorted()
+		*
+		*/
+		virtual void drawSorted(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+								VECamera *pCamera, VELight *pLight,
+								vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+								VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems) {
+
+			if (numDrawItems == 0) return;
+
+			bindPipeline(commandBuffer, pLight);
+
+			setDynamicPipelineState(commandBuffer, numPass);
+
+			bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+			vh::vhSpan<veDrawRecord> records = getEnginePointer()->getFrameArena().allocate<veDrawRecord>(numDrawItems);
+			for (uint32_t i = 0; i < numDrawItems; i++) {
+				gatherDrawRecord(pDrawItems[i].m_pEntity, imageIndex, records[i]);
+			}
+
+			recordDraws(commandBuffer, m_pipelineLayout, vh::vhSpan<const veDrawRecord>(records.data(), numDrawItems));
+		}
+	};
+
+
 }
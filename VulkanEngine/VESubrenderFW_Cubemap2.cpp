@@ -32,13 +32,9 @@ namespace ve {
 			{},
 			&m_pipelineLayout);
 
-		m_pipelines.resize(1);
-		vh::vhPipeCreateGraphicsPipeline(getRendererForwardPointer()->getDevice(),
-			{ "shader/Forward/Cubemap2/vert.spv", "shader/Forward/Cubemap2/frag.spv" },
-			getRendererForwardPointer()->getSwapChainExtent(),
-			m_pipelineLayout, getRendererForwardPointer()->getRenderPass(),
-			{},
-			&m_pipelines[0]);
+		m_shaderFileNames = { "shader/Forward/Cubemap2/vert.spv", "shader/Forward/Cubemap2/frag.spv" };
+		m_dynamicStates = { };
+		getPermutation(0);	//the shaders do not depend on the light
 
 	}
 
@@ -12,7 +12,7 @@ namespace ve {
 	/**
 	* \brief Subrenderer that manages entities that are cubemap based sky boxes
 	*/
-	class VESubrenderFW_Cubemap2 : public VESubrender {
+	class VESubrenderFW_Cubemap2 : public VESubrenderT<veSubrenderTraits<1, 2, VK_INDEX_TYPE_UINT32, false>> {
 	protected:
 
 	public:
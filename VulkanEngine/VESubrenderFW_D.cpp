@@ -29,17 +29,15 @@ namespace ve {
 		VkDescriptorSetLayout perObjectLayout = getRendererForwardPointer()->getDescriptorSetLayoutPerObject();
 
 		vh::vhPipeCreateGraphicsPipelineLayout(getRendererForwardPointer()->getDevice(),
-			{ perObjectLayout, perObjectLayout,  getRendererForwardPointer()->getDescriptorSetLayoutShadow(), perObjectLayout, m_descriptorSetLayoutResources },
-			{ },
+			{ perObjectLayout, perObjectLayout,  getRendererForwardPointer()->getDescriptorSetLayoutShadow(), perObjectLayout, m_descriptorSetLayoutResources,
+			  getRendererForwardPointer()->getDescriptorSetLayoutCulling() },
+			{ { VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t) } },		//first slot of a culled group
 			&m_pipelineLayout);
 
-		m_pipelines.resize(1);
-		vh::vhPipeCreateGraphicsPipeline(	getRendererForwardPointer()->getDevice(),
-			{ "shader/Forward/D/vert.spv", "shader/Forward/D/frag.spv" },
-			getRendererForwardPointer()->getSwapChainExtent(),
-			m_pipelineLayout, getRendererForwardPointer()->getRenderPass(),
-			{ VK_DYNAMIC_STATE_BLEND_CONSTANTS },
-			&m_pipelines[0]);
+		m_shaderFileNames = { "shader/Forward/D/vert.spv", "shader/Forward/D/frag.spv" };
+		m_dynamicStates = { VK_DYNAMIC_STATE_BLEND_CONSTANTS };
+		m_featureMask = VE_SHADER_FEATURE_LIGHT_TYPE_MASK | VE_SHADER_FEATURE_SHADOWS | VE_SHADER_FEATURE_GPU_CULLING;
+		getPermutation(VELight::VE_LIGHT_TYPE_DIRECTIONAL | VE_SHADER_FEATURE_SHADOWS);	//the usual permutation, the others are warmed up later
 	}
 
 
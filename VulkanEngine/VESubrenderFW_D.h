@@ -13,7 +13,7 @@ namespace ve {
 	/**
 	* \brief Subrenderer that manages entities that have one diffuse texture for coloring
 	*/
-	class VESubrenderFW_D : public VESubrender {
+	class VESubrenderFW_D : public VESubrenderT<veSubrenderTraits<1, 2, VK_INDEX_TYPE_UINT32, false>> {
 	protected:
 
 	public:
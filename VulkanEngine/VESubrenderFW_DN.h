@@ -12,7 +12,7 @@ namespace ve {
 	/**
 	* \brief Subrenderer that manages entities that have a diffuse texture and a normal map
 	*/
-	class VESubrenderFW_DN : public VESubrender {
+	class VESubrenderFW_DN : public VESubrenderT<veSubrenderTraits<1, 2, VK_INDEX_TYPE_UINT32, false>> {
 	protected:
 
 	public:
@@ -0,0 +1,260 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+/*
+GLSL source of shader/Forward/Impostor/vert.spv, compile with glslangValidator -V impostor.vert -o vert.spv
+
+#version 450
+
+struct Instance { vec4 positionScale; vec4 rotation; };
+
+layout(set = 0, binding = 0) uniform cameraUBO_t { mat4 camModel; mat4 camView; mat4 camProj; vec4 camParam; } cameraUBO;
+layout(set = 4, binding = 2) uniform impostorUBO_t { vec4 sphere; vec4 params; Instance instances[511]; } impostorUBO;
+
+layout(location = 0) in vec3 inPositionL;
+
+layout(location = 0) out vec2 fragAtlasUV;
+layout(location = 1) out vec2 fragCellUV;
+layout(location = 2) flat out vec4 fragRotation;
+layout(location = 3) out vec3 fragPositionW;
+
+vec3 rotate(vec4 q, vec3 v) {
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec2 encodeHemiOct(vec3 d) {
+	vec2 p = d.xz / (abs(d.x) + abs(d.y) + abs(d.z));
+	return vec2(p.x + p.y, p.x - p.y) * 0.5 + 0.5;
+}
+
+vec3 decodeHemiOct(vec2 uv) {
+	vec2 e = uv * 2.0 - 1.0;
+	vec2 p = vec2(e.x + e.y, e.x - e.y) * 0.5;
+	return normalize(vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y));
+}
+
+void getBasis(vec3 dir, out vec3 right, out vec3 up) {
+	up = abs(dir.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+	right = normalize(cross(dir, up));
+	up = cross(right, dir);
+}
+
+void main() {
+	Instance instance = impostorUBO.instances[gl_InstanceIndex];
+	vec4 q = instance.rotation;
+	float scale = instance.positionScale.w;
+	float radius = impostorUBO.sphere.w;
+	vec3 centerW = instance.positionScale.xyz + rotate(q, impostorUBO.sphere.xyz * scale);
+
+	vec3 dirR = rotate(vec4(-q.xyz, q.w), cameraUBO.camModel[3].xyz - centerW);	//view direction in root space
+	dirR = normalize(vec3(dirR.x, max(dirR.y, 0.001 * length(dirR)), dirR.z));		//views from below use the horizon
+
+	float views = impostorUBO.params.x;
+	vec2 cell = round(encodeHemiOct(dirR) * (views - 1.0));
+	vec3 cellDir = decodeHemiOct(cell / (views - 1.0));
+
+	vec3 right, up, cellRight, cellUp;
+	getBasis(dirR, right, up);
+	getBasis(cellDir, cellRight, cellUp);
+
+	vec3 offsetR = (right * inPositionL.x + up * inPositionL.y) * radius;
+	fragCellUV = vec2(dot(offsetR, cellRight), -dot(offsetR, cellUp)) / radius * 0.5 + 0.5;	//reproject into the baked view
+	fragAtlasUV = (cell + fragCellUV) / views;
+	fragRotation = q;
+	fragPositionW = centerW + rotate(q, offsetR * scale);
+
+	gl_Position = cameraUBO.camProj * cameraUBO.camView * vec4(fragPositionW, 1.0);
+}
+
+
+GLSL source of shader/Forward/Impostor/frag.spv, compile with glslangValidator -V impostor.frag -o frag.spv
+
+#version 450
+
+layout(constant_id = 0) const int LIGHT_TYPE = 0;
+
+layout(set = 1, binding = 0) uniform lightUBO_t { ivec4 type; mat4 model; vec4 col_ambient; vec4 col_diffuse; vec4 col_specular; vec4 param; } lightUBO;
+layout(set = 4, binding = 0) uniform sampler2D albedoSampler;
+layout(set = 4, binding = 1) uniform sampler2D normalSampler;
+
+layout(location = 0) in vec2 fragAtlasUV;
+layout(location = 1) in vec2 fragCellUV;
+layout(location = 2) flat in vec4 fragRotation;
+layout(location = 3) in vec3 fragPositionW;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 rotate(vec4 q, vec3 v) {
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() {
+	if (any(lessThan(fragCellUV, vec2(0.0))) || any(greaterThan(fragCellUV, vec2(1.0)))) discard;
+
+	vec4 albedo = texture(albedoSampler, fragAtlasUV);
+	if (albedo.a < 0.5) discard;
+
+	vec3 normalW = normalize(rotate(fragRotation, texture(normalSampler, fragAtlasUV).xyz * 2.0 - 1.0));
+
+	vec3 lightDirW = -normalize(lightUBO.model[2].xyz);
+	float attenuation = 1.0;
+	if (LIGHT_TYPE != 0) {
+		vec3 toLight = lightUBO.model[3].xyz - fragPositionW;
+		lightDirW = normalize(toLight);
+		attenuation = clamp(1.0 - length(toLight) / lightUBO.param.x, 0.0, 1.0);
+	}
+
+	float diffuse = attenuation * max(dot(normalW, lightDirW), 0.0);
+	outColor = vec4(albedo.rgb * (lightUBO.col_ambient.rgb + diffuse * lightUBO.col_diffuse.rgb), 1.0);
+}
+*/
+
+
+namespace ve {
+
+	/**
+	* \brief Initialize the subrenderer
+	*
+	* Create descriptor set layout, pipeline layout and the PSO. The resources of an impostor are the albedo atlas,
+	* the normal atlas and the UBO with its instances.
+	*
+	*/
+	void VESubrenderFW_Impostor::initSubrenderer() {
+		VESubrender::initSubrenderer();
+
+		vh::vhRenderCreateDescriptorSetLayout(getRendererForwardPointer()->getDevice(),
+			{ 1, 1, 1 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER },
+			{ VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_VERTEX_BIT },
+			&m_descriptorSetLayoutResources);
+
+		VkDescriptorSetLayout perObjectLayout = getRendererForwardPointer()->getDescriptorSetLayoutPerObject();
+
+		vh::vhPipeCreateGraphicsPipelineLayout(getRendererForwardPointer()->getDevice(),
+			{ perObjectLayout, perObjectLayout,  getRendererForwardPointer()->getDescriptorSetLayoutShadow(), perObjectLayout, m_descriptorSetLayoutResources },
+			{ },
+			&m_pipelineLayout);
+
+		m_shaderFileNames = { "shader/Forward/Impostor/vert.spv", "shader/Forward/Impostor/frag.spv" };
+		m_dynamicStates = { VK_DYNAMIC_STATE_BLEND_CONSTANTS };
+		m_featureMask = VE_SHADER_FEATURE_LIGHT_TYPE_MASK;
+		getPermutation(VELight::VE_LIGHT_TYPE_DIRECTIONAL);		//the usual permutation, the others are warmed up later
+	}
+
+
+	/**
+	* \brief Set the blend constants, the first light pass overwrites the image, the others add to it
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] numPass The number of the light that is rendered
+	*
+	*/
+	void VESubrenderFW_Impostor::setDynamicPipelineState(VkCommandBuffer commandBuffer, uint32_t numPass) {
+		float blendConstant = numPass == 0 ? 0.0f : 1.0f;
+		float blendConstants[4] = { blendConstant, blendConstant, blendConstant, blendConstant };
+		vkCmdSetBlendConstants(commandBuffer, blendConstants);
+	}
+
+
+	/**
+	* \brief Add an impostor to the subrenderer
+	*
+	* Create a descriptor set per swapchain image, holding the atlases and the impostor buffer of the image
+	*
+	*/
+	void VESubrenderFW_Impostor::addEntity(VEEntity *pEntity) {
+		VESubrender::addEntity(pEntity);
+
+		VEImpostor *pImpostor = (VEImpostor*)pEntity;
+		vh::vhRenderCreateDescriptorSets(getRendererForwardPointer()->getDevice(),
+			(uint32_t)getRendererForwardPointer()->getSwapChainNumber(),
+			m_descriptorSetLayoutResources,
+			getRendererForwardPointer()->getDescriptorPool(),
+			pEntity->m_descriptorSetsResources);
+
+		for (uint32_t i = 0; i < pEntity->m_descriptorSetsResources.size(); i++) {
+			vh::vhRenderUpdateDescriptorSet(getRendererForwardPointer()->getDevice(),
+				pEntity->m_descriptorSetsResources[i],
+				{ VK_NULL_HANDLE, VK_NULL_HANDLE, pImpostor->getBuffer(i) },	//UBOs
+				{ 0, 0, (uint32_t)sizeof(VEImpostor::veUBOImpostor_t) },		//UBO sizes
+				{ { pEntity->m_pMaterial->mapDiffuse->m_imageView }, { pEntity->m_pMaterial->mapNormal->m_imageView }, {} },	//textureImageViews
+				{ { pEntity->m_pMaterial->mapDiffuse->m_sampler }, { pEntity->m_pMaterial->mapNormal->m_sampler }, {} }		//samplers
+			);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Draw all impostors that are managed by this subrenderer
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	*
+	*/
+	void VESubrenderFW_Impostor::draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+										VECamera *pCamera, VELight *pLight,
+										vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {
+
+		if (m_entities.size() == 0) return;
+
+		bindPipeline(commandBuffer, pLight);
+
+		setDynamicPipelineState(commandBuffer, numPass);
+
+		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+		for (auto pEntity : m_entities) {
+			if (!pEntity->m_drawEntity) continue;
+			bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pEntity);
+			((VEImpostor*)pEntity)->recordDraw(commandBuffer, imageIndex);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Draw a sorted run of impostors from a render queue
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	* \param[in] pDrawItems Pointer to the first draw item of the run
+	* \param[in] numDrawItems Number of draw items in the run
+	*
+	*/
+	void VESubrenderFW_Impostor::drawSorted(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+											VECamera *pCamera, VELight *pLight,
+											vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+											VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems) {
+
+		if (numDrawItems == 0) return;
+
+		bindPipeline(commandBuffer, pLight);
+
+		setDynamicPipelineState(commandBuffer, numPass);
+
+		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+		for (uint32_t i = 0; i < numDrawItems; i++) {
+			bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pDrawItems[i].m_pEntity);
+			((VEImpostor*)pDrawItems[i].m_pEntity)->recordDraw(commandBuffer, imageIndex);
+		}
+	}
+}
+
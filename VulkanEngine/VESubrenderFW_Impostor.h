@@ -0,0 +1,46 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+
+namespace ve {
+
+	/**
+	* \brief Subrenderer that draws VEImpostor entities
+	*
+	* Each impostor is one instanced indirect draw of a camera facing quad. The quads sample the albedo and normal
+	* atlases of the impostor and are lit like the other objects.
+	*/
+	class VESubrenderFW_Impostor : public VESubrender {
+	protected:
+
+	public:
+		///Constructor
+		VESubrenderFW_Impostor() {};
+		///Destructor
+		virtual ~VESubrenderFW_Impostor() {};
+
+		///\returns the class of the subrenderer
+		virtual veSubrenderClass getClass() { return VE_SUBRENDERER_CLASS_OBJECT; };
+		///\returns the type of the subrenderer
+		virtual veSubrenderType getType() { return VE_SUBRENDERER_TYPE_IMPOSTOR; };
+
+		virtual void	initSubrenderer();
+		virtual void	setDynamicPipelineState(VkCommandBuffer commandBuffer, uint32_t numPass);
+		virtual void	addEntity(VEEntity *pEntity);
+
+		virtual void	draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+								VECamera *pCamera, VELight *pLight,
+								vh::vhSpan<VkDescriptorSet> descriptorSetsShadow);
+		virtual void	drawSorted(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+									VECamera *pCamera, VELight *pLight,
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+									VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems);
+	};
+}
+
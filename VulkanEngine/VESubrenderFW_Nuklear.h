@@ -26,13 +26,15 @@ namespace ve {
 		virtual veSubrenderClass getClass() { return VE_SUBRENDERER_CLASS_OVERLAY; };
 		///\returns the type of the subrenderer
 		virtual veSubrenderType getType() { return VE_SUBRENDERER_TYPE_NUKLEAR; };
+		///\returns true, Nuklear uses GLFW and the graphics queue when it is initialized
+		virtual bool needsMainThread() { return true; };
 
 		virtual void initSubrenderer();
 		virtual void closeSubrenderer();
 		virtual void prepareDraw();
 		virtual void draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
 							VECamera *pCamera, VELight *pLight,
-							std::vector<VkDescriptorSet> descriptorSetsShadow) {};
+							vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {};
 		virtual VkSemaphore draw(uint32_t imageIndex, VkSemaphore wait_semaphore);
 
 		///\returns the Nuklear context
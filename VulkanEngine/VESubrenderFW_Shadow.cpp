@@ -22,16 +22,37 @@ namespace ve {
 
 		VkDescriptorSetLayout perObjectLayout = getRendererForwardPointer()->getDescriptorSetLayoutPerObject();
 		vh::vhPipeCreateGraphicsPipelineLayout(getRendererForwardPointer()->getDevice(),
-			{ perObjectLayout, perObjectLayout, getRendererForwardPointer()->getDescriptorSetLayoutShadow(), perObjectLayout },
-			{ },
+			{ perObjectLayout, perObjectLayout, getRendererForwardPointer()->getDescriptorSetLayoutShadow(), perObjectLayout,
+			  getRendererForwardPointer()->getDescriptorSetLayoutCulling() },
+			{ { VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t) } },		//first slot of a culled group
 			&m_pipelineLayout);
 
-		m_pipelines.resize(1);
-		vh::vhPipeCreateGraphicsShadowPipeline(getRendererForwardPointer()->getDevice(),
-			"shader/Forward/Shadow/vert.spv", 
-			getRendererForwardPointer()->getShadowMapExtent(),
-			m_pipelineLayout, getRendererForwardPointer()->getRenderPassShadow(),
-			&m_pipelines[0]);
+		m_shaderFileNames = { "shader/Forward/Shadow/vert.spv" };
+		m_featureMask = VE_SHADER_FEATURE_GPU_CULLING;
+		getPermutation(0);	//depth only, does not depend on the light
+	}
+
+
+	/**
+	*
+	* \brief Create the shadow pipeline of a shader permutation
+	*
+	* \param[in] featureKey The feature key, turned into specialization constants
+	* \returns the new pipeline
+	*
+	*/
+	VkPipeline VESubrenderFW_Shadow::createPermutation(uint32_t featureKey) {
+		veSpecialization specialization(featureKey);
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VECHECKRESULT(vh::vhPipeCreateGraphicsShadowPipeline(	getRendererForwardPointer()->getDevice(),
+																m_shaderFileNames[0],
+																getRendererForwardPointer()->getShadowMapExtent(),
+																m_pipelineLayout, getRendererForwardPointer()->getRenderPassShadow(),
+																&pipeline,
+																&specialization.m_info, getRendererForwardPointer()->getPipelineCache()),
+						"Error: Could not create shadow pipeline");
+		return pipeline;
 	}
 
 	/**
@@ -46,6 +67,21 @@ namespace ve {
 	}
 
 
+	/**
+	*
+	* \brief Bind only the position stream of a mesh, the shadow pipeline needs no other attributes
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] pMesh Pointer to the mesh
+	*
+	*/
+	void VESubrenderFW_Shadow::bindVertexBuffers(VkCommandBuffer commandBuffer, VEMesh *pMesh) {
+		VkBuffer vertexBuffers[] = { pMesh->m_vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	}
+
+
 	/**
 	*
 	* \brief Bind default descriptor sets
@@ -65,9 +101,9 @@ namespace ve {
 		//set 3...per object UBO
 		//set 4...additional per object resources
 
-		std::vector<VkDescriptorSet> sets = { entity->m_descriptorSetsUBO[imageIndex] };
+		VkDescriptorSet set = entity->m_descriptorSetsUBO[imageIndex];
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 3, (uint32_t)sets.size(), sets.data(), 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 3, 1, &set, 0, nullptr);
 	}
 
 
@@ -87,24 +123,64 @@ namespace ve {
 	*/
 	void VESubrenderFW_Shadow::draw(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
 									VECamera *pCamera, VELight *pLight,
-									std::vector<VkDescriptorSet> descriptorSetsShadow) {
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {
 
-		bindPipeline(commandBuffer);
+		bindPipeline(commandBuffer, pLight);
 
 		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
 
+		VEGPUCulling *pCulling = getGPUCulling();
+		bool culling = pCulling != nullptr && pCulling->isCulling();
+
 		//go through all entities and draw them
 		for (auto object : getSceneManagerPointer()->m_sceneNodes) {
 			VESceneNode *pObject = object.second;
 			if (pObject->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY) {
 				VEEntity *pEntity = (VEEntity*)pObject;
 
+				if (culling && pEntity->m_cullSlot != VE_CULL_NO_SLOT) continue;		//drawn with its group
 				if (pEntity->m_drawEntity && pEntity->m_castsShadow) {
 					bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pEntity);	//bind the entity's descriptor sets
 					drawEntity(commandBuffer, imageIndex, pEntity);
 				}
 			}
 		}
+
+		drawCulledGroups(commandBuffer, imageIndex, numPass, pCamera, pLight, descriptorSetsShadow, true);
 	}
-}
 
+	/**
+	*
+	* \brief Add all entities that cast shadows to a render queue
+	*
+	* Like draw(), this goes through all scene nodes, since all entities of the scene cast shadows,
+	* regardless of the subrenderer they are drawn with in the light pass. If the view is culled on the GPU,
+	* entities with a culling slot are not added, instead all groups are added once.
+	*
+	* \param[in] queue The render queue to add the entities to
+	* \param[in] pCamera Pointer to the shadow camera, used for sorting front to back
+	*
+	*/
+	void VESubrenderFW_Shadow::addToRenderQueue(VERenderQueue &queue, uint32_t, VECamera *pCamera) {
+		VEGPUCulling *pCulling = getGPUCulling();
+		bool culling = pCulling != nullptr && pCulling->isCulling();
+
+		for (auto object : getSceneManagerPointer()->m_sceneNodes) {
+			VESceneNode *pObject = object.second;
+			if (pObject->getNodeType() == VESceneNode::VE_OBJECT_TYPE_ENTITY) {
+				VEEntity *pEntity = (VEEntity*)pObject;
+
+				if (culling && pEntity->m_cullSlot != VE_CULL_NO_SLOT) continue;		//drawn with its group
+				if (pEntity->m_drawEntity && pEntity->m_castsShadow) {
+					queue.addDrawItem(0, this, pEntity, pCamera);
+				}
+			}
+		}
+
+		if (!culling) return;
+		for (uint32_t i = 0; i < pCulling->getNumberGroups(); i++) {
+			VEGPUCulling::veCullGroup &group = pCulling->getGroup(i);
+			if (!group.m_entities.empty()) queue.addDrawItem(0, this, group.m_entities[0], pCamera, i);
+		}
+	}
+}
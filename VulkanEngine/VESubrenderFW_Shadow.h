@@ -12,8 +12,9 @@ namespace ve {
 	/**
 	* \brief Subrenderer that manages draws the shadow pass
 	*/
-	class VESubrenderFW_Shadow : public VESubrender {
+	class VESubrenderFW_Shadow : public VESubrenderT<veSubrenderTraits<0, 1, VK_INDEX_TYPE_UINT32, false>> {
 	protected:
+		virtual VkPipeline createPermutation(uint32_t featureKey);	//create the shadow pipeline
 
 	public:
 		///Constructor
@@ -29,10 +30,12 @@ namespace ve {
 		virtual void initSubrenderer();
 		virtual void addEntity(VEEntity *pEntity);
 		void bindDescriptorSetsPerEntity(VkCommandBuffer commandBuffer, uint32_t imageIndex, VEEntity *entity);
+		virtual void bindVertexBuffers(VkCommandBuffer commandBuffer, VEMesh *pMesh);
 		//void bindDescriptorSets(VkCommandBuffer commandBuffer, uint32_t imageIndex, VEEntity *entity);
 		virtual void draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
 							VECamera *pCamera, VELight *pLight,
-							std::vector<VkDescriptorSet> descriptorSetsShadow);
+							vh::vhSpan<VkDescriptorSet> descriptorSetsShadow);
+		virtual void addToRenderQueue(VERenderQueue &queue, uint32_t numPass, VECamera *pCamera);
 	};
 }
 
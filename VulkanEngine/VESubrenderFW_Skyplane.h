@@ -12,7 +12,7 @@ namespace ve {
 	/**
 	* \brief Subrenderer that manages entities that are cubemap based sky boxes
 	*/
-	class VESubrenderFW_Skyplane : public VESubrender {
+	class VESubrenderFW_Skyplane : public VESubrenderT<veSubrenderTraits<1, 2, VK_INDEX_TYPE_UINT32, false>> {
 	protected:
 
 	public:
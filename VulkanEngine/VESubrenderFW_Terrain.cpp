@@ -0,0 +1,79 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief Draw all terrains that are managed by this subrenderer
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	*
+	*/
+	void VESubrenderFW_Terrain::draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+										VECamera *pCamera, VELight *pLight,
+										vh::vhSpan<VkDescriptorSet> descriptorSetsShadow) {
+
+		if (m_entities.size() == 0) return;
+
+		bindPipeline(commandBuffer, pLight);
+
+		setDynamicPipelineState(commandBuffer, numPass);
+
+		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+		for (auto pEntity : m_entities) {
+			if (!pEntity->m_drawEntity) continue;
+			bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pEntity);
+			((VETerrain*)pEntity)->recordDraws(commandBuffer, imageIndex);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Draw a sorted run of terrains from a render queue
+	*
+	* \param[in] commandBuffer The command buffer to record into all draw calls
+	* \param[in] imageIndex Index of the current swap chain image
+	* \param[in] numPass The number of the light that has been rendered
+	* \param[in] pCamera Pointer to the current camera
+	* \param[in] pLight Pointer to the current light
+	* \param[in] descriptorSetsShadow The shadow maps to be used.
+	* \param[in] pDrawItems Pointer to the first draw item of the run
+	* \param[in] numDrawItems Number of draw items in the run
+	*
+	*/
+	void VESubrenderFW_Terrain::drawSorted(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+											VECamera *pCamera, VELight *pLight,
+											vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+											VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems) {
+
+		if (numDrawItems == 0) return;
+
+		bindPipeline(commandBuffer, pLight);
+
+		setDynamicPipelineState(commandBuffer, numPass);
+
+		bindDescriptorSetsPerFrame(commandBuffer, imageIndex, pCamera, pLight, descriptorSetsShadow);
+
+		for (uint32_t i = 0; i < numDrawItems; i++) {
+			bindDescriptorSetsPerEntity(commandBuffer, imageIndex, pDrawItems[i].m_pEntity);
+			((VETerrain*)pDrawItems[i].m_pEntity)->recordDraws(commandBuffer, imageIndex);
+		}
+	}
+}
+
@@ -0,0 +1,40 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+
+namespace ve {
+
+	/**
+	* \brief Subrenderer that draws VETerrain entities with their diffuse texture
+	*
+	* Resources, shaders and pipeline state are those of VESubrenderFW_D, only the draws differ: each terrain
+	* records the indirect draws of its selected quadtree nodes.
+	*/
+	class VESubrenderFW_Terrain : public VESubrenderFW_D {
+	protected:
+
+	public:
+		///Constructor
+		VESubrenderFW_Terrain() {};
+		///Destructor
+		virtual ~VESubrenderFW_Terrain() {};
+
+		///\returns the type of the subrenderer
+		virtual veSubrenderType getType() { return VE_SUBRENDERER_TYPE_TERRAIN_WITH_HEIGHTMAP; };
+
+		virtual void	draw(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+								VECamera *pCamera, VELight *pLight,
+								vh::vhSpan<VkDescriptorSet> descriptorSetsShadow);
+		virtual void	drawSorted(	VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t numPass,
+									VECamera *pCamera, VELight *pLight,
+									vh::vhSpan<VkDescriptorSet> descriptorSetsShadow,
+									VERenderQueue::veDrawItem *pDrawItems, uint32_t numDrawItems);
+	};
+}
+
@@ -0,0 +1,568 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#include "VEInclude.h"
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief Create the grid patch shared by all terrains
+	*
+	* The patch has (VE_TERRAIN_PATCH_SIZE+1)^2 grid vertices, followed by VE_TERRAIN_PATCH_SIZE+1 skirt vertices
+	* for each of the edges z=0, z=max, x=0 and x=max. Skirts hang down from the edges and are drawn from both
+	* sides, since the crack they cover can be seen from either side. Only the index buffer of the mesh is used
+	* for drawing, the vertices are a flat grid of unit quads for the bounds.
+	*
+	* \returns a pointer to the new mesh
+	*
+	*/
+	VEMesh * VETerrain::createPatchMesh() {
+		const uint32_t P = VE_TERRAIN_PATCH_SIZE;
+		const uint32_t numGrid = (P + 1) * (P + 1);
+		uint32_t indexCount = 6 * P * P + 4 * P * 12;
+
+		return new VEMesh(VE_TERRAIN_PATCH_MESH, VE_TERRAIN_PATCH_VERTICES, indexCount,
+			[&](glm::vec3 *pPositions, vh::vhVertexAttributes *pAttributes) {
+				for (uint32_t j = 0; j <= P; j++) {
+					for (uint32_t i = 0; i <= P; i++) {
+						pPositions[j * (P + 1) + i] = glm::vec3((float)i, 0.0f, (float)j);
+					}
+				}
+				for (uint32_t e = 0; e < 4; e++) {
+					for (uint32_t k = 0; k <= P; k++) {
+						uint32_t i = e < 2 ? k : (e == 2 ? 0 : P);
+						uint32_t j = e < 2 ? (e == 0 ? 0 : P) : k;
+						pPositions[numGrid + e * (P + 1) + k] = glm::vec3((float)i, -1.0f, (float)j);
+					}
+				}
+				for (uint32_t v = 0; v < VE_TERRAIN_PATCH_VERTICES; v++) {
+					pAttributes[v] = { glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(pPositions[v].x, pPositions[v].z) / (float)P };
+				}
+			},
+			[&](uint32_t *pIndices) {
+				uint32_t n = 0;
+				for (uint32_t j = 0; j < P; j++) {				//front faces point up: reversed winding like the model loaders
+					for (uint32_t i = 0; i < P; i++) {
+						uint32_t v00 = j * (P + 1) + i;
+						uint32_t v10 = v00 + 1;
+						uint32_t v01 = v00 + P + 1;
+						uint32_t v11 = v01 + 1;
+						uint32_t quad[6] = { v00, v10, v01, v10, v11, v01 };
+						for (uint32_t q = 0; q < 6; q++) pIndices[n++] = quad[q];
+					}
+				}
+				for (uint32_t e = 0; e < 4; e++) {
+					for (uint32_t k = 0; k < P; k++) {
+						uint32_t a = e < 2 ? (e == 0 ? 0 : P * (P + 1)) + k : k * (P + 1) + (e == 2 ? 0 : P);
+						uint32_t b = e < 2 ? a + 1 : a + P + 1;
+						uint32_t c = numGrid + e * (P + 1) + k;
+						uint32_t d = c + 1;
+						uint32_t quad[12] = { a, b, c, b, d, c, a, c, b, b, c, d };
+						for (uint32_t q = 0; q < 12; q++) pIndices[n++] = quad[q];
+					}
+				}
+			});
+	}
+
+
+	/**
+	*
+	* \brief Terrain constructor
+	*
+	* Loads the heightmap, builds the quadtree and the buffers, and pages in the root node, which stays resident.
+	* The terrain casts no shadows and is not hit by ray casts, use getHeight() instead.
+	*
+	* \param[in] name Name of the terrain
+	* \param[in] pPatchMesh The shared patch mesh, see createPatchMesh()
+	* \param[in] pMat Material with the diffuse texture, the texture coordinates go from 0 to 1 over the whole terrain
+	* \param[in] heightmap Path of the heightmap, a square 16 bit raw file (.r16, .raw) or an image stb_image can load
+	* \param[in] size Extent of the terrain along x and z
+	* \param[in] heightScale Height of the max heightmap value
+	* \param[in] transf Local to parent transform, should not scale
+	* \param[in] parent Pointer to the parent
+	*
+	*/
+	VETerrain::VETerrain(	std::string name, VEMesh *pPatchMesh, VEMaterial *pMat,
+							std::string heightmap, float size, float heightScale,
+							glm::mat4 transf, VESceneNode *parent) :
+								VEEntity(name, VE_ENTITY_TYPE_TERRAIN_HEIGHTMAP, pPatchMesh, pMat, transf, parent),
+								m_size(size), m_heightScale(heightScale) {
+
+		m_castsShadow = false;
+		m_raycastMask = 0;
+
+		loadHeightmap(heightmap);
+		computeNodeHeights();
+
+		m_nodeSlots.assign(m_nodeHeights.size(), VE_TERRAIN_NO_SLOT);
+		m_slotNodes.assign(VE_TERRAIN_NUM_SLOTS, VE_TERRAIN_NO_SLOT);
+		m_slotFrames.assign(VE_TERRAIN_NUM_SLOTS, 0);
+		m_scratchPositions.resize(VE_TERRAIN_PATCH_VERTICES);
+		m_scratchAttributes.resize(VE_TERRAIN_PATCH_VERTICES);
+
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+		m_attributeOffset = (VkDeviceSize)VE_TERRAIN_NUM_SLOTS * VE_TERRAIN_PATCH_VERTICES * sizeof(glm::vec3);
+		VkDeviceSize vertexSize = m_attributeOffset + (VkDeviceSize)VE_TERRAIN_NUM_SLOTS * VE_TERRAIN_PATCH_VERTICES * sizeof(vh::vhVertexAttributes);
+		VECHECKRESULT(vh::vhBufCreateBuffer(allocator, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+											VMA_MEMORY_USAGE_CPU_TO_GPU, &m_vertexBuffer, &m_vertexBufferAllocation), "Could not create terrain vertex buffer");
+		VECHECKRESULT(vmaMapMemory(allocator, m_vertexBufferAllocation, (void**)&m_pVertices), "Could not map terrain vertex buffer");
+
+		uint32_t numImages = getRendererPointer()->getSwapChainNumber();
+		VkDeviceSize indirectSize = VE_TERRAIN_MAX_DRAWS * sizeof(VkDrawIndexedIndirectCommand);
+		m_indirectBuffers.resize(numImages);
+		m_indirectAllocations.resize(numImages);
+		m_pIndirect.resize(numImages);
+		for (uint32_t i = 0; i < numImages; i++) {
+			VECHECKRESULT(vh::vhBufCreateBuffer(allocator, indirectSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+												VMA_MEMORY_USAGE_CPU_TO_GPU, &m_indirectBuffers[i], &m_indirectAllocations[i]), "Could not create terrain indirect buffer");
+			VECHECKRESULT(vmaMapMemory(allocator, m_indirectAllocations[i], (void**)&m_pIndirect[i]), "Could not map terrain indirect buffer");
+			memset(m_pIndirect[i], 0, (size_t)indirectSize);
+		}
+
+		pageIn(m_numLevels - 1, 0, 0);
+	}
+
+
+	/**
+	*
+	* \brief Terrain destructor, destroys the vertex and indirect buffers
+	*
+	*/
+	VETerrain::~VETerrain() {
+		VmaAllocator allocator = getRendererPointer()->getVmaAllocator();
+		vmaUnmapMemory(allocator, m_vertexBufferAllocation);
+		vmaDestroyBuffer(allocator, m_vertexBuffer, m_vertexBufferAllocation);
+		for (uint32_t i = 0; i < m_indirectBuffers.size(); i++) {
+			vmaUnmapMemory(allocator, m_indirectAllocations[i]);
+			vmaDestroyBuffer(allocator, m_indirectBuffers[i], m_indirectAllocations[i]);
+		}
+	}
+
+
+	/**
+	*
+	* \brief Map or decode the heightmap
+	*
+	* Raw files hold little endian 16 bit heights and are used straight from the file data, which is mapped
+	* unless the file is compressed in a pack. Other formats are decoded to 16 bit gray values.
+	*
+	* \param[in] filename Path of the heightmap
+	*
+	*/
+	void VETerrain::loadHeightmap(std::string filename) {
+		if (!getFileSystemPointer()->read(filename, m_file)) {
+			throw std::runtime_error("Error: Could not load heightmap " + filename + "!");
+		}
+
+		std::string ext = filename.substr(filename.find_last_of('.') + 1);
+		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+		if (ext == "r16" || ext == "raw") {
+			m_resolution = (uint32_t)sqrt((double)(m_file.m_size / sizeof(uint16_t)));
+			if ((size_t)m_resolution * m_resolution * sizeof(uint16_t) != m_file.m_size) {
+				throw std::runtime_error("Error: Heightmap " + filename + " is not square!");
+			}
+			m_pHeights = (const uint16_t*)m_file.m_pData;
+		}
+		else {
+			int width, height, channels;
+			stbi_us *pPixels = stbi_load_16_from_memory((const stbi_uc*)m_file.m_pData, (int)m_file.m_size, &width, &height, &channels, 1);
+			if (pPixels == nullptr) {
+				throw std::runtime_error("Error: Could not decode heightmap " + filename + "!");
+			}
+			m_decoded.assign(pPixels, pPixels + (size_t)width * height);
+			stbi_image_free(pPixels);
+			m_file.release();
+			if (width != height) {
+				throw std::runtime_error("Error: Heightmap " + filename + " is not square!");
+			}
+			m_resolution = (uint32_t)width;
+			m_pHeights = m_decoded.data();
+		}
+
+		if (m_resolution < 2) {
+			throw std::runtime_error("Error: Heightmap " + filename + " is too small!");
+		}
+	}
+
+
+	/**
+	*
+	* \brief Compute the min and max heights of all nodes
+	*
+	* The leaves are made large enough that VE_TERRAIN_PATCH_SIZE quads cover at least their texels, and their
+	* number per side is rounded up to a power of 2. Leaves take the range of their texels, inner nodes the range
+	* of their children. This is the only pass over the whole heightmap.
+	*
+	*/
+	void VETerrain::computeNodeHeights() {
+		uint32_t numNeeded = (m_resolution - 2) / VE_TERRAIN_PATCH_SIZE + 1;	//leaves needed per side
+		m_numLeaves = 1;
+		m_numLevels = 1;
+		while (m_numLeaves < numNeeded) {
+			m_numLeaves <<= 1;
+			m_numLevels++;
+		}
+
+		m_levelOffsets.resize(m_numLevels);
+		uint32_t numNodes = 0;
+		for (uint32_t l = 0; l < m_numLevels; l++) {
+			m_levelOffsets[l] = numNodes;
+			numNodes += (m_numLeaves >> l) * (m_numLeaves >> l);
+		}
+		m_nodeHeights.resize(numNodes);
+
+		float span = (float)(m_resolution - 1) / (float)m_numLeaves;		//texels per leaf
+		for (uint32_t z = 0; z < m_numLeaves; z++) {
+			uint32_t z0 = (uint32_t)floor(z * span);
+			uint32_t z1 = std::min((uint32_t)ceil((z + 1) * span), m_resolution - 1);
+			for (uint32_t x = 0; x < m_numLeaves; x++) {
+				uint32_t x0 = (uint32_t)floor(x * span);
+				uint32_t x1 = std::min((uint32_t)ceil((x + 1) * span), m_resolution - 1);
+
+				glm::vec2 range(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+				for (uint32_t tz = z0; tz <= z1; tz++) {
+					for (uint32_t tx = x0; tx <= x1; tx++) {
+						float h = getTexel(tx, tz);
+						range = glm::vec2(std::min(range.x, h), std::max(range.y, h));
+					}
+				}
+				m_nodeHeights[getNode(0, x, z)] = range;
+			}
+		}
+
+		for (uint32_t l = 1; l < m_numLevels; l++) {
+			uint32_t n = m_numLeaves >> l;
+			for (uint32_t z = 0; z < n; z++) {
+				for (uint32_t x = 0; x < n; x++) {
+					glm::vec2 range = m_nodeHeights[getNode(l - 1, 2 * x, 2 * z)];
+					for (uint32_t c = 1; c < 4; c++) {
+						glm::vec2 child = m_nodeHeights[getNode(l - 1, 2 * x + (c & 1), 2 * z + (c >> 1))];
+						range = glm::vec2(std::min(range.x, child.x), std::max(range.y, child.y));
+					}
+					m_nodeHeights[getNode(l, x, z)] = range;
+				}
+			}
+		}
+	}
+
+
+	/**
+	* \param[in] x Texel column
+	* \param[in] z Texel row
+	* \returns the height of a texel
+	*/
+	float VETerrain::getTexel(uint32_t x, uint32_t z) {
+		return m_pHeights[(size_t)z * m_resolution + x] * (m_heightScale / 65535.0f);
+	}
+
+
+	/**
+	* \param[in] tx Texel column, clamped to the heightmap
+	* \param[in] tz Texel row, clamped to the heightmap
+	* \returns the bilinear height at texel coordinates
+	*/
+	float VETerrain::sampleHeight(float tx, float tz) {
+		float maxTexel = (float)(m_resolution - 1);
+		tx = glm::clamp(tx, 0.0f, maxTexel);
+		tz = glm::clamp(tz, 0.0f, maxTexel);
+		uint32_t x0 = std::min((uint32_t)tx, m_resolution - 2);
+		uint32_t z0 = std::min((uint32_t)tz, m_resolution - 2);
+		float fx = tx - x0;
+		float fz = tz - z0;
+
+		float h0 = glm::mix(getTexel(x0, z0), getTexel(x0 + 1, z0), fx);
+		float h1 = glm::mix(getTexel(x0, z0 + 1), getTexel(x0 + 1, z0 + 1), fx);
+		return glm::mix(h0, h1, fz);
+	}
+
+
+	/**
+	*
+	* \brief Get the height of the terrain surface
+	*
+	* This is the heightmap at full resolution, the drawn surface may be coarser far away from the camera.
+	*
+	* \param[in] x Local space x coordinate
+	* \param[in] z Local space z coordinate
+	* \returns the local space height at this position
+	*
+	*/
+	float VETerrain::getHeight(float x, float z) {
+		float texelsPerUnit = (float)(m_resolution - 1) / m_size;
+		return sampleHeight((x + 0.5f * m_size) * texelsPerUnit, (z + 0.5f * m_size) * texelsPerUnit);
+	}
+
+
+	/**
+	* \param[in] level Level of the node, 0 are the leaves
+	* \param[in] x Column of the node in its level
+	* \param[in] z Row of the node in its level
+	* \returns the local space box of a node
+	*/
+	cl::clAABB VETerrain::getNodeBox(uint32_t level, uint32_t x, uint32_t z) {
+		float extent = m_size / (float)(m_numLeaves >> level);
+		glm::vec2 range = m_nodeHeights[getNode(level, x, z)];
+		return cl::clAABB(	glm::vec3((x + 0.5f) * extent - 0.5f * m_size, 0.5f * (range.x + range.y), (z + 0.5f) * extent - 0.5f * m_size),
+							glm::vec3(0.5f * extent, 0.5f * (range.y - range.x), 0.5f * extent));
+	}
+
+
+	/**
+	* \param[in] box Local space box
+	* \returns true if the box is not completely outside of one of the frustum planes
+	*/
+	bool VETerrain::isVisible(const cl::clAABB &box) {
+		for (uint32_t i = 0; i < 6; i++) {
+			glm::vec3 n(m_planes[i]);
+			float r = glm::dot(glm::abs(n), box.extent);
+			if (glm::dot(n, box.center) + m_planes[i].w < -r) return false;
+		}
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Find a slot for a node that is paged in
+	*
+	* Free slots are used first. Otherwise the slot that has not been drawn for the longest time is reused, but only
+	* if no frame in flight can still read it. The slot of the root is never reused.
+	*
+	* \returns the slot, or VE_TERRAIN_NO_SLOT if all slots are in use
+	*
+	*/
+	uint32_t VETerrain::getFreeSlot() {
+		uint64_t delay = getRendererPointer()->getSwapChainNumber() + 1;
+		uint32_t root = m_levelOffsets[m_numLevels - 1];
+		uint32_t best = VE_TERRAIN_NO_SLOT;
+
+		for (uint32_t slot = 0; slot < VE_TERRAIN_NUM_SLOTS; slot++) {
+			if (m_slotNodes[slot] == VE_TERRAIN_NO_SLOT) return slot;
+			if (m_slotNodes[slot] == root || m_slotFrames[slot] + delay > m_frame) continue;
+			if (best == VE_TERRAIN_NO_SLOT || m_slotFrames[slot] < m_slotFrames[best]) best = slot;
+		}
+		return best;
+	}
+
+
+	/**
+	*
+	* \brief Make a node resident
+	*
+	* At most VE_TERRAIN_PAGE_BUDGET nodes are paged in per frame, nodes that do not get a slot are drawn
+	* through their parents and paged in later.
+	*
+	* \param[in] level Level of the node
+	* \param[in] x Column of the node in its level
+	* \param[in] z Row of the node in its level
+	* \returns true if the node is resident
+	*
+	*/
+	bool VETerrain::pageIn(uint32_t level, uint32_t x, uint32_t z) {
+		uint32_t node = getNode(level, x, z);
+		uint32_t slot = m_nodeSlots[node];
+		if (slot != VE_TERRAIN_NO_SLOT) {
+			m_slotFrames[slot] = m_frame;
+			return true;
+		}
+		if (m_numPaged >= VE_TERRAIN_PAGE_BUDGET) return false;
+
+		slot = getFreeSlot();
+		if (slot == VE_TERRAIN_NO_SLOT) return false;
+		if (m_slotNodes[slot] != VE_TERRAIN_NO_SLOT) m_nodeSlots[m_slotNodes[slot]] = VE_TERRAIN_NO_SLOT;
+
+		fillSlot(slot, level, x, z);
+		m_slotNodes[slot] = node;
+		m_nodeSlots[node] = slot;
+		m_slotFrames[slot] = m_frame;
+		m_numPaged++;
+		return true;
+	}
+
+
+	/**
+	*
+	* \brief Create the vertices of a node in a slot
+	*
+	* The grid samples the heightmap with the spacing of the node's level. Normals and tangents come from central
+	* differences, the skirts go down by the height range of the node, which is more than the largest crack.
+	* The vertices are built in scratch buffers and copied, since the mapped memory may be slow to read.
+	*
+	* \param[in] slot The slot to write
+	* \param[in] level Level of the node
+	* \param[in] x Column of the node in its level
+	* \param[in] z Row of the node in its level
+	*
+	*/
+	void VETerrain::fillSlot(uint32_t slot, uint32_t level, uint32_t x, uint32_t z) {
+		const uint32_t P = VE_TERRAIN_PATCH_SIZE;
+		const uint32_t numGrid = (P + 1) * (P + 1);
+
+		float maxTexel = (float)(m_resolution - 1);
+		float spacing = maxTexel / (float)(m_numLeaves * P) * (float)(1 << level);	//texels per quad
+		float texelSize = m_size / maxTexel;
+		float delta = std::max(spacing, 1.0f);
+		glm::vec2 range = m_nodeHeights[getNode(level, x, z)];
+		float skirt = range.y - range.x + spacing * texelSize;
+
+		for (uint32_t j = 0; j <= P; j++) {
+			float tz = (float)(z * P + j) * spacing;
+			for (uint32_t i = 0; i <= P; i++) {
+				float tx = (float)(x * P + i) * spacing;
+				float dhdx = (sampleHeight(tx + delta, tz) - sampleHeight(tx - delta, tz)) / (2.0f * delta * texelSize);
+				float dhdz = (sampleHeight(tx, tz + delta) - sampleHeight(tx, tz - delta)) / (2.0f * delta * texelSize);
+
+				uint32_t v = j * (P + 1) + i;
+				m_scratchPositions[v] = glm::vec3(tx * texelSize - 0.5f * m_size, sampleHeight(tx, tz), tz * texelSize - 0.5f * m_size);
+				m_scratchAttributes[v] = {	glm::normalize(glm::vec3(-dhdx, 1.0f, -dhdz)),
+											glm::normalize(glm::vec3(1.0f, dhdx, 0.0f)),
+											glm::vec2(tx, tz) / maxTexel };
+			}
+		}
+
+		for (uint32_t e = 0; e < 4; e++) {
+			for (uint32_t k = 0; k <= P; k++) {
+				uint32_t v = e < 2 ? (e == 0 ? 0 : P * (P + 1)) + k : k * (P + 1) + (e == 2 ? 0 : P);
+				m_scratchPositions[numGrid + e * (P + 1) + k] = m_scratchPositions[v] - glm::vec3(0.0f, skirt, 0.0f);
+				m_scratchAttributes[numGrid + e * (P + 1) + k] = m_scratchAttributes[v];
+			}
+		}
+
+		memcpy(m_pVertices + (size_t)slot * VE_TERRAIN_PATCH_VERTICES * sizeof(glm::vec3),
+				m_scratchPositions.data(), VE_TERRAIN_PATCH_VERTICES * sizeof(glm::vec3));
+		memcpy(m_pVertices + m_attributeOffset + (size_t)slot * VE_TERRAIN_PATCH_VERTICES * sizeof(vh::vhVertexAttributes),
+				m_scratchAttributes.data(), VE_TERRAIN_PATCH_VERTICES * sizeof(vh::vhVertexAttributes));
+	}
+
+
+	/**
+	*
+	* \brief Select the nodes to draw below a visible node
+	*
+	* A node is refined if the camera is closer than m_lodFactor times its size, its visible children are
+	* resident or can be paged in, and the draw budget allows drawing them instead of the node. Otherwise the
+	* node itself is drawn. The node has already been counted in m_numReserved, and is resident.
+	*
+	* \param[in] level Level of the node
+	* \param[in] x Column of the node in its level
+	* \param[in] z Row of the node in its level
+	*
+	*/
+	void VETerrain::selectNode(uint32_t level, uint32_t x, uint32_t z) {
+		if (level > 0) {
+			cl::clAABB box = getNodeBox(level, x, z);
+			float distance = glm::length(glm::max(glm::abs(m_cameraPos - box.center) - box.extent, glm::vec3(0.0f)));
+
+			if (distance < m_lodFactor * 2.0f * box.extent.x) {
+				bool visible[4];
+				uint32_t numVisible = 0;
+				for (uint32_t c = 0; c < 4; c++) {
+					visible[c] = isVisible(getNodeBox(level - 1, 2 * x + (c & 1), 2 * z + (c >> 1)));
+					if (visible[c]) numVisible++;
+				}
+
+				bool refine = m_numReserved - 1 + numVisible <= VE_TERRAIN_MAX_DRAWS;
+				for (uint32_t c = 0; c < 4 && refine; c++) {
+					if (visible[c]) refine = pageIn(level - 1, 2 * x + (c & 1), 2 * z + (c >> 1));
+				}
+
+				if (refine) {
+					m_numReserved = m_numReserved - 1 + numVisible;
+					for (uint32_t c = 0; c < 4; c++) {
+						if (visible[c]) selectNode(level - 1, 2 * x + (c & 1), 2 * z + (c >> 1));
+					}
+					return;
+				}
+			}
+		}
+
+		uint32_t slot = m_nodeSlots[getNode(level, x, z)];
+		m_slotFrames[slot] = m_frame;
+		m_pDraws[m_numDraws++] = { m_pMesh->m_indexCount, 1, 0, (int32_t)(slot * VE_TERRAIN_PATCH_VERTICES), 0 };
+	}
+
+
+	/**
+	*
+	* \brief Update the UBO and select the nodes to draw with this swapchain image
+	*
+	* The camera frustum and position are moved to the local space of the terrain, then the quadtree is traversed
+	* from the root. Indirect draws that are not used are cleared.
+	*
+	* \param[in] worldMatrix The world matrix of the terrain
+	* \param[in] imageIndex Index of the swapchain image that is currently used
+	*
+	*/
+	void VETerrain::updateUBO(glm::mat4 worldMatrix, uint32_t imageIndex) {
+		VEEntity::updateUBO(worldMatrix, imageIndex);
+
+		m_pDraws = m_pIndirect[imageIndex];
+		m_numDraws = 0;
+
+		VECamera *pCamera = getSceneManagerPointer()->getCamera();
+		if (pCamera != nullptr && m_drawEntity) {
+			m_frame++;
+			m_numPaged = 0;
+			m_numReserved = 1;
+
+			glm::mat4 cameraWorld = pCamera->getWorldTransform();
+			VEGPUCulling::getFrustumPlanes(pCamera->getProjectionMatrix() * glm::inverse(cameraWorld) * worldMatrix, m_planes);
+			m_cameraPos = glm::vec3(glm::inverse(worldMatrix) * cameraWorld[3]);
+
+			uint32_t root = m_numLevels - 1;
+			if (isVisible(getNodeBox(root, 0, 0))) selectNode(root, 0, 0);
+		}
+
+		for (uint32_t i = m_numDraws; i < VE_TERRAIN_MAX_DRAWS; i++) {
+			m_pDraws[i] = { 0, 0, 0, 0, 0 };
+		}
+	}
+
+
+	/**
+	*
+	* \brief Record the draws of the selected nodes
+	*
+	* The descriptor sets of the terrain must be bound. The slot buffer and the index buffer of the patch mesh are
+	* bound, then each of the VE_TERRAIN_MAX_DRAWS indirect draws is recorded, so the command buffer does not
+	* depend on how many nodes are selected. Unused draws have no instances.
+	*
+	* \param[in] commandBuffer The command buffer to record into
+	* \param[in] imageIndex Index of the swapchain image the command buffer is used with
+	*
+	*/
+	void VETerrain::recordDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+		VkBuffer vertexBuffers[] = { m_vertexBuffer, m_vertexBuffer };
+		VkDeviceSize offsets[] = { 0, m_attributeOffset };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, m_pMesh->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+		for (uint32_t i = 0; i < VE_TERRAIN_MAX_DRAWS; i++) {
+			vkCmdDrawIndexedIndirect(commandBuffer, m_indirectBuffers[imageIndex], i * sizeof(VkDrawIndexedIndirectCommand),
+									1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+
+	/**
+	*
+	* \brief Get a sphere around the whole terrain, used for sorting
+	*
+	* \param[out] center Local space center of the sphere
+	* \param[out] radius Radius of the sphere
+	*
+	*/
+	void VETerrain::getBoundingSphere(glm::vec3 *center, float *radius) {
+		cl::clAABB box = getNodeBox(m_numLevels - 1, 0, 0);
+		*center = box.center;
+		*radius = glm::length(box.extent);
+	}
+
+}
+
@@ -0,0 +1,115 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#pragma once
+
+const uint32_t VE_TERRAIN_PATCH_SIZE = 32;			///<Quads along each side of a patch, every quadtree node is drawn as one patch
+const uint32_t VE_TERRAIN_PATCH_VERTICES = (VE_TERRAIN_PATCH_SIZE + 1) * (VE_TERRAIN_PATCH_SIZE + 5);	///<Grid vertices plus the skirt vertices of the 4 edges
+const uint32_t VE_TERRAIN_MAX_DRAWS = 256;			///<Max patches drawn per frame, bounds the triangle count
+const uint32_t VE_TERRAIN_NUM_SLOTS = 512;			///<Patches resident in the vertex buffer, bounds the memory
+const uint32_t VE_TERRAIN_PAGE_BUDGET = 16;			///<Max patches paged in per frame
+const uint32_t VE_TERRAIN_NO_SLOT = 0xFFFFFFFF;		///<Node is not resident
+const std::string VE_TERRAIN_PATCH_MESH = "VETerrainPatch";	///<Name of the shared patch mesh in the scene manager
+
+
+namespace ve {
+
+	/**
+	*
+	* \brief A terrain entity drawn from a heightmap
+	*
+	* The heightmap is covered by a quadtree. The leaves sample the heightmap at full resolution, each level above
+	* halves the resolution. All nodes are drawn with the same grid patch of VE_TERRAIN_PATCH_SIZE quads, so the
+	* index buffer is shared and only the vertices differ. Skirts along the patch edges hide the cracks between
+	* neighbors of different levels.
+	*
+	* Each frame the quadtree is traversed on the CPU: nodes outside the camera frustum are culled, and nodes closer
+	* than their LOD range are refined if their visible children are resident and the draw budget allows it.
+	* The vertices of a node are created from the heightmap when the node is first needed and stay in one of
+	* VE_TERRAIN_NUM_SLOTS slots of a host visible vertex buffer until the slot is reused. So the triangle count per
+	* frame and the memory are bounded, no matter how large the heightmap is.
+	*
+	* Selected nodes are written as indirect draws into a buffer per swapchain image, recorded command buffers
+	* stay valid when the selection changes. Raw heightmaps (.r16, .raw) are mapped, so the OS reads only the pages
+	* that are sampled.
+	*
+	* The terrain is centered on its local origin. Its transform should not scale, the size is given instead.
+	*
+	*/
+	class VETerrain : public VEEntity {
+
+	protected:
+		veFileData					m_file;							///<The heightmap file, mapped if possible
+		std::vector<uint16_t>		m_decoded;						///<Decoded heights of compressed image formats
+		const uint16_t *			m_pHeights = nullptr;			///<Heights, m_resolution x m_resolution
+		uint32_t					m_resolution = 0;				///<Heightmap texels per side
+		float						m_size = 1.0f;					///<Extent of the terrain along x and z
+		float						m_heightScale = 1.0f;			///<Height of the max heightmap value
+		float						m_lodFactor = 2.0f;				///<Nodes closer than this times their size are refined
+
+		uint32_t					m_numLeaves = 1;				///<Leaf nodes per side, a power of 2
+		uint32_t					m_numLevels = 1;				///<Levels of the quadtree, level 0 are the leaves
+		std::vector<uint32_t>		m_levelOffsets;					///<Index of the first node of each level
+		std::vector<glm::vec2>		m_nodeHeights;					///<Min and max height of each node
+		std::vector<uint32_t>		m_nodeSlots;					///<Slot of each node, or VE_TERRAIN_NO_SLOT
+		std::vector<uint32_t>		m_slotNodes;					///<Node of each slot, or VE_TERRAIN_NO_SLOT
+		std::vector<uint64_t>		m_slotFrames;					///<Frame each slot was last drawn in
+		uint64_t					m_frame = 0;					///<Number of selections so far
+
+		VkBuffer					m_vertexBuffer = VK_NULL_HANDLE;	///<Positions of all slots, then attributes of all slots
+		VmaAllocation				m_vertexBufferAllocation = nullptr;	///<VMA information for the vertex buffer
+		uint8_t *					m_pVertices = nullptr;				///<Mapped vertex buffer
+		VkDeviceSize				m_attributeOffset = 0;				///<Start of the attribute stream
+		std::vector<VkBuffer>		m_indirectBuffers;					///<Indirect draws for each swapchain image
+		std::vector<VmaAllocation>	m_indirectAllocations;				///<VMA information for the indirect buffers
+		std::vector<VkDrawIndexedIndirectCommand *> m_pIndirect;		///<Mapped indirect buffers
+
+		glm::vec4					m_planes[6];					///<Frustum planes in local space, during selection
+		glm::vec3					m_cameraPos;					///<Camera position in local space, during selection
+		VkDrawIndexedIndirectCommand * m_pDraws = nullptr;			///<Indirect draws of the current image, during selection
+		uint32_t					m_numDraws = 0;					///<Draws written during selection
+		uint32_t					m_numReserved = 0;				///<Draws written or promised to selected nodes
+		uint32_t					m_numPaged = 0;					///<Nodes paged in during this selection
+		std::vector<glm::vec3>		m_scratchPositions;				///<Positions of the node being paged in
+		std::vector<vh::vhVertexAttributes> m_scratchAttributes;	///<Attributes of the node being paged in
+
+		void		loadHeightmap(std::string filename);			//map or decode the heightmap
+		void		computeNodeHeights();							//min and max heights of all nodes
+		float		getTexel(uint32_t x, uint32_t z);				//height of a texel
+		float		sampleHeight(float tx, float tz);				//bilinear height at texel coordinates
+		uint32_t	getNode(uint32_t level, uint32_t x, uint32_t z) { return m_levelOffsets[level] + z * (m_numLeaves >> level) + x; };	//index of a node
+		cl::clAABB	getNodeBox(uint32_t level, uint32_t x, uint32_t z);	//local space box of a node
+		bool		isVisible(const cl::clAABB &box);				//box intersects the frustum
+		uint32_t	getFreeSlot();									//free slot or slot not used for a while
+		bool		pageIn(uint32_t level, uint32_t x, uint32_t z);	//make a node resident
+		void		fillSlot(uint32_t slot, uint32_t level, uint32_t x, uint32_t z);	//create the vertices of a node
+		void		selectNode(uint32_t level, uint32_t x, uint32_t z);	//select the nodes to draw below a node
+
+	public:
+		VETerrain(	std::string name, VEMesh *pPatchMesh, VEMaterial *pMat,
+					std::string heightmap, float size, float heightScale,
+					glm::mat4 transf = glm::mat4(1.0f), VESceneNode *parent = nullptr);
+		virtual ~VETerrain();
+
+		static VEMesh * createPatchMesh();							//the grid patch shared by all terrains
+
+		virtual void updateUBO(glm::mat4 worldMatrix, uint32_t imageIndex);	//update the UBO and select the nodes to draw
+		virtual void getBoundingSphere(glm::vec3 *center, float *radius);	//sphere around the whole terrain
+
+		void		recordDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex);	//record the draws of the selected nodes
+		float		getHeight(float x, float z);					//height at a local space position
+
+		///\param[in] lodFactor Nodes closer than this times their size are refined, larger values give more detail
+		void		setLodFactor(float lodFactor) { m_lodFactor = lodFactor; };
+		///\returns the number of patches drawn in the last frame
+		uint32_t	getNumDraws() { return m_numDraws; };
+		///\returns the number of nodes currently resident
+		uint32_t	getNumResident() { return (uint32_t)std::count_if(m_slotNodes.begin(), m_slotNodes.end(), [](uint32_t node) { return node != VE_TERRAIN_NO_SLOT; }); };
+	};
+
+}
+
@@ -39,6 +39,8 @@ namespace ve {
 		* \param[in] height Height fo the new window
 		*/
 		virtual void		initWindow(int width, int height) {};
+		///Initialize the window system, so the required instance extensions are known before the window exists
+		virtual void		initWindowSystem() {};
 		///\returns a list of required instance extensions for interacting with the local window system
 		virtual std::vector<const char*> getRequiredInstanceExtensions() { return {}; };
 		/**
@@ -20,7 +20,7 @@ namespace ve {
 	*
 	*/
 	void VEWindowGLFW::initWindow( int WIDTH, int HEIGHT) {
-		glfwInit();
+		glfwInit();													//does nothing if initWindowSystem() was called
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		m_window = glfwCreateWindow(WIDTH, HEIGHT, "Vienna Vulkan Engine", nullptr, nullptr);
 		glfwSetWindowUserPointer(m_window, this);
@@ -37,6 +37,18 @@ namespace ve {
 		glfwSetInputMode(m_window, GLFW_STICKY_MOUSE_BUTTONS, 1);
 	}
 
+	/**
+	*
+	* \brief Initialize GLFW
+	*
+	* After this the required instance extensions are known, so the Vulkan instance can be created while
+	* the window is being created.
+	*
+	*/
+	void VEWindowGLFW::initWindowSystem() {
+		glfwInit();
+	}
+
 	///\returns the required Vulkan instance extensions to interact with the local window system
 	std::vector<const char*> VEWindowGLFW::getRequiredInstanceExtensions() {
 		uint32_t glfwExtensionCount = 0;
@@ -38,6 +38,7 @@ namespace ve {
 		static void mouse_scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
 		virtual void		initWindow( int width, int height );						//create the window
+		virtual void		initWindowSystem();											//initialize GLFW
 		virtual std::vector<const char*> getRequiredInstanceExtensions();				//return GLFW Vulkan extensions
 		virtual bool		createSurface(VkInstance instance, VkSurfaceKHR *pSurface);	//create a Vulkan surface
 		virtual bool		windowShouldClose() { return glfwWindowShouldClose(m_window)!=0; };	//winddow was closed by user?
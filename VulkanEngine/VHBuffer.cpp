@@ -463,6 +463,20 @@ namespace vh {
 			sourceStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 			destinationStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 		}
+		else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+			barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		}
+		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		}
 		else if (oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL  && newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) {
 			barrier.srcAccessMask = 0;
 			barrier.dstAccessMask = 0;
@@ -490,51 +504,32 @@ namespace vh {
 
 	//texture image VMA
 
+	///Pixels of an image decoded by stb_image
+	struct vhImageData {
+		VkDeviceSize imageSize = 0;
+		stbi_uc* pixels;
+		int texWidth, texHeight, texChannels;
+	};
+
 	/**
-	* \brief Create a texture image from multiple files
+	* \brief Copy decoded images into the layers of a new texture image, and free the pixels
 	*
 	* \param[in] device Logical Vulkan device
 	* \param[in] allocator The VMA allocator
 	* \param[in] graphicsQueue Device queue for submitting commands
 	* \param[in] commandPool Command pool for allocating command buffers
-	* \param[in] basedir Directoy the files are in
-	* \param[in] texNames List of file names holding the textures (should have same resolution)
-	* \param[in] flags Image create flags 
+	* \param[in] imageData The decoded images, one per layer (should have same resolution)
+	* \param[in] flags Image create flags
 	* \param[out] textureImage The new image
 	* \param[out] textureImageAllocation The VMA allocation info
-	* \param[out] extent The extent of the loaded image
 	* \returns VK_SUCCESS or a Vulkan error code
 	*
 	*/
-	VkResult vhBufCreateTextureImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
-								std::string basedir, std::vector<std::string> texNames, VkImageCreateFlags flags,
-								VkImage *textureImage, VmaAllocation *textureImageAllocation, VkExtent2D *extent) {
-
-		struct image_data {
-			VkDeviceSize imageSize = 0;
-			stbi_uc* pixels;
-			int texWidth, texHeight, texChannels;
-		};
-
-		std::vector<image_data> imageData;
-		imageData.resize(texNames.size());
+	static VkResult vhBufUploadTextureImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+								std::vector<vhImageData> &imageData, VkImageCreateFlags flags,
+								VkImage *textureImage, VmaAllocation *textureImageAllocation) {
 		VkDeviceSize imageSize = 0;
-
-		for (uint32_t i = 0; i < texNames.size(); i++) {
-			std::string filename = basedir + "/" + texNames[i];
-			imageData[i].pixels = stbi_load(filename.c_str(), &imageData[i].texWidth, &imageData[i].texHeight, &imageData[i].texChannels, STBI_rgb_alpha);
-
-			if (imageData[i].pixels == nullptr) {
-				return VK_INCOMPLETE;
-			}
-
-			imageData[i].imageSize += imageData[i].texWidth * imageData[i].texHeight * 4;
-			imageSize += imageData[i].imageSize;
-
-			if (!imageData[i].pixels) {
-				return VK_INCOMPLETE;
-			}
-		}
+		for (auto &image : imageData) imageSize += image.imageSize;
 
 		VkBuffer stagingBuffer;
 		VmaAllocation stagingBufferAllocation;
@@ -607,6 +602,83 @@ namespace vh {
 	}
 
 
+	/**
+	* \brief Create a texture image from multiple files
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] allocator The VMA allocator
+	* \param[in] graphicsQueue Device queue for submitting commands
+	* \param[in] commandPool Command pool for allocating command buffers
+	* \param[in] basedir Directoy the files are in
+	* \param[in] texNames List of file names holding the textures (should have same resolution)
+	* \param[in] flags Image create flags 
+	* \param[out] textureImage The new image
+	* \param[out] textureImageAllocation The VMA allocation info
+	* \param[out] extent The extent of the loaded image
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhBufCreateTextureImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+								std::string basedir, std::vector<std::string> texNames, VkImageCreateFlags flags,
+								VkImage *textureImage, VmaAllocation *textureImageAllocation, VkExtent2D *extent) {
+
+		std::vector<vhImageData> imageData;
+		imageData.resize(texNames.size());
+
+		std::vector<char> file;
+		for (uint32_t i = 0; i < texNames.size(); i++) {
+			std::string filename = basedir + "/" + texNames[i];
+			if (!vhFileLoad(filename, file)) {
+				return VK_INCOMPLETE;
+			}
+			imageData[i].pixels = stbi_load_from_memory((const stbi_uc*)file.data(), (int)file.size(), &imageData[i].texWidth, &imageData[i].texHeight, &imageData[i].texChannels, STBI_rgb_alpha);
+
+			if (imageData[i].pixels == nullptr) {
+				return VK_INCOMPLETE;
+			}
+
+			imageData[i].imageSize += imageData[i].texWidth * imageData[i].texHeight * 4;
+
+			if (!imageData[i].pixels) {
+				return VK_INCOMPLETE;
+			}
+		}
+
+		return vhBufUploadTextureImage(device, allocator, graphicsQueue, commandPool, imageData, flags, textureImage, textureImageAllocation);
+	}
+
+
+	/**
+	* \brief Create a texture image from a compressed image (png, jpg, ...) in memory
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] allocator The VMA allocator
+	* \param[in] graphicsQueue Device queue for submitting commands
+	* \param[in] commandPool Command pool for allocating command buffers
+	* \param[in] pData The image file contents
+	* \param[in] size Size of the image file
+	* \param[out] textureImage The new image
+	* \param[out] textureImageAllocation The VMA allocation info
+	* \param[out] extent The extent of the loaded image
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhBufCreateTextureImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+								const uint8_t *pData, uint32_t size,
+								VkImage *textureImage, VmaAllocation *textureImageAllocation, VkExtent2D *extent) {
+		std::vector<vhImageData> imageData(1);
+		imageData[0].pixels = stbi_load_from_memory(pData, (int)size, &imageData[0].texWidth, &imageData[0].texHeight, &imageData[0].texChannels, STBI_rgb_alpha);
+		if (imageData[0].pixels == nullptr) {
+			return VK_INCOMPLETE;
+		}
+		imageData[0].imageSize = imageData[0].texWidth * imageData[0].texHeight * 4;
+		extent->width = (uint32_t)imageData[0].texWidth;
+		extent->height = (uint32_t)imageData[0].texHeight;
+
+		return vhBufUploadTextureImage(device, allocator, graphicsQueue, commandPool, imageData, 0, textureImage, textureImageAllocation);
+	}
+
+
 	/**
 	* \brief Create an image that is also a cubemap
 	*
@@ -913,6 +985,9 @@ namespace vh {
 	/**
 	* \brief Create a Vulkan vertex buffer
 	*
+	* The buffer holds two streams: first the positions of all vertices, then the other attributes
+	* of all vertices (vhVertexAttributes), starting at a 16 byte aligned offset.
+	*
 	* \param[in] device Logical Vulkan device
 	* \param[in] allocator VMA allocator
 	* \param[in] graphicsQueue Device queue for submitting commands
@@ -920,14 +995,54 @@ namespace vh {
 	* \param[in] vertices List of vertices and their data
 	* \param[out] vertexBuffer The new vertex buffer
 	* \param[out] vertexBufferAllocation VMA allocation information
+	* \param[out] attributeOffset Offset of the attribute stream in the buffer
 	* \returns VK_SUCCESS or a Vulkan error code
 	*
 	*/
 	VkResult vhBufCreateVertexBuffer(	VkDevice device, VmaAllocator allocator,
 									VkQueue graphicsQueue, VkCommandPool commandPool,
 									std::vector<vh::vhVertex> &vertices,
-									VkBuffer *vertexBuffer, VmaAllocation *vertexBufferAllocation) {
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+									VkBuffer *vertexBuffer, VmaAllocation *vertexBufferAllocation,
+									VkDeviceSize *attributeOffset) {
+		return vhBufCreateVertexBuffer(	device, allocator, graphicsQueue, commandPool, (uint32_t)vertices.size(),
+			[&](glm::vec3 *pPositions, vhVertexAttributes *pAttributes) {
+				for (uint32_t i = 0; i < vertices.size(); i++) {		//split the vertices into the two streams
+					pPositions[i] = vertices[i].pos;
+					pAttributes[i].normal = vertices[i].normal;
+					pAttributes[i].tangent = vertices[i].tangent;
+					pAttributes[i].texCoord = vertices[i].texCoord;
+				}
+			},
+			vertexBuffer, vertexBufferAllocation, attributeOffset);
+	}
+
+
+	/**
+	* \brief Create a Vulkan vertex buffer, the caller writes the vertex data directly into the staging buffer
+	*
+	* This avoids building a vertex list first, e.g. when the data comes from a file mapped into memory.
+	* The layout is the same as for the vertex list version.
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] allocator VMA allocator
+	* \param[in] graphicsQueue Device queue for submitting commands
+	* \param[in] commandPool Command pool for allocating command bbuffers
+	* \param[in] vertexCount Number of vertices
+	* \param[in] fill Called once with the position and the attribute stream, must write all vertices
+	* \param[out] vertexBuffer The new vertex buffer
+	* \param[out] vertexBufferAllocation VMA allocation information
+	* \param[out] attributeOffset Offset of the attribute stream in the buffer
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhBufCreateVertexBuffer(	VkDevice device, VmaAllocator allocator,
+									VkQueue graphicsQueue, VkCommandPool commandPool,
+									uint32_t vertexCount,
+									std::function<void(glm::vec3 *pPositions, vhVertexAttributes *pAttributes)> fill,
+									VkBuffer *vertexBuffer, VmaAllocation *vertexBufferAllocation,
+									VkDeviceSize *attributeOffset) {
+		*attributeOffset = (sizeof(glm::vec3) * vertexCount + 15) & ~(VkDeviceSize)15;
+		VkDeviceSize bufferSize = *attributeOffset + sizeof(vhVertexAttributes) * vertexCount;
 
 		VkBuffer stagingBuffer;
 		VmaAllocation stagingBufferAllocation;
@@ -937,7 +1052,7 @@ namespace vh {
 
 		void* data;
 		VHCHECKRESULT( vmaMapMemory(allocator, stagingBufferAllocation, &data) );
-		memcpy(data, vertices.data(), (size_t)bufferSize);
+		fill((glm::vec3*)data, (vhVertexAttributes*)((uint8_t*)data + *attributeOffset));
 		vmaUnmapMemory(allocator, stagingBufferAllocation);
 
 		VHCHECKRESULT( vhBufCreateBuffer(	allocator, bufferSize, 
@@ -967,7 +1082,30 @@ namespace vh {
 	VkResult vhBufCreateIndexBuffer(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
 								std::vector<uint32_t> &indices,
 								VkBuffer *indexBuffer, VmaAllocation *indexBufferAllocation) {
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+		return vhBufCreateIndexBuffer(	device, allocator, graphicsQueue, commandPool, (uint32_t)indices.size(),
+										[&](uint32_t *pIndices) { memcpy(pIndices, indices.data(), sizeof(uint32_t) * indices.size()); },
+										indexBuffer, indexBufferAllocation);
+	}
+
+
+	/**
+	* \brief Create a Vulkan index buffer, the caller writes the indices directly into the staging buffer
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] allocator VMA allocator
+	* \param[in] graphicsQueue Device queue for submitting commands
+	* \param[in] commandPool Command pool for allocating command bbuffers
+	* \param[in] indexCount Number of 32 bit indices
+	* \param[in] fill Called once with the staging memory, must write all indices
+	* \param[out] indexBuffer The new index buffer
+	* \param[out] indexBufferAllocation VMA allocation information
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhBufCreateIndexBuffer(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+								uint32_t indexCount, std::function<void(uint32_t *pIndices)> fill,
+								VkBuffer *indexBuffer, VmaAllocation *indexBufferAllocation) {
+		VkDeviceSize bufferSize = sizeof(uint32_t) * indexCount;
 
 		VkBuffer stagingBuffer;
 		VmaAllocation stagingBufferAllocation;
@@ -975,7 +1113,7 @@ namespace vh {
 
 		void* data;
 		VHCHECKRESULT( vmaMapMemory(allocator, stagingBufferAllocation, &data ) );
-		memcpy(data, indices.data(), (size_t)bufferSize);
+		fill((uint32_t*)data);
 		vmaUnmapMemory(allocator, stagingBufferAllocation);
 
 		VHCHECKRESULT(	vhBufCreateBuffer(allocator, bufferSize, 
@@ -14,7 +14,7 @@ namespace vh {
 
 	///Debug callback
 	VKAPI_ATTR VkBool32 VKAPI_CALL vhDebugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location, int32_t code, const char* layerPrefix, const char* msg, void* userData) {
-		std::cerr << "validation layer: " << msg << std::endl;
+		VHLOGWARNING("validation layer: %s", msg);
 		return VK_FALSE;
 	}
 
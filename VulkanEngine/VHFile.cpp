@@ -8,8 +8,21 @@
 
 #include "VHHelper.h"
 
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
 namespace vh {
 
+	std::function<bool(const std::string&, std::vector<char>&)> g_vhFileReadFunction;	///<Reads files instead of the disk, e.g. from a virtual file system
+
 	//-------------------------------------------------------------------------------------------------------
 	/**
 	*
@@ -21,25 +34,129 @@ namespace vh {
 	*/
 
 	std::vector<char> vhFileRead(const std::string& filename) {
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		if (!file.is_open()) {
+		std::vector<char> buffer;
+		if (!vhFileLoad(filename, buffer)) {
 			throw std::runtime_error("failed to open file!");
 		}
+		return buffer;
+	}
+
+
+	/**
+	*
+	* \brief Read the contents of a file into a buffer
+	*
+	* If a read function has been set with vhFileSetReadFunction(), it is tried first. 
+	*
+	* \param[in] filename Filename
+	* \param[out] buffer Receives the file contents
+	* \returns false if the file could not be read
+	*
+	*/
+	bool vhFileLoad(const std::string& filename, std::vector<char> &buffer) {
+		if (g_vhFileReadFunction && g_vhFileReadFunction(filename, buffer)) return true;
+
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) return false;
 
 		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
+		buffer.resize(fileSize);
 
 		file.seekg(0);
 		file.read(buffer.data(), fileSize);
 
-		file.close();
+		return !file.fail();
+	}
 
-		return buffer;
+
+	/**
+	*
+	* \brief Set a function vhFileRead() and vhFileLoad() read files with
+	*
+	* \param[in] function Fills the buffer and returns true if it found the file, nullptr to read from disk only
+	*
+	*/
+	void vhFileSetReadFunction(std::function<bool(const std::string&, std::vector<char>&)> function) {
+		g_vhFileReadFunction = function;
 	}
 	
 
-}
+
+	/**
+	*
+	* \brief Map a file read only into memory
+	*
+	* \param[in] filename Filename
+	* \param[out] file The mapping, must be released with vhFileUnmap()
+	* \returns true if the file exists and is not empty
+	*
+	*/
+	bool vhFileMap(const std::string& filename, vhMappedFile &file) {
+#if defined(_WIN32)
+		HANDLE hFile = CreateFileA(	filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+									FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0) {
+			CloseHandle(hFile);
+			return false;
+		}
+
+		HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (hMapping == nullptr) {
+			CloseHandle(hFile);
+			return false;
+		}
+		const char *pData = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (pData == nullptr) {
+			CloseHandle(hMapping);
+			CloseHandle(hFile);
+			return false;
+		}
+		file.m_file = hFile;
+		file.m_mapping = hMapping;
+		file.m_pData = pData;
+		file.m_size = (size_t)size.QuadPart;
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			return false;
+		}
+
+		void *pData = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);													//the mapping stays valid
+		if (pData == MAP_FAILED) return false;
+		madvise(pData, (size_t)st.st_size, MADV_SEQUENTIAL);
+		file.m_pData = (const char*)pData;
+		file.m_size = (size_t)st.st_size;
+#endif
+		return true;
+	}
 
 
+	/**
+	*
+	* \brief Release a file mapped with vhFileMap()
+	*
+	* \param[in] file The mapping
+	*
+	*/
+	void vhFileUnmap(vhMappedFile &file) {
+		if (file.m_pData == nullptr) return;
+#if defined(_WIN32)
+		UnmapViewOfFile(file.m_pData);
+		CloseHandle((HANDLE)file.m_mapping);
+		CloseHandle((HANDLE)file.m_file);
+#else
+		munmap((void*)file.m_pData, file.m_size);
+#endif
+		file.m_pData = nullptr;
+		file.m_size = 0;
+	}
 
+}
@@ -20,9 +20,19 @@
 #include <set>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <thread>
+#include <future>
+#include <functional>
 #include <random>
 #include <cmath>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <cassert>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -46,6 +56,8 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/IOSystem.hpp>
+#include <assimp/IOStream.hpp>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -54,6 +66,43 @@
 
 namespace vh {
 
+	/**
+	*
+	* \brief A view of contiguous elements owned by someone else
+	*
+	* A span can be made from a std::vector, a C array, or from a pointer and a size, e.g. memory of a vhLinearArena.
+	* Pass it by value instead of a std::vector, so no copy is made and the caller can use any storage.
+	*
+	*/
+	template<typename T> struct vhSpan {
+		T *		m_pData = nullptr;		///<First element
+		size_t	m_size = 0;				///<Number of elements
+
+		///Constructor, an empty span
+		vhSpan() {};
+		///Constructor, from a pointer and a size
+		vhSpan(T *pData, size_t size) : m_pData(pData), m_size(size) {};
+		///Constructor, from a vector
+		vhSpan(std::vector<typename std::remove_const<T>::type> &v) : m_pData(v.data()), m_size(v.size()) {};
+		///Constructor, from a const vector, only for spans of const elements
+		vhSpan(const std::vector<typename std::remove_const<T>::type> &v) : m_pData(v.data()), m_size(v.size()) {};
+		///Constructor, from a C array
+		template<size_t N> vhSpan(T(&a)[N]) : m_pData(a), m_size(N) {};
+
+		///\returns the number of elements
+		size_t	size() const { return m_size; };
+		///\returns true if there are no elements
+		bool	empty() const { return m_size == 0; };
+		///\returns a pointer to the first element
+		T *		data() const { return m_pData; };
+		///\returns the first element
+		T *		begin() const { return m_pData; };
+		///\returns one past the last element
+		T *		end() const { return m_pData + m_size; };
+		///\returns element i
+		T &		operator[](size_t i) const { return m_pData[i]; };
+	};
+
 	///need only for start up
 	struct QueueFamilyIndices {
 		int graphicsFamily = -1;	///<Index of graphics family
@@ -74,50 +123,79 @@ namespace vh {
 
 	//the following structs are used to fill in uniform buffers, and are used as they are in GLSL shaders
 
+	///vertex data other than the position, stored in the attribute stream of the vertex buffers
+	struct vhVertexAttributes {
+		glm::vec3 normal;		///<Vertex normal vector
+		glm::vec3 tangent;		///<Tangent vector
+		glm::vec2 texCoord;		///<Texture coordinates
+	};
+
 	///per vertex data that is stored in the vertex buffers
+	///Vertex buffers hold two streams: all positions (binding 0), then all other attributes (binding 1).
+	///Depth and shadow passes bind only the position stream.
 	struct vhVertex {
 		glm::vec3 pos;			///<Vertex position
 		glm::vec3 normal;		///<Vertex normal vector
 		glm::vec3 tangent;		///<Tangent vector
 		glm::vec2 texCoord;		///<Texture coordinates
 
-		///\returns the binding description of this vertex data structure
-		static VkVertexInputBindingDescription getBindingDescription() {
-			VkVertexInputBindingDescription bindingDescription = {};
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(vhVertex);
-			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		///\returns the binding descriptions of the position stream and the attribute stream
+		static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions() {
+			std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {};
+			bindingDescriptions[0] = getPositionBindingDescription();
 
-			return bindingDescription;
-		} 
+			bindingDescriptions[1].binding = 1;
+			bindingDescriptions[1].stride = sizeof(vhVertexAttributes);
+			bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			return bindingDescriptions;
+		}
 
-		///\returns the vertex attribute description of the vertex data
+		///\returns the vertex attribute descriptions of both streams
 		static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
 			std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {};
 
-			attributeDescriptions[0].binding = 0;
-			attributeDescriptions[0].location = 0;
-			attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[0].offset = offsetof(vhVertex, pos);
+			attributeDescriptions[0] = getPositionAttributeDescription();
 
-			attributeDescriptions[1].binding = 0;
+			attributeDescriptions[1].binding = 1;
 			attributeDescriptions[1].location = 1;
 			attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[1].offset = offsetof(vhVertex, normal);
+			attributeDescriptions[1].offset = offsetof(vhVertexAttributes, normal);
 
-			attributeDescriptions[2].binding = 0;
+			attributeDescriptions[2].binding = 1;
 			attributeDescriptions[2].location = 2;
 			attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[2].offset = offsetof(vhVertex, tangent);
+			attributeDescriptions[2].offset = offsetof(vhVertexAttributes, tangent);
 
-			attributeDescriptions[3].binding = 0;
+			attributeDescriptions[3].binding = 1;
 			attributeDescriptions[3].location = 3;
 			attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-			attributeDescriptions[3].offset = offsetof(vhVertex, texCoord);
+			attributeDescriptions[3].offset = offsetof(vhVertexAttributes, texCoord);
 
 			return attributeDescriptions;
 		}
 
+		///\returns the binding description of the position stream, used alone by depth and shadow passes
+		static VkVertexInputBindingDescription getPositionBindingDescription() {
+			VkVertexInputBindingDescription bindingDescription = {};
+			bindingDescription.binding = 0;
+			bindingDescription.stride = sizeof(glm::vec3);
+			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			return bindingDescription;
+		}
+
+		///\returns the vertex attribute description of the position stream
+		static VkVertexInputAttributeDescription getPositionAttributeDescription() {
+			VkVertexInputAttributeDescription attributeDescription = {};
+			attributeDescription.binding = 0;
+			attributeDescription.location = 0;
+			attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+			attributeDescription.offset = 0;
+
+			return attributeDescription;
+		}
+
 		///Operator for comparing two vertices
 		bool operator==(const vhVertex& other) const {
 			return pos == other.pos && normal == other.normal && tangent == other.tangent && texCoord == other.texCoord;
@@ -202,6 +280,7 @@ namespace vh {
 									VkImage image, VkFormat format, VkImageAspectFlagBits aspect, uint32_t miplevels, uint32_t layerCount,
 									VkImageLayout oldLayout, VkImageLayout newLayout);
 	VkResult vhBufCreateTextureImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool, std::string basedir, std::vector<std::string> names, VkImageCreateFlags flags, VkImage *textureImage, VmaAllocation *textureImageAllocation, VkExtent2D *extent);
+	VkResult vhBufCreateTextureImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool, const uint8_t *pData, uint32_t size, VkImage *textureImage, VmaAllocation *textureImageAllocation, VkExtent2D *extent);
 	VkResult vhBufCreateTexturecubeImage(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool, gli::texture_cube &cube, VkImage *textureImage, VmaAllocation *textureImageAllocation, VkFormat *pformat);
 	VkResult vhBufCreateTextureSampler(VkDevice device, VkSampler *textureSampler);
 	VkResult vhBufCreateFramebuffers(VkDevice device, std::vector<VkImageView> imageViews,
@@ -217,10 +296,20 @@ namespace vh {
 	VkResult vhBufCreateVertexBuffer(VkDevice device, VmaAllocator allocator,
 									VkQueue graphicsQueue, VkCommandPool commandPool,
 									std::vector<vh::vhVertex> &vertices,
-									VkBuffer *vertexBuffer, VmaAllocation *vertexBufferAllocation);
+									VkBuffer *vertexBuffer, VmaAllocation *vertexBufferAllocation,
+									VkDeviceSize *attributeOffset);
+	VkResult vhBufCreateVertexBuffer(VkDevice device, VmaAllocator allocator,
+									VkQueue graphicsQueue, VkCommandPool commandPool,
+									uint32_t vertexCount,
+									std::function<void(glm::vec3 *pPositions, vhVertexAttributes *pAttributes)> fill,
+									VkBuffer *vertexBuffer, VmaAllocation *vertexBufferAllocation,
+									VkDeviceSize *attributeOffset);
 	VkResult vhBufCreateIndexBuffer(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
 									std::vector<uint32_t> &indices,
 									VkBuffer *indexBuffer, VmaAllocation *indexBufferAllocation);
+	VkResult vhBufCreateIndexBuffer(VkDevice device, VmaAllocator allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+									uint32_t indexCount, std::function<void(uint32_t *pIndices)> fill,
+									VkBuffer *indexBuffer, VmaAllocation *indexBufferAllocation);
 	VkResult vhBufCreateUniformBuffers(	VmaAllocator allocator,
 									uint32_t numberBuffers, VkDeviceSize bufferSize, 
 									std::vector<VkBuffer> &uniformBuffers, 
@@ -230,6 +319,7 @@ namespace vh {
 	//rendering
 	VkResult vhRenderCreateRenderPass( VkDevice device, VkFormat swapChainImageFormat, VkFormat depthFormat, VkAttachmentLoadOp loadOp, VkRenderPass *renderPass);
 	VkResult vhRenderCreateRenderPassShadow( VkDevice device, VkFormat depthFormat, VkRenderPass *renderPass);
+	VkResult vhRenderCreateRenderPassOffscreen(VkDevice device, std::vector<VkFormat> colorFormats, VkFormat depthFormat, VkRenderPass *renderPass);
 
 	VkResult vhRenderCreateDescriptorSetLayout(	VkDevice device, std::vector<uint32_t> counts, std::vector<VkDescriptorType> types,
 											std::vector<VkShaderStageFlags> stageFlags, VkDescriptorSetLayout * descriptorSetLayout);
@@ -245,21 +335,46 @@ namespace vh {
 										std::vector<std::vector<VkSampler>> textureSamplers);
 	VkResult vhRenderBeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer frameBuffer, VkExtent2D extent);
 	VkResult vhRenderBeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer frameBuffer,
-									std::vector<VkClearValue> &clearValues, VkExtent2D extent);
+									vhSpan<const VkClearValue> clearValues, VkExtent2D extent);
 	VkResult vhRenderPresentResult(	VkQueue presentQueue, VkSwapchainKHR swapChain,
 									uint32_t imageIndex, VkSemaphore signalSemaphore);
 
 	VkResult vhPipeCreateGraphicsPipelineLayout(VkDevice device, std::vector<VkDescriptorSetLayout> descriptorSetLayouts, std::vector<VkPushConstantRange> pushConstantRanges, VkPipelineLayout *pipelineLayout);
 	VkResult vhPipeCreateGraphicsPipeline(	VkDevice device, std::vector<std::string> shaderFileNames,
 											VkExtent2D swapChainExtent, VkPipelineLayout pipelineLayout, VkRenderPass renderPass,
-											std::vector<VkDynamicState> dynamicStates, VkPipeline *graphicsPipeline);
+											std::vector<VkDynamicState> dynamicStates, VkPipeline *graphicsPipeline,
+											const VkSpecializationInfo *pSpecializationInfo = nullptr,
+											VkPipelineCache pipelineCache = VK_NULL_HANDLE);
 	VkResult vhPipeCreateGraphicsShadowPipeline(VkDevice device, std::string verShaderFilename,
 												VkExtent2D shadowMapExtent, VkPipelineLayout pipelineLayout,
-												VkRenderPass renderPass, VkPipeline *graphicsPipeline);
+												VkRenderPass renderPass, VkPipeline *graphicsPipeline,
+												const VkSpecializationInfo *pSpecializationInfo = nullptr,
+												VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+	VkResult vhPipeCreateGraphicsOffscreenPipeline(	VkDevice device, std::vector<std::string> shaderFileNames,
+													VkPipelineLayout pipelineLayout, VkRenderPass renderPass,
+													uint32_t numColorAttachments, VkPipeline *graphicsPipeline);
+	VkResult vhPipeCreatePipelineCache(	VkPhysicalDevice physicalDevice, VkDevice device, std::string filename,
+										VkPipelineCache *pipelineCache);
+	VkResult vhPipeSavePipelineCache(VkDevice device, VkPipelineCache pipelineCache, std::string filename);
+	VkResult vhPipeCreateComputePipeline(	VkDevice device, std::string shaderFilename,
+											VkPipelineLayout pipelineLayout, VkPipeline *computePipeline);
 
 	//--------------------------------------------------------------------------------------------------------------------------------
 	//file
+
+	///A file mapped read only into memory, see vhFileMap()
+	struct vhMappedFile {
+		const char *	m_pData = nullptr;		///<Start of the file contents
+		size_t			m_size = 0;				///<Size of the file in bytes
+		void *			m_file = nullptr;		///<File handle (Windows only)
+		void *			m_mapping = nullptr;	///<File mapping handle (Windows only)
+	};
+
 	std::vector<char> vhFileRead(const std::string& filename);
+	bool	vhFileLoad(const std::string& filename, std::vector<char> &buffer);
+	void	vhFileSetReadFunction(std::function<bool(const std::string&, std::vector<char>&)> function);
+	bool	vhFileMap(const std::string& filename, vhMappedFile &file);
+	void	vhFileUnmap(vhMappedFile &file);
 
 	//--------------------------------------------------------------------------------------------------------------------------------
 	//command
@@ -281,6 +396,70 @@ namespace vh {
 	uint32_t vhMemFindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 	VkResult vhMemCreateVMAAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VmaAllocator &allocator);
 
+	//define VH_COUNT_ALLOCATIONS in the build to count heap allocations with a replaced global operator new
+
+	uint64_t vhMemGetNumAllocations();		//heap allocations of the calling thread so far, 0 if not counted
+
+	/**
+	*
+	* \brief Linear allocator for temporary data, e.g. data that lives only during one frame
+	*
+	* Allocating moves a pointer forward, and reset() frees everything at once. If a block is full, a new block is
+	* taken from the heap. reset() then replaces all blocks by one block large enough for everything, so after a few
+	* frames allocating from the arena does not touch the heap any more. Destructors are not called, so only
+	* trivially destructible types can be allocated. Not thread safe.
+	*
+	*/
+	class vhLinearArena {
+	protected:
+		std::vector<uint8_t*>	m_blocks;			///<All blocks, the last one is the current
+		std::vector<size_t>		m_blockSizes;		///<Size of each block
+		size_t					m_offset = 0;		///<Used bytes in the current block
+		size_t					m_used = 0;			///<Used bytes in all full blocks since the last reset
+		size_t					m_highWater = 0;	///<Max bytes used between two resets
+
+		void	addBlock(size_t size);				//take a new block from the heap
+
+	public:
+		vhLinearArena(size_t size = 0);
+		~vhLinearArena();
+		vhLinearArena(const vhLinearArena &) = delete;
+		vhLinearArena & operator=(const vhLinearArena &) = delete;
+
+		void *	allocate(size_t size, size_t alignment);	//allocate aligned memory
+		void	reset();									//free all allocations
+
+		/**
+		* \brief Allocate value initialized elements
+		* \param[in] count Number of elements
+		* \returns a span of the new elements
+		*/
+		template<typename T> vhSpan<T> allocate(size_t count) {
+			static_assert(std::is_trivially_destructible<T>::value, "vhLinearArena does not call destructors");
+			T *pData = (T*)allocate(count * sizeof(T), alignof(T));
+			for (size_t i = 0; i < count; i++) new (pData + i) T();
+			return vhSpan<T>(pData, count);
+		};
+
+		/**
+		* \brief Allocate copies of elements
+		* \param[in] pSrc The elements to copy
+		* \param[in] count Number of elements
+		* \returns a span of the copies
+		*/
+		template<typename T> vhSpan<T> allocateCopy(const T *pSrc, size_t count) {
+			static_assert(std::is_trivially_destructible<T>::value, "vhLinearArena does not call destructors");
+			T *pData = (T*)allocate(count * sizeof(T), alignof(T));
+			for (size_t i = 0; i < count; i++) new (pData + i) T(pSrc[i]);
+			return vhSpan<T>(pData, count);
+		};
+
+		///\returns the bytes that can be allocated without touching the heap
+		size_t	getCapacity() { return m_blockSizes.empty() ? 0 : m_blockSizes.back(); };
+		///\returns the max bytes used between two resets
+		size_t	getHighWater() { return m_highWater; };
+	};
+
 	//--------------------------------------------------------------------------------------------------------------------------------
 	//debug
 	VKAPI_ATTR VkBool32 VKAPI_CALL vhDebugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location, int32_t code, const char* layerPrefix, const char* msg, void* userData);
@@ -288,6 +467,153 @@ namespace vh {
 	void vhDebugDestroyReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT callback, const VkAllocationCallbacks* pAllocator);
 	void vhSetupDebugCallback(VkInstance instance, VkDebugReportCallbackEXT *callback);
 
+	//--------------------------------------------------------------------------------------------------------------------------------
+	//log
+
+	///Severity of a log message
+	enum vhLogLevel {
+		VH_LOG_LEVEL_DEBUG = 0,			///<Detailed output for developers
+		VH_LOG_LEVEL_INFO = 1,			///<Normal progress messages
+		VH_LOG_LEVEL_WARNING = 2,		///<Something unexpected that can be handled
+		VH_LOG_LEVEL_ERROR = 3,			///<An operation failed
+		VH_LOG_LEVEL_NONE = 4			///<Nothing is logged, also marks padding in the log buffers
+	};
+
+	//messages below this level are removed at compile time
+	#ifndef VH_LOG_LEVEL
+	#ifdef NDEBUG
+	#define VH_LOG_LEVEL vh::VH_LOG_LEVEL_INFO
+	#else
+	#define VH_LOG_LEVEL vh::VH_LOG_LEVEL_DEBUG
+	#endif
+	#endif
+
+	//use these macros to log a message, the arguments are as for printf
+	#define VHLOG(level, ...) { \
+		if ((level) >= VH_LOG_LEVEL) { \
+			vh::vhLog(level, __VA_ARGS__); \
+		} \
+	}
+	#define VHLOGDEBUG(...) VHLOG(vh::VH_LOG_LEVEL_DEBUG, __VA_ARGS__)
+	#define VHLOGINFO(...) VHLOG(vh::VH_LOG_LEVEL_INFO, __VA_ARGS__)
+	#define VHLOGWARNING(...) VHLOG(vh::VH_LOG_LEVEL_WARNING, __VA_ARGS__)
+	#define VHLOGERROR(...) VHLOG(vh::VH_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+	typedef void(*vhLogFormatFunction)(const char *format, const uint8_t *pArgs, std::string &out);	///<Formats the arguments of a record
+
+	///A log message in the buffer of a thread, the packed arguments follow it
+	struct vhLogRecord {
+		uint32_t			m_size;				///<Size of the record including the arguments, a multiple of 8
+		uint32_t			m_level;			///<The vhLogLevel
+		uint64_t			m_time;				///<Steady clock time in ns
+		const char *		m_format;			///<printf format string, must be a literal
+		vhLogFormatFunction	m_formatFunction;	///<Unpacks the arguments and formats the message
+	};
+
+	///Packs an argument into a record. Numbers, enums and pointers are copied, strings are copied with their length.
+	template<typename T> struct vhLogArg {
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, "Log arguments must be numbers, pointers or strings");
+		typedef T type;		///<Type passed to snprintf
+
+		///\returns the packed size
+		static size_t size(const T &) { return sizeof(T); };
+		///Pack the value
+		static void write(uint8_t *&p, const T &value) { memcpy(p, &value, sizeof(T)); p += sizeof(T); };
+		///\returns the unpacked value
+		static T read(const uint8_t *&p) { T value; memcpy(&value, p, sizeof(T)); p += sizeof(T); return value; };
+	};
+
+	///Packs a C string
+	template<> struct vhLogArg<const char*> {
+		typedef const char* type;	///<Type passed to snprintf
+
+		///\returns the packed size
+		static size_t size(const char *value) { return sizeof(uint32_t) + (value != nullptr ? strlen(value) : 6) + 1; };
+		///Pack the string
+		static void write(uint8_t *&p, const char *value) {
+			if (value == nullptr) value = "(null)";
+			uint32_t length = (uint32_t)strlen(value);
+			memcpy(p, &length, sizeof(length));
+			memcpy(p + sizeof(length), value, length + 1);
+			p += sizeof(length) + length + 1;
+		};
+		///\returns the unpacked string, it points into the record
+		static const char * read(const uint8_t *&p) {
+			uint32_t length;
+			memcpy(&length, p, sizeof(length));
+			const char *value = (const char*)p + sizeof(length);
+			p += sizeof(length) + length + 1;
+			return value;
+		};
+	};
+
+	///Packs a C string
+	template<> struct vhLogArg<char*> : public vhLogArg<const char*> {};
+
+	///Packs a std::string
+	template<> struct vhLogArg<std::string> : public vhLogArg<const char*> {
+		///\returns the packed size
+		static size_t size(const std::string &value) { return sizeof(uint32_t) + value.size() + 1; };
+		///Pack the string
+		static void write(uint8_t *&p, const std::string &value) { vhLogArg<const char*>::write(p, value.c_str()); };
+	};
+
+	///Unpack the arguments of a record into a tuple, then format the message
+	template<typename... Args, size_t... I>
+	void vhLogFormatTuple(const char *format, const std::tuple<Args...> &values, std::string &out, std::index_sequence<I...>) {
+		int length = snprintf(nullptr, 0, format, std::get<I>(values)...);
+		if (length <= 0) return;
+		size_t start = out.size();
+		out.resize(start + length + 1);
+		snprintf(&out[start], length + 1, format, std::get<I>(values)...);
+		out.resize(start + length);
+	}
+
+	///Format the message of a record, called by the flusher thread
+	template<typename... Args>
+	void vhLogFormat(const char *format, const uint8_t *pArgs, std::string &out) {
+		std::tuple<typename vhLogArg<Args>::type...> values{ vhLogArg<Args>::read(pArgs)... };	//braces unpack in order
+		(void)pArgs;																			//unused without arguments
+		vhLogFormatTuple(format, values, out, std::index_sequence_for<Args...>());
+	}
+
+	vhLogRecord * vhLogBegin(size_t size, vhLogLevel level);
+	void	vhLogEnd(vhLogRecord *pRecord);
+	void	vhLogInit(std::string filename = "", vhLogLevel consoleLevel = VH_LOG_LEVEL_DEBUG);
+	void	vhLogFlush();
+	void	vhLogClose();
+	uint64_t vhLogGetNumDropped();
+
+	/**
+	*
+	* \brief Log a message
+	*
+	* The arguments are packed into the buffer of the calling thread without formatting. The flusher thread
+	* formats them later. If the buffer is full the message is dropped.
+	*
+	* \param[in] level Severity of the message
+	* \param[in] format printf format string, must be a literal since it is used after the call returns
+	* \param[in] args Arguments for the format string
+	*
+	*/
+	template<typename... Args>
+	void vhLog(vhLogLevel level, const char *format, const Args&... args) {
+		size_t sizes[] = { sizeof(vhLogRecord), vhLogArg<typename std::decay<const Args>::type>::size(args)... };
+		size_t size = 0;
+		for (auto s : sizes) size += s;
+
+		vhLogRecord *pRecord = vhLogBegin(size, level);
+		if (pRecord == nullptr) return;
+		pRecord->m_format = format;
+		pRecord->m_formatFunction = &vhLogFormat<typename std::decay<const Args>::type...>;
+
+		uint8_t *p = (uint8_t*)(pRecord + 1);
+		int order[] = { 0, (vhLogArg<typename std::decay<const Args>::type>::write(p, args), 0)... };	//braces pack in order
+		(void)order;
+		(void)p;
+		vhLogEnd(pRecord);
+	}
+
 }
 
 
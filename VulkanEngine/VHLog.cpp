@@ -0,0 +1,303 @@
+/**
+* The Vienna Vulkan Engine
+*
+* (c) bei Helmut Hlavacs, University of Vienna
+*
+*/
+
+#include "VHHelper.h"
+
+const uint32_t VH_LOG_BUFFER_SIZE = 1 << 18;		///<Size of the log buffer of each thread, a power of 2
+const uint32_t VH_LOG_FLUSH_INTERVAL = 10;			///<The flusher thread wakes up at least every this many ms
+
+
+namespace vh {
+
+	///Log buffer of one thread, a ring written by the thread and read by the flusher
+	struct vhLogBuffer {
+		std::vector<uint8_t>	m_data;					///<The ring
+		std::atomic<uint64_t>	m_head;					///<Bytes ever written, only the owning thread writes it
+		std::atomic<uint64_t>	m_tail;					///<Bytes ever read, only the flusher writes it
+		std::atomic<bool>		m_alive;				///<False once the thread has ended
+		uint32_t				m_threadIndex = 0;		///<Number of the thread, in order of the first message
+
+		///Constructor
+		vhLogBuffer() : m_data(VH_LOG_BUFFER_SIZE), m_head(0), m_tail(0), m_alive(true) {};
+	};
+
+	///A formatted message, collected from all buffers and sorted by time before it is written
+	struct vhLogMessage {
+		uint64_t		m_time;						///<Steady clock time in ns
+		uint32_t		m_level;					///<The vhLogLevel
+		uint32_t		m_threadIndex;				///<Number of the thread
+		size_t			m_start;					///<Start of the text in the text buffer
+		size_t			m_length;					///<Length of the text
+	};
+
+	///State of the log, shared by all threads
+	struct vhLogState {
+		std::mutex				m_mutex;					///<Guards the buffer list, sinks and draining
+		std::vector<std::shared_ptr<vhLogBuffer>> m_buffers;	///<Buffers of all threads
+		uint32_t				m_numThreads = 0;			///<Threads that have logged so far
+		std::atomic<uint64_t>	m_numDropped;				///<Messages dropped since a buffer was full
+		std::thread				m_thread;					///<The flusher thread
+		std::condition_variable	m_wakeup;					///<Wakes up the flusher early
+		bool					m_running = false;			///<The flusher thread is running
+		FILE *					m_file = nullptr;			///<The file sink
+		vhLogLevel				m_consoleLevel = VH_LOG_LEVEL_DEBUG;	///<Lowest level written to the console
+		uint64_t				m_startTime;				///<Time of the first use, message times are relative to it
+		std::vector<vhLogMessage> m_messages;				///<Messages of the current drain
+		std::string				m_text;						///<Texts of the current drain
+		std::string				m_lines;					///<Output of the current drain
+
+		///Constructor
+		vhLogState() : m_numDropped(0) {
+			m_startTime = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		};
+		///Destructor, stops the flusher thread if vhLogClose() was not called
+		~vhLogState() {
+			if (m_thread.joinable()) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_running = false;
+				}
+				m_wakeup.notify_one();
+				m_thread.join();
+			}
+			if (m_file != nullptr) fclose(m_file);
+		};
+	};
+
+	///\returns the state of the log, created on first use
+	static vhLogState & vhLogGetState() {
+		static vhLogState state;
+		return state;
+	}
+
+	///Owns the buffer of a thread, marks it dead when the thread ends so the flusher can remove it once it is empty
+	struct vhLogThreadBuffer {
+		std::shared_ptr<vhLogBuffer> m_pBuffer;		///<The buffer
+
+		///Constructor, registers a new buffer
+		vhLogThreadBuffer() : m_pBuffer(std::make_shared<vhLogBuffer>()) {
+			vhLogState &state = vhLogGetState();
+			std::lock_guard<std::mutex> lock(state.m_mutex);
+			m_pBuffer->m_threadIndex = state.m_numThreads++;
+			state.m_buffers.push_back(m_pBuffer);
+		};
+		///Destructor
+		~vhLogThreadBuffer() { m_pBuffer->m_alive = false; };
+	};
+
+	static thread_local vhLogThreadBuffer t_logBuffer;	///<Buffer of the calling thread
+
+
+	/**
+	*
+	* \brief Reserve a record in the buffer of the calling thread
+	*
+	* Records are contiguous. If a record does not fit before the end of the ring, the rest of the ring is skipped.
+	* Nothing is locked, if the ring is full the message is dropped.
+	*
+	* \param[in] size Size of the record including the packed arguments
+	* \param[in] level Severity of the message
+	* \returns the record, or nullptr if it does not fit
+	*
+	*/
+	vhLogRecord * vhLogBegin(size_t size, vhLogLevel level) {
+		vhLogBuffer &buffer = *t_logBuffer.m_pBuffer;
+		size = (size + 7) & ~(size_t)7;
+		if (size > VH_LOG_BUFFER_SIZE / 4) {
+			vhLogGetState().m_numDropped++;
+			return nullptr;
+		}
+
+		uint64_t head = buffer.m_head.load(std::memory_order_relaxed);
+		uint64_t tail = buffer.m_tail.load(std::memory_order_acquire);
+		size_t pos = (size_t)(head & (VH_LOG_BUFFER_SIZE - 1));
+		size_t rest = VH_LOG_BUFFER_SIZE - pos;
+		size_t skip = rest < size ? rest : 0;
+		if (head + skip + size - tail > VH_LOG_BUFFER_SIZE) {
+			vhLogGetState().m_numDropped++;
+			return nullptr;
+		}
+
+		if (skip >= sizeof(vhLogRecord)) {								//mark the skipped bytes as padding
+			vhLogRecord *pPadding = (vhLogRecord*)&buffer.m_data[pos];
+			pPadding->m_size = (uint32_t)skip;
+			pPadding->m_level = VH_LOG_LEVEL_NONE;
+		}
+		if (skip > 0) {
+			head += skip;
+			pos = 0;
+			buffer.m_head.store(head, std::memory_order_release);
+		}
+
+		vhLogRecord *pRecord = (vhLogRecord*)&buffer.m_data[pos];
+		pRecord->m_size = (uint32_t)size;
+		pRecord->m_level = level;
+		pRecord->m_time = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		return pRecord;
+	}
+
+
+	/**
+	*
+	* \brief Publish a record written after vhLogBegin()
+	*
+	* Errors wake up the flusher thread, so they are written right away.
+	*
+	* \param[in] pRecord The record
+	*
+	*/
+	void vhLogEnd(vhLogRecord *pRecord) {
+		vhLogBuffer &buffer = *t_logBuffer.m_pBuffer;
+		buffer.m_head.store(buffer.m_head.load(std::memory_order_relaxed) + pRecord->m_size, std::memory_order_release);
+		if (pRecord->m_level >= VH_LOG_LEVEL_ERROR) vhLogGetState().m_wakeup.notify_one();
+	}
+
+
+	/**
+	*
+	* \brief Read all buffers, format the messages and write them to the sinks
+	*
+	* Must be called with the log mutex locked. Buffers of ended threads are removed once they are empty.
+	*
+	* \param[in] state The log state
+	*
+	*/
+	static void vhLogDrain(vhLogState &state) {
+		state.m_messages.clear();
+		state.m_text.clear();
+
+		for (uint32_t i = 0; i < state.m_buffers.size(); ) {
+			vhLogBuffer &buffer = *state.m_buffers[i];
+			bool alive = buffer.m_alive.load(std::memory_order_acquire);
+			uint64_t tail = buffer.m_tail.load(std::memory_order_relaxed);
+			uint64_t head = buffer.m_head.load(std::memory_order_acquire);
+
+			while (tail < head) {
+				size_t pos = (size_t)(tail & (VH_LOG_BUFFER_SIZE - 1));
+				size_t rest = VH_LOG_BUFFER_SIZE - pos;
+				if (rest < sizeof(vhLogRecord)) {						//too small for a padding record
+					tail += rest;
+					continue;
+				}
+				const vhLogRecord *pRecord = (const vhLogRecord*)&buffer.m_data[pos];
+				if (pRecord->m_level != VH_LOG_LEVEL_NONE) {
+					vhLogMessage message = { pRecord->m_time, pRecord->m_level, buffer.m_threadIndex, state.m_text.size(), 0 };
+					pRecord->m_formatFunction(pRecord->m_format, (const uint8_t*)(pRecord + 1), state.m_text);
+					message.m_length = state.m_text.size() - message.m_start;
+					state.m_messages.push_back(message);
+				}
+				tail += pRecord->m_size;
+			}
+			buffer.m_tail.store(tail, std::memory_order_release);
+
+			if (!alive) state.m_buffers.erase(state.m_buffers.begin() + i);	//the thread wrote everything before it ended
+			else i++;
+		}
+		if (state.m_messages.empty()) return;
+
+		std::stable_sort(state.m_messages.begin(), state.m_messages.end(),
+			[](const vhLogMessage &a, const vhLogMessage &b) { return a.m_time < b.m_time; });
+
+		static const char *levelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+		char prefix[64];
+		bool console = false;
+		state.m_lines.clear();
+		for (auto &message : state.m_messages) {
+			int length = snprintf(prefix, sizeof(prefix), "[%10.3f] [%u] %s: ", (message.m_time - state.m_startTime) / 1.0e6,
+								message.m_threadIndex, levelNames[std::min(message.m_level, 3u)]);
+			size_t start = state.m_lines.size();
+			state.m_lines.append(prefix, std::max(length, 0));
+			state.m_lines.append(state.m_text, message.m_start, message.m_length);
+			state.m_lines.push_back('\n');
+
+			if (state.m_file != nullptr) fwrite(&state.m_lines[start], 1, state.m_lines.size() - start, state.m_file);
+			if (message.m_level >= (uint32_t)state.m_consoleLevel) {
+				fwrite(&state.m_lines[start], 1, state.m_lines.size() - start, stdout);
+				console = true;
+			}
+		}
+		if (console) fflush(stdout);
+		if (state.m_file != nullptr) fflush(state.m_file);
+	}
+
+
+	/**
+	*
+	* \brief Start the flusher thread and open the file sink
+	*
+	* Messages logged before are kept in the buffers and written once the thread runs. Calling it again
+	* while the log is running does nothing.
+	*
+	* \param[in] filename Name of the log file, empty for console output only
+	* \param[in] consoleLevel Lowest level written to the console, VH_LOG_LEVEL_NONE for file output only
+	*
+	*/
+	void vhLogInit(std::string filename, vhLogLevel consoleLevel) {
+		vhLogState &state = vhLogGetState();
+		std::lock_guard<std::mutex> lock(state.m_mutex);
+		if (state.m_running) return;
+
+		if (!filename.empty()) state.m_file = fopen(filename.c_str(), "w");
+		state.m_consoleLevel = consoleLevel;
+		state.m_running = true;
+		state.m_thread = std::thread([&state]() {
+			std::unique_lock<std::mutex> lock(state.m_mutex);
+			while (state.m_running) {
+				vhLogDrain(state);
+				state.m_wakeup.wait_for(lock, std::chrono::milliseconds(VH_LOG_FLUSH_INTERVAL));
+			}
+			vhLogDrain(state);
+		});
+	}
+
+
+	/**
+	*
+	* \brief Write all messages logged so far, e.g. before showing an error and waiting for input
+	*
+	* Works with and without the flusher thread.
+	*
+	*/
+	void vhLogFlush() {
+		vhLogState &state = vhLogGetState();
+		std::lock_guard<std::mutex> lock(state.m_mutex);
+		vhLogDrain(state);
+	}
+
+
+	/**
+	*
+	* \brief Stop the flusher thread, write all remaining messages and close the file sink
+	*
+	*/
+	void vhLogClose() {
+		vhLogState &state = vhLogGetState();
+		{
+			std::lock_guard<std::mutex> lock(state.m_mutex);
+			if (!state.m_running) return;
+			state.m_running = false;
+		}
+		state.m_wakeup.notify_one();
+		state.m_thread.join();
+
+		std::lock_guard<std::mutex> lock(state.m_mutex);
+		if (state.m_file != nullptr) fclose(state.m_file);
+		state.m_file = nullptr;
+	}
+
+
+	/**
+	*
+	* \returns the number of messages dropped because a buffer was full
+	*
+	*/
+	uint64_t vhLogGetNumDropped() {
+		return vhLogGetState().m_numDropped.load();
+	}
+
+}
+
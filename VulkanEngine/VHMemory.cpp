@@ -7,8 +7,161 @@
 
 #include "VHHelper.h"
 
+
+#ifdef VH_COUNT_ALLOCATIONS
+
+static thread_local uint64_t g_vhNumAllocations = 0;	///<Heap allocations of this thread
+
+//replace the global allocation functions, so heap allocations of each thread can be counted
+
+void * operator new(size_t size) {
+	g_vhNumAllocations++;
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+	g_vhNumAllocations++;
+	return malloc(size > 0 ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	free(p);
+}
+
+#endif
+
+
 namespace vh {
 
+	/**
+	*
+	* \returns the number of heap allocations the calling thread has made so far, or 0 if VH_COUNT_ALLOCATIONS is
+	* not defined. Take the difference of two calls to count the allocations of some code.
+	*
+	*/
+	uint64_t vhMemGetNumAllocations() {
+	#ifdef VH_COUNT_ALLOCATIONS
+		return g_vhNumAllocations;
+	#else
+		return 0;
+	#endif
+	}
+
+
+	/**
+	*
+	* \brief Constructor of the arena
+	*
+	* \param[in] size Size of the first block, 0 for taking the first block when it is needed
+	*
+	*/
+	vhLinearArena::vhLinearArena(size_t size) {
+		if (size > 0) addBlock(size);
+	}
+
+	/**
+	* \brief Destructor, frees all blocks
+	*/
+	vhLinearArena::~vhLinearArena() {
+		for (auto pBlock : m_blocks) delete[] pBlock;
+	}
+
+	/**
+	*
+	* \brief Take a new block from the heap and make it the current block
+	*
+	* \param[in] size Size of the block
+	*
+	*/
+	void vhLinearArena::addBlock(size_t size) {
+		m_used += m_offset;
+		m_offset = 0;
+		m_blocks.push_back(new uint8_t[size]);
+		m_blockSizes.push_back(size);
+	}
+
+	/**
+	*
+	* \brief Allocate memory that is valid until the next reset()
+	*
+	* \param[in] size Number of bytes
+	* \param[in] alignment Alignment of the memory, a power of 2
+	* \returns a pointer to the memory
+	*
+	*/
+	void * vhLinearArena::allocate(size_t size, size_t alignment) {
+		if (size == 0) size = 1;
+		auto alignedOffset = [&]() {
+			size_t address = (size_t)m_blocks.back() + m_offset;
+			return m_offset + (((address + alignment - 1) & ~(alignment - 1)) - address);
+		};
+
+		size_t offset = m_blocks.empty() ? 0 : alignedOffset();
+		if (m_blocks.empty() || offset + size > m_blockSizes.back()) {		//does not fit, next block is twice as large
+			size_t blockSize = m_blockSizes.empty() ? 4096 : 2 * m_blockSizes.back();
+			addBlock(std::max(blockSize, size + alignment));
+			offset = alignedOffset();
+		}
+
+		uint8_t *pBlock = m_blocks.back();
+		m_offset = offset + size;
+		m_highWater = std::max(m_highWater, m_used + m_offset);
+		return pBlock + offset;
+	}
+
+	/**
+	*
+	* \brief Free all allocations
+	*
+	* If more than one block was used, all blocks are replaced by one block holding the high water mark, so the
+	* next time everything fits into one block.
+	*
+	*/
+	void vhLinearArena::reset() {
+		if (m_blocks.size() > 1) {
+			size_t size = m_blockSizes.back();
+			while (size < m_highWater) size *= 2;
+			for (auto pBlock : m_blocks) delete[] pBlock;
+			m_blocks.clear();
+			m_blockSizes.clear();
+			m_used = 0;
+			m_offset = 0;
+			addBlock(size);
+		}
+		m_used = 0;
+		m_offset = 0;
+	}
+
 	//-------------------------------------------------------------------------------------------------------
 	//
 
@@ -76,6 +229,7 @@ namespace vh {
 		return vmaCreateAllocator(&allocatorInfo, &allocator);
 	}
 
+
 }
 
 
@@ -157,6 +157,81 @@ namespace vh {
 	}
 
 
+	/**
+	*
+	* \brief Create a render pass for rendering into offscreen images, e.g. for baking
+	*
+	* All attachments are cleared. The color attachments end in shader read layout, so they can be sampled
+	* afterwards, the depth attachment is not stored.
+	*
+	* \param[in] device The logical Vulkan device
+	* \param[in] colorFormats The formats of the color attachments
+	* \param[in] depthFormat The depth attachment format
+	* \param[out] renderPass The new render pass
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhRenderCreateRenderPassOffscreen(VkDevice device, std::vector<VkFormat> colorFormats, VkFormat depthFormat, VkRenderPass *renderPass) {
+
+		std::vector<VkAttachmentDescription> attachments(colorFormats.size() + 1);
+		std::vector<VkAttachmentReference> colorReferences(colorFormats.size());
+		for (uint32_t i = 0; i < colorFormats.size(); i++) {
+			attachments[i] = {};
+			attachments[i].format = colorFormats[i];
+			attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			colorReferences[i].attachment = i;
+			colorReferences[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		}
+
+		VkAttachmentDescription &depthAttachment = attachments.back();
+		depthAttachment = {};
+		depthAttachment.format = depthFormat;
+		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference depthReference = {};
+		depthReference.attachment = (uint32_t)colorFormats.size();
+		depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = (uint32_t)colorReferences.size();
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		VkSubpassDependency dependency = {};
+		dependency.srcSubpass = 0;
+		dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 1;
+		renderPassInfo.pDependencies = &dependency;
+
+		return vkCreateRenderPass(device, &renderPassInfo, nullptr, renderPass);
+	}
+
+
 	/**
 	*
 	* \brief Create a descriptor layout
@@ -342,12 +417,9 @@ namespace vh {
 								 VkFramebuffer frameBuffer, 
 								 VkExtent2D extent) {
 
-		std::vector<VkClearValue> clearValues = {};
-		VkClearValue cv1, cv2;
-		cv1.color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues.push_back(cv1);
-		cv2.depthStencil = { 1.0f, 0 };
-		clearValues.push_back(cv2);
+		VkClearValue clearValues[2];
+		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+		clearValues[1].depthStencil = { 1.0f, 0 };
 
 		return vhRenderBeginRenderPass(commandBuffer, renderPass, frameBuffer, clearValues, extent);
 	}
@@ -369,7 +441,7 @@ namespace vh {
 	VkResult vhRenderBeginRenderPass(	VkCommandBuffer commandBuffer,
 									VkRenderPass renderPass,
 									VkFramebuffer frameBuffer,
-									std::vector<VkClearValue> &clearValues,
+									vhSpan<const VkClearValue> clearValues,
 									VkExtent2D extent) {
 
 		VkRenderPassBeginInfo renderPassInfo = {};
@@ -485,6 +557,8 @@ namespace vh {
 	* \param[in] renderPass Renderpass to be used
 	* \param[in] dynamicStates List of dynamic states that can be changed during usage of the pipeline
 	* \param[out] graphicsPipeline The new PSO
+	* \param[in] pSpecializationInfo Specialization constants for all shader stages, or nullptr
+	* \param[in] pipelineCache Pipeline cache to use, or VK_NULL_HANDLE
 	* \returns VK_SUCCESS or a Vulkan error code
 	*
 	*/
@@ -494,7 +568,9 @@ namespace vh {
 											VkPipelineLayout pipelineLayout,
 											VkRenderPass renderPass,
 											std::vector<VkDynamicState> dynamicStates,
-											VkPipeline *graphicsPipeline) {
+											VkPipeline *graphicsPipeline,
+											const VkSpecializationInfo *pSpecializationInfo,
+											VkPipelineCache pipelineCache) {
 
 		std::vector<VkPipelineShaderStageCreateInfo> shaderStages; 
 
@@ -507,6 +583,7 @@ namespace vh {
 		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 		vertShaderStageInfo.module = vertShaderModule;
 		vertShaderStageInfo.pName = "main";
+		vertShaderStageInfo.pSpecializationInfo = pSpecializationInfo;
 
 		shaderStages.push_back(vertShaderStageInfo);
 
@@ -521,6 +598,7 @@ namespace vh {
 			fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 			fragShaderStageInfo.module = fragShaderModule;
 			fragShaderStageInfo.pName = "main";
+			fragShaderStageInfo.pSpecializationInfo = pSpecializationInfo;
 
 			shaderStages.push_back(fragShaderStageInfo);
 		}
@@ -528,12 +606,12 @@ namespace vh {
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-		auto bindingDescription = vhVertex::getBindingDescription();
+		auto bindingDescriptions = vhVertex::getBindingDescriptions();
 		auto attributeDescriptions = vhVertex::getAttributeDescriptions();
 
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -627,7 +705,7 @@ namespace vh {
 		pipelineInfo.subpass = 0;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		VHCHECKRESULT( vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, graphicsPipeline) );
+		VHCHECKRESULT( vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, graphicsPipeline) );
 
 		if(fragShaderModule != VK_NULL_HANDLE )
 			vkDestroyShaderModule(device, fragShaderModule, nullptr);
@@ -649,6 +727,8 @@ namespace vh {
 	* \param[in] pipelineLayout Pipeline layout
 	* \param[in] renderPass Renderpass to be used
 	* \param[out] graphicsPipeline The new PSO
+	* \param[in] pSpecializationInfo Specialization constants for the vertex shader, or nullptr
+	* \param[in] pipelineCache Pipeline cache to use, or VK_NULL_HANDLE
 	* \returns VK_SUCCESS or a Vulkan error code
 	*
 	*/
@@ -657,7 +737,9 @@ namespace vh {
 												VkExtent2D shadowMapExtent,
 												VkPipelineLayout pipelineLayout,
 												VkRenderPass renderPass,
-												VkPipeline *graphicsPipeline) {
+												VkPipeline *graphicsPipeline,
+												const VkSpecializationInfo *pSpecializationInfo,
+												VkPipelineCache pipelineCache) {
 
 		auto vertShaderCode = vhFileRead(verShaderFilename);
 
@@ -668,19 +750,20 @@ namespace vh {
 		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 		vertShaderStageInfo.module = vertShaderModule;
 		vertShaderStageInfo.pName = "main";
+		vertShaderStageInfo.pSpecializationInfo = pSpecializationInfo;
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo };
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-		auto bindingDescription = vhVertex::getBindingDescription();
-		auto attributeDescriptions = vhVertex::getAttributeDescriptions();
+		auto bindingDescription = vhVertex::getPositionBindingDescription();		//shadow maps need only positions
+		auto attributeDescription = vhVertex::getPositionAttributeDescription();
 
 		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+		vertexInputInfo.vertexAttributeDescriptionCount = 1;
 		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+		vertexInputInfo.pVertexAttributeDescriptions = &attributeDescription;
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -760,13 +843,241 @@ namespace vh {
 		pipelineInfo.subpass = 0;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		VHCHECKRESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, graphicsPipeline ) );
+		VHCHECKRESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, graphicsPipeline ) );
 
 		vkDestroyShaderModule(device, vertShaderModule, nullptr);
 		return VK_SUCCESS;
 	}
 
 
-}
+	/**
+	*
+	* \brief Create a pipeline state object (PSO) for rendering into offscreen images
+	*
+	* Like vhPipeCreateGraphicsPipeline(), but without blending, so all channels including alpha are written
+	* to all color attachments. Viewport and scissor are dynamic, so one pipeline can draw into several regions
+	* of an atlas.
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] shaderFileNames Names of the vertex and fragment shader files
+	* \param[in] pipelineLayout Pipeline layout
+	* \param[in] renderPass Renderpass to be used, see vhRenderCreateRenderPassOffscreen()
+	* \param[in] numColorAttachments Number of color attachments of the render pass
+	* \param[out] graphicsPipeline The new PSO
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhPipeCreateGraphicsOffscreenPipeline(	VkDevice device,
+													std::vector<std::string> shaderFileNames,
+													VkPipelineLayout pipelineLayout,
+													VkRenderPass renderPass,
+													uint32_t numColorAttachments,
+													VkPipeline *graphicsPipeline) {
+
+		auto vertShaderCode = vhFileRead(shaderFileNames[0]);
+		auto fragShaderCode = vhFileRead(shaderFileNames[1]);
+		VkShaderModule vertShaderModule = vhPipeCreateShaderModule(device, vertShaderCode);
+		VkShaderModule fragShaderModule = vhPipeCreateShaderModule(device, fragShaderCode);
+
+		VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStages[0].module = vertShaderModule;
+		shaderStages[0].pName = "main";
+		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].pName = "main";
+
+		auto bindingDescriptions = vhVertex::getBindingDescriptions();
+		auto attributeDescriptions = vhVertex::getAttributeDescriptions();
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+		VkPipelineViewportStateCreateInfo viewportState = {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer = {};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.depthClampEnable = VK_FALSE;
+		rasterizer.rasterizerDiscardEnable = VK_FALSE;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.lineWidth = 1.0f;
+		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizer.depthBiasEnable = VK_FALSE;
+
+		VkPipelineMultisampleStateCreateInfo multisampling = {};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.sampleShadingEnable = VK_FALSE;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.depthTestEnable = VK_TRUE;
+		depthStencil.depthWriteEnable = VK_TRUE;
+		depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		depthStencil.depthBoundsTestEnable = VK_FALSE;
+		depthStencil.stencilTestEnable = VK_FALSE;
+
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(numColorAttachments);
+		for (auto &attachment : colorBlendAttachments) {
+			attachment = {};
+			attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			attachment.blendEnable = VK_FALSE;
+		}
+
+		VkPipelineColorBlendStateCreateInfo colorBlending = {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.attachmentCount = numColorAttachments;
+		colorBlending.pAttachments = colorBlendAttachments.data();
+
+		VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState = {};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = 2;
+		dynamicState.pDynamicStates = dynamicStates;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.subpass = 0;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, graphicsPipeline);
+
+		vkDestroyShaderModule(device, fragShaderModule, nullptr);
+		vkDestroyShaderModule(device, vertShaderModule, nullptr);
+		return result;
+	}
 
 
+	/**
+	*
+	* \brief Create a compute pipeline
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] shaderFilename Name of the compute shader file
+	* \param[in] pipelineLayout Pipeline layout
+	* \param[out] computePipeline The new pipeline
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhPipeCreateComputePipeline(	VkDevice device,
+											std::string shaderFilename,
+											VkPipelineLayout pipelineLayout,
+											VkPipeline *computePipeline) {
+
+		auto compShaderCode = vhFileRead(shaderFilename);
+
+		VkShaderModule compShaderModule = vhPipeCreateShaderModule(device, compShaderCode);
+
+		VkPipelineShaderStageCreateInfo compShaderStageInfo = {};
+		compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		compShaderStageInfo.module = compShaderModule;
+		compShaderStageInfo.pName = "main";
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = compShaderStageInfo;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, computePipeline);
+
+		vkDestroyShaderModule(device, compShaderModule, nullptr);
+		return result;
+	}
+
+
+	/**
+	*
+	* \brief Create a pipeline cache, filled with the data of an earlier run if there is any
+	*
+	* The file is used only if its header matches the device, otherwise the cache starts empty.
+	*
+	* \param[in] physicalDevice Physical Vulkan device
+	* \param[in] device Logical Vulkan device
+	* \param[in] filename File written by vhPipeSavePipelineCache(), may be missing
+	* \param[out] pipelineCache The new pipeline cache
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhPipeCreatePipelineCache(	VkPhysicalDevice physicalDevice, VkDevice device, std::string filename,
+										VkPipelineCache *pipelineCache) {
+		std::vector<char> data;
+		if (vhFileLoad(filename, data)) {
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+			//header: length, version, vendor ID, device ID, cache UUID
+			uint32_t header[4];
+			if (data.size() < sizeof(header) + VK_UUID_SIZE) data.clear();
+			else {
+				memcpy(header, data.data(), sizeof(header));
+				if (header[0] < sizeof(header) + VK_UUID_SIZE || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+					header[2] != properties.vendorID || header[3] != properties.deviceID ||
+					memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+					data.clear();
+				}
+			}
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo = {};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = data.size();
+		cacheInfo.pInitialData = data.size() > 0 ? data.data() : nullptr;
+
+		return vkCreatePipelineCache(device, &cacheInfo, nullptr, pipelineCache);
+	}
+
+
+	/**
+	*
+	* \brief Write the contents of a pipeline cache to a file, so the next run can start with it
+	*
+	* \param[in] device Logical Vulkan device
+	* \param[in] pipelineCache The pipeline cache
+	* \param[in] filename Name of the file
+	* \returns VK_SUCCESS or a Vulkan error code
+	*
+	*/
+	VkResult vhPipeSavePipelineCache(VkDevice device, VkPipelineCache pipelineCache, std::string filename) {
+		size_t size = 0;
+		VHCHECKRESULT(vkGetPipelineCacheData(device, pipelineCache, &size, nullptr));
+
+		std::vector<char> data(size);
+		VHCHECKRESULT(vkGetPipelineCacheData(device, pipelineCache, &size, data.data()));
+
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return VK_ERROR_INITIALIZATION_FAILED;
+		file.write(data.data(), size);
+		return file.fail() ? VK_ERROR_INITIALIZATION_FAILED : VK_SUCCESS;
+	}
+
+}
@@ -190,7 +190,8 @@ int main() {
 	}
 	catch ( const std::runtime_error & err ) {
 		if (mve.getLoopCount() == 0) {							//engine was not initialized
-			std::cout << "Error: " << err.what() << std::endl;	//just output to console
+			VHLOGERROR("Error: %s", err.what());				//just output to console
+			vh::vhLogFlush();
 			char in = getchar();
 			return 1;
 		}